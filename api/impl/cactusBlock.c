@@ -19,9 +19,13 @@ int blockConstruct_constructP(const void *o1, const void *o2) {
 }
 
 Block *block_construct(int64_t length, Flower *flower) {
-	return block_construct2(cactusDisk_getUniqueID(flower_getCactusDisk(flower)), length,
-			end_construct3(cactusDisk_getUniqueID(flower_getCactusDisk(flower)), 0, 0, 1, flower),
-			end_construct3(cactusDisk_getUniqueID(flower_getCactusDisk(flower)), 0, 0, 0, flower), flower);
+	return block_construct3(cactusDisk_getUniqueIDInterval(flower_getCactusDisk(flower), 3), length, flower);
+}
+
+Block *block_construct3(Name name, int64_t length, Flower *flower) {
+	return block_construct2(name, length,
+			end_construct3(name + 1, 0, 0, 1, flower),
+			end_construct3(name + 2, 0, 0, 0, flower), flower);
 }
 
 Block *block_construct2(Name name, int64_t length,
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Least recently used caches.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+typedef struct _cactusCacheEntry CactusCacheEntry;
+
+struct _cactusCacheEntry {
+    void *key;
+    void *value;
+    int64_t size;
+    int64_t compressedSize;
+    CactusCacheEntry *previous; //More recently used
+    CactusCacheEntry *next; //Less recently used
+};
+
+struct _cactusCache {
+    char *name;
+    int64_t maxSize;
+    int64_t size;
+    int64_t compressedSize;
+    stHash *entries;
+    CactusCacheEntry *mostRecent;
+    CactusCacheEntry *leastRecent;
+    void (*destructFn)(void *key, void *value, void *extraArg);
+    void *extraArg;
+    //Counters
+    int64_t hits;
+    int64_t misses;
+    int64_t evictions;
+    int64_t evictedBytes;
+    int64_t compressedBytesHit;
+};
+
+static void cactusCache_unlink(CactusCache *cache, CactusCacheEntry *entry) {
+    if (entry->previous != NULL) {
+        entry->previous->next = entry->next;
+    } else {
+        cache->mostRecent = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->previous = entry->previous;
+    } else {
+        cache->leastRecent = entry->previous;
+    }
+    entry->previous = NULL;
+    entry->next = NULL;
+}
+
+static void cactusCache_linkAsMostRecent(CactusCache *cache, CactusCacheEntry *entry) {
+    entry->previous = NULL;
+    entry->next = cache->mostRecent;
+    if (cache->mostRecent != NULL) {
+        cache->mostRecent->previous = entry;
+    }
+    cache->mostRecent = entry;
+    if (cache->leastRecent == NULL) {
+        cache->leastRecent = entry;
+    }
+}
+
+static void cactusCache_removeEntry(CactusCache *cache, CactusCacheEntry *entry) {
+    cactusCache_unlink(cache, entry);
+    stHash_remove(cache->entries, entry->key);
+    cache->size -= entry->size;
+    cache->compressedSize -= entry->compressedSize;
+    assert(cache->size >= 0);
+    if (cache->destructFn != NULL) {
+        cache->destructFn(entry->key, entry->value, cache->extraArg);
+    }
+    free(entry);
+}
+
+static void cactusCache_evict(CactusCache *cache, CactusCacheEntry *entryToKeep) {
+    /*
+     * Evicts least recently used entries until the cache is within budget.
+     */
+    while (cache->size > cache->maxSize && cache->leastRecent != NULL && cache->leastRecent != entryToKeep) {
+        cache->evictions++;
+        cache->evictedBytes += cache->leastRecent->size;
+        cactusCache_removeEntry(cache, cache->leastRecent);
+    }
+}
+
+CactusCache *cactusCache_construct(const char *name, int64_t maxSize,
+        void (*destructFn)(void *key, void *value, void *extraArg), void *extraArg) {
+    assert(maxSize >= 0);
+    CactusCache *cache = st_calloc(1, sizeof(CactusCache));
+    cache->name = stString_copy(name);
+    cache->maxSize = maxSize;
+    cache->entries = stHash_construct();
+    cache->destructFn = destructFn;
+    cache->extraArg = extraArg;
+    return cache;
+}
+
+void cactusCache_destruct(CactusCache *cache) {
+    cactusCache_clear(cache);
+    stHash_destruct(cache->entries);
+    free(cache->name);
+    free(cache);
+}
+
+int64_t cactusCache_getMaxSize(CactusCache *cache) {
+    return cache->maxSize;
+}
+
+void cactusCache_setMaxSize(CactusCache *cache, int64_t maxSize) {
+    assert(maxSize >= 0);
+    cache->maxSize = maxSize;
+    cactusCache_evict(cache, NULL);
+}
+
+int64_t cactusCache_getSize(CactusCache *cache) {
+    return cache->size;
+}
+
+bool cactusCache_contains(CactusCache *cache, void *key) {
+    return stHash_search(cache->entries, key) != NULL;
+}
+
+void *cactusCache_get(CactusCache *cache, void *key, int64_t *size) {
+    CactusCacheEntry *entry = stHash_search(cache->entries, key);
+    if (entry == NULL) {
+        cache->misses++;
+        return NULL;
+    }
+    cache->hits++;
+    cache->compressedBytesHit += entry->compressedSize;
+    if (cache->mostRecent != entry) {
+        cactusCache_unlink(cache, entry);
+        cactusCache_linkAsMostRecent(cache, entry);
+    }
+    if (size != NULL) {
+        *size = entry->size;
+    }
+    return entry->value;
+}
+
+void cactusCache_countMiss(CactusCache *cache) {
+    cache->misses++;
+}
+
+void cactusCache_set(CactusCache *cache, void *key, void *value, int64_t size, int64_t compressedSize) {
+    assert(size >= 0);
+    CactusCacheEntry *entry = stHash_search(cache->entries, key);
+    if (entry != NULL) {
+        cactusCache_removeEntry(cache, entry);
+    }
+    entry = st_malloc(sizeof(CactusCacheEntry));
+    entry->key = key;
+    entry->value = value;
+    entry->size = size;
+    entry->compressedSize = compressedSize;
+    stHash_insert(cache->entries, key, entry);
+    cactusCache_linkAsMostRecent(cache, entry);
+    cache->size += size;
+    cache->compressedSize += compressedSize;
+    cactusCache_evict(cache, entry);
+}
+
+void cactusCache_remove(CactusCache *cache, void *key) {
+    CactusCacheEntry *entry = stHash_search(cache->entries, key);
+    if (entry != NULL) {
+        cactusCache_removeEntry(cache, entry);
+    }
+}
+
+void cactusCache_clear(CactusCache *cache) {
+    while (cache->leastRecent != NULL) {
+        cactusCache_removeEntry(cache, cache->leastRecent);
+    }
+    assert(cache->size == 0);
+}
+
+void cactusCache_printStats(CactusCache *cache, FILE *fileHandle) {
+    int64_t lookups = cache->hits + cache->misses;
+    fprintf(fileHandle, "Cache %s: size %" PRIi64 " bytes (%" PRIi64 " stored/compressed bytes) of %" PRIi64
+            " bytes in %" PRIi64 " entries, hits %" PRIi64 ", misses %" PRIi64 ", hit rate %.3f, evictions %" PRIi64
+            " (%" PRIi64 " bytes), stored bytes served from cache %" PRIi64 "\n",
+            cache->name, cache->size, cache->compressedSize, cache->maxSize, stHash_size(cache->entries), cache->hits,
+            cache->misses, lookups > 0 ? ((double) cache->hits) / lookups : 0.0, cache->evictions, cache->evictedBytes,
+            cache->compressedBytesHit);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_CACHE_H_
+#define CACTUS_CACHE_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Least recently used caches with a byte budget, used by the cactus disk.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+typedef struct _cactusCache CactusCache;
+
+/*
+ * Constructs a cache holding at most maxSize bytes of values. Keys are compared by identity, so may
+ * be pointers or integers cast to pointers. Whenever a value leaves the cache, by eviction, removal or
+ * clearing, destructFn is called with its key, value and the given extraArg.
+ */
+CactusCache *cactusCache_construct(const char *name, int64_t maxSize,
+        void (*destructFn)(void *key, void *value, void *extraArg), void *extraArg);
+
+/*
+ * Destructs the cache, and everything in it.
+ */
+void cactusCache_destruct(CactusCache *cache);
+
+/*
+ * Gets the byte budget of the cache.
+ */
+int64_t cactusCache_getMaxSize(CactusCache *cache);
+
+/*
+ * Sets the byte budget of the cache, evicting least recently used values until it fits.
+ */
+void cactusCache_setMaxSize(CactusCache *cache, int64_t maxSize);
+
+/*
+ * Gets the number of bytes of values currently in the cache.
+ */
+int64_t cactusCache_getSize(CactusCache *cache);
+
+/*
+ * Returns non-zero if the key is in the cache. Does not change the recency of the key or the counters.
+ */
+bool cactusCache_contains(CactusCache *cache, void *key);
+
+/*
+ * Gets the value for the key, or NULL if not present, counting a hit or miss. A hit makes the key the
+ * most recently used. If size is not NULL it is set to the size of the value.
+ */
+void *cactusCache_get(CactusCache *cache, void *key, int64_t *size);
+
+/*
+ * Counts a miss for a lookup that was resolved without calling cactusCache_get.
+ */
+void cactusCache_countMiss(CactusCache *cache);
+
+/*
+ * Adds a value to the cache, which takes ownership of it, replacing any value for the same key. The size
+ * is the number of bytes the value uses in memory and is what is counted against the budget, compressedSize
+ * is the size of the value as stored in the database (or equal to size if not compressed), and is used
+ * to count the database traffic saved by hits. Least recently used values are evicted until the cache is within
+ * budget, though the new value is always kept.
+ */
+void cactusCache_set(CactusCache *cache, void *key, void *value, int64_t size, int64_t compressedSize);
+
+/*
+ * Removes a key from the cache, if present.
+ */
+void cactusCache_remove(CactusCache *cache, void *key);
+
+/*
+ * Removes everything from the cache.
+ */
+void cactusCache_clear(CactusCache *cache);
+
+/*
+ * Prints the size, hit, miss and eviction counters of the cache to the given file handle.
+ */
+void cactusCache_printStats(CactusCache *cache, FILE *fileHandle);
+
+#endif
@@ -12,55 +12,231 @@
 #include <unistd.h>
 #include <math.h>
 #include <time.h>
-#define CACTUS_DISK_NAME_INCREMENT 16384
 #define CACTUS_DISK_BUCKET_NUMBER 65536
 #define CACTUS_DISK_PARAMETER_KEY -100000
 #define CACTUS_DISK_SEQUENCE_CHUNK_SIZE 500
+#define CACTUS_DISK_PACKED_SEQUENCE_CHUNK_SIZE 8192
+#define CACTUS_DISK_CACHE_SIZE 10000000
+#define CACTUS_DISK_STRING_CACHE_SIZE 10000000
+
+/*
+ * The database connection may be shared with a prefetching thread (see cactusDiskPrefetch_fetch), so all
+ * access to it goes through this lock.
+ */
+
+static void cactusDisk_lockDatabase(CactusDisk *cactusDisk) {
+    pthread_mutex_lock(&cactusDisk->databaseLock);
+}
+
+static void cactusDisk_unlockDatabase(CactusDisk *cactusDisk) {
+    pthread_mutex_unlock(&cactusDisk->databaseLock);
+}
+
+/*
+ * The in memory state of the cactus disk (the loaded flowers and meta sequences, the caches, the pending
+ * updates) is guarded by a second, recursive lock, so that one disk can be used by
+ * several threads at once. It is recursive because loading an object reenters the disk, e.g. a flower
+ * adds itself and loads its meta sequences. When both locks are held this one is always taken first.
+ */
+
+static void cactusDisk_lock(CactusDisk *cactusDisk) {
+    pthread_mutex_lock(&cactusDisk->lock);
+}
+
+static void cactusDisk_unlock(CactusDisk *cactusDisk) {
+    pthread_mutex_unlock(&cactusDisk->lock);
+}
+
+/*
+ * Functions on the database, which is either a stKVDatabase or, for a local cactus disk, a CactusLocalDatabase.
+ * Updates are queued as DatabaseRequests, which can be applied to either. All are called with the database lock held.
+ */
+
+typedef struct _databaseRequest {
+    bool insert; //Else an update.
+    Name key;
+    void *value;
+    int64_t size;
+} DatabaseRequest;
+
+static DatabaseRequest *databaseRequest_construct(bool insert, Name key, const void *value, int64_t size) {
+    DatabaseRequest *request = st_malloc(sizeof(DatabaseRequest));
+    request->insert = insert;
+    request->key = key;
+    request->value = memcpy(st_malloc(size > 0 ? size : 1), value, size);
+    request->size = size;
+    return request;
+}
+
+static void databaseRequest_destruct(DatabaseRequest *request) {
+    free(request->value);
+    free(request);
+}
+
+static bool database_containsRecord(CactusDisk *cactusDisk, Name key) {
+    if (cactusDisk->localDatabase != NULL) {
+        return cactusLocalDatabase_containsRecord(cactusDisk->localDatabase, key);
+    }
+    return stKVDatabase_containsRecord(cactusDisk->database, key);
+}
+
+static void *database_getRecord(CactusDisk *cactusDisk, Name key, int64_t *recordSize) {
+    if (cactusDisk->localDatabase != NULL) {
+        return cactusLocalDatabase_getRecord(cactusDisk->localDatabase, key, recordSize);
+    }
+    return stKVDatabase_getRecord2(cactusDisk->database, key, recordSize);
+}
+
+static stList *database_bulkGetRecords(CactusDisk *cactusDisk, stList *keys) {
+    if (cactusDisk->localDatabase != NULL) {
+        return cactusLocalDatabase_bulkGetRecords(cactusDisk->localDatabase, keys);
+    }
+    return stKVDatabase_bulkGetRecords(cactusDisk->database, keys);
+}
+
+static void database_bulkSetRecords(CactusDisk *cactusDisk, stList *requests) {
+    if (cactusDisk->localDatabase != NULL) {
+        stTry
+            {
+                for (int64_t i = 0; i < stList_length(requests); i++) {
+                    DatabaseRequest *request = stList_get(requests, i);
+                    if (request->insert) {
+                        cactusLocalDatabase_insertRecord(cactusDisk->localDatabase, request->key, request->value,
+                                request->size);
+                    } else {
+                        cactusLocalDatabase_updateRecord(cactusDisk->localDatabase, request->key, request->value,
+                                request->size);
+                    }
+                }
+                cactusLocalDatabase_commit(cactusDisk->localDatabase);
+            }
+            stCatch(except)
+                {
+                    cactusLocalDatabase_abort(cactusDisk->localDatabase); //All or nothing, as with the database servers.
+                    stThrowNewCause(except, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Failed to set records");
+                }stTryEnd
+        ;
+        return;
+    }
+    stList *bulkRequests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    for (int64_t i = 0; i < stList_length(requests); i++) {
+        DatabaseRequest *request = stList_get(requests, i);
+        stList_append(bulkRequests, request->insert ?
+                stKVDatabaseBulkRequest_constructInsertRequest(request->key, request->value, request->size) :
+                stKVDatabaseBulkRequest_constructUpdateRequest(request->key, request->value, request->size));
+    }
+    stTry
+        {
+            stKVDatabase_bulkSetRecords(cactusDisk->database, bulkRequests);
+        }
+        stCatch(except)
+            {
+                stList_destruct(bulkRequests);
+                stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID, "Failed to set records");
+            }stTryEnd
+    ;
+    stList_destruct(bulkRequests);
+}
+
+static void database_bulkRemoveRecords(CactusDisk *cactusDisk, stList *keys) {
+    /*
+     * Removes the records with the given keys, given as a list of stIntTuples.
+     */
+    if (cactusDisk->localDatabase != NULL) {
+        stTry
+            {
+                for (int64_t i = 0; i < stList_length(keys); i++) {
+                    cactusLocalDatabase_removeRecord(cactusDisk->localDatabase, stIntTuple_get(stList_get(keys, i), 0));
+                }
+                cactusLocalDatabase_commit(cactusDisk->localDatabase);
+            }
+            stCatch(except)
+                {
+                    cactusLocalDatabase_abort(cactusDisk->localDatabase); //As for database_bulkSetRecords.
+                    stThrowNewCause(except, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Failed to remove records");
+                }stTryEnd
+        ;
+        return;
+    }
+    stKVDatabase_bulkRemoveRecords(cactusDisk->database, keys);
+}
+
+static int64_t database_incrementInt64(CactusDisk *cactusDisk, Name key, int64_t incrementAmount) {
+    if (cactusDisk->localDatabase != NULL) {
+        return cactusLocalDatabase_incrementInt64(cactusDisk->localDatabase, key, incrementAmount);
+    }
+    return stKVDatabase_incrementInt64(cactusDisk->database, key, incrementAmount);
+}
+
+static void database_insertInt64(CactusDisk *cactusDisk, Name key, int64_t value) {
+    if (cactusDisk->localDatabase != NULL) {
+        cactusLocalDatabase_insertInt64(cactusDisk->localDatabase, key, value);
+    } else {
+        stKVDatabase_insertInt64(cactusDisk->database, key, value);
+    }
+}
 
 /*
  * Functions on meta sequences.
  */
 
 void cactusDisk_addMetaSequence(CactusDisk *cactusDisk, MetaSequence *metaSequence) {
+    cactusDisk_lock(cactusDisk);
     assert(stSortedSet_search(cactusDisk->metaSequences, metaSequence) == NULL);
     stSortedSet_insert(cactusDisk->metaSequences, metaSequence);
+    cactusDisk_unlock(cactusDisk);
 }
 
 void cactusDisk_removeMetaSequence(CactusDisk *cactusDisk, MetaSequence *metaSequence) {
+    cactusDisk_lock(cactusDisk);
     assert(stSortedSet_search(cactusDisk->metaSequences, metaSequence) != NULL);
     stSortedSet_remove(cactusDisk->metaSequences, metaSequence);
+    cactusDisk_unlock(cactusDisk);
 }
 
 /*
  * Functions on strings stored by the flower disk.
  */
 
+static int64_t cactusDisk_getSequenceChunkSize(CactusDisk *cactusDisk) {
+    return cactusDisk->packedStrings ? CACTUS_DISK_PACKED_SEQUENCE_CHUNK_SIZE : CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
+}
+
 Name cactusDisk_addString(CactusDisk *cactusDisk, const char *string) {
     /*
      * Adds a string to the database.
      */
     int64_t stringSize = strlen(string);
-    int64_t intervalSize = ceil((double) stringSize / CACTUS_DISK_SEQUENCE_CHUNK_SIZE);
+    int64_t chunkSize = cactusDisk_getSequenceChunkSize(cactusDisk);
+    int64_t intervalSize = ceil((double) stringSize / chunkSize);
     Name name = cactusDisk_getUniqueIDInterval(cactusDisk, intervalSize);
-    stList *insertRequests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
-    for (int64_t i = 0; i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE < stringSize; i++) {
-        int64_t j =
-            (i + 1) * CACTUS_DISK_SEQUENCE_CHUNK_SIZE < stringSize ?
-            CACTUS_DISK_SEQUENCE_CHUNK_SIZE : stringSize - i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
-        char *subString = stString_getSubString(string, i * CACTUS_DISK_SEQUENCE_CHUNK_SIZE, j);
-        stList_append(insertRequests, stKVDatabaseBulkRequest_constructInsertRequest(name + i, subString, j + 1));
-        free(subString);
+    stList *insertRequests = stList_construct3(0, (void (*)(void *)) databaseRequest_destruct);
+    for (int64_t i = 0; i * chunkSize < stringSize; i++) {
+        int64_t j = (i + 1) * chunkSize < stringSize ? chunkSize : stringSize - i * chunkSize;
+        if (cactusDisk->packedStrings) {
+            int64_t recordSize;
+            void *record = packedSequence_encode(string + i * chunkSize, j, &recordSize);
+            stList_append(insertRequests, databaseRequest_construct(1, name + i, record, recordSize));
+            free(record);
+        } else {
+            char *subString = stString_getSubString(string, i * chunkSize, j);
+            stList_append(insertRequests, databaseRequest_construct(1, name + i, subString, j + 1));
+            free(subString);
+        }
     }
+    cactusDisk_lockDatabase(cactusDisk);
     stTry
     {
-        stKVDatabase_bulkSetRecords(cactusDisk->database, insertRequests);
+        database_bulkSetRecords(cactusDisk, insertRequests);
     }
     stCatch(except)
     {
+        cactusDisk_unlockDatabase(cactusDisk);
         stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                         "An unknown database error occurred when we tried to add a string to the cactus disk");
     }stTryEnd
          ;
+    cactusDisk_unlockDatabase(cactusDisk);
     stList_destruct(insertRequests);
     return name;
 }
@@ -136,20 +312,162 @@ static stList *mergeSubstrings(stList *substrings, int64_t proximityToMerge) {
     return mergedSubstrings;
 }
 
-static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stList *substrings) {
-    if (cactusDisk->stringCache == NULL) {
-        // No string cache.
-        return;
+/*
+ * Functions on the string cache. The cache holds forward strand intervals of strings, each base of
+ * a string being held at most once: overlapping or adjacent intervals are merged as they are added.
+ * The intervals are indexed by a sorted set, and evicted least recently used first by a CactusCache.
+ * An interval read by a string view is pinned: if it leaves the cache, being merged or evicted, it is only
+ * freed once the last view of it is released.
+ */
+
+typedef struct _cachedString {
+    Name name;
+    int64_t start;
+    int64_t length;
+    char *string;
+    int64_t pinCount; //The number of unreleased views of the interval.
+    bool inCache;
+} CachedString;
+
+static void cachedString_destruct(CachedString *cachedString) {
+    free(cachedString->string);
+    free(cachedString);
+}
+
+static int cachedString_cmp(CachedString *cachedString1, CachedString *cachedString2) {
+    int i = cactusMisc_nameCompare(cachedString1->name, cachedString2->name);
+    if (i != 0) {
+        return i;
     }
+    return cachedString1->start < cachedString2->start ? -1 : (cachedString1->start > cachedString2->start ? 1 : 0);
+}
+
+static void stringCache_evict(void *key, void *value, CactusDisk *cactusDisk) {
     /*
-     * Caches the given set of substrings in the cactusDisk cache.
+     * Called by the string cache whenever an interval leaves the cache.
+     */
+    CachedString *cachedString = key;
+    assert(cachedString == value);
+    stSortedSet_remove(cactusDisk->cachedStrings, cachedString);
+    cachedString->inCache = 0;
+    if (cachedString->pinCount == 0) {
+        cachedString_destruct(cachedString);
+    }
+}
+
+static void stringCache_pin(CactusDisk *cactusDisk, CachedString *cachedString, int64_t start, int64_t length,
+        int64_t strand, StringView *stringView) {
+    /*
+     * Fills in a view of the given interval of the cached string, pinning it.
+     */
+    assert(cachedString->inCache);
+    assert(start >= cachedString->start && start + length <= cachedString->start + cachedString->length);
+    cachedString->pinCount++;
+    stringView_construct(stringView, cachedString->string + start - cachedString->start, length, strand, cactusDisk,
+            cachedString);
+}
+
+void cactusDisk_unpinString(CactusDisk *cactusDisk, void *cachedString) {
+    cactusDisk_lock(cactusDisk);
+    CachedString *cachedString2 = cachedString;
+    assert(cachedString2->pinCount > 0);
+    if (--cachedString2->pinCount == 0 && !cachedString2->inCache) {
+        cachedString_destruct(cachedString2);
+    }
+    cactusDisk_unlock(cactusDisk);
+}
+
+static CachedString *stringCache_find(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length) {
+    /*
+     * Gets the cached interval containing the given interval, or NULL if not cached.
+     */
+    CachedString query;
+    query.name = name;
+    query.start = start;
+    CachedString *cachedString = stSortedSet_searchLessThanOrEqual(cactusDisk->cachedStrings, &query);
+    if (cachedString != NULL && cachedString->name == name
+            && cachedString->start + cachedString->length >= start + length) {
+        return cachedString;
+    }
+    return NULL;
+}
+
+static CachedString *stringCache_get(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length) {
+    /*
+     * As stringCache_find, but counts the lookup and marks the interval as recently used.
+     */
+    CachedString *cachedString = stringCache_find(cactusDisk, name, start, length);
+    if (cachedString != NULL) {
+        cactusCache_get(cactusDisk->stringCache, cachedString, NULL);
+    } else {
+        cactusCache_countMiss(cactusDisk->stringCache);
+    }
+    return cachedString;
+}
+
+static void stringCache_set(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, const char *string) {
+    /*
+     * Adds the given forward strand interval to the cache, merging it with any
+     * cached intervals it overlaps or abuts.
+     */
+    assert(length > 0);
+    //Find the intervals to merge with
+    stList *overlapping = stList_construct();
+    CachedString query;
+    query.name = name;
+    query.start = start;
+    CachedString *cachedString = stSortedSet_searchLessThanOrEqual(cactusDisk->cachedStrings, &query);
+    if (cachedString == NULL || cachedString->name != name || cachedString->start + cachedString->length < start) {
+        cachedString = stSortedSet_searchGreaterThan(cactusDisk->cachedStrings, &query);
+    }
+    while (cachedString != NULL && cachedString->name == name && cachedString->start <= start + length) {
+        if (cachedString->start <= start && cachedString->start + cachedString->length >= start + length) {
+            //Already cached
+            stList_destruct(overlapping);
+            return;
+        }
+        stList_append(overlapping, cachedString);
+        cachedString = stSortedSet_searchGreaterThan(cactusDisk->cachedStrings, cachedString);
+    }
+    //Build the merged interval
+    CachedString *mergedString = st_malloc(sizeof(CachedString));
+    mergedString->name = name;
+    mergedString->start = start;
+    int64_t end = start + length;
+    if (stList_length(overlapping) > 0) {
+        CachedString *first = stList_get(overlapping, 0);
+        CachedString *last = stList_peek(overlapping);
+        mergedString->start = first->start < start ? first->start : start;
+        end = last->start + last->length > end ? last->start + last->length : end;
+    }
+    mergedString->length = end - mergedString->start;
+    mergedString->string = st_malloc(sizeof(char) * mergedString->length);
+    mergedString->pinCount = 0;
+    mergedString->inCache = 1;
+    for (int64_t i = 0; i < stList_length(overlapping); i++) {
+        cachedString = stList_get(overlapping, i);
+        memcpy(mergedString->string + cachedString->start - mergedString->start, cachedString->string,
+                sizeof(char) * cachedString->length);
+        cactusCache_remove(cactusDisk->stringCache, cachedString);
+    }
+    memcpy(mergedString->string + start - mergedString->start, string, sizeof(char) * length);
+    stSortedSet_insert(cactusDisk->cachedStrings, mergedString);
+    cactusCache_set(cactusDisk->stringCache, mergedString, mergedString, mergedString->length, mergedString->length);
+    stList_destruct(overlapping);
+}
+
+static stList *getSubstringChunks(CactusDisk *cactusDisk, stList *substrings) {
+    /*
+     * Gets the set of records that cover the given substrings.
      */
+    int64_t chunkSize = cactusDisk_getSequenceChunkSize(cactusDisk);
+    stList *records = NULL;
     stList *getRequests = stList_construct3(0, free);
     for (int64_t i = 0; i < stList_length(substrings); i++) {
         Substring *substring = stList_get(substrings, i);
-        int64_t intervalSize = (substring->length + substring->start - 1) / CACTUS_DISK_SEQUENCE_CHUNK_SIZE
-            - substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1;
-        Name shiftedName = substring->name + substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE;
+        int64_t intervalSize = (substring->length + substring->start - 1) / chunkSize
+            - substring->start / chunkSize + 1;
+        Name shiftedName = substring->name + substring->start / chunkSize;
         for (int64_t j = 0; j < intervalSize; j++) {
             int64_t *k = st_malloc(sizeof(int64_t));
             k[0] = shiftedName + j;
@@ -158,51 +476,121 @@ static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stList *substrings) {
     }
     if (stList_length(getRequests) == 0) {
         stList_destruct(getRequests);
-        return;
+        return NULL;
     }
-    stList *records = NULL;
+    cactusDisk_lockDatabase(cactusDisk);
     stTry
     {
-        records = stKVDatabase_bulkGetRecords(cactusDisk->database, getRequests);
+        records = database_bulkGetRecords(cactusDisk, getRequests);
     }
     stCatch(except)
     {
+        cactusDisk_unlockDatabase(cactusDisk);
         stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                         "An unknown database error occurred when getting a sequence string");
     }stTryEnd
          ;
+    cactusDisk_unlockDatabase(cactusDisk);
     assert(records != NULL);
     assert(stList_length(records) == stList_length(getRequests));
     stList_destruct(getRequests);
+    return records;
+}
+
+static void cacheSubstringChunks(CactusDisk *cactusDisk, stList *substrings, stList *records) {
+    /*
+     * Caches the given set of substrings in the cactusDisk cache, given the records returned by getSubstringChunks.
+     */
+    int64_t chunkSize = cactusDisk_getSequenceChunkSize(cactusDisk);
     stListIterator *recordsIt = stList_getIterator(records);
     for (int64_t i = 0; i < stList_length(substrings); i++) {
         Substring *substring = stList_get(substrings, i);
-        int64_t intervalSize = (substring->length + substring->start - 1) / CACTUS_DISK_SEQUENCE_CHUNK_SIZE
-            - substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1;
-        stList *strings = stList_construct();
-        while (intervalSize-- > 0) {
-            int64_t recordSize;
-            stKVDatabaseBulkResult *result = stList_getNext(recordsIt);
-            assert(result != NULL);
-            char *string = stKVDatabaseBulkResult_getRecord(result, &recordSize);
-            assert(string != NULL);
-            assert(strlen(string) == recordSize - 1);
-            stList_append(strings, string);
-            assert(recordSize <= CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1);
+        int64_t intervalSize = (substring->length + substring->start - 1) / chunkSize
+            - substring->start / chunkSize + 1;
+        if (cactusDisk->packedStrings) {
+            //Decode just the requested interval from the packed chunks.
+            char *string = st_malloc(sizeof(char) * substring->length);
+            int64_t chunkStart = (substring->start / chunkSize) * chunkSize;
+            int64_t end = substring->start + substring->length;
+            while (intervalSize-- > 0) {
+                int64_t recordSize;
+                stKVDatabaseBulkResult *result = stList_getNext(recordsIt);
+                assert(result != NULL);
+                void *record = stKVDatabaseBulkResult_getRecord(result, &recordSize);
+                assert(record != NULL);
+                int64_t chunkLength = packedSequence_getLength(record);
+                int64_t from = substring->start > chunkStart ? substring->start : chunkStart;
+                int64_t to = end < chunkStart + chunkLength ? end : chunkStart + chunkLength;
+                assert(from < to);
+                packedSequence_decode(record, from - chunkStart, to - from, string + from - substring->start);
+                chunkStart += chunkSize;
+            }
+            stringCache_set(cactusDisk, substring->name, substring->start, substring->length, string);
+            free(string);
+        } else {
+            stList *strings = stList_construct();
+            while (intervalSize-- > 0) {
+                int64_t recordSize;
+                stKVDatabaseBulkResult *result = stList_getNext(recordsIt);
+                assert(result != NULL);
+                char *string = stKVDatabaseBulkResult_getRecord(result, &recordSize);
+                assert(string != NULL);
+                assert(strlen(string) == recordSize - 1);
+                stList_append(strings, string);
+                assert(recordSize <= CACTUS_DISK_SEQUENCE_CHUNK_SIZE + 1);
+            }
+            assert(stList_length(strings) > 0);
+            char *joinedString = stString_join2("", strings);
+            stringCache_set(cactusDisk, substring->name,
+                              (substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE) * CACTUS_DISK_SEQUENCE_CHUNK_SIZE,
+                              strlen(joinedString), joinedString);
+            free(joinedString);
+            stList_destruct(strings);
         }
-        assert(stList_length(strings) > 0);
-        char *joinedString = stString_join2("", strings);
-        stCache_setRecord(cactusDisk->stringCache, substring->name,
-                          (substring->start / CACTUS_DISK_SEQUENCE_CHUNK_SIZE) * CACTUS_DISK_SEQUENCE_CHUNK_SIZE,
-                          strlen(joinedString), joinedString);
-        free(joinedString);
-        stList_destruct(strings);
     }
     assert(stList_getNext(recordsIt) == NULL);
     stList_destructIterator(recordsIt);
+}
+
+static void cacheSubstringsFromDB(CactusDisk *cactusDisk, stList *substrings) {
+    if (cactusDisk->stringCache == NULL) {
+        // No string cache.
+        return;
+    }
+    /*
+     * Caches the given set of substrings in the cactusDisk cache.
+     */
+    stList *records = getSubstringChunks(cactusDisk, substrings);
+    if (records == NULL) {
+        return;
+    }
+    cactusDisk_lock(cactusDisk);
+    cacheSubstringChunks(cactusDisk, substrings, records);
+    cactusDisk_unlock(cactusDisk);
     stList_destruct(records);
 }
 
+static stList *getUncachedSubstrings(CactusDisk *cactusDisk, stList *substrings) {
+    /*
+     * Gets the merged set of substrings not already held in the string cache.
+     */
+    stList *mergedSubstrings = mergeSubstrings(substrings, cactusDisk_getSequenceChunkSize(cactusDisk));
+    stList *uncachedSubstrings = stList_construct3(0, (void (*)(void *)) substring_destruct);
+    cactusDisk_lock(cactusDisk);
+    while (stList_length(mergedSubstrings) > 0) {
+        Substring *substring = stList_pop(mergedSubstrings);
+        if (stringCache_find(cactusDisk, substring->name, substring->start, substring->length) == NULL) {
+            stList_append(uncachedSubstrings, substring);
+        } else {
+            substring_destruct(substring);
+        }
+    }
+    cactusDisk_unlock(cactusDisk);
+    stList_destruct(mergedSubstrings);
+    stList_reverse(uncachedSubstrings);
+    return uncachedSubstrings;
+}
+
 void cactusDisk_preCacheStrings2(CactusDisk *cactusDisk, stList *substrings) {
     /*
      * Precaches the given substrings, so that they are all in memory.
@@ -211,8 +599,8 @@ void cactusDisk_preCacheStrings2(CactusDisk *cactusDisk, stList *substrings) {
         // No string cache.
         return;
     }
-    //Now do some simple merging to reduce granularity
-    stList *mergedSubstrings = mergeSubstrings(substrings, CACTUS_DISK_SEQUENCE_CHUNK_SIZE);
+    //Now do some simple merging to reduce granularity, skipping anything already cached
+    stList *mergedSubstrings = getUncachedSubstrings(cactusDisk, substrings);
     //Now cache the sequences
     cacheSubstringsFromDB(cactusDisk, mergedSubstrings);
     stList_destruct(mergedSubstrings);
@@ -312,51 +700,73 @@ void cactusDisk_preCacheSegmentStrings(CactusDisk *cactusDisk, stList *flowers)
     stList_destruct(substrings);
 }
 
-char *cactusDisk_getStringFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand) {
+bool cactusDisk_getStringViewFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
+        StringView *stringView) {
     /*
-     * Gets a sequence from the cache.
+     * Gets a view of a sequence in the cache, without copying it.
      */
     if (cactusDisk->stringCache == NULL) {
         // No cache.
-        return NULL;
+        return 0;
     }
-    char *string = NULL;
-    if (stCache_containsRecord(cactusDisk->stringCache, name, start, sizeof(char) * length)) {
-        int64_t recordSize;
-        string = stCache_getRecord(cactusDisk->stringCache, name, start, sizeof(char) * length, &recordSize);
-        assert(string != NULL);
-        assert(recordSize == length);
-        string = st_realloc(string, sizeof(char) * (length + 1));
-        string[length] = '\0';
-        if (!strand) {
-            char *string2 = stString_reverseComplementString(string);
-            free(string);
-            string = string2;
-        }
+    cactusDisk_lock(cactusDisk);
+    CachedString *cachedString = stringCache_get(cactusDisk, name, start, length);
+    if (cachedString != NULL) {
+        stringCache_pin(cactusDisk, cachedString, start, length, strand, stringView);
     }
-    return string;
+    cactusDisk_unlock(cactusDisk);
+    return cachedString != NULL;
 }
 
-char *cactusDisk_getString(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
-        int64_t totalSequenceLength) {
+void cactusDisk_getStringView(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
+        StringView *stringView) {
     /*
-     * Gets a string from the database.
-     *
+     * Gets a view of a sequence, first caching it from the database if needed.
      */
     assert(length >= 0);
     if (length == 0) {
-        return stString_copy("");
+        stringView_construct(stringView, "", 0, strand, NULL, NULL);
+        return;
     }
-    //First try getting it from the cache
-    char *string = cactusDisk_getStringFromCache(cactusDisk, name, start, length, strand);
-    if (string == NULL) { //If not in the cache, add it to the cache and then get it from the cache.
+    if (!cactusDisk_getStringViewFromCache(cactusDisk, name, start, length, strand, stringView)) {
         stList *list = stList_construct3(0, (void (*)(void *)) substring_destruct);
         stList_append(list, substring_construct(name, start, length));
-        cacheSubstringsFromDB(cactusDisk, list);
+        stList *records = getSubstringChunks(cactusDisk, list);
+        cactusDisk_lock(cactusDisk); //Cache and pin the string in one go, so that no other thread can evict it in between.
+        cacheSubstringChunks(cactusDisk, list, records);
+        CachedString *cachedString = stringCache_find(cactusDisk, name, start, length);
+        assert(cachedString != NULL);
+        stringCache_pin(cactusDisk, cachedString, start, length, strand, stringView);
+        cactusDisk_unlock(cactusDisk);
+        stList_destruct(records);
         stList_destruct(list);
-        string = cactusDisk_getStringFromCache(cactusDisk, name, start, length, strand);
     }
-    assert(string != NULL);
+}
+
+char *cactusDisk_getStringFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand) {
+    /*
+     * Gets a sequence from the cache.
+     */
+    StringView stringView;
+    char *string = NULL;
+    if (cactusDisk_getStringViewFromCache(cactusDisk, name, start, length, strand, &stringView)) {
+        string = stringView_getString(&stringView);
+        stringView_release(&stringView);
+    }
+    return string;
+}
+
+char *cactusDisk_getString(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
+        int64_t totalSequenceLength) {
+    /*
+     * Gets a string from the database. The database is read outside cactusDisk_lock, which is only held
+     * to add the chunks to the cache and pin the string, so other threads can keep using the cache
+     * meanwhile. The view keeps the string from being evicted while it is copied.
+     */
+    StringView stringView;
+    cactusDisk_getStringView(cactusDisk, name, start, length, strand, &stringView);
+    char *string = stringView_getString(&stringView);
+    stringView_release(&stringView);
     return string;
 }
 
@@ -384,6 +794,9 @@ static void cactusDisk_writeBinaryRepresentation(CactusDisk *cactusDisk,
     if (cactusDisk->eventTree != NULL) {
         eventTree_writeBinaryRepresentation(cactusDisk->eventTree, writeFn);
     }
+    if (cactusDisk->packedStrings) {
+        binaryRepresentation_writeElementType(CODE_PACKED_STRINGS, writeFn);
+    }
     binaryRepresentation_writeElementType(CODE_CACTUS_DISK, writeFn);
 }
 
@@ -391,6 +804,12 @@ static void cactusDisk_loadFromBinaryRepresentation(void **binaryString, CactusD
     assert(binaryRepresentation_peekNextElementType(*binaryString) == CODE_CACTUS_DISK);
     binaryRepresentation_popNextElementType(binaryString);
     cactusDisk->eventTree = eventTree_loadFromBinaryRepresentation(binaryString, cactusDisk);
+    //Disks written before the packed encoding existed have no flag and store strings as plain text.
+    cactusDisk->packedStrings = 0;
+    if (binaryRepresentation_peekNextElementType(*binaryString) == CODE_PACKED_STRINGS) {
+        binaryRepresentation_popNextElementType(binaryString);
+        cactusDisk->packedStrings = 1;
+    }
     assert(binaryRepresentation_peekNextElementType(*binaryString) == CODE_CACTUS_DISK);
     binaryRepresentation_popNextElementType(binaryString);
 }
@@ -416,79 +835,126 @@ static void *decompress(void *data, int64_t *dataSize) {
     return data2;
 }
 
-static stList *getRecords(CactusDisk *cactusDisk, stList *objectNames, char *type) {
-    if (stList_length(objectNames) == 0) {
-        return stList_construct3(0, NULL);
+/*
+ * Functions on the cache of decompressed records.
+ */
+
+static void recordCache_evict(void *key, void *record, void *extraArg) {
+    free(record);
+}
+
+static void *recordCache_get(CactusDisk *cactusDisk, Name objectName, int64_t *recordSize) {
+    /*
+     * Returns a copy of the cached record, or NULL if not cached.
+     */
+    if (cactusDisk->cache == NULL) {
+        return NULL;
+    }
+    cactusDisk_lock(cactusDisk);
+    void *record = cactusCache_get(cactusDisk->cache, (void *) objectName, recordSize);
+    if (record != NULL) {
+        record = memcpy(st_malloc(*recordSize), record, *recordSize);
     }
+    cactusDisk_unlock(cactusDisk);
+    return record;
+}
+
+static void recordCache_set(CactusDisk *cactusDisk, Name objectName, void *record, int64_t recordSize,
+        int64_t compressedRecordSize) {
+    /*
+     * Caches a copy of the given decompressed record.
+     */
+    if (cactusDisk->cache != NULL) {
+        void *recordCopy = memcpy(st_malloc(recordSize), record, recordSize);
+        cactusDisk_lock(cactusDisk);
+        cactusCache_set(cactusDisk->cache, (void *) objectName, recordCopy, recordSize, compressedRecordSize);
+        cactusDisk_unlock(cactusDisk);
+    }
+}
+
+static stList *getCompressedRecords(CactusDisk *cactusDisk, stList *objectNames, char *type) {
+    /*
+     * Gets the bulk results for the given records from the database, without touching the caches.
+     */
     stList *records = NULL;
+    cactusDisk_lockDatabase(cactusDisk);
     stTry
         {
-            records = stKVDatabase_bulkGetRecords(cactusDisk->database, objectNames);
+            records = database_bulkGetRecords(cactusDisk, objectNames);
         }
         stCatch(except)
             {
+                cactusDisk_unlockDatabase(cactusDisk);
                 stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                         "An unknown database error occurred when getting a bulk set of %s", type);
             }stTryEnd
     ;
+    cactusDisk_unlockDatabase(cactusDisk);
     assert(records != NULL);
     assert(stList_length(objectNames) == stList_length(records));
+    return records;
+}
+
+static stList *getRecords(CactusDisk *cactusDisk, stList *objectNames, char *type, int64_t *recordSizes) {
+    /*
+     * Gets the decompressed records, placing their sizes in recordSizes.
+     */
+    if (stList_length(objectNames) == 0) {
+        return stList_construct3(0, NULL);
+    }
+    stList *records = getCompressedRecords(cactusDisk, objectNames, type);
     stList_setDestructor(records, free);
     for (int64_t i = 0; i < stList_length(objectNames); i++) {
         Name objectName = *((int64_t *) stList_get(objectNames, i));
         int64_t recordSize;
-        void *record;
         stKVDatabaseBulkResult *result = stList_get(records, i);
         assert(result != NULL);
-        if (cactusDisk->cache == NULL
-            || !stCache_containsRecord(cactusDisk->cache, objectName, 0, INT64_MAX)) {
+        void *record = recordCache_get(cactusDisk, objectName, &recordSize);
+        if (record == NULL) {
             record = stKVDatabaseBulkResult_getRecord(result, &recordSize);
             assert(recordSize >= 0);
             assert(record != NULL);
+            int64_t compressedRecordSize = recordSize;
             record = decompress(record, &recordSize);
-            if (cactusDisk->cache != NULL) {
-                stCache_setRecord(cactusDisk->cache, objectName, 0, recordSize, record);
-            }
-        } else {
-            record = stCache_getRecord(cactusDisk->cache, objectName, 0, INT64_MAX, &recordSize);
-            assert(recordSize >= 0);
-            assert(record != NULL);
+            recordCache_set(cactusDisk, objectName, record, recordSize, compressedRecordSize);
         }
+        assert(recordSize >= 0);
+        assert(record != NULL);
         stKVDatabaseBulkResult_destruct(result);
         stList_set(records, i, record);
+        recordSizes[i] = recordSize;
     }
     return records;
 }
 
 static void *getRecord(CactusDisk *cactusDisk, Name objectName, char *type, int64_t *size) {
-    void *cA = NULL;
     int64_t recordSize = 0;
-    if (cactusDisk->cache != NULL
-        && stCache_containsRecord(cactusDisk->cache, objectName, 0, INT64_MAX)) { //If we already have the record, we won't update it.
-        cA = stCache_getRecord(cactusDisk->cache, objectName, 0, INT64_MAX, &recordSize);
-    } else {
+    void *cA = recordCache_get(cactusDisk, objectName, &recordSize); //If we already have the record, we won't update it.
+    if (cA == NULL) {
+        cactusDisk_lockDatabase(cactusDisk);
         stTry
             {
-                cA = stKVDatabase_getRecord2(cactusDisk->database, objectName, &recordSize);
+                cA = database_getRecord(cactusDisk, objectName, &recordSize);
             }
             stCatch(except)
                 {
+                    cactusDisk_unlockDatabase(cactusDisk);
                     stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                             "An unknown database error occurred when getting a %s", type);
                 }stTryEnd
         ;
+        cactusDisk_unlockDatabase(cactusDisk);
         if (cA == NULL) {
             return NULL;
         }
         //Decompression
         assert(recordSize > 0);
+        int64_t compressedRecordSize = recordSize;
         void *cA2 = decompress(cA, &recordSize);
         free(cA);
         cA = cA2;
         // Add the uncompressed record to the cache.
-        if (cactusDisk->cache != NULL) {
-            stCache_setRecord(cactusDisk->cache, objectName, 0, recordSize, cA);
-        }
+        recordCache_set(cactusDisk, objectName, cA, recordSize, compressedRecordSize);
     }
     if (size != NULL) {
         *size = recordSize;
@@ -497,12 +963,39 @@ static void *getRecord(CactusDisk *cactusDisk, Name objectName, char *type, int6
 }
 
 static bool containsRecord(CactusDisk *cactusDisk, Name objectName) {
-    return (cactusDisk->cache != NULL
-            && stCache_containsRecord(cactusDisk->cache, objectName, 0, INT64_MAX))
-        || stKVDatabase_containsRecord(cactusDisk->database, objectName);
+    if (cactusDisk->cache != NULL) {
+        cactusDisk_lock(cactusDisk);
+        bool cached = cactusCache_contains(cactusDisk->cache, (void *) objectName);
+        cactusDisk_unlock(cactusDisk);
+        if (cached) {
+            return 1;
+        }
+    }
+    cactusDisk_lockDatabase(cactusDisk);
+    bool contained = database_containsRecord(cactusDisk, objectName);
+    cactusDisk_unlockDatabase(cactusDisk);
+    return contained;
+}
+
+static int64_t getCacheSizeFromEnvironment(const char *variable, int64_t defaultSize) {
+    /*
+     * Gets a cache budget in bytes from the given environment variable, if set.
+     */
+    const char *value = getenv(variable);
+    if (value == NULL) {
+        return defaultSize;
+    }
+    int64_t size;
+    if (sscanf(value, "%" SCNi64, &size) != 1 || size < 0) {
+        stThrowNew(CACTUS_DISK_EXCEPTION_ID, "Could not parse a cache size in bytes from %s: '%s'", variable, value);
+    }
+    return size;
 }
 
-static CactusDisk *cactusDisk_constructPrivate(stKVDatabaseConf *conf, bool create, bool cache) {
+static int64_t cactusDisk_leaseUniqueIDs(CactusDisk *cactusDisk, int64_t leaseSize);
+
+static CactusDisk *cactusDisk_constructPrivate(stKVDatabaseConf *conf, const char *localDatabaseFile, bool create,
+        bool cache, bool packStrings) {
     CactusDisk *cactusDisk = st_calloc(1, sizeof(CactusDisk));
 
     //construct lists of in memory objects
@@ -510,25 +1003,39 @@ static CactusDisk *cactusDisk_constructPrivate(stKVDatabaseConf *conf, bool crea
     cactusDisk->flowers = stSortedSet_construct3(cactusDisk_constructFlowersP, NULL);
     cactusDisk->flowerNamesMarkedForDeletion = stSortedSet_construct3((int (*)(const void *, const void *)) strcmp,
             free);
-    cactusDisk->updateRequests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    cactusDisk->updateRequests = stList_construct3(0, (void (*)(void *)) databaseRequest_destruct);
+    cactusDisk->flowerFingerprints = stHash_construct2(NULL, free);
 
     cactusDisk->eventTree = NULL;
+    cactusDisk->packedStrings = packStrings; //Overridden by the stored parameters if the disk already exists.
 
     //Now open the database
-    cactusDisk->database = stKVDatabase_construct(conf, create);
+    pthread_mutexattr_t lockAttributes;
+    pthread_mutexattr_init(&lockAttributes);
+    pthread_mutexattr_settype(&lockAttributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&cactusDisk->lock, &lockAttributes);
+    pthread_mutexattr_destroy(&lockAttributes);
+    pthread_mutex_init(&cactusDisk->databaseLock, NULL);
+    if (localDatabaseFile != NULL) {
+        cactusDisk->localDatabase = cactusLocalDatabase_construct(localDatabaseFile, create);
+    } else {
+        cactusDisk->database = stKVDatabase_construct(conf, create);
+    }
     if (cache) {
-        // 10MB for general DB responses
-        cactusDisk->cache = stCache_construct2(10000000);
+        cactusDisk->cache = cactusCache_construct("records",
+                getCacheSizeFromEnvironment("CACTUS_DISK_CACHE_SIZE", CACTUS_DISK_CACHE_SIZE), recordCache_evict, NULL);
     }
-    // 100MB for strings
-    cactusDisk->stringCache = stCache_construct2(10000000);
+    cactusDisk->cachedStrings = stSortedSet_construct3((int (*)(const void *, const void *)) cachedString_cmp, NULL);
+    cactusDisk->stringCache = cactusCache_construct("strings",
+            getCacheSizeFromEnvironment("CACTUS_DISK_STRING_CACHE_SIZE", CACTUS_DISK_STRING_CACHE_SIZE),
+            (void (*)(void *, void *, void *)) stringCache_evict, cactusDisk);
 
     //initialise the unique ids.
     int64_t seed = (clock() << 24) | (time(NULL) << 16) | (getpid() & 65535); //Likely to be unique
     st_logDebug("The cactus disk is seeding the random number generator with the value %" PRIi64 "\n", seed);
     st_randomSeed(seed);
-    cactusDisk->uniqueNumber = 0;
-    cactusDisk->maxUniqueNumber = 0;
+    cactusDisk->idAllocator = cactusIDAllocator_construct((int64_t (*)(void *, int64_t)) cactusDisk_leaseUniqueIDs,
+            cactusDisk);
 
     //Now load any stuff..
     if (containsRecord(cactusDisk, CACTUS_DISK_PARAMETER_KEY)) {
@@ -547,7 +1054,45 @@ static CactusDisk *cactusDisk_constructPrivate(stKVDatabaseConf *conf, bool crea
 }
 
 CactusDisk *cactusDisk_construct(stKVDatabaseConf *conf, bool create, bool cache) {
-    return cactusDisk_constructPrivate(conf, create, cache);
+    return cactusDisk_constructPrivate(conf, NULL, create, cache, 1);
+}
+
+CactusDisk *cactusDisk_construct2(stKVDatabaseConf *conf, bool create, bool cache, bool packStrings) {
+    return cactusDisk_constructPrivate(conf, NULL, create, cache, packStrings);
+}
+
+CactusDisk *cactusDisk_constructLocal(const char *fileName, bool create, bool cache) {
+    return cactusDisk_constructPrivate(NULL, fileName, create, cache, 1);
+}
+
+static char *getLocalDatabaseFile(const char *databaseString) {
+    /*
+     * Gets the file of a local database configuration string, or NULL if the string is not one.
+     */
+    if (strstr(databaseString, "type=\"local\"") == NULL) {
+        return NULL;
+    }
+    const char *attribute = "database_file=\"";
+    const char *start = strstr(databaseString, attribute);
+    const char *end = start != NULL ? strchr(start + strlen(attribute), '"') : NULL;
+    if (end == NULL) {
+        stThrowNew(CACTUS_DISK_EXCEPTION_ID, "No database_file given for a local database: %s", databaseString);
+    }
+    start += strlen(attribute);
+    return stString_getSubString(start, 0, end - start);
+}
+
+CactusDisk *cactusDisk_constructFromString(const char *databaseString, bool create, bool cache) {
+    char *localDatabaseFile = getLocalDatabaseFile(databaseString);
+    if (localDatabaseFile != NULL) {
+        CactusDisk *cactusDisk = cactusDisk_constructLocal(localDatabaseFile, create, cache);
+        free(localDatabaseFile);
+        return cactusDisk;
+    }
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(databaseString);
+    CactusDisk *cactusDisk = cactusDisk_construct(conf, create, cache);
+    stKVDatabaseConf_destruct(conf);
+    return cactusDisk;
 }
 
 void cactusDisk_destruct(CactusDisk *cactusDisk) {
@@ -567,25 +1112,100 @@ void cactusDisk_destruct(CactusDisk *cactusDisk) {
     stSortedSet_destruct(cactusDisk->metaSequences);
 
     //close DB
-    stKVDatabase_destruct(cactusDisk->database);
+    if (cactusDisk->localDatabase != NULL) {
+        cactusLocalDatabase_destruct(cactusDisk->localDatabase);
+    } else {
+        stKVDatabase_destruct(cactusDisk->database);
+    }
+    pthread_mutex_destroy(&cactusDisk->databaseLock);
+    cactusIDAllocator_destruct(cactusDisk->idAllocator);
 
+    if (getenv("CACTUS_DISK_CACHE_STATS") != NULL) {
+        cactusDisk_printCacheStats(cactusDisk, stderr);
+    }
     if (cactusDisk->cache != NULL) {
-        stCache_destruct(cactusDisk->cache);
+        cactusCache_destruct(cactusDisk->cache);
     }
     if (cactusDisk->stringCache != NULL) {
-        stCache_destruct(cactusDisk->stringCache);
+        cactusCache_destruct(cactusDisk->stringCache);
+        stSortedSet_destruct(cactusDisk->cachedStrings);
     }
 
     stList_destruct(cactusDisk->updateRequests);
+    stHash_destruct(cactusDisk->flowerFingerprints);
 
+    pthread_mutex_destroy(&cactusDisk->lock);
     free(cactusDisk);
 }
 
+/*
+ * Functions on the fingerprints of flower records, used to tell if a flower has changed since it was
+ * read from the database without reading it again.
+ */
+
+typedef struct _recordFingerprint {
+    int64_t recordSize;
+    uint64_t hash;
+} RecordFingerprint;
+
+static void flowerFingerprint_set(CactusDisk *cactusDisk, Name flowerName, const void *record, int64_t recordSize) {
+    /*
+     * Records the fingerprint of the given flower record, as it now stands in the database.
+     */
+    RecordFingerprint *fingerprint = st_malloc(sizeof(RecordFingerprint));
+    fingerprint->recordSize = recordSize;
+    fingerprint->hash = binaryRepresentation_fingerprint(record, recordSize);
+    cactusDisk_lock(cactusDisk);
+    free(stHash_remove(cactusDisk->flowerFingerprints, (void *) flowerName));
+    stHash_insert(cactusDisk->flowerFingerprints, (void *) flowerName, fingerprint);
+    cactusDisk_unlock(cactusDisk);
+}
+
+static void flowerFingerprint_remove(CactusDisk *cactusDisk, Name flowerName) {
+    cactusDisk_lock(cactusDisk);
+    free(stHash_remove(cactusDisk->flowerFingerprints, (void *) flowerName));
+    cactusDisk_unlock(cactusDisk);
+}
+
+static RecordFingerprint *flowerFingerprint_get(CactusDisk *cactusDisk, Name flowerName,
+        RecordFingerprint *fingerprint) {
+    /*
+     * Copies the fingerprint of the flower into the given struct and returns it, or returns NULL
+     * if the flower record has not been seen.
+     */
+    cactusDisk_lock(cactusDisk);
+    RecordFingerprint *storedFingerprint = stHash_search(cactusDisk->flowerFingerprints, (void *) flowerName);
+    if (storedFingerprint != NULL) {
+        *fingerprint = *storedFingerprint;
+    }
+    cactusDisk_unlock(cactusDisk);
+    return storedFingerprint != NULL ? fingerprint : NULL;
+}
+
 void cactusDisk_addUpdateRequest(CactusDisk *cactusDisk, Flower *flower) {
     int64_t recordSize;
     void *vA = binaryRepresentation_makeBinaryRepresentation(flower,
             (void (*)(void *, void (*)(const void * ptr, size_t size, size_t count))) flower_writeBinaryRepresentation,
             &recordSize);
+    RecordFingerprint fingerprint;
+    if (flowerFingerprint_get(cactusDisk, flower_getName(flower), &fingerprint) != NULL) {
+        //The flower was read from (or queued for writing to) the database, so we know what is there without reading it.
+        if (fingerprint.recordSize == recordSize
+                && fingerprint.hash == binaryRepresentation_fingerprint(vA, recordSize)) {
+            free(vA); //Unchanged
+            return;
+        }
+        int64_t compressedSize;
+        void *compressed = stCompression_compress(vA, recordSize, &compressedSize, -1);
+        cactusDisk_lock(cactusDisk);
+        stList_append(cactusDisk->updateRequests,
+                databaseRequest_construct(0, flower_getName(flower), compressed, compressedSize));
+        cactusDisk_unlock(cactusDisk);
+        flowerFingerprint_set(cactusDisk, flower_getName(flower), vA, recordSize);
+        free(vA);
+        free(compressed);
+        return;
+    }
     //Compression
     int64_t compressedSize;
     void *compressed = stCompression_compress(vA, recordSize, &compressedSize, -1);
@@ -594,14 +1214,19 @@ void cactusDisk_addUpdateRequest(CactusDisk *cactusDisk, Flower *flower) {
         int64_t recordSize2;
         void *vA2 = getRecord(cactusDisk, flower_getName(flower), "flower", &recordSize2);
         if (!stCache_recordsIdentical(vA, recordSize, vA2, recordSize2)) { //Only rewrite if we actually did something
+            cactusDisk_lock(cactusDisk);
             stList_append(cactusDisk->updateRequests,
-                    stKVDatabaseBulkRequest_constructUpdateRequest(flower_getName(flower), compressed, compressedSize));
+                    databaseRequest_construct(0, flower_getName(flower), compressed, compressedSize));
+            cactusDisk_unlock(cactusDisk);
         }
         free(vA2);
     } else {
+        cactusDisk_lock(cactusDisk);
         stList_append(cactusDisk->updateRequests,
-                stKVDatabaseBulkRequest_constructInsertRequest(flower_getName(flower), compressed, compressedSize));
+                databaseRequest_construct(1, flower_getName(flower), compressed, compressedSize));
+        cactusDisk_unlock(cactusDisk);
     }
+    flowerFingerprint_set(cactusDisk, flower_getName(flower), vA, recordSize);
     free(vA);
     free(compressed);
 }
@@ -614,15 +1239,15 @@ void cactusDisk_forceParameterUpdate(CactusDisk *cactusDisk, bool keyAlreadyExis
                                                       &recordSize);
     //Compression
     cactusDiskParameters = compress(cactusDiskParameters, &recordSize);
+    cactusDisk_lock(cactusDisk);
     if (keyAlreadyExists) {
         stList_append(cactusDisk->updateRequests,
-                      stKVDatabaseBulkRequest_constructUpdateRequest(CACTUS_DISK_PARAMETER_KEY, cactusDiskParameters,
-                                                                     recordSize));
+                      databaseRequest_construct(0, CACTUS_DISK_PARAMETER_KEY, cactusDiskParameters, recordSize));
     } else {
         stList_append(cactusDisk->updateRequests,
-                      stKVDatabaseBulkRequest_constructInsertRequest(CACTUS_DISK_PARAMETER_KEY, cactusDiskParameters,
-                                                                     recordSize));
+                      databaseRequest_construct(1, CACTUS_DISK_PARAMETER_KEY, cactusDiskParameters, recordSize));
     }
+    cactusDisk_unlock(cactusDisk);
     free(cactusDiskParameters);
 }
 
@@ -634,6 +1259,8 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
 
     st_logDebug("Starting to write the cactus to disk\n");
 
+    cactusDisk_lock(cactusDisk); //Held throughout, so the set of objects to write can not change under us.
+
     stSortedSetIterator *it = stSortedSet_getIterator(cactusDisk->flowers);
     //Sort flowers to update.
     while ((flower = stSortedSet_getNext(it)) != NULL) {
@@ -649,9 +1276,10 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
     while ((nameString = stSortedSet_getNext(it)) != NULL) {
         Name name = cactusMisc_stringToName(nameString);
         if (containsRecord(cactusDisk, name)) {
-            stList_append(cactusDisk->updateRequests, stKVDatabaseBulkRequest_constructUpdateRequest(name, &name, 0)); //We set it to null in the first atomic operation.
+            stList_append(cactusDisk->updateRequests, databaseRequest_construct(0, name, &name, 0)); //We set it to null in the first atomic operation.
             stList_append(removeRequests, stIntTuple_construct1(name));
         }
+        flowerFingerprint_remove(cactusDisk, name);
     }
     stSortedSet_destructIterator(it);
 
@@ -669,10 +1297,10 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
         vA = compress(vA, &recordSize);
         if (!containsRecord(cactusDisk, metaSequence_getName(metaSequence))) {
             stList_append(cactusDisk->updateRequests,
-                    stKVDatabaseBulkRequest_constructInsertRequest(metaSequence_getName(metaSequence), vA, recordSize));
+                    databaseRequest_construct(1, metaSequence_getName(metaSequence), vA, recordSize));
         } else {
             stList_append(cactusDisk->updateRequests,
-                    stKVDatabaseBulkRequest_constructUpdateRequest(metaSequence_getName(metaSequence), vA, recordSize));
+                    databaseRequest_construct(0, metaSequence_getName(metaSequence), vA, recordSize));
         }
         free(vA);
     }
@@ -688,51 +1316,64 @@ void cactusDisk_write(CactusDisk *cactusDisk) {
 
     if (stList_length(cactusDisk->updateRequests) > 0) {
         st_logDebug("Going to write %" PRIi64 " updates\n", stList_length(cactusDisk->updateRequests));
+        cactusDisk_lockDatabase(cactusDisk);
         stTry
             {
                 st_logDebug("Writing %" PRIi64 " updates\n", stList_length(cactusDisk->updateRequests));
                 assert(stList_length(cactusDisk->updateRequests) > 0);
-                stKVDatabase_bulkSetRecords(cactusDisk->database, cactusDisk->updateRequests);
+                database_bulkSetRecords(cactusDisk, cactusDisk->updateRequests);
             }
             stCatch(except)
                 {
+                    cactusDisk_unlockDatabase(cactusDisk);
+                    cactusDisk_unlock(cactusDisk);
+                    stList_destruct(removeRequests);
                     stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                             "Failed when trying to set records in updating the cactus disk");
                 }stTryEnd
         ;
+        cactusDisk_unlockDatabase(cactusDisk);
     }
 
     st_logDebug("Updated the database with inserts\n");
 
     if (stList_length(removeRequests) > 0) {
+        cactusDisk_lockDatabase(cactusDisk);
         stTry
             {
-                stKVDatabase_bulkRemoveRecords(cactusDisk->database, removeRequests);
+                database_bulkRemoveRecords(cactusDisk, removeRequests);
             }
             stCatch(except)
                 {
+                    cactusDisk_unlockDatabase(cactusDisk);
+                    cactusDisk_unlock(cactusDisk);
+                    stList_destruct(removeRequests);
                     stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                             "Failed when trying to remove records in updating the cactus disk");
                 }stTryEnd
         ;
+        cactusDisk_unlockDatabase(cactusDisk);
     }
 
     st_logDebug("Now removed flowers we don't need\n");
 
     stList_destruct(cactusDisk->updateRequests);
-    cactusDisk->updateRequests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    cactusDisk->updateRequests = stList_construct3(0, (void (*)(void *)) databaseRequest_destruct);
+    cactusDisk_unlock(cactusDisk);
     stList_destruct(removeRequests);
 
     st_logDebug("Finished writing to the database\n");
 }
 
 stList *cactusDisk_getFlowers(CactusDisk *cactusDisk, stList *flowerNames) {
-    stList *records = getRecords(cactusDisk, flowerNames, "flowers");
+    int64_t *recordSizes = st_malloc(sizeof(int64_t) * (stList_length(flowerNames) + 1));
+    stList *records = getRecords(cactusDisk, flowerNames, "flowers", recordSizes);
     assert(stList_length(flowerNames) == stList_length(records));
     stList *flowers = stList_construct();
+    cactusDisk_lock(cactusDisk); //Another thread may have loaded some of the flowers since we read the records.
     for (int64_t i = 0; i < stList_length(flowerNames); i++) {
         Name flowerName = *((int64_t *) stList_get(flowerNames, i));
-        static Flower flower;
+        Flower flower;
         flower.name = flowerName;
         Flower *flower2;
         if ((flower2 = stSortedSet_search(cactusDisk->flowers, &flower)) == NULL) {
@@ -741,44 +1382,191 @@ stList *cactusDisk_getFlowers(CactusDisk *cactusDisk, stList *flowerNames) {
             void *cA = record;
             flower2 = flower_loadFromBinaryRepresentation(&cA, cactusDisk);
             assert(flower2 != NULL);
+            flowerFingerprint_set(cactusDisk, flowerName, record, recordSizes[i]);
         }
         stList_append(flowers, flower2);
     }
+    cactusDisk_unlock(cactusDisk);
     stList_destruct(records);
+    free(recordSizes);
     return flowers;
 }
 
 Flower *cactusDisk_getFlower(CactusDisk *cactusDisk, Name flowerName) {
-    static Flower flower;
+    Flower flower;
     flower.name = flowerName;
     Flower *flower2;
-    if ((flower2 = stSortedSet_search(cactusDisk->flowers, &flower)) != NULL) {
+    cactusDisk_lock(cactusDisk);
+    flower2 = stSortedSet_search(cactusDisk->flowers, &flower);
+    cactusDisk_unlock(cactusDisk);
+    if (flower2 != NULL) {
         return flower2;
     }
-    void *cA = getRecord(cactusDisk, flowerName, "flower", NULL);
+    //Read the record without holding the lock, so other threads can carry on meanwhile.
+    int64_t recordSize;
+    void *cA = getRecord(cactusDisk, flowerName, "flower", &recordSize);
 
     if (cA == NULL) {
         return NULL;
     }
-    void *cA2 = cA;
-    flower2 = flower_loadFromBinaryRepresentation(&cA2, cactusDisk);
+    cactusDisk_lock(cactusDisk);
+    if ((flower2 = stSortedSet_search(cactusDisk->flowers, &flower)) == NULL) { //Check another thread has not loaded it.
+        void *cA2 = cA;
+        flower2 = flower_loadFromBinaryRepresentation(&cA2, cactusDisk);
+        flowerFingerprint_set(cactusDisk, flowerName, cA, recordSize);
+    }
+    cactusDisk_unlock(cactusDisk);
     free(cA);
     return flower2;
 }
 
+/*
+ * Functions for prefetching flowers and strings.
+ */
+
+struct _cactusDiskPrefetch {
+    CactusDisk *cactusDisk;
+    stList *flowerNames;
+    stList *flowerRecords; //The decompressed records, in the order of flowerNames.
+    int64_t *flowerRecordSizes;
+    int64_t *compressedFlowerRecordSizes;
+    stList *substrings; //The merged, uncached substrings to fetch.
+    stList *substringRecords; //The chunks covering the substrings, as returned by getSubstringChunks.
+    bool fetched;
+};
+
+CactusDiskPrefetch *cactusDiskPrefetch_construct(CactusDisk *cactusDisk, stList *flowerNames,
+        stList *segmentStringFlowers) {
+    CactusDiskPrefetch *prefetch = st_calloc(1, sizeof(CactusDiskPrefetch));
+    prefetch->cactusDisk = cactusDisk;
+    prefetch->flowerNames = stList_construct3(0, free);
+    for (int64_t i = 0; i < stList_length(flowerNames); i++) {
+        int64_t *flowerName = st_malloc(sizeof(int64_t));
+        flowerName[0] = *((int64_t *) stList_get(flowerNames, i));
+        stList_append(prefetch->flowerNames, flowerName);
+    }
+    if (segmentStringFlowers != NULL && cactusDisk->stringCache != NULL) {
+        stList *substrings = getSubstringsForFlowerSegments(segmentStringFlowers);
+        prefetch->substrings = getUncachedSubstrings(cactusDisk, substrings);
+        stList_destruct(substrings);
+    } else {
+        prefetch->substrings = stList_construct3(0, (void (*)(void *)) substring_destruct);
+    }
+    return prefetch;
+}
+
+void cactusDiskPrefetch_destruct(CactusDiskPrefetch *prefetch) {
+    stList_destruct(prefetch->flowerNames);
+    if (prefetch->flowerRecords != NULL) {
+        stList_destruct(prefetch->flowerRecords);
+        free(prefetch->flowerRecordSizes);
+        free(prefetch->compressedFlowerRecordSizes);
+    }
+    stList_destruct(prefetch->substrings);
+    if (prefetch->substringRecords != NULL) {
+        stList_destruct(prefetch->substringRecords);
+    }
+    free(prefetch);
+}
+
+void cactusDiskPrefetch_fetch(CactusDiskPrefetch *prefetch) {
+    /*
+     * Only reads the database (under its lock) and the immutable parameters of the cactus disk,
+     * so can be run on a thread other than the one using the cactus disk.
+     */
+    if (prefetch->fetched) {
+        return;
+    }
+    CactusDisk *cactusDisk = prefetch->cactusDisk;
+    int64_t recordNumber = stList_length(prefetch->flowerNames);
+    prefetch->flowerRecords = stList_construct3(0, free);
+    prefetch->flowerRecordSizes = st_malloc(sizeof(int64_t) * (recordNumber + 1));
+    prefetch->compressedFlowerRecordSizes = st_malloc(sizeof(int64_t) * (recordNumber + 1));
+    if (recordNumber > 0) {
+        stList *results = getCompressedRecords(cactusDisk, prefetch->flowerNames, "flowers");
+        for (int64_t i = 0; i < recordNumber; i++) {
+            stKVDatabaseBulkResult *result = stList_get(results, i);
+            int64_t recordSize;
+            void *record = stKVDatabaseBulkResult_getRecord(result, &recordSize);
+            assert(record != NULL);
+            prefetch->compressedFlowerRecordSizes[i] = recordSize;
+            stList_append(prefetch->flowerRecords, decompress(record, &recordSize));
+            prefetch->flowerRecordSizes[i] = recordSize;
+            stKVDatabaseBulkResult_destruct(result);
+        }
+        stList_destruct(results);
+    }
+    prefetch->substringRecords = getSubstringChunks(cactusDisk, prefetch->substrings);
+    prefetch->fetched = 1;
+}
+
+stList *cactusDiskPrefetch_loadFlowers(CactusDiskPrefetch *prefetch) {
+    cactusDiskPrefetch_fetch(prefetch);
+    CactusDisk *cactusDisk = prefetch->cactusDisk;
+    stList *flowers = stList_construct();
+    cactusDisk_lock(cactusDisk);
+    for (int64_t i = 0; i < stList_length(prefetch->flowerNames); i++) {
+        Name flowerName = *((int64_t *) stList_get(prefetch->flowerNames, i));
+        Flower flower2;
+        flower2.name = flowerName;
+        Flower *flower = stSortedSet_search(cactusDisk->flowers, &flower2);
+        if (flower == NULL) {
+            //As in getRecords, a cached record takes precedence over the one read from the database.
+            int64_t recordSize;
+            void *record = recordCache_get(cactusDisk, flowerName, &recordSize);
+            if (record == NULL) {
+                record = stList_get(prefetch->flowerRecords, i);
+                recordSize = prefetch->flowerRecordSizes[i];
+                recordCache_set(cactusDisk, flowerName, record, recordSize,
+                        prefetch->compressedFlowerRecordSizes[i]);
+                void *cA = record;
+                flower = flower_loadFromBinaryRepresentation(&cA, cactusDisk);
+                flowerFingerprint_set(cactusDisk, flowerName, record, recordSize);
+            } else {
+                void *cA = record;
+                flower = flower_loadFromBinaryRepresentation(&cA, cactusDisk);
+                flowerFingerprint_set(cactusDisk, flowerName, record, recordSize);
+                free(record);
+            }
+            assert(flower != NULL);
+        }
+        stList_append(flowers, flower);
+    }
+    cactusDisk_unlock(cactusDisk);
+    return flowers;
+}
+
+void cactusDiskPrefetch_cacheStrings(CactusDiskPrefetch *prefetch) {
+    cactusDiskPrefetch_fetch(prefetch);
+    if (prefetch->substringRecords != NULL && prefetch->cactusDisk->stringCache != NULL) {
+        cactusDisk_lock(prefetch->cactusDisk);
+        cacheSubstringChunks(prefetch->cactusDisk, prefetch->substrings, prefetch->substringRecords);
+        cactusDisk_unlock(prefetch->cactusDisk);
+        stList_destruct(prefetch->substringRecords);
+        prefetch->substringRecords = NULL;
+    }
+}
+
 MetaSequence *cactusDisk_getMetaSequence(CactusDisk *cactusDisk, Name metaSequenceName) {
-    static MetaSequence metaSequence;
+    MetaSequence metaSequence;
     metaSequence.name = metaSequenceName;
     MetaSequence *metaSequence2;
-    if ((metaSequence2 = stSortedSet_search(cactusDisk->metaSequences, &metaSequence)) != NULL) {
+    cactusDisk_lock(cactusDisk);
+    metaSequence2 = stSortedSet_search(cactusDisk->metaSequences, &metaSequence);
+    cactusDisk_unlock(cactusDisk);
+    if (metaSequence2 != NULL) {
         return metaSequence2;
     }
     void *cA = getRecord(cactusDisk, metaSequenceName, "metaSequence", NULL);
     if (cA == NULL) {
         return NULL;
     }
-    void *cA2 = cA;
-    metaSequence2 = metaSequence_loadFromBinaryRepresentation(&cA2, cactusDisk);
+    cactusDisk_lock(cactusDisk); //As in cactusDisk_getFlower.
+    if ((metaSequence2 = stSortedSet_search(cactusDisk->metaSequences, &metaSequence)) == NULL) {
+        void *cA2 = cA;
+        metaSequence2 = metaSequence_loadFromBinaryRepresentation(&cA2, cactusDisk);
+    }
+    cactusDisk_unlock(cactusDisk);
     free(cA);
     return metaSequence2;
 }
@@ -788,28 +1576,37 @@ MetaSequence *cactusDisk_getMetaSequence(CactusDisk *cactusDisk, Name metaSequen
  */
 
 bool cactusDisk_flowerIsLoaded(CactusDisk *cactusDisk, Name flowerName) {
-    static Flower flower;
+    Flower flower;
     flower.name = flowerName;
-    return stSortedSet_search(cactusDisk->flowers, &flower) != NULL;
+    cactusDisk_lock(cactusDisk);
+    bool loaded = stSortedSet_search(cactusDisk->flowers, &flower) != NULL;
+    cactusDisk_unlock(cactusDisk);
+    return loaded;
 }
 
 void cactusDisk_addFlower(CactusDisk *cactusDisk, Flower *flower) {
+    cactusDisk_lock(cactusDisk);
     assert(stSortedSet_search(cactusDisk->flowers, flower) == NULL);
     stSortedSet_insert(cactusDisk->flowers, flower);
+    cactusDisk_unlock(cactusDisk);
 }
 
 void cactusDisk_removeFlower(CactusDisk *cactusDisk, Flower *flower) {
     assert(cactusDisk_flowerIsLoaded(cactusDisk, flower_getName(flower)));
+    cactusDisk_lock(cactusDisk);
     stSortedSet_remove(cactusDisk->flowers, flower);
+    cactusDisk_unlock(cactusDisk);
 }
 
 void cactusDisk_deleteFlowerFromDisk(CactusDisk *cactusDisk, Flower *flower) {
     char *nameString = cactusMisc_nameToString(flower_getName(flower));
+    cactusDisk_lock(cactusDisk);
     if (stSortedSet_search(cactusDisk->flowerNamesMarkedForDeletion, nameString) == NULL) {
         stSortedSet_insert(cactusDisk->flowerNamesMarkedForDeletion, nameString);
     } else {
         free(nameString);
     }
+    cactusDisk_unlock(cactusDisk);
 }
 
 void cactusDisk_setEventTree(CactusDisk *cactusDisk, EventTree *eventTree) {
@@ -820,11 +1617,16 @@ void cactusDisk_setEventTree(CactusDisk *cactusDisk, EventTree *eventTree) {
  * Function to get unique ID.
  */
 
-void cactusDisk_getBlockOfUniqueIDs(CactusDisk *cactusDisk, int64_t intervalSize) {
-    intervalSize = intervalSize < CACTUS_DISK_NAME_INCREMENT ? CACTUS_DISK_NAME_INCREMENT : intervalSize;
-    bool done = 0;
+static int64_t cactusDisk_leaseUniqueIDs(CactusDisk *cactusDisk, int64_t leaseSize) {
+    /*
+     * Leases an interval of IDs for the ID allocator. The IDs are divided into buckets, each with a counter
+     * record keyed by a negative name, and the lease is taken by incrementing a random bucket's counter,
+     * so that concurrent processes rarely contend for the same record.
+     */
     int64_t collisionCount = 0;
-    while (!done) {
+    int64_t firstID = 0;
+    cactusDisk_lockDatabase(cactusDisk);
+    while (firstID == 0) {
         stTry
             {
                 Name keyName = st_randomInt(-CACTUS_DISK_BUCKET_NUMBER, 0);
@@ -836,22 +1638,20 @@ void cactusDisk_getBlockOfUniqueIDs(CactusDisk *cactusDisk, int64_t intervalSize
                 assert(minimumValue >= 1);
                 assert(maximumValue <= INT64_MAX);
                 assert(minimumValue < maximumValue);
-                if (stKVDatabase_containsRecord(cactusDisk->database, keyName)) {
-                    cactusDisk->maxUniqueNumber = stKVDatabase_incrementInt64(cactusDisk->database, keyName,
-                            intervalSize);
-                    cactusDisk->uniqueNumber = cactusDisk->maxUniqueNumber - intervalSize;
-                    if (cactusDisk->uniqueNumber <= 0 || cactusDisk->uniqueNumber < minimumValue
-                            || cactusDisk->uniqueNumber > maximumValue) {
-                        st_errAbort("Got a non positive unique number %lli %lli %lli %lli", cactusDisk->uniqueNumber,
-                                cactusDisk->maxUniqueNumber, minimumValue, maximumValue);
+                if (database_containsRecord(cactusDisk, keyName)) {
+                    int64_t endID = database_incrementInt64(cactusDisk, keyName, leaseSize);
+                    if (endID - leaseSize <= 0 || endID - leaseSize < minimumValue || endID - leaseSize > maximumValue) {
+                        st_errAbort("Got a non positive unique number %" PRIi64 " %" PRIi64 " %" PRIi64 " %" PRIi64 "",
+                                endID - leaseSize, endID, minimumValue, maximumValue);
+                    }
+                    if (endID >= maximumValue) {
+                        st_errAbort("We have exhausted a bucket, which seems really unlikely");
                     }
-                    assert(cactusDisk->uniqueNumber >= minimumValue);
-                    assert(cactusDisk->uniqueNumber <= maximumValue);
-                    assert(cactusDisk->uniqueNumber > 0);
+                    firstID = endID - leaseSize;
                 } else {
                     stTry
                         {
-                            stKVDatabase_insertInt64(cactusDisk->database, keyName, minimumValue);
+                            database_insertInt64(cactusDisk, keyName, minimumValue);
                         }
                         stCatch(except)
                             {
@@ -866,17 +1666,13 @@ void cactusDisk_getBlockOfUniqueIDs(CactusDisk *cactusDisk, int64_t intervalSize
                                 }
                             }stTryEnd
                     ;
-                    continue;
-                }
-                if (cactusDisk->maxUniqueNumber >= maximumValue) {
-                    st_errAbort("We have exhausted a bucket, which seems really unlikely");
                 }
-                done = 1;
             }
             stCatch(except)
                 {
                     collisionCount++;
                     if (collisionCount >= 10) {
+                        cactusDisk_unlockDatabase(cactusDisk);
                         stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID,
                                 "Repeated unknown database errors occurred when we tried to get a unique ID, collision count %" PRIi64 "",
                                 collisionCount);
@@ -886,15 +1682,21 @@ void cactusDisk_getBlockOfUniqueIDs(CactusDisk *cactusDisk, int64_t intervalSize
                 }stTryEnd
         ;
     }
+    cactusDisk_unlockDatabase(cactusDisk);
+    return firstID;
 }
 
 int64_t cactusDisk_getUniqueIDInterval(CactusDisk *cactusDisk, int64_t intervalSize) {
-    assert(cactusDisk->uniqueNumber <= cactusDisk->maxUniqueNumber);
-    if (cactusDisk->uniqueNumber + intervalSize > cactusDisk->maxUniqueNumber) {
-        cactusDisk_getBlockOfUniqueIDs(cactusDisk, intervalSize);
-    }
-    Name uniqueNumber = cactusDisk->uniqueNumber;
-    cactusDisk->uniqueNumber += intervalSize;
+    int64_t uniqueNumber = 0;
+    stTry
+        {
+            uniqueNumber = cactusIDAllocator_getInterval(cactusDisk->idAllocator, intervalSize);
+        }
+        stCatch(except)
+            {
+                stThrowNewCause(except, CACTUS_DISK_EXCEPTION_ID, "Could not get a block of unique IDs");
+            }stTryEnd
+    ;
     return uniqueNumber;
 }
 
@@ -903,11 +1705,35 @@ int64_t cactusDisk_getUniqueID(CactusDisk *cactusDisk) {
 }
 
 void cactusDisk_clearStringCache(CactusDisk *cactusDisk) {
-    stCache_clear(cactusDisk->stringCache);
+    cactusDisk_lock(cactusDisk);
+    cactusCache_clear(cactusDisk->stringCache);
+    cactusDisk_unlock(cactusDisk);
 }
 
 void cactusDisk_clearCache(CactusDisk *cactusDisk) {
-    stCache_clear(cactusDisk->cache);
+    if (cactusDisk->cache != NULL) {
+        cactusDisk_lock(cactusDisk);
+        cactusCache_clear(cactusDisk->cache);
+        cactusDisk_unlock(cactusDisk);
+    }
+}
+
+void cactusDisk_setCacheSizes(CactusDisk *cactusDisk, int64_t cacheSize, int64_t stringCacheSize) {
+    cactusDisk_lock(cactusDisk);
+    if (cactusDisk->cache != NULL) {
+        cactusCache_setMaxSize(cactusDisk->cache, cacheSize);
+    }
+    cactusCache_setMaxSize(cactusDisk->stringCache, stringCacheSize);
+    cactusDisk_unlock(cactusDisk);
+}
+
+void cactusDisk_printCacheStats(CactusDisk *cactusDisk, FILE *fileHandle) {
+    cactusDisk_lock(cactusDisk);
+    if (cactusDisk->cache != NULL) {
+        cactusCache_printStats(cactusDisk->cache, fileHandle);
+    }
+    cactusCache_printStats(cactusDisk->stringCache, fileHandle);
+    cactusDisk_unlock(cactusDisk);
 }
 
 EventTree *cactusDisk_getEventTree(CactusDisk *cactusDisk) {
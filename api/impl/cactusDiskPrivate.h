@@ -7,19 +7,28 @@
 #ifndef CACTUS_DISK_PRIVATE_H_
 #define CACTUS_DISK_PRIVATE_H_
 
+#include <pthread.h>
 #include "cactusGlobals.h"
+#include "cactusCache.h"
+#include "cactusLocalDatabase.h"
+#include "cactusIDAllocator.h"
 
 struct _cactusDisk {
     stKVDatabase *database;
+    CactusLocalDatabase *localDatabase; //If non-NULL, the embedded database used in place of the stKVDatabase.
+    pthread_mutex_t databaseLock; //Serialises access to the database, which may be shared with a prefetching thread.
+    pthread_mutex_t lock; //Recursive lock guarding the in memory state below, so the disk can be shared between threads.
     stSortedSet *metaSequences;
     stSortedSet *flowers;
     stSortedSet *flowerNamesMarkedForDeletion;
     stList *updateRequests;
-    stCache *cache;
-    stCache *stringCache;
+    stHash *flowerFingerprints; //Fingerprints of the flower records as last read from, or queued for writing to, the database.
+    CactusCache *cache;
+    CactusCache *stringCache;
+    stSortedSet *cachedStrings; //The intervals in the string cache, ordered by string name and start.
     EventTree *eventTree;
-    Name uniqueNumber;
-    Name maxUniqueNumber;
+    CactusIDAllocator *idAllocator; //Hands out unique IDs from ranges leased from the database.
+    bool packedStrings; //If true, sequence strings are stored using the 2-bit packed encoding.
 };
 
 ////////////////////////////////////////////////
@@ -90,9 +99,68 @@ char *cactusDisk_getString(CactusDisk *cactusDisk, Name name,
  */
 char *cactusDisk_getStringFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand);
 
+/*
+ * Fills in a view of the string, caching it from the database if it is not already cached. The view pins the
+ * cached interval until it is released.
+ */
+void cactusDisk_getStringView(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
+        StringView *stringView);
+
+/*
+ * Fills in a view of the string if it is in the cache, returning non-zero, else returns zero.
+ */
+bool cactusDisk_getStringViewFromCache(CactusDisk *cactusDisk, Name name, int64_t start, int64_t length, int64_t strand,
+        StringView *stringView);
+
+/*
+ * Unpins a cached interval pinned by a view, freeing it if it has since left the cache. Called by stringView_release.
+ */
+void cactusDisk_unpinString(CactusDisk *cactusDisk, void *cachedString);
+
 /*
  * Set the event tree for this disk. (Hopefully this only happens once.)
  */
 void cactusDisk_setEventTree(CactusDisk *cactusDisk, EventTree *eventTree);
 
+/*
+ * Functions for prefetching flowers and strings.
+ */
+
+/*
+ * A set of flower records and sequence strings to be read from the database ahead of when they are needed.
+ * Fetching only reads the database, so it can be done on a separate thread while the cactus disk is in use.
+ * The results are then loaded into the cactus disk by the thread that owns it.
+ */
+typedef struct _cactusDiskPrefetch CactusDiskPrefetch;
+
+/*
+ * Constructs a prefetch for the given list of flower names and the strings of the segments in the given
+ * list of flowers (which may be NULL). Strings already in the string cache are not refetched. Does not fetch
+ * anything.
+ */
+CactusDiskPrefetch *cactusDiskPrefetch_construct(CactusDisk *cactusDisk, stList *flowerNames,
+        stList *segmentStringFlowers);
+
+/*
+ * Frees the prefetch, along with anything fetched but not loaded.
+ */
+void cactusDiskPrefetch_destruct(CactusDiskPrefetch *prefetch);
+
+/*
+ * Reads the records of the prefetch from the database, if not already done. This is the only prefetch function that
+ * may be called from a thread other than the one using the cactus disk.
+ */
+void cactusDiskPrefetch_fetch(CactusDiskPrefetch *prefetch);
+
+/*
+ * Returns the list of flowers of the prefetch, in the order their names were given, loading any that
+ * are not already in memory.
+ */
+stList *cactusDiskPrefetch_loadFlowers(CactusDiskPrefetch *prefetch);
+
+/*
+ * Adds the prefetched strings to the string cache.
+ */
+void cactusDiskPrefetch_cacheStrings(CactusDiskPrefetch *prefetch);
+
 #endif
@@ -893,7 +893,7 @@ void flower_removeFace(Flower *flower, Face *face) {
  * Serialisation functions.
  */
 
-void flower_writeBinaryRepresentation(Flower *flower, void(*writeFn)(const void * ptr, size_t size, size_t count)) {
+void flower_writeLegacyBinaryRepresentation(Flower *flower, void(*writeFn)(const void * ptr, size_t size, size_t count)) {
     Flower_SequenceIterator *sequenceIterator;
     Flower_EndIterator *endIterator;
     Flower_BlockIterator *blockIterator;
@@ -945,10 +945,455 @@ void flower_writeBinaryRepresentation(Flower *flower, void(*writeFn)(const void
     binaryRepresentation_writeElementType(CODE_FLOWER, writeFn); //this avoids interpretting things wrong.
 }
 
+/*
+ * The columnar encoding. After the flower's name, flags and parent name, each type of object is written
+ * as a count followed by one column per field, e.g. all the end names, then all the end flags, and so on.
+ * Integers are varints and names are written relative to the name of the flower.
+ */
+
+#define FLOWER_COLUMNAR_BUILT_BLOCKS 1
+#define FLOWER_COLUMNAR_BUILT_TREES 2
+#define FLOWER_COLUMNAR_BUILT_FACES 4
+
+#define END_COLUMNAR_STUB 1
+#define END_COLUMNAR_ATTACHED 2
+#define END_COLUMNAR_SIDE 4
+#define END_COLUMNAR_PHYLOGENY 8
+
+#define CAP_COLUMNAR_NO_COORDINATES 0
+#define CAP_COLUMNAR_WITH_COORDINATES 1
+#define CAP_COLUMNAR_WITH_COORDINATES_BUT_NO_SEQUENCE 2
+#define CAP_COLUMNAR_TYPE_MASK 3
+#define CAP_COLUMNAR_STRAND 4
+#define CAP_COLUMNAR_ADJACENCY 8
+#define CAP_COLUMNAR_PARENT 16
+
+static stList *flower_getSortedSetAsList(stSortedSet *sortedSet) {
+    stList *list = stList_construct();
+    stSortedSetIterator *it = stSortedSet_getIterator(sortedSet);
+    void *o;
+    while ((o = stSortedSet_getNext(it)) != NULL) {
+        stList_append(list, o);
+    }
+    stSortedSet_destructIterator(it);
+    return list;
+}
+
+static void flower_getCapsInSerialisationOrderP(Cap *cap, stList *caps) {
+    stList_append(caps, cap);
+    for (int64_t i = 0; i < cap_getChildNumber(cap); i++) {
+        flower_getCapsInSerialisationOrderP(cap_getChild(cap, i), caps);
+    }
+}
+
+static stList *flower_getCapsInSerialisationOrder(End *end) {
+    /*
+     * Gets the caps of the end in the order end_writeBinaryRepresentation writes them, so parents come before children.
+     */
+    stList *caps = stList_construct();
+    Cap *cap = end_getRootInstance(end);
+    if (cap == NULL) {
+        End_InstanceIterator *iterator = end_getInstanceIterator(end);
+        while ((cap = end_getNext(iterator)) != NULL) {
+            assert(cap_getParent(cap) == NULL);
+            stList_append(caps, cap);
+        }
+        end_destructInstanceIterator(iterator);
+    } else {
+        flower_getCapsInSerialisationOrderP(cap, caps);
+    }
+    return caps;
+}
+
+static int64_t cap_getColumnarFlags(Cap *cap) {
+    int64_t flags;
+    if (cap_getCoordinate(cap) == INT64_MAX) {
+        flags = CAP_COLUMNAR_NO_COORDINATES;
+    } else if (cap_getSequence(cap) != NULL) {
+        flags = CAP_COLUMNAR_WITH_COORDINATES;
+    } else {
+        flags = CAP_COLUMNAR_WITH_COORDINATES_BUT_NO_SEQUENCE;
+    }
+    return flags | (cap_getStrand(cap) ? CAP_COLUMNAR_STRAND : 0) | (cap_getAdjacency(cap) != NULL ? CAP_COLUMNAR_ADJACENCY : 0)
+            | (cap_getParent(cap) != NULL ? CAP_COLUMNAR_PARENT : 0);
+}
+
+void flower_writeBinaryRepresentation(Flower *flower, void(*writeFn)(const void * ptr, size_t size, size_t count)) {
+    Name flowerName = flower_getName(flower);
+    binaryRepresentation_writeElementType(CODE_FLOWER_COLUMNAR, writeFn);
+    binaryRepresentation_writeVarInt(flowerName, writeFn);
+    binaryRepresentation_writeVarInt((flower_builtBlocks(flower) ? FLOWER_COLUMNAR_BUILT_BLOCKS : 0)
+            | (flower_builtTrees(flower) ? FLOWER_COLUMNAR_BUILT_TREES : 0)
+            | (flower_builtFaces(flower) ? FLOWER_COLUMNAR_BUILT_FACES : 0), writeFn);
+    binaryRepresentation_writeRelativeName(flower->parentFlowerName, flowerName, writeFn);
+
+    //Sequences
+    stList *sequences = flower_getSortedSetAsList(flower->sequences);
+    binaryRepresentation_writeVarInt(stList_length(sequences), writeFn);
+    for (int64_t i = 0; i < stList_length(sequences); i++) {
+        binaryRepresentation_writeRelativeName(sequence_getName(stList_get(sequences, i)), flowerName, writeFn);
+    }
+    stList_destruct(sequences);
+
+    //Ends
+    stList *ends = flower_getSortedSetAsList(flower->ends);
+    stList *caps = stList_construct();
+    binaryRepresentation_writeVarInt(stList_length(ends), writeFn);
+    for (int64_t i = 0; i < stList_length(ends); i++) {
+        binaryRepresentation_writeRelativeName(end_getName(stList_get(ends, i)), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(ends); i++) {
+        End *end = stList_get(ends, i);
+        assert(end_getOrientation(end));
+        binaryRepresentation_writeVarInt((end_isStubEnd(end) ? END_COLUMNAR_STUB : 0)
+                | (end_isAttached(end) ? END_COLUMNAR_ATTACHED : 0) | (end_getSide(end) ? END_COLUMNAR_SIDE : 0)
+                | (end_getRootInstance(end) != NULL ? END_COLUMNAR_PHYLOGENY : 0), writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(ends); i++) {
+        stList *endCaps = flower_getCapsInSerialisationOrder(stList_get(ends, i));
+        binaryRepresentation_writeVarInt(stList_length(endCaps), writeFn);
+        stList_appendAll(caps, endCaps);
+        stList_destruct(endCaps);
+    }
+    stList_destruct(ends);
+
+    //Caps
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        binaryRepresentation_writeRelativeName(cap_getName(stList_get(caps, i)), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        binaryRepresentation_writeVarInt(cap_getColumnarFlags(stList_get(caps, i)), writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(caps); i++) { //The sequence, else the event.
+        Cap *cap = stList_get(caps, i);
+        Sequence *sequence = cap_getCoordinate(cap) != INT64_MAX ? cap_getSequence(cap) : NULL;
+        binaryRepresentation_writeRelativeName(sequence != NULL ? sequence_getName(sequence) : event_getName(cap_getEvent(cap)),
+                flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(caps); i++) { //Coordinates, relative to the start of the sequence if there is one.
+        Cap *cap = stList_get(caps, i);
+        if (cap_getCoordinate(cap) != INT64_MAX) {
+            Sequence *sequence = cap_getSequence(cap);
+            binaryRepresentation_writeVarInt(cap_getCoordinate(cap) - (sequence != NULL ? sequence_getStart(sequence) : 0),
+                    writeFn);
+        }
+    }
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        Cap *cap = stList_get(caps, i);
+        if (cap_getAdjacency(cap) != NULL) {
+            binaryRepresentation_writeRelativeName(cap_getName(cap_getAdjacency(cap)), flowerName, writeFn);
+        }
+    }
+    for (int64_t i = 0; i < stList_length(caps); i++) {
+        Cap *cap = stList_get(caps, i);
+        if (cap_getParent(cap) != NULL) {
+            binaryRepresentation_writeRelativeName(cap_getName(cap_getParent(cap)), flowerName, writeFn);
+        }
+    }
+    stList_destruct(caps);
+
+    //Blocks
+    stList *blocks = flower_getSortedSetAsList(flower->blocks);
+    stList *segments = stList_construct();
+    binaryRepresentation_writeVarInt(stList_length(blocks), writeFn);
+    for (int64_t i = 0; i < stList_length(blocks); i++) {
+        binaryRepresentation_writeRelativeName(block_getName(stList_get(blocks, i)), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(blocks); i++) {
+        binaryRepresentation_writeVarInt(block_getLength(stList_get(blocks, i)), writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(blocks); i++) {
+        binaryRepresentation_writeRelativeName(end_getName(block_get5End(stList_get(blocks, i))), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(blocks); i++) {
+        binaryRepresentation_writeRelativeName(end_getName(block_get3End(stList_get(blocks, i))), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(blocks); i++) {
+        Block *block = stList_get(blocks, i);
+        assert(block_getOrientation(block));
+        binaryRepresentation_writeVarInt(block_getInstanceNumber(block), writeFn);
+        Block_InstanceIterator *iterator = block_getInstanceIterator(block);
+        Segment *segment;
+        while ((segment = block_getNext(iterator)) != NULL) {
+            assert(segment_getOrientation(segment));
+            stList_append(segments, segment);
+        }
+        block_destructInstanceIterator(iterator);
+    }
+    stList_destruct(blocks);
+
+    //Segments
+    for (int64_t i = 0; i < stList_length(segments); i++) {
+        binaryRepresentation_writeRelativeName(segment_getName(stList_get(segments, i)), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(segments); i++) {
+        binaryRepresentation_writeRelativeName(cap_getName(segment_get5Cap(stList_get(segments, i))), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(segments); i++) {
+        binaryRepresentation_writeRelativeName(cap_getName(segment_get3Cap(stList_get(segments, i))), flowerName, writeFn);
+    }
+    stList_destruct(segments);
+
+    //Groups
+    stList *groups = flower_getSortedSetAsList(flower->groups);
+    binaryRepresentation_writeVarInt(stList_length(groups), writeFn);
+    for (int64_t i = 0; i < stList_length(groups); i++) {
+        binaryRepresentation_writeRelativeName(group_getName(stList_get(groups, i)), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(groups); i++) {
+        binaryRepresentation_writeVarInt(group_isLeaf(stList_get(groups, i)), writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(groups); i++) {
+        binaryRepresentation_writeVarInt(group_getEndNumber(stList_get(groups, i)), writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(groups); i++) {
+        Group_EndIterator *iterator = group_getEndIterator(stList_get(groups, i));
+        End *end;
+        while ((end = group_getNextEnd(iterator)) != NULL) {
+            binaryRepresentation_writeRelativeName(end_getName(end), flowerName, writeFn);
+        }
+        group_destructEndIterator(iterator);
+    }
+    stList_destruct(groups);
+
+    //Chains
+    stList *chains = flower_getSortedSetAsList(flower->chains);
+    stList *links = stList_construct();
+    binaryRepresentation_writeVarInt(stList_length(chains), writeFn);
+    for (int64_t i = 0; i < stList_length(chains); i++) {
+        binaryRepresentation_writeRelativeName(chain_getName(stList_get(chains, i)), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(chains); i++) {
+        Chain *chain = stList_get(chains, i);
+        binaryRepresentation_writeVarInt(chain_getLength(chain), writeFn);
+        for (Link *link = chain_getFirst(chain); link != NULL; link = link_getNextLink(link)) {
+            stList_append(links, link);
+        }
+    }
+    stList_destruct(chains);
+
+    //Links
+    for (int64_t i = 0; i < stList_length(links); i++) {
+        binaryRepresentation_writeRelativeName(group_getName(link_getGroup(stList_get(links, i))), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(links); i++) {
+        binaryRepresentation_writeRelativeName(end_getName(link_get3End(stList_get(links, i))), flowerName, writeFn);
+    }
+    for (int64_t i = 0; i < stList_length(links); i++) {
+        binaryRepresentation_writeRelativeName(end_getName(link_get5End(stList_get(links, i))), flowerName, writeFn);
+    }
+    stList_destruct(links);
+
+    binaryRepresentation_writeElementType(CODE_FLOWER_COLUMNAR, writeFn); //this avoids interpretting things wrong.
+}
+
+static int64_t *flower_getVarIntColumn(void **binaryString, int64_t length) {
+    int64_t *column = st_malloc(sizeof(int64_t) * (length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        column[i] = binaryRepresentation_getVarInt(binaryString);
+    }
+    return column;
+}
+
+static Name *flower_getNameColumn(void **binaryString, int64_t length, Name flowerName) {
+    Name *column = st_malloc(sizeof(Name) * (length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        column[i] = binaryRepresentation_getRelativeName(binaryString, flowerName);
+    }
+    return column;
+}
+
+static int64_t flower_sumColumn(int64_t *column, int64_t length) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < length; i++) {
+        total += column[i];
+    }
+    return total;
+}
+
+static void flower_loadCapsFromColumnarBinaryRepresentation(void **binaryString, Flower *flower, End **ends,
+        int64_t *endFlags, int64_t *capNumbers, int64_t endNumber) {
+    Name flowerName = flower_getName(flower);
+    int64_t capNumber = flower_sumColumn(capNumbers, endNumber);
+    Name *names = flower_getNameColumn(binaryString, capNumber, flowerName);
+    int64_t *flags = flower_getVarIntColumn(binaryString, capNumber);
+    Name *sequenceOrEventNames = flower_getNameColumn(binaryString, capNumber, flowerName);
+    int64_t *coordinates = st_malloc(sizeof(int64_t) * (capNumber + 1));
+    for (int64_t i = 0; i < capNumber; i++) {
+        if ((flags[i] & CAP_COLUMNAR_TYPE_MASK) != CAP_COLUMNAR_NO_COORDINATES) {
+            coordinates[i] = binaryRepresentation_getVarInt(binaryString);
+        }
+    }
+    Name *adjacencyNames = st_malloc(sizeof(Name) * (capNumber + 1));
+    for (int64_t i = 0; i < capNumber; i++) {
+        if (flags[i] & CAP_COLUMNAR_ADJACENCY) {
+            adjacencyNames[i] = binaryRepresentation_getRelativeName(binaryString, flowerName);
+        }
+    }
+    Name *parentNames = st_malloc(sizeof(Name) * (capNumber + 1));
+    for (int64_t i = 0; i < capNumber; i++) {
+        if (flags[i] & CAP_COLUMNAR_PARENT) {
+            parentNames[i] = binaryRepresentation_getRelativeName(binaryString, flowerName);
+        }
+    }
+
+    //Now construct the caps, in the same order and with the same linking as cap_loadFromBinaryRepresentation.
+    EventTree *eventTree = flower_getEventTree(flower);
+    int64_t i = 0;
+    for (int64_t j = 0; j < endNumber; j++) {
+        End *end = ends[j];
+        for (int64_t k = 0; k < capNumbers[j]; k++, i++) {
+            Cap *cap;
+            bool strand = flags[i] & CAP_COLUMNAR_STRAND;
+            switch (flags[i] & CAP_COLUMNAR_TYPE_MASK) {
+                case CAP_COLUMNAR_NO_COORDINATES:
+                    cap = cap_construct3(names[i], eventTree_getEvent(eventTree, sequenceOrEventNames[i]), end);
+                    cap_setCoordinates(cap, INT64_MAX, strand, NULL); //Hacks
+                    break;
+                case CAP_COLUMNAR_WITH_COORDINATES: {
+                    Sequence *sequence = flower_getSequence(flower, sequenceOrEventNames[i]);
+                    assert(sequence != NULL);
+                    cap = cap_construct4(names[i], end, coordinates[i] + sequence_getStart(sequence), strand, sequence);
+                    break;
+                }
+                default:
+                    assert((flags[i] & CAP_COLUMNAR_TYPE_MASK) == CAP_COLUMNAR_WITH_COORDINATES_BUT_NO_SEQUENCE);
+                    cap = cap_construct3(names[i], eventTree_getEvent(eventTree, sequenceOrEventNames[i]), end);
+                    cap_setCoordinates(cap, coordinates[i], strand, NULL);
+            }
+            if (flags[i] & CAP_COLUMNAR_ADJACENCY) {
+                Cap *adjacentCap = flower_getCap(flower, adjacencyNames[i]);
+                if (adjacentCap != NULL) { //if null we'll make the adjacency when the other cap is constructed.
+                    cap_makeAdjacent(adjacentCap, cap);
+                }
+            }
+            if (flags[i] & CAP_COLUMNAR_PARENT) {
+                Cap *parentCap = flower_getCap(flower, parentNames[i]);
+                assert(parentCap != NULL);
+                cap_makeParentAndChild(parentCap, cap);
+            }
+            if (k == 0 && (endFlags[j] & END_COLUMNAR_PHYLOGENY)) {
+                end_setRootInstance(end, cap);
+            }
+        }
+    }
+    assert(i == capNumber);
+    free(names);
+    free(flags);
+    free(sequenceOrEventNames);
+    free(coordinates);
+    free(adjacencyNames);
+    free(parentNames);
+}
+
+static Flower *flower_loadFromColumnarBinaryRepresentation(void **binaryString, CactusDisk *cactusDisk) {
+    binaryRepresentation_popNextElementType(binaryString);
+    Name flowerName = binaryRepresentation_getVarInt(binaryString);
+    Flower *flower = flower_construct3(flowerName, cactusDisk);
+    int64_t flowerFlags = binaryRepresentation_getVarInt(binaryString);
+    flower_setBuiltBlocks(flower, flowerFlags & FLOWER_COLUMNAR_BUILT_BLOCKS);
+    flower_setBuiltTrees(flower, flowerFlags & FLOWER_COLUMNAR_BUILT_TREES);
+    flower->parentFlowerName = binaryRepresentation_getRelativeName(binaryString, flowerName);
+
+    //Sequences
+    int64_t sequenceNumber = binaryRepresentation_getVarInt(binaryString);
+    for (int64_t i = 0; i < sequenceNumber; i++) {
+        sequence_construct(cactusDisk_getMetaSequence(cactusDisk,
+                binaryRepresentation_getRelativeName(binaryString, flowerName)), flower);
+    }
+
+    //Ends and caps
+    int64_t endNumber = binaryRepresentation_getVarInt(binaryString);
+    Name *endNames = flower_getNameColumn(binaryString, endNumber, flowerName);
+    int64_t *endFlags = flower_getVarIntColumn(binaryString, endNumber);
+    int64_t *capNumbers = flower_getVarIntColumn(binaryString, endNumber);
+    End **ends = st_malloc(sizeof(End *) * (endNumber + 1));
+    for (int64_t i = 0; i < endNumber; i++) {
+        ends[i] = end_construct3(endNames[i], endFlags[i] & END_COLUMNAR_STUB, (endFlags[i] & END_COLUMNAR_ATTACHED) != 0,
+                (endFlags[i] & END_COLUMNAR_SIDE) != 0, flower);
+    }
+    flower_loadCapsFromColumnarBinaryRepresentation(binaryString, flower, ends, endFlags, capNumbers, endNumber);
+    free(endNames);
+    free(endFlags);
+    free(capNumbers);
+    free(ends);
+
+    //Blocks and segments
+    int64_t blockNumber = binaryRepresentation_getVarInt(binaryString);
+    Name *blockNames = flower_getNameColumn(binaryString, blockNumber, flowerName);
+    int64_t *blockLengths = flower_getVarIntColumn(binaryString, blockNumber);
+    Name *leftEndNames = flower_getNameColumn(binaryString, blockNumber, flowerName);
+    Name *rightEndNames = flower_getNameColumn(binaryString, blockNumber, flowerName);
+    int64_t *segmentNumbers = flower_getVarIntColumn(binaryString, blockNumber);
+    int64_t segmentNumber = flower_sumColumn(segmentNumbers, blockNumber);
+    Name *segmentNames = flower_getNameColumn(binaryString, segmentNumber, flowerName);
+    Name *_5CapNames = flower_getNameColumn(binaryString, segmentNumber, flowerName);
+    Name *_3CapNames = flower_getNameColumn(binaryString, segmentNumber, flowerName);
+    for (int64_t i = 0, j = 0; i < blockNumber; i++) {
+        Block *block = block_construct2(blockNames[i], blockLengths[i], flower_getEnd(flower, leftEndNames[i]),
+                flower_getEnd(flower, rightEndNames[i]), flower);
+        for (int64_t k = 0; k < segmentNumbers[i]; k++, j++) {
+            segment_construct3(segmentNames[j], block, end_getInstance(block_get5End(block), _5CapNames[j]),
+                    end_getInstance(block_get3End(block), _3CapNames[j]));
+        }
+    }
+    free(blockNames);
+    free(blockLengths);
+    free(leftEndNames);
+    free(rightEndNames);
+    free(segmentNumbers);
+    free(segmentNames);
+    free(_5CapNames);
+    free(_3CapNames);
+
+    //Groups
+    int64_t groupNumber = binaryRepresentation_getVarInt(binaryString);
+    Name *groupNames = flower_getNameColumn(binaryString, groupNumber, flowerName);
+    int64_t *terminalGroups = flower_getVarIntColumn(binaryString, groupNumber);
+    int64_t *groupEndNumbers = flower_getVarIntColumn(binaryString, groupNumber);
+    for (int64_t i = 0; i < groupNumber; i++) {
+        Group *group = group_construct4(flower, groupNames[i], terminalGroups[i]);
+        for (int64_t j = 0; j < groupEndNumbers[i]; j++) {
+            end_setGroup(flower_getEnd(flower, binaryRepresentation_getRelativeName(binaryString, flowerName)), group);
+        }
+    }
+    free(groupNames);
+    free(terminalGroups);
+    free(groupEndNumbers);
+
+    //Chains and links
+    int64_t chainNumber = binaryRepresentation_getVarInt(binaryString);
+    Name *chainNames = flower_getNameColumn(binaryString, chainNumber, flowerName);
+    int64_t *linkNumbers = flower_getVarIntColumn(binaryString, chainNumber);
+    int64_t linkNumber = flower_sumColumn(linkNumbers, chainNumber);
+    Name *linkGroupNames = flower_getNameColumn(binaryString, linkNumber, flowerName);
+    Name *_3EndNames = flower_getNameColumn(binaryString, linkNumber, flowerName);
+    Name *_5EndNames = flower_getNameColumn(binaryString, linkNumber, flowerName);
+    for (int64_t i = 0, j = 0; i < chainNumber; i++) {
+        Chain *chain = chain_construct2(chainNames[i], flower);
+        for (int64_t k = 0; k < linkNumbers[i]; k++, j++) {
+            link_construct(flower_getEnd(flower, _3EndNames[j]), flower_getEnd(flower, _5EndNames[j]),
+                    flower_getGroup(flower, linkGroupNames[j]), chain);
+        }
+    }
+    free(chainNames);
+    free(linkNumbers);
+    free(linkGroupNames);
+    free(_3EndNames);
+    free(_5EndNames);
+
+    flower_setBuildFaces(flower, flowerFlags & FLOWER_COLUMNAR_BUILT_FACES);
+    assert(binaryRepresentation_peekNextElementType(*binaryString) == CODE_FLOWER_COLUMNAR);
+    binaryRepresentation_popNextElementType(binaryString);
+    return flower;
+}
+
 Flower *flower_loadFromBinaryRepresentation(void **binaryString, CactusDisk *cactusDisk) {
     Flower *flower = NULL;
     bool buildFaces;
-    if (binaryRepresentation_peekNextElementType(*binaryString) == CODE_FLOWER) {
+    if (binaryRepresentation_peekNextElementType(*binaryString) == CODE_FLOWER_COLUMNAR) {
+        flower = flower_loadFromColumnarBinaryRepresentation(binaryString, cactusDisk);
+    } else if (binaryRepresentation_peekNextElementType(*binaryString) == CODE_FLOWER) {
         binaryRepresentation_popNextElementType(binaryString);
         flower = flower_construct3(binaryRepresentation_getName(binaryString), cactusDisk);
         flower_setBuiltBlocks(flower, binaryRepresentation_getBool(binaryString));
@@ -152,13 +152,21 @@ void flower_reconstructFaces(Flower * flower);
 void flower_destructFaces(Flower *flower);
 
 /*
- * Write a binary representation of the flower to the write function.
+ * Write a binary representation of the flower to the write function. This uses the compact,
+ * columnar encoding (see CODE_FLOWER_COLUMNAR).
  */
 void flower_writeBinaryRepresentation(Flower *flower, void(*writeFn)(const void * ptr,
         size_t size, size_t count));
 
 /*
- * Loads a flower into memory from a binary representation of the flower.
+ * Write a binary representation of the flower in the original, element by element encoding
+ * (see CODE_FLOWER).
+ */
+void flower_writeLegacyBinaryRepresentation(Flower *flower, void(*writeFn)(const void * ptr,
+        size_t size, size_t count));
+
+/*
+ * Loads a flower into memory from a binary representation of the flower, in either encoding.
  */
 Flower *flower_loadFromBinaryRepresentation(void **binaryString, CactusDisk *cactusDisk);
 
@@ -174,6 +174,59 @@ stList *flowerWriter_parseFlowersFromStdin(CactusDisk *cactusDisk) {
     return flowers;
 }
 
+/*
+ * The state used by a prefetching flower stream. While the caller works on the current flower a
+ * background thread reads the records of the next batch of flowers from the database, along with
+ * the nested flowers and segment strings of the next flower in the current batch. Only database reads
+ * happen on the thread; the records are deserialised by the caller's thread when they are handed over.
+ */
+typedef struct _flowerStreamPrefetcher {
+    bool preCacheNestedFlowers;
+    bool preCacheSegmentStrings;
+    CactusDiskPrefetch *nextBatch; //The records of the next batch of flowers, or NULL.
+    CactusDiskPrefetch *nextFlower; //The nested flowers and strings of the next flower in the current batch, or NULL.
+    pthread_t thread;
+    bool fetching; //True if the thread is running.
+} FlowerStreamPrefetcher;
+
+static void *flowerStreamPrefetcher_fetch(void *arg) {
+    FlowerStreamPrefetcher *prefetcher = arg;
+    if (prefetcher->nextFlower != NULL) { //Wanted first, so fetched first.
+        cactusDiskPrefetch_fetch(prefetcher->nextFlower);
+    }
+    if (prefetcher->nextBatch != NULL) {
+        cactusDiskPrefetch_fetch(prefetcher->nextBatch);
+    }
+    return NULL;
+}
+
+static void flowerStreamPrefetcher_start(FlowerStreamPrefetcher *prefetcher) {
+    assert(!prefetcher->fetching);
+    if (prefetcher->nextFlower == NULL && prefetcher->nextBatch == NULL) {
+        return;
+    }
+    // If we can't get a thread, the fetches are just done when the records are needed.
+    prefetcher->fetching = pthread_create(&prefetcher->thread, NULL, flowerStreamPrefetcher_fetch, prefetcher) == 0;
+}
+
+static void flowerStreamPrefetcher_wait(FlowerStreamPrefetcher *prefetcher) {
+    if (prefetcher->fetching) {
+        pthread_join(prefetcher->thread, NULL);
+        prefetcher->fetching = 0;
+    }
+}
+
+static void flowerStreamPrefetcher_destruct(FlowerStreamPrefetcher *prefetcher) {
+    flowerStreamPrefetcher_wait(prefetcher);
+    if (prefetcher->nextBatch != NULL) {
+        cactusDiskPrefetch_destruct(prefetcher->nextBatch);
+    }
+    if (prefetcher->nextFlower != NULL) {
+        cactusDiskPrefetch_destruct(prefetcher->nextFlower);
+    }
+    free(prefetcher);
+}
+
 static FlowerStream *flowerStream_construct(stList *flowerNames, CactusDisk *cactusDisk) {
     FlowerStream *ret = malloc(sizeof(FlowerStream));
     ret->flowerNames = flowerNames;
@@ -181,6 +234,7 @@ static FlowerStream *flowerStream_construct(stList *flowerNames, CactusDisk *cac
     ret->curFlower = NULL;
     ret->nextIdx = 0;
     ret->cactusDisk = cactusDisk;
+    ret->prefetcher = NULL;
     return ret;
 }
 
@@ -189,7 +243,19 @@ FlowerStream *flowerWriter_getFlowerStream(CactusDisk *cactusDisk, FILE *file) {
     return flowerStream_construct(flowerNamesList, cactusDisk);
 }
 
+FlowerStream *flowerWriter_getPrefetchingFlowerStream(CactusDisk *cactusDisk, FILE *file, bool preCacheNestedFlowers,
+        bool preCacheSegmentStrings) {
+    FlowerStream *flowerStream = flowerWriter_getFlowerStream(cactusDisk, file);
+    flowerStream->prefetcher = st_calloc(1, sizeof(FlowerStreamPrefetcher));
+    flowerStream->prefetcher->preCacheNestedFlowers = preCacheNestedFlowers;
+    flowerStream->prefetcher->preCacheSegmentStrings = preCacheSegmentStrings;
+    return flowerStream;
+}
+
 void flowerStream_destruct(FlowerStream *flowerStream) {
+    if (flowerStream->prefetcher != NULL) {
+        flowerStreamPrefetcher_destruct(flowerStream->prefetcher);
+    }
     if (flowerStream->curFlower != NULL) {
         flower_destruct(flowerStream->curFlower, false);
     }
@@ -198,6 +264,105 @@ void flowerStream_destruct(FlowerStream *flowerStream) {
     free(flowerStream);
 }
 
+static stList *flowerStream_getBatchNames(FlowerStream *flowerStream, int64_t batchStart) {
+    /*
+     * Gets the names of the batch of flowers starting at the given index.
+     */
+    int64_t batchEnd = batchStart + FLOWER_STREAM_BATCH_SIZE;
+    if (batchEnd > stList_length(flowerStream->flowerNames)) {
+        batchEnd = stList_length(flowerStream->flowerNames);
+    }
+    stList *namesBatch = stList_construct2(batchEnd - batchStart);
+    for (int64_t i = batchStart; i < batchEnd; i++) {
+        stList_set(namesBatch, i - batchStart, stList_get(flowerStream->flowerNames, i));
+    }
+    // We want to be able to treat the batch like a stack and get
+    // the same order, so we reverse it.
+    stList_reverse(namesBatch);
+    return namesBatch;
+}
+
+static CactusDiskPrefetch *flowerStream_getFlowerPrefetch(FlowerStream *flowerStream, Flower *flower) {
+    /*
+     * Gets a prefetch of what the caller will want to precache for the given flower, or NULL if nothing.
+     */
+    FlowerStreamPrefetcher *prefetcher = flowerStream->prefetcher;
+    if (!prefetcher->preCacheNestedFlowers && !prefetcher->preCacheSegmentStrings) {
+        return NULL;
+    }
+    stList *nestedFlowerNames = stList_construct3(0, free);
+    if (prefetcher->preCacheNestedFlowers) {
+        Flower_GroupIterator *groupIt = flower_getGroupIterator(flower);
+        Group *group;
+        while ((group = flower_getNextGroup(groupIt)) != NULL) {
+            if (!group_isLeaf(group)) {
+                int64_t *iA = st_malloc(sizeof(int64_t));
+                iA[0] = group_getName(group);
+                stList_append(nestedFlowerNames, iA);
+            }
+        }
+        flower_destructGroupIterator(groupIt);
+    }
+    stList *flowers = stList_construct();
+    stList_append(flowers, flower);
+    CactusDiskPrefetch *prefetch = cactusDiskPrefetch_construct(flowerStream->cactusDisk, nestedFlowerNames,
+            prefetcher->preCacheSegmentStrings ? flowers : NULL);
+    stList_destruct(flowers);
+    stList_destruct(nestedFlowerNames);
+    return prefetch;
+}
+
+static void flowerStream_loadFlowerPrefetch(CactusDiskPrefetch *prefetch) {
+    stList_destruct(cactusDiskPrefetch_loadFlowers(prefetch));
+    cactusDiskPrefetch_cacheStrings(prefetch);
+    cactusDiskPrefetch_destruct(prefetch);
+}
+
+static Flower *flowerStream_getNextPrefetched(FlowerStream *flowerStream) {
+    FlowerStreamPrefetcher *prefetcher = flowerStream->prefetcher;
+    flowerStreamPrefetcher_wait(prefetcher);
+    if (stList_length(flowerStream->flowerBatch) == 0) {
+        assert(prefetcher->nextFlower == NULL);
+        if (prefetcher->nextBatch == NULL) {
+            // The first batch, which has not been prefetched.
+            stList *namesBatch = flowerStream_getBatchNames(flowerStream, flowerStream->nextIdx);
+            prefetcher->nextBatch = cactusDiskPrefetch_construct(flowerStream->cactusDisk, namesBatch, NULL);
+            stList_destruct(namesBatch);
+        }
+        stList_destruct(flowerStream->flowerBatch);
+        flowerStream->flowerBatch = cactusDiskPrefetch_loadFlowers(prefetcher->nextBatch);
+        cactusDiskPrefetch_destruct(prefetcher->nextBatch);
+        prefetcher->nextBatch = NULL;
+        // Start on the batch after.
+        int64_t nextBatchStart = flowerStream->nextIdx + stList_length(flowerStream->flowerBatch);
+        if (nextBatchStart < stList_length(flowerStream->flowerNames)) {
+            stList *namesBatch = flowerStream_getBatchNames(flowerStream, nextBatchStart);
+            prefetcher->nextBatch = cactusDiskPrefetch_construct(flowerStream->cactusDisk, namesBatch, NULL);
+            stList_destruct(namesBatch);
+        }
+    }
+    flowerStream->curFlower = stList_pop(flowerStream->flowerBatch);
+    flowerStream->nextIdx++;
+
+    // Get the nested flowers and strings of this flower, which will have been prefetched unless it is the first of
+    // its batch.
+    CactusDiskPrefetch *prefetch = prefetcher->nextFlower;
+    if (prefetch == NULL) {
+        prefetch = flowerStream_getFlowerPrefetch(flowerStream, flowerStream->curFlower);
+    }
+    prefetcher->nextFlower = NULL;
+    if (prefetch != NULL) {
+        flowerStream_loadFlowerPrefetch(prefetch);
+    }
+
+    // Now prefetch for the next flower while the caller works on this one.
+    if (stList_length(flowerStream->flowerBatch) > 0) {
+        prefetcher->nextFlower = flowerStream_getFlowerPrefetch(flowerStream, stList_peek(flowerStream->flowerBatch));
+    }
+    flowerStreamPrefetcher_start(prefetcher);
+    return flowerStream->curFlower;
+}
+
 Flower *flowerStream_getNext(FlowerStream *flowerStream) {
     if (flowerStream->curFlower != NULL) {
         // Unload the previously loaded flower.
@@ -207,21 +372,13 @@ Flower *flowerStream_getNext(FlowerStream *flowerStream) {
         flowerStream->curFlower = NULL;
         return NULL;
     }
+    if (flowerStream->prefetcher != NULL) {
+        return flowerStream_getNextPrefetched(flowerStream);
+    }
     if (stList_length(flowerStream->flowerBatch) == 0) {
         // Time to load the next batch of flowers from the DB.
         // Get the next batch of names.
-        int64_t batchStart = flowerStream->nextIdx;
-        int64_t batchEnd = flowerStream->nextIdx + FLOWER_STREAM_BATCH_SIZE;
-        if (batchEnd > stList_length(flowerStream->flowerNames)) {
-            batchEnd = stList_length(flowerStream->flowerNames);
-        }
-        stList *namesBatch = stList_construct2(batchEnd - batchStart);
-        for (int64_t i = batchStart; i < batchEnd; i++) {
-            stList_set(namesBatch, i - batchStart, stList_get(flowerStream->flowerNames, i));
-        }
-        // We want to be able to treat the batch like a stack and get
-        // the same order, so we reverse it.
-        stList_reverse(namesBatch);
+        stList *namesBatch = flowerStream_getBatchNames(flowerStream, flowerStream->nextIdx);
         stList_destruct(flowerStream->flowerBatch);
         flowerStream->flowerBatch = cactusDisk_getFlowers(flowerStream->cactusDisk, namesBatch);
         stList_destruct(namesBatch);
@@ -58,7 +58,14 @@
 #include "cactusSequence.h"
 #include "cactusSequencePrivate.h"
 #include "cactusSerialisation.h"
+#include "cactusPackedSequence.h"
+#include "cactusCache.h"
+#include "cactusLocalDatabase.h"
+#include "cactusIDAllocator.h"
 #include "cactusTestCommon.h"
 #include "cactusFlowerWriter.h"
+#include "cactusStringView.h"
+#include "cactusStringViewPrivate.h"
+#include "cactusProfile.h"
 
 #endif
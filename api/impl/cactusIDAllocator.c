@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include "cactusIDAllocator.h"
+#include <sys/time.h>
+
+/*
+ * A lease used up in less than the first period is followed by one twice as big, a lease lasting longer than the
+ * second by one half the size.
+ */
+#define CACTUS_ID_ALLOCATOR_GROW_SECONDS 2.0
+#define CACTUS_ID_ALLOCATOR_SHRINK_SECONDS 60.0
+
+const char *CACTUS_ID_ALLOCATOR_EXCEPTION_ID = "CACTUS_ID_ALLOCATOR_EXCEPTION_ID";
+
+struct _cactusIDAllocator {
+    int64_t (*leaseFn)(void *extraArg, int64_t leaseSize);
+    void *extraArg;
+    pthread_mutex_t lock;
+    int64_t nextID; //The next unused ID of the current lease.
+    int64_t endID; //One past the last ID of the current lease.
+    int64_t leaseSize;
+    int64_t leaseNumber;
+    double leaseTime; //When the current lease was taken.
+};
+
+static double getTime(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec / 1000000.0;
+}
+
+CactusIDAllocator *cactusIDAllocator_construct(int64_t (*leaseFn)(void *extraArg, int64_t leaseSize),
+        void *extraArg) {
+    CactusIDAllocator *allocator = st_malloc(sizeof(CactusIDAllocator));
+    allocator->leaseFn = leaseFn;
+    allocator->extraArg = extraArg;
+    pthread_mutex_init(&allocator->lock, NULL);
+    allocator->nextID = 0;
+    allocator->endID = 0;
+    allocator->leaseSize = CACTUS_ID_ALLOCATOR_MINIMUM_LEASE;
+    allocator->leaseNumber = 0;
+    allocator->leaseTime = 0.0;
+    return allocator;
+}
+
+void cactusIDAllocator_destruct(CactusIDAllocator *allocator) {
+    pthread_mutex_destroy(&allocator->lock);
+    free(allocator);
+}
+
+static void adaptLeaseSize(CactusIDAllocator *allocator, double time) {
+    if (allocator->leaseNumber == 0) {
+        return;
+    }
+    double leaseDuration = time - allocator->leaseTime;
+    if (leaseDuration < CACTUS_ID_ALLOCATOR_GROW_SECONDS) {
+        if (allocator->leaseSize < CACTUS_ID_ALLOCATOR_MAXIMUM_LEASE) {
+            allocator->leaseSize *= 2;
+        }
+    } else if (leaseDuration > CACTUS_ID_ALLOCATOR_SHRINK_SECONDS) {
+        if (allocator->leaseSize > CACTUS_ID_ALLOCATOR_MINIMUM_LEASE) {
+            allocator->leaseSize /= 2;
+        }
+    }
+}
+
+int64_t cactusIDAllocator_getInterval(CactusIDAllocator *allocator, int64_t intervalSize) {
+    assert(intervalSize >= 0);
+    pthread_mutex_lock(&allocator->lock);
+    if (allocator->endID - allocator->nextID < intervalSize) {
+        double time = getTime();
+        adaptLeaseSize(allocator, time);
+        int64_t leaseSize = intervalSize > allocator->leaseSize ? intervalSize : allocator->leaseSize;
+        stTry {
+            allocator->nextID = allocator->leaseFn(allocator->extraArg, leaseSize);
+        } stCatch(except) {
+            pthread_mutex_unlock(&allocator->lock);
+            stThrowNewCause(except, CACTUS_ID_ALLOCATOR_EXCEPTION_ID, "Could not lease %" PRIi64 " unique IDs",
+                    leaseSize);
+        } stTryEnd;
+        allocator->endID = allocator->nextID + leaseSize;
+        allocator->leaseNumber++;
+        allocator->leaseTime = time;
+        st_logDebug("Leased %" PRIi64 " unique IDs starting from %" PRIi64 "\n", leaseSize, allocator->nextID);
+    }
+    int64_t id = allocator->nextID;
+    allocator->nextID += intervalSize;
+    pthread_mutex_unlock(&allocator->lock);
+    return id;
+}
+
+int64_t cactusIDAllocator_getLeaseSize(CactusIDAllocator *allocator) {
+    pthread_mutex_lock(&allocator->lock);
+    int64_t leaseSize = allocator->leaseSize;
+    pthread_mutex_unlock(&allocator->lock);
+    return leaseSize;
+}
+
+int64_t cactusIDAllocator_getLeaseNumber(CactusIDAllocator *allocator) {
+    pthread_mutex_lock(&allocator->lock);
+    int64_t leaseNumber = allocator->leaseNumber;
+    pthread_mutex_unlock(&allocator->lock);
+    return leaseNumber;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_ID_ALLOCATOR_H_
+#define CACTUS_ID_ALLOCATOR_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Allocation of unique IDs from leased ranges.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * Hands out unique IDs from ranges leased from a shared store, such as the database of a cactus disk. Each lease is
+ * made persistent by the lease function, once, and the IDs in it are then handed out without going back to the
+ * store. The size of the leases adapts to the rate at which they are used up: leases that are consumed quickly
+ * double in size, up to CACTUS_ID_ALLOCATOR_MAXIMUM_LEASE, and leases that last a long time halve, down to
+ * CACTUS_ID_ALLOCATOR_MINIMUM_LEASE. IDs left in a lease when the allocator is destructed are not reused.
+ * The allocator is thread safe.
+ */
+typedef struct _cactusIDAllocator CactusIDAllocator;
+
+#define CACTUS_ID_ALLOCATOR_MINIMUM_LEASE 16384
+#define CACTUS_ID_ALLOCATOR_MAXIMUM_LEASE 268435456
+
+extern const char *CACTUS_ID_ALLOCATOR_EXCEPTION_ID;
+
+/*
+ * Constructs an allocator. The lease function must reserve, persistently and atomically with respect to all other
+ * users of the store, an interval of at least leaseSize IDs, returning its first ID. It may throw an exception,
+ * which is passed on by cactusIDAllocator_getInterval.
+ */
+CactusIDAllocator *cactusIDAllocator_construct(int64_t (*leaseFn)(void *extraArg, int64_t leaseSize),
+        void *extraArg);
+
+/*
+ * Frees the allocator.
+ */
+void cactusIDAllocator_destruct(CactusIDAllocator *allocator);
+
+/*
+ * Returns the first ID of a contiguous interval of intervalSize unused IDs, leasing a new range if the current
+ * one is too small.
+ */
+int64_t cactusIDAllocator_getInterval(CactusIDAllocator *allocator, int64_t intervalSize);
+
+/*
+ * Gets the size of the next lease the allocator will take, before any adaptation.
+ */
+int64_t cactusIDAllocator_getLeaseSize(CactusIDAllocator *allocator);
+
+/*
+ * Gets the number of leases taken by the allocator.
+ */
+int64_t cactusIDAllocator_getLeaseNumber(CactusIDAllocator *allocator);
+
+#endif
@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include "cactusLocalDatabase.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+
+/*
+ * The file starts with a header page, followed by a log of entries, each an EntryHeader followed by the value
+ * padded to a multiple of eight bytes. An entry with a negative size removes its key. Only the entries before
+ * the committed length in the header are part of the database. Changes are staged in memory, laid out as log
+ * entries, and commit appends them after the committed length and then moves the committed length past them
+ * once they are on disk.
+ *
+ * Several processes may have the file open. The file is only locked while it is read into the index (shared) or
+ * written by a commit (exclusive), and each process brings its index up to date with the entries committed by
+ * the others before it reads a record and when it commits.
+ */
+
+#define LOCAL_DATABASE_MAGIC "CACTUSKV"
+#define LOCAL_DATABASE_VERSION 1
+#define LOCAL_DATABASE_HEADER_SIZE 4096
+#define LOCAL_DATABASE_INITIAL_CAPACITY 1048576
+
+const char *CACTUS_LOCAL_DATABASE_EXCEPTION_ID = "CACTUS_LOCAL_DATABASE_EXCEPTION_ID";
+
+typedef struct _fileHeader {
+    char magic[8];
+    int64_t version;
+    int64_t committedLength;
+} FileHeader;
+
+typedef struct _entryHeader {
+    int64_t key;
+    int64_t size;
+} EntryHeader;
+
+typedef struct _indexEntry {
+    int64_t key; //Must be first, the entry is its own key in the index.
+    int64_t offset; //Offset of the value in the file, or in the staged log for a staged change.
+    int64_t size; //Negative for a staged removal.
+    int64_t committedOffset; //For a staged change, the offset of the committed value it replaces, or -1 if none.
+} IndexEntry;
+
+struct _cactusLocalDatabase {
+    char *fileName;
+    int fileHandle;
+    char *map;
+    int64_t capacity; //Size of the mapping, at most the size of the file.
+    int64_t committedLength; //The length of the log read into the index.
+    stHash *index; //The committed records.
+    char *stagedLog; //The staged changes, as they will be appended to the log.
+    int64_t stagedLength;
+    int64_t stagedCapacity;
+    stHash *stagedIndex; //The staged changes.
+};
+
+static uint64_t indexEntry_hashKey(const void *key) {
+    return (uint64_t) *((int64_t *) key) * 0x9E3779B97F4A7C15ULL;
+}
+
+static int indexEntry_equalKey(const void *key1, const void *key2) {
+    return *((int64_t *) key1) == *((int64_t *) key2);
+}
+
+static stHash *index_construct(void) {
+    return stHash_construct3(indexEntry_hashKey, indexEntry_equalKey, NULL, free);
+}
+
+static IndexEntry *index_set(stHash *index, int64_t key, int64_t offset, int64_t size) {
+    IndexEntry query;
+    query.key = key;
+    IndexEntry *indexEntry = stHash_remove(index, &query);
+    if (indexEntry == NULL) {
+        indexEntry = st_malloc(sizeof(IndexEntry));
+        indexEntry->key = key;
+        indexEntry->committedOffset = -1;
+    }
+    indexEntry->offset = offset;
+    indexEntry->size = size;
+    stHash_insert(index, indexEntry, indexEntry);
+    return indexEntry;
+}
+
+static IndexEntry *index_get(stHash *index, int64_t key) {
+    IndexEntry query;
+    query.key = key;
+    return stHash_search(index, &query);
+}
+
+static void index_remove(stHash *index, int64_t key) {
+    IndexEntry query;
+    query.key = key;
+    free(stHash_remove(index, &query));
+}
+
+static int64_t roundUp(int64_t i) {
+    return (i + 7) & ~((int64_t) 7);
+}
+
+static FileHeader *getHeader(CactusLocalDatabase *database) {
+    return (FileHeader *) database->map;
+}
+
+static void lockFile(CactusLocalDatabase *database, int operation) {
+    /*
+     * Takes (LOCK_SH or LOCK_EX) or releases (LOCK_UN) the lock on the file, waiting for other processes.
+     */
+    while (flock(database->fileHandle, operation) != 0) {
+        if (errno != EINTR) {
+            stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not %s the database file %s: %s",
+                    operation == LOCK_UN ? "unlock" : "lock", database->fileName, strerror(errno));
+        }
+    }
+}
+
+static int64_t getFileSize(CactusLocalDatabase *database) {
+    struct stat fileStat;
+    if (fstat(database->fileHandle, &fileStat) != 0) {
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not get the size of the database file %s: %s",
+                database->fileName, strerror(errno));
+    }
+    return fileStat.st_size;
+}
+
+static void syncRange(CactusLocalDatabase *database, int64_t start, int64_t end) {
+    /*
+     * Flushes the given range of the mapping to disk.
+     */
+    int64_t pageSize = sysconf(_SC_PAGESIZE);
+    start = (start / pageSize) * pageSize;
+    if (end > start && msync(database->map + start, end - start, MS_SYNC) != 0) {
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not sync the database file %s: %s", database->fileName,
+                strerror(errno));
+    }
+}
+
+static void mapFile(CactusLocalDatabase *database, int64_t capacity) {
+    /*
+     * (Re)maps the first capacity bytes of the file.
+     */
+    if (database->map != NULL) {
+        munmap(database->map, database->capacity);
+        database->map = NULL;
+    }
+    void *map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, database->fileHandle, 0);
+    if (map == MAP_FAILED) {
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not map the database file %s: %s", database->fileName,
+                strerror(errno));
+    }
+    database->map = map;
+    database->capacity = capacity;
+}
+
+static void ensureCapacity(CactusLocalDatabase *database, int64_t length) {
+    /*
+     * Makes sure the file and its mapping hold at least the given length, doubling the file as needed. Must be
+     * called with the file locked exclusively, as other processes may also have grown the file.
+     */
+    if (length <= database->capacity) {
+        return;
+    }
+    int64_t capacity = getFileSize(database);
+    if (capacity < length) {
+        capacity = capacity > LOCAL_DATABASE_INITIAL_CAPACITY ? capacity : LOCAL_DATABASE_INITIAL_CAPACITY;
+        while (capacity < length) {
+            capacity *= 2;
+        }
+        if (ftruncate(database->fileHandle, capacity) != 0) {
+            stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID,
+                    "Could not extend the database file %s to %" PRIi64 " bytes: %s", database->fileName, capacity,
+                    strerror(errno));
+        }
+    }
+    mapFile(database, capacity);
+}
+
+static void readLog(CactusLocalDatabase *database) {
+    /*
+     * Adds the entries committed since the index was last read to the index. Must be called with the file locked.
+     */
+    int64_t committedLength = getHeader(database)->committedLength;
+    if (committedLength > database->capacity) { //Another process has grown the file.
+        mapFile(database, getFileSize(database));
+    }
+    if (committedLength < database->committedLength || committedLength > database->capacity) {
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "The database file %s is corrupt", database->fileName);
+    }
+    int64_t offset = database->committedLength;
+    while (offset < committedLength) {
+        EntryHeader entryHeader;
+        memcpy(&entryHeader, database->map + offset, sizeof(EntryHeader));
+        offset += sizeof(EntryHeader);
+        if (entryHeader.size >= 0) {
+            index_set(database->index, entryHeader.key, offset, entryHeader.size);
+            offset += roundUp(entryHeader.size);
+        } else {
+            index_remove(database->index, entryHeader.key);
+        }
+        if (offset > committedLength) {
+            stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "The database file %s is corrupt", database->fileName);
+        }
+    }
+    database->committedLength = committedLength;
+}
+
+static void refreshIndex(CactusLocalDatabase *database) {
+    /*
+     * Reads any entries other processes have committed into the index. The committed length in the header only
+     * grows, so an unchanged length can be seen without taking the lock.
+     */
+    if (getHeader(database)->committedLength == database->committedLength) {
+        return;
+    }
+    lockFile(database, LOCK_SH);
+    stTry
+        {
+            readLog(database);
+        }
+        stCatch(except)
+            {
+                flock(database->fileHandle, LOCK_UN);
+                stThrowNewCause(except, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not read the database file %s",
+                        database->fileName);
+            }stTryEnd
+    ;
+    lockFile(database, LOCK_UN);
+}
+
+CactusLocalDatabase *cactusLocalDatabase_construct(const char *fileName, bool create) {
+    CactusLocalDatabase *database = st_calloc(1, sizeof(CactusLocalDatabase));
+    database->fileName = stString_copy(fileName);
+    database->fileHandle = open(fileName, create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    if (database->fileHandle < 0) {
+        free(database->fileName);
+        free(database);
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not open the database file %s: %s", fileName,
+                strerror(errno));
+    }
+    database->index = index_construct();
+    database->stagedIndex = index_construct();
+    database->committedLength = LOCAL_DATABASE_HEADER_SIZE;
+    stTry
+        {
+            lockFile(database, LOCK_EX); //So that only one process sets up a new database.
+            int64_t fileSize = getFileSize(database);
+            if (fileSize == 0) {
+                //A new database.
+                ensureCapacity(database, LOCAL_DATABASE_HEADER_SIZE);
+                FileHeader *header = getHeader(database);
+                memcpy(header->magic, LOCAL_DATABASE_MAGIC, 8);
+                header->version = LOCAL_DATABASE_VERSION;
+                header->committedLength = LOCAL_DATABASE_HEADER_SIZE;
+                syncRange(database, 0, LOCAL_DATABASE_HEADER_SIZE);
+            } else {
+                if (fileSize < LOCAL_DATABASE_HEADER_SIZE) {
+                    stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "The file %s is not a cactus local database",
+                            fileName);
+                }
+                mapFile(database, fileSize);
+                FileHeader *header = getHeader(database);
+                if (memcmp(header->magic, LOCAL_DATABASE_MAGIC, 8) != 0 || header->version != LOCAL_DATABASE_VERSION) {
+                    stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "The file %s is not a cactus local database",
+                            fileName);
+                }
+            }
+            readLog(database);
+            lockFile(database, LOCK_UN);
+        }
+        stCatch(except)
+            {
+                cactusLocalDatabase_destruct(database); //Closing the file releases the lock.
+                stThrowNewCause(except, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not open the database file %s",
+                        fileName);
+            }stTryEnd
+    ;
+    return database;
+}
+
+void cactusLocalDatabase_destruct(CactusLocalDatabase *database) {
+    if (database->map != NULL) {
+        munmap(database->map, database->capacity);
+    }
+    close(database->fileHandle);
+    stHash_destruct(database->index);
+    stHash_destruct(database->stagedIndex);
+    free(database->stagedLog);
+    free(database->fileName);
+    free(database);
+}
+
+void cactusLocalDatabase_deleteFromDisk(CactusLocalDatabase *database) {
+    char *fileName = stString_copy(database->fileName);
+    cactusLocalDatabase_destruct(database);
+    unlink(fileName);
+    free(fileName);
+}
+
+int64_t cactusLocalDatabase_getNumberOfRecords(CactusLocalDatabase *database) {
+    refreshIndex(database);
+    return stHash_size(database->index);
+}
+
+bool cactusLocalDatabase_containsRecord(CactusLocalDatabase *database, int64_t key) {
+    refreshIndex(database);
+    return index_get(database->index, key) != NULL;
+}
+
+void *cactusLocalDatabase_getRecord(CactusLocalDatabase *database, int64_t key, int64_t *recordSize) {
+    refreshIndex(database);
+    IndexEntry *indexEntry = index_get(database->index, key);
+    if (indexEntry == NULL) {
+        return NULL;
+    }
+    *recordSize = indexEntry->size;
+    return memcpy(st_malloc(indexEntry->size > 0 ? indexEntry->size : 1), database->map + indexEntry->offset,
+            indexEntry->size);
+}
+
+stList *cactusLocalDatabase_bulkGetRecords(CactusLocalDatabase *database, stList *keys) {
+    stList *results = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        int64_t recordSize = 0;
+        void *record = cactusLocalDatabase_getRecord(database, *((int64_t *) stList_get(keys, i)), &recordSize);
+        stList_append(results, stKVDatabaseBulkResult_construct(record, recordSize));
+    }
+    return results;
+}
+
+static bool containsStagedRecord(CactusLocalDatabase *database, int64_t key) {
+    IndexEntry *indexEntry = index_get(database->stagedIndex, key);
+    if (indexEntry != NULL) {
+        return indexEntry->size >= 0;
+    }
+    return cactusLocalDatabase_containsRecord(database, key);
+}
+
+static void stageEntry(CactusLocalDatabase *database, int64_t key, const void *value, int64_t size) {
+    /*
+     * Appends an entry to the staged log, noting which committed value it replaces the first time the key is staged.
+     */
+    int64_t entryLength = sizeof(EntryHeader) + roundUp(size > 0 ? size : 0);
+    if (database->stagedLength + entryLength > database->stagedCapacity) {
+        database->stagedCapacity = 2 * (database->stagedLength + entryLength);
+        database->stagedLog = st_realloc(database->stagedLog, database->stagedCapacity);
+    }
+    EntryHeader entryHeader;
+    entryHeader.key = key;
+    entryHeader.size = size;
+    memcpy(database->stagedLog + database->stagedLength, &entryHeader, sizeof(EntryHeader));
+    if (size > 0) {
+        memcpy(database->stagedLog + database->stagedLength + sizeof(EntryHeader), value, size);
+    }
+    bool firstStaged = index_get(database->stagedIndex, key) == NULL;
+    IndexEntry *indexEntry = index_set(database->stagedIndex, key, database->stagedLength + sizeof(EntryHeader), size);
+    if (firstStaged) {
+        IndexEntry *committedEntry = index_get(database->index, key);
+        indexEntry->committedOffset = committedEntry != NULL ? committedEntry->offset : -1;
+    }
+    database->stagedLength += entryLength;
+}
+
+void cactusLocalDatabase_insertRecord(CactusLocalDatabase *database, int64_t key, const void *value, int64_t size) {
+    if (containsStagedRecord(database, key)) {
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Tried to insert the record %" PRIi64 " which already exists",
+                key);
+    }
+    stageEntry(database, key, value, size);
+}
+
+void cactusLocalDatabase_updateRecord(CactusLocalDatabase *database, int64_t key, const void *value, int64_t size) {
+    if (!containsStagedRecord(database, key)) {
+        stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Tried to update the record %" PRIi64 " which does not exist",
+                key);
+    }
+    stageEntry(database, key, value, size);
+}
+
+void cactusLocalDatabase_removeRecord(CactusLocalDatabase *database, int64_t key) {
+    if (containsStagedRecord(database, key)) {
+        stageEntry(database, key, NULL, -1);
+    }
+}
+
+static void commitLocked(CactusLocalDatabase *database) {
+    /*
+     * Commits the staged changes, with the file locked exclusively. Fails, changing nothing, if another process
+     * has committed a change to any of the staged records since they were staged.
+     */
+    readLog(database);
+    stHashIterator *it = stHash_getIterator(database->stagedIndex);
+    IndexEntry *indexEntry;
+    while ((indexEntry = stHash_getNext(it)) != NULL) {
+        IndexEntry *committedEntry = index_get(database->index, indexEntry->key);
+        if ((committedEntry != NULL ? committedEntry->offset : -1) != indexEntry->committedOffset) {
+            stHash_destructIterator(it);
+            stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID,
+                    "The record %" PRIi64 " was changed by another process before the commit", indexEntry->key);
+        }
+    }
+    stHash_destructIterator(it);
+    //First get the entries on disk, then move the committed length past them.
+    int64_t start = database->committedLength;
+    ensureCapacity(database, start + database->stagedLength);
+    memcpy(database->map + start, database->stagedLog, database->stagedLength);
+    syncRange(database, start, start + database->stagedLength);
+    getHeader(database)->committedLength = start + database->stagedLength;
+    syncRange(database, 0, LOCAL_DATABASE_HEADER_SIZE);
+    database->committedLength = start + database->stagedLength;
+    //Now make the changes visible.
+    it = stHash_getIterator(database->stagedIndex);
+    while ((indexEntry = stHash_getNext(it)) != NULL) {
+        if (indexEntry->size >= 0) {
+            index_set(database->index, indexEntry->key, start + indexEntry->offset, indexEntry->size);
+        } else {
+            index_remove(database->index, indexEntry->key);
+        }
+    }
+    stHash_destructIterator(it);
+    cactusLocalDatabase_abort(database);
+}
+
+void cactusLocalDatabase_commit(CactusLocalDatabase *database) {
+    if (database->stagedLength == 0) {
+        return;
+    }
+    lockFile(database, LOCK_EX);
+    stTry
+        {
+            commitLocked(database);
+        }
+        stCatch(except)
+            {
+                flock(database->fileHandle, LOCK_UN);
+                stThrowNewCause(except, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not commit to the database file %s",
+                        database->fileName);
+            }stTryEnd
+    ;
+    lockFile(database, LOCK_UN);
+}
+
+void cactusLocalDatabase_abort(CactusLocalDatabase *database) {
+    database->stagedLength = 0;
+    stHash_destruct(database->stagedIndex);
+    database->stagedIndex = index_construct();
+}
+
+void cactusLocalDatabase_insertInt64(CactusLocalDatabase *database, int64_t key, int64_t value) {
+    cactusLocalDatabase_insertRecord(database, key, &value, sizeof(int64_t));
+    cactusLocalDatabase_commit(database);
+}
+
+int64_t cactusLocalDatabase_incrementInt64(CactusLocalDatabase *database, int64_t key, int64_t incrementAmount) {
+    /*
+     * As with the database servers, a missing record is treated as zero. The record is read and written under one
+     * exclusive lock, so increments from different processes are never lost.
+     */
+    int64_t value = incrementAmount;
+    lockFile(database, LOCK_EX);
+    stTry
+        {
+            readLog(database);
+            IndexEntry *indexEntry = index_get(database->index, key);
+            if (indexEntry != NULL) {
+                if (indexEntry->size != sizeof(int64_t)) {
+                    stThrowNew(CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "The record %" PRIi64 " is not an integer", key);
+                }
+                int64_t oldValue;
+                memcpy(&oldValue, database->map + indexEntry->offset, sizeof(int64_t));
+                value += oldValue;
+            }
+            stageEntry(database, key, &value, sizeof(int64_t));
+            commitLocked(database);
+        }
+        stCatch(except)
+            {
+                flock(database->fileHandle, LOCK_UN);
+                stThrowNewCause(except, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, "Could not increment the record %" PRIi64
+                        "", key);
+            }stTryEnd
+    ;
+    lockFile(database, LOCK_UN);
+    return value;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_LOCAL_DATABASE_H_
+#define CACTUS_LOCAL_DATABASE_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//An embedded key/value database, used by the cactus disk in place of a database server.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * The database is a single memory mapped file, holding a log of records with an index in memory. Changes
+ * are staged by the insert, update and remove functions and made durable together by
+ * cactusLocalDatabase_commit, so a crash leaves the database as it was at the last commit. Several processes may
+ * use the file at once: the file is locked only while a process reads in or commits changes, and each sees the
+ * changes the others have committed. The functions are not thread safe.
+ */
+typedef struct _cactusLocalDatabase CactusLocalDatabase;
+
+extern const char *CACTUS_LOCAL_DATABASE_EXCEPTION_ID;
+
+/*
+ * Opens the database in the given file, creating the file if 'create' is non-zero.
+ */
+CactusLocalDatabase *cactusLocalDatabase_construct(const char *fileName, bool create);
+
+/*
+ * Closes the database, discarding any uncommitted changes.
+ */
+void cactusLocalDatabase_destruct(CactusLocalDatabase *database);
+
+/*
+ * Closes the database and deletes its file.
+ */
+void cactusLocalDatabase_deleteFromDisk(CactusLocalDatabase *database);
+
+/*
+ * Gets the number of committed records.
+ */
+int64_t cactusLocalDatabase_getNumberOfRecords(CactusLocalDatabase *database);
+
+/*
+ * Returns non-zero if there is a committed record with the given key.
+ */
+bool cactusLocalDatabase_containsRecord(CactusLocalDatabase *database, int64_t key);
+
+/*
+ * Gets a copy of the committed record with the given key, placing its size in recordSize, or
+ * returns NULL if there is no such record.
+ */
+void *cactusLocalDatabase_getRecord(CactusLocalDatabase *database, int64_t key, int64_t *recordSize);
+
+/*
+ * Gets the records for a list of int64_t keys, as a list of stKVDatabaseBulkResult, as stKVDatabase_bulkGetRecords.
+ * Missing records have a NULL value.
+ */
+stList *cactusLocalDatabase_bulkGetRecords(CactusLocalDatabase *database, stList *keys);
+
+/*
+ * Stages a new record. Throws an exception if the record already exists.
+ */
+void cactusLocalDatabase_insertRecord(CactusLocalDatabase *database, int64_t key, const void *value, int64_t size);
+
+/*
+ * Stages a new value for an existing record. Throws an exception if the record does not exist.
+ */
+void cactusLocalDatabase_updateRecord(CactusLocalDatabase *database, int64_t key, const void *value, int64_t size);
+
+/*
+ * Stages the removal of a record. Does nothing if the record does not exist.
+ */
+void cactusLocalDatabase_removeRecord(CactusLocalDatabase *database, int64_t key);
+
+/*
+ * Makes the staged changes durable and visible, atomically. Throws an exception, committing nothing, if
+ * another process has committed a change to any of the staged records since it was staged.
+ */
+void cactusLocalDatabase_commit(CactusLocalDatabase *database);
+
+/*
+ * Discards the staged changes.
+ */
+void cactusLocalDatabase_abort(CactusLocalDatabase *database);
+
+/*
+ * Inserts and commits an integer record. Throws an exception if the record already exists.
+ */
+void cactusLocalDatabase_insertInt64(CactusLocalDatabase *database, int64_t key, int64_t value);
+
+/*
+ * Adds the given amount to an integer record and commits it, returning the new value.
+ */
+int64_t cactusLocalDatabase_incrementInt64(CactusLocalDatabase *database, int64_t key, int64_t incrementAmount);
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include <ctype.h>
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Packed sequence functions.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+#define PACKED_SEQUENCE_HEADER_SIZE (3 * sizeof(uint32_t))
+#define PACKED_SEQUENCE_RUN_SIZE (2 * sizeof(uint32_t))
+
+static const char *packedSequence_bases = "ACGT";
+
+static int64_t packedSequence_baseCode(char c) {
+    switch (c) {
+        case 'A':
+            return 0;
+        case 'C':
+            return 1;
+        case 'G':
+            return 2;
+        case 'T':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+static uint32_t packedSequence_getUInt32(const char *cA, int64_t index) {
+    uint32_t i;
+    memcpy(&i, cA + index * sizeof(uint32_t), sizeof(uint32_t));
+    return i;
+}
+
+static void packedSequence_setUInt32(char *cA, int64_t index, uint32_t i) {
+    memcpy(cA + index * sizeof(uint32_t), &i, sizeof(uint32_t));
+}
+
+typedef struct _packedSequenceRuns {
+    /*
+     * Temporary store of the runs used while encoding.
+     */
+    uint32_t *runs;
+    char *characters;
+    int64_t runNumber;
+} PackedSequenceRuns;
+
+static void packedSequenceRuns_add(PackedSequenceRuns *runs, int64_t position, char c) {
+    /*
+     * Extends the last run if it is adjacent and of the same character, else starts a new run.
+     */
+    if (runs->runNumber > 0) {
+        int64_t i = runs->runNumber - 1;
+        if (runs->runs[2 * i] + runs->runs[2 * i + 1] == position && runs->characters[i] == c) {
+            runs->runs[2 * i + 1]++;
+            return;
+        }
+    }
+    runs->runs[2 * runs->runNumber] = position;
+    runs->runs[2 * runs->runNumber + 1] = 1;
+    runs->characters[runs->runNumber++] = c;
+}
+
+void *packedSequence_encode(const char *string, int64_t length, int64_t *recordSize) {
+    assert(length >= 0);
+    assert(length <= UINT32_MAX);
+    PackedSequenceRuns caseRuns, exceptionRuns;
+    caseRuns.runs = st_malloc(PACKED_SEQUENCE_RUN_SIZE * (length + 1));
+    caseRuns.characters = st_malloc(sizeof(char) * (length + 1));
+    caseRuns.runNumber = 0;
+    exceptionRuns.runs = st_malloc(PACKED_SEQUENCE_RUN_SIZE * (length + 1));
+    exceptionRuns.characters = st_malloc(sizeof(char) * (length + 1));
+    exceptionRuns.runNumber = 0;
+    int64_t packedSize = (length + 3) / 4;
+    unsigned char *packed = st_calloc(packedSize + 1, sizeof(unsigned char));
+    for (int64_t i = 0; i < length; i++) {
+        char c = string[i];
+        if (islower((unsigned char) c)) {
+            packedSequenceRuns_add(&caseRuns, i, 'a');
+            c = toupper((unsigned char) c);
+        }
+        int64_t code = packedSequence_baseCode(c);
+        if (code == -1) {
+            packedSequenceRuns_add(&exceptionRuns, i, c);
+            code = 0;
+        }
+        packed[i / 4] |= code << (2 * (i % 4));
+    }
+
+    *recordSize = PACKED_SEQUENCE_HEADER_SIZE + PACKED_SEQUENCE_RUN_SIZE * (caseRuns.runNumber + exceptionRuns.runNumber)
+            + exceptionRuns.runNumber + packedSize;
+    char *record = st_malloc(*recordSize);
+    packedSequence_setUInt32(record, 0, length);
+    packedSequence_setUInt32(record, 1, caseRuns.runNumber);
+    packedSequence_setUInt32(record, 2, exceptionRuns.runNumber);
+    char *cA = record + PACKED_SEQUENCE_HEADER_SIZE;
+    memcpy(cA, caseRuns.runs, PACKED_SEQUENCE_RUN_SIZE * caseRuns.runNumber);
+    cA += PACKED_SEQUENCE_RUN_SIZE * caseRuns.runNumber;
+    memcpy(cA, exceptionRuns.runs, PACKED_SEQUENCE_RUN_SIZE * exceptionRuns.runNumber);
+    cA += PACKED_SEQUENCE_RUN_SIZE * exceptionRuns.runNumber;
+    memcpy(cA, exceptionRuns.characters, exceptionRuns.runNumber);
+    cA += exceptionRuns.runNumber;
+    memcpy(cA, packed, packedSize);
+    assert(cA + packedSize == record + *recordSize);
+
+    free(caseRuns.runs);
+    free(caseRuns.characters);
+    free(exceptionRuns.runs);
+    free(exceptionRuns.characters);
+    free(packed);
+    return record;
+}
+
+int64_t packedSequence_getLength(const void *record) {
+    return packedSequence_getUInt32(record, 0);
+}
+
+static int64_t packedSequence_getFirstOverlappingRun(const char *runs, int64_t runNumber, int64_t start) {
+    /*
+     * Binary search for the first run whose end is greater than start.
+     */
+    int64_t min = 0, max = runNumber;
+    while (min < max) {
+        int64_t mid = (min + max) / 2;
+        if (packedSequence_getUInt32(runs, 2 * mid) + packedSequence_getUInt32(runs, 2 * mid + 1) <= start) {
+            min = mid + 1;
+        } else {
+            max = mid;
+        }
+    }
+    return min;
+}
+
+void packedSequence_decode(const void *record, int64_t start, int64_t length, char *string) {
+    const char *cA = record;
+    assert(start >= 0);
+    assert(length >= 0);
+    assert(start + length <= packedSequence_getLength(record));
+    int64_t caseRunNumber = packedSequence_getUInt32(cA, 1);
+    int64_t exceptionRunNumber = packedSequence_getUInt32(cA, 2);
+    const char *caseRuns = cA + PACKED_SEQUENCE_HEADER_SIZE;
+    const char *exceptionRuns = caseRuns + PACKED_SEQUENCE_RUN_SIZE * caseRunNumber;
+    const char *exceptionCharacters = exceptionRuns + PACKED_SEQUENCE_RUN_SIZE * exceptionRunNumber;
+    const unsigned char *packed = (const unsigned char *) (exceptionCharacters + exceptionRunNumber);
+
+    //The bases
+    for (int64_t i = 0; i < length; i++) {
+        int64_t j = start + i;
+        string[i] = packedSequence_bases[(packed[j / 4] >> (2 * (j % 4))) & 3];
+    }
+
+    //The non-ACGT characters
+    for (int64_t i = packedSequence_getFirstOverlappingRun(exceptionRuns, exceptionRunNumber, start);
+            i < exceptionRunNumber; i++) {
+        int64_t runStart = packedSequence_getUInt32(exceptionRuns, 2 * i);
+        int64_t runEnd = runStart + packedSequence_getUInt32(exceptionRuns, 2 * i + 1);
+        if (runStart >= start + length) {
+            break;
+        }
+        for (int64_t j = runStart > start ? runStart : start; j < runEnd && j < start + length; j++) {
+            string[j - start] = exceptionCharacters[i];
+        }
+    }
+
+    //The soft-masked characters
+    for (int64_t i = packedSequence_getFirstOverlappingRun(caseRuns, caseRunNumber, start); i < caseRunNumber; i++) {
+        int64_t runStart = packedSequence_getUInt32(caseRuns, 2 * i);
+        int64_t runEnd = runStart + packedSequence_getUInt32(caseRuns, 2 * i + 1);
+        if (runStart >= start + length) {
+            break;
+        }
+        for (int64_t j = runStart > start ? runStart : start; j < runEnd && j < start + length; j++) {
+            string[j - start] = tolower((unsigned char) string[j - start]);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_PACKED_SEQUENCE_H_
+#define CACTUS_PACKED_SEQUENCE_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Functions for storing sequence strings in a packed, 2-bit per base form.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * A packed sequence record holds a chunk of sequence with ACGT stored at 2 bits per base.
+ * Everything that does not fit in 2 bits is kept in two sidecar run-length tables, sorted by start
+ * coordinate: a table of lower case (soft-masked) runs and a table of runs of
+ * any other character (N, IUPAC codes, etc.). The layout of a record is:
+ *
+ * uint32 length, uint32 caseRunNumber, uint32 exceptionRunNumber,
+ * caseRunNumber x (uint32 start, uint32 length),
+ * exceptionRunNumber x (uint32 start, uint32 length),
+ * exceptionRunNumber x char,
+ * ceil(length/4) bytes of packed bases.
+ */
+
+/*
+ * Encodes the first length characters of the given string as a packed sequence record. The record
+ * must be freed by the caller, its size in bytes is returned in recordSize.
+ */
+void *packedSequence_encode(const char *string, int64_t length, int64_t *recordSize);
+
+/*
+ * Gets the number of characters stored in a packed sequence record.
+ */
+int64_t packedSequence_getLength(const void *record);
+
+/*
+ * Decodes the characters [start, start+length) of the packed sequence record into the given
+ * buffer. The buffer is not null terminated.
+ */
+void packedSequence_decode(const void *record, int64_t start, int64_t length, char *string);
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Profile functions.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+typedef struct _profilePhase {
+    Name flowerName;
+    char *phaseName;
+    int64_t parent; //The index of the enclosing phase, or -1 if there is none.
+    double startWallSeconds, wallSeconds;
+    double startCpuSeconds, cpuSeconds;
+    int64_t startRssKb, endRssKb;
+    int64_t peakRssKb; //While the phase is running, the peak before the last reset of the high water mark.
+} ProfilePhase;
+
+struct _cactusProfile {
+    char *programName;
+    double startWallSeconds, startCpuSeconds;
+    int64_t peakRssKb; //The peak of the ended phases and before the last reset of the high water mark.
+    stList *phases; //In the order they were started.
+    stList *runningPhases; //The indices of the running phases, innermost last.
+    bool canResetPeak;
+};
+
+static double getWallSeconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1.0e9;
+}
+
+static double getCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1.0e6 + usage.ru_stime.tv_sec
+            + usage.ru_stime.tv_usec / 1.0e6;
+}
+
+/*
+ * Reads a field in kB from /proc/self/status, returning -1 if it can not be read.
+ */
+static int64_t getProcStatusKb(const char *field) {
+    FILE *fileHandle = fopen("/proc/self/status", "r");
+    if (fileHandle == NULL) {
+        return -1;
+    }
+    int64_t kb = -1;
+    size_t fieldLength = strlen(field);
+    char line[256];
+    while (fgets(line, sizeof(line), fileHandle) != NULL) {
+        if (strncmp(line, field, fieldLength) == 0 && line[fieldLength] == ':') {
+            if (sscanf(line + fieldLength + 1, "%" SCNi64, &kb) != 1) {
+                kb = -1;
+            }
+            break;
+        }
+    }
+    fclose(fileHandle);
+    return kb;
+}
+
+static int64_t getMaxRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; //In bytes on OS X.
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static int64_t getRssKb() {
+    int64_t kb = getProcStatusKb("VmRSS");
+    return kb >= 0 ? kb : getMaxRssKb();
+}
+
+static int64_t getPeakRssKb() {
+    int64_t kb = getProcStatusKb("VmHWM");
+    return kb >= 0 ? kb : getMaxRssKb();
+}
+
+/*
+ * Resets the high water mark of the resident memory to the current resident memory (see proc(5)),
+ * returning false if this is not possible.
+ */
+static bool resetPeakRss() {
+    FILE *fileHandle = fopen("/proc/self/clear_refs", "w");
+    if (fileHandle == NULL) {
+        return 0;
+    }
+    bool reset = fputs("5", fileHandle) >= 0;
+    return fclose(fileHandle) == 0 && reset;
+}
+
+static void profilePhase_destruct(ProfilePhase *phase) {
+    free(phase->phaseName);
+    free(phase);
+}
+
+CactusProfile *cactusProfile_construct(const char *programName) {
+    CactusProfile *profile = st_malloc(sizeof(CactusProfile));
+    profile->programName = stString_copy(programName);
+    profile->startWallSeconds = getWallSeconds();
+    profile->startCpuSeconds = getCpuSeconds();
+    profile->phases = stList_construct3(0, (void (*)(void *)) profilePhase_destruct);
+    profile->runningPhases = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    profile->peakRssKb = getPeakRssKb();
+    profile->canResetPeak = getProcStatusKb("VmHWM") >= 0 && resetPeakRss();
+    return profile;
+}
+
+void cactusProfile_destruct(CactusProfile *profile) {
+    if (profile == NULL) {
+        return;
+    }
+    while (stList_length(profile->runningPhases) > 0) {
+        cactusProfile_endPhase(profile);
+    }
+    stList_destruct(profile->runningPhases);
+    stList_destruct(profile->phases);
+    free(profile->programName);
+    free(profile);
+}
+
+static ProfilePhase *getRunningPhase(CactusProfile *profile) {
+    if (stList_length(profile->runningPhases) == 0) {
+        return NULL;
+    }
+    return stList_get(profile->phases, stIntTuple_get(stList_peek(profile->runningPhases), 0));
+}
+
+void cactusProfile_startPhase(CactusProfile *profile, Name flowerName, const char *phaseName) {
+    if (profile == NULL) {
+        return;
+    }
+    ProfilePhase *parent = getRunningPhase(profile);
+    ProfilePhase *phase = st_malloc(sizeof(ProfilePhase));
+    phase->flowerName = flowerName;
+    phase->phaseName = stString_copy(phaseName);
+    phase->parent = parent == NULL ? -1 : stIntTuple_get(stList_peek(profile->runningPhases), 0);
+    phase->startRssKb = getRssKb();
+    phase->endRssKb = phase->startRssKb;
+    phase->peakRssKb = phase->startRssKb;
+    if (profile->canResetPeak) {
+        //The peaks so far of the parent and the program would be lost by the reset, so fold them in first.
+        int64_t peakRssKb = getPeakRssKb();
+        if (parent != NULL && peakRssKb > parent->peakRssKb) {
+            parent->peakRssKb = peakRssKb;
+        }
+        if (peakRssKb > profile->peakRssKb) {
+            profile->peakRssKb = peakRssKb;
+        }
+        resetPeakRss();
+    }
+    stList_append(profile->runningPhases, stIntTuple_construct1(stList_length(profile->phases)));
+    stList_append(profile->phases, phase);
+    phase->startWallSeconds = getWallSeconds();
+    phase->startCpuSeconds = getCpuSeconds();
+}
+
+void cactusProfile_endPhase(CactusProfile *profile) {
+    if (profile == NULL) {
+        return;
+    }
+    ProfilePhase *phase = getRunningPhase(profile);
+    if (phase == NULL) {
+        st_errAbort("Tried to end a phase of the profile of %s, but none is running", profile->programName);
+    }
+    phase->wallSeconds = getWallSeconds() - phase->startWallSeconds;
+    phase->cpuSeconds = getCpuSeconds() - phase->startCpuSeconds;
+    phase->endRssKb = getRssKb();
+    int64_t peakRssKb = getPeakRssKb();
+    phase->peakRssKb = peakRssKb > phase->peakRssKb ? peakRssKb : phase->peakRssKb;
+    stIntTuple_destruct(stList_pop(profile->runningPhases));
+    ProfilePhase *parent = getRunningPhase(profile);
+    if (parent != NULL && phase->peakRssKb > parent->peakRssKb) {
+        parent->peakRssKb = phase->peakRssKb;
+    }
+    if (phase->peakRssKb > profile->peakRssKb) {
+        profile->peakRssKb = phase->peakRssKb;
+    }
+}
+
+int64_t cactusProfile_getPhaseNumber(CactusProfile *profile) {
+    if (profile == NULL) {
+        return 0;
+    }
+    return stList_length(profile->phases) - stList_length(profile->runningPhases);
+}
+
+static void writeJsonString(FILE *fileHandle, const char *string) {
+    fputc('"', fileHandle);
+    for (const char *c = string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(fileHandle, "\\%c", *c);
+        } else if ((unsigned char) *c < 0x20) {
+            fprintf(fileHandle, "\\u%04x", (unsigned char) *c);
+        } else {
+            fputc(*c, fileHandle);
+        }
+    }
+    fputc('"', fileHandle);
+}
+
+void cactusProfile_writeReport(CactusProfile *profile, FILE *fileHandle) {
+    if (profile == NULL) {
+        return;
+    }
+    int64_t peakRssKb = getPeakRssKb();
+    fprintf(fileHandle, "{\n  \"program\": ");
+    writeJsonString(fileHandle, profile->programName);
+    fprintf(fileHandle, ",\n  \"wallSeconds\": %.6f,\n  \"cpuSeconds\": %.6f,\n  \"peakRssKb\": %" PRIi64 ",\n",
+            getWallSeconds() - profile->startWallSeconds, getCpuSeconds() - profile->startCpuSeconds,
+            peakRssKb > profile->peakRssKb ? peakRssKb : profile->peakRssKb);
+    fprintf(fileHandle, "  \"phases\": [");
+    bool first = 1;
+    for (int64_t i = 0; i < stList_length(profile->phases); i++) {
+        ProfilePhase *phase = stList_get(profile->phases, i);
+        bool running = 0;
+        for (int64_t j = 0; j < stList_length(profile->runningPhases); j++) {
+            running = running || stIntTuple_get(stList_get(profile->runningPhases, j), 0) == i;
+        }
+        if (running) {
+            continue;
+        }
+        fprintf(fileHandle, "%s\n    { \"id\": %" PRIi64 ", \"flower\": ", first ? "" : ",", i);
+        first = 0;
+        if (phase->flowerName == NULL_NAME) {
+            fprintf(fileHandle, "null");
+        } else {
+            fprintf(fileHandle, "%" PRIi64 "", phase->flowerName);
+        }
+        fprintf(fileHandle, ", \"phase\": ");
+        writeJsonString(fileHandle, phase->phaseName);
+        fprintf(fileHandle, ", \"parent\": ");
+        if (phase->parent == -1) {
+            fprintf(fileHandle, "null");
+        } else {
+            fprintf(fileHandle, "%" PRIi64 "", phase->parent);
+        }
+        fprintf(fileHandle, ", \"wallSeconds\": %.6f, \"cpuSeconds\": %.6f, \"startRssKb\": %" PRIi64
+                ", \"endRssKb\": %" PRIi64 ", \"peakRssKb\": %" PRIi64 " }", phase->wallSeconds, phase->cpuSeconds,
+                phase->startRssKb, phase->endRssKb, phase->peakRssKb);
+    }
+    fprintf(fileHandle, "\n  ]\n}\n");
+}
+
+void cactusProfile_writeReportToFile(CactusProfile *profile, const char *fileName) {
+    if (profile == NULL) {
+        return;
+    }
+    FILE *fileHandle = fopen(fileName, "w");
+    if (fileHandle == NULL) {
+        st_errAbort("Could not open the profile report file %s", fileName);
+    }
+    cactusProfile_writeReport(profile, fileHandle);
+    fclose(fileHandle);
+}
@@ -22,6 +22,12 @@ Segment *segment_construct(Block *block, Event *event) {
 
 Segment *segment_construct2(Block *block, int64_t startCoordinate, bool strand,
         Sequence *sequence) {
+    return segment_construct4(cactusDisk_getUniqueIDInterval(flower_getCactusDisk(block_getFlower(block)), 3),
+            block, startCoordinate, strand, sequence);
+}
+
+Segment *segment_construct4(Name name, Block *block, int64_t startCoordinate, bool strand,
+        Sequence *sequence) {
     assert(startCoordinate >= sequence_getStart(sequence));
     assert(startCoordinate + block_getLength(block) <= sequence_getStart(sequence) + sequence_getLength(sequence));
 
@@ -32,9 +38,8 @@ Segment *segment_construct2(Block *block, int64_t startCoordinate, bool strand,
         i = j;
         j = startCoordinate;
     }
-    return segment_construct3(cactusDisk_getUniqueID(flower_getCactusDisk(block_getFlower(
-            block))), block, cap_construct2(block_get5End(block), i, strand,
-            sequence), cap_construct2(block_get3End(block), j, strand,
+    return segment_construct3(name, block, cap_construct4(name + 1, block_get5End(block), i, strand,
+            sequence), cap_construct4(name + 2, block_get3End(block), j, strand,
             sequence));
 }
 
@@ -112,6 +117,16 @@ char *segment_getString(Segment *segment) {
             segment_getStrand(segment));
 }
 
+bool segment_getStringView(Segment *segment, StringView *stringView) {
+    Sequence *sequence = segment_getSequence(segment);
+    if (sequence == NULL) {
+        return 0;
+    }
+    sequence_getStringView(sequence, segment_getStart(segment_getStrand(segment) ? segment : segment_getReverse(segment)),
+            segment_getLength(segment), segment_getStrand(segment), stringView);
+    return 1;
+}
+
 Cap *segment_get5Cap(Segment *segment) {
     return segment->_5Cap;
 }
@@ -32,6 +32,22 @@ void binaryRepresentation_writeName(Name name, void (*writeFn)(const void * ptr,
 	binaryRepresentation_writeInteger(name, writeFn);
 }
 
+void binaryRepresentation_writeVarInt(int64_t i, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
+	uint64_t j = ((uint64_t) i << 1) ^ (uint64_t) (i >> 63); //zigzag, so small negative numbers are small too.
+	unsigned char cA[10];
+	int64_t k = 0;
+	while (j >= 128) {
+		cA[k++] = (j & 127) | 128;
+		j >>= 7;
+	}
+	cA[k++] = j;
+	writeFn(cA, sizeof(char), k);
+}
+
+void binaryRepresentation_writeRelativeName(Name name, Name baseName, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
+	binaryRepresentation_writeVarInt((int64_t) ((uint64_t) name - (uint64_t) baseName), writeFn); //wraps, so NULL_NAME is fine.
+}
+
 void binaryRepresentation_writeFloat(float f, void (*writeFn)(const void * ptr, size_t size, size_t count)) {
 	writeFn(&f, sizeof(float), 1);
 }
@@ -62,7 +78,7 @@ char *binaryRepresentation_getString(void **binaryString) {
 	return cA;
 }
 
-char *binaryRepresentation_getStringStatic_cA = NULL;
+static __thread char *binaryRepresentation_getStringStatic_cA = NULL; //One buffer per thread.
 const char *binaryRepresentation_getStringStatic(void **binaryString) {
 	if(binaryRepresentation_getStringStatic_cA != NULL) {
 		free(binaryRepresentation_getStringStatic_cA);
@@ -82,6 +98,23 @@ Name binaryRepresentation_getName(void **binaryString) {
 	return binaryRepresentation_getInteger(binaryString);
 }
 
+int64_t binaryRepresentation_getVarInt(void **binaryString) {
+	unsigned char *cA = *binaryString;
+	uint64_t j = 0;
+	int64_t shift = 0;
+	while (*cA & 128) {
+		j |= (uint64_t) (*cA++ & 127) << shift;
+		shift += 7;
+	}
+	j |= (uint64_t) (*cA++) << shift;
+	*binaryString = cA;
+	return (int64_t) (j >> 1) ^ -(int64_t) (j & 1);
+}
+
+Name binaryRepresentation_getRelativeName(void **binaryString, Name baseName) {
+	return (Name) ((uint64_t) baseName + (uint64_t) binaryRepresentation_getVarInt(binaryString));
+}
+
 float binaryRepresentation_getFloat(void **binaryString) {
 	float *i;
 	i = *binaryString;
@@ -96,36 +129,79 @@ bool binaryRepresentation_getBool(void **binaryString) {
 	return *i;
 }
 
-int64_t binaryRepresentation_makeBinaryRepresentationP_i = 0;
-void binaryRepresentation_makeBinaryRepresentationP(const void * ptr, size_t size, size_t count) {
-	/*
-	 * Records the cummulative size of the substrings written out in creating the flower.
-	 */
-	assert(ptr != NULL);
-	binaryRepresentation_makeBinaryRepresentationP_i += size * count;
+struct _binaryRepresentationBuffer {
+	char *buffer;
+	int64_t size;
+	int64_t capacity;
+	BinaryRepresentationBuffer *previous; //The buffer being written to by an enclosing call on the same thread, if any.
+};
+
+BinaryRepresentationBuffer *binaryRepresentationBuffer_construct(int64_t initialCapacity) {
+	BinaryRepresentationBuffer *buffer = st_malloc(sizeof(BinaryRepresentationBuffer));
+	buffer->capacity = initialCapacity > 0 ? initialCapacity : 1;
+	buffer->buffer = st_malloc(buffer->capacity);
+	buffer->size = 0;
+	buffer->previous = NULL;
+	return buffer;
+}
+
+void binaryRepresentationBuffer_destruct(BinaryRepresentationBuffer *buffer) {
+	free(buffer->buffer);
+	free(buffer);
+}
+
+void binaryRepresentationBuffer_write(BinaryRepresentationBuffer *buffer, const void *ptr, size_t size, size_t count) {
+	int64_t length = size * count;
+	if(buffer->size + length > buffer->capacity) {
+		while(buffer->size + length > buffer->capacity) {
+			buffer->capacity *= 2;
+		}
+		buffer->buffer = realloc(buffer->buffer, buffer->capacity);
+		if(buffer->buffer == NULL) {
+			st_errAbort("Could not realloc memory\n");
+		}
+	}
+	memcpy(buffer->buffer + buffer->size, ptr, length);
+	buffer->size += length;
 }
 
-char *binaryRepresentation_makeBinaryRepresentationP2_vA = NULL;
-void binaryRepresentation_makeBinaryRepresentationP2(const void * ptr, size_t size, size_t count) {
-	/*
-	 * Cummulates all the binary data into one array
-	 */
-	memcpy(binaryRepresentation_makeBinaryRepresentationP2_vA, ptr, size*count);
-	binaryRepresentation_makeBinaryRepresentationP2_vA += size * count;
+int64_t binaryRepresentationBuffer_getSize(BinaryRepresentationBuffer *buffer) {
+	return buffer->size;
 }
 
-void *binaryRepresentation_makeBinaryRepresentation(void *object, void (*writeBinaryRepresentation)(void *, void (*writeFn)(const void * ptr, size_t size, size_t count)), int64_t *recordSize) {
-	void *vA;
-	binaryRepresentation_makeBinaryRepresentationP_i = 0;
-	writeBinaryRepresentation(object, binaryRepresentation_makeBinaryRepresentationP);
-	assert(binaryRepresentation_makeBinaryRepresentationP_i < INT64_MAX);
-	vA = st_malloc(binaryRepresentation_makeBinaryRepresentationP_i);
-	binaryRepresentation_makeBinaryRepresentationP2_vA = vA;
-	writeBinaryRepresentation(object, binaryRepresentation_makeBinaryRepresentationP2);
-	*recordSize = binaryRepresentation_makeBinaryRepresentationP_i;
+void *binaryRepresentationBuffer_finish(BinaryRepresentationBuffer *buffer, int64_t *recordSize) {
+	void *vA = realloc(buffer->buffer, buffer->size > 0 ? buffer->size : 1); //Trim the spare capacity.
+	if(vA == NULL) {
+		st_errAbort("Could not realloc memory\n");
+	}
+	*recordSize = buffer->size;
+	free(buffer);
 	return vA;
 }
 
+/*
+ * The object writers take a plain write function, so the buffer of the current call is found through
+ * a per thread stack of buffers, which makes binaryRepresentation_makeBinaryRepresentation safe to call
+ * from several threads at once, or from within a writer.
+ */
+static __thread BinaryRepresentationBuffer *binaryRepresentation_currentBuffer = NULL;
+
+static void binaryRepresentation_writeToCurrentBuffer(const void * ptr, size_t size, size_t count) {
+	assert(binaryRepresentation_currentBuffer != NULL);
+	binaryRepresentationBuffer_write(binaryRepresentation_currentBuffer, ptr, size, count);
+}
+
+#define BINARY_REPRESENTATION_INITIAL_CAPACITY 4096
+
+void *binaryRepresentation_makeBinaryRepresentation(void *object, void (*writeBinaryRepresentation)(void *, void (*writeFn)(const void * ptr, size_t size, size_t count)), int64_t *recordSize) {
+	BinaryRepresentationBuffer *buffer = binaryRepresentationBuffer_construct(BINARY_REPRESENTATION_INITIAL_CAPACITY);
+	buffer->previous = binaryRepresentation_currentBuffer;
+	binaryRepresentation_currentBuffer = buffer;
+	writeBinaryRepresentation(object, binaryRepresentation_writeToCurrentBuffer);
+	binaryRepresentation_currentBuffer = buffer->previous;
+	return binaryRepresentationBuffer_finish(buffer, recordSize);
+}
+
 void *binaryRepresentation_resizeObjectAsPowerOf2(void *vA, int64_t *recordSize) {
     if(*recordSize == 0) {
         *recordSize = 1;
@@ -139,3 +215,33 @@ void *binaryRepresentation_resizeObjectAsPowerOf2(void *vA, int64_t *recordSize)
     *recordSize = finalSize;
     return vA;
 }
+
+uint64_t binaryRepresentation_fingerprint(const void *record, int64_t recordSize) {
+	/*
+	 * The 64 bit variant of Austin Appleby's MurmurHash2, reading eight bytes at a time.
+	 */
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+	const unsigned char *data = record;
+	uint64_t h = 0x8445d61a4e774912ULL ^ ((uint64_t) recordSize * m);
+	int64_t i = 0;
+	for (; i + 8 <= recordSize; i += 8) {
+		uint64_t k;
+		memcpy(&k, data + i, 8);
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+	if (i < recordSize) {
+		uint64_t k = 0;
+		memcpy(&k, data + i, recordSize - i);
+		h ^= k;
+		h *= m;
+	}
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
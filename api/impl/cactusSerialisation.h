@@ -46,6 +46,8 @@
 #define CODE_PSEUDO_CHROMOSOME 23
 #define CODE_PSEUDO_ADJACENCY 24
 #define CODE_CACTUS_DISK 25
+#define CODE_PACKED_STRINGS 26
+#define CODE_FLOWER_COLUMNAR 27
 
 /*
  * Writes a code for the element type.
@@ -67,6 +69,18 @@ void binaryRepresentation_writeInteger(int64_t i, void (*writeFn)(const void * p
  */
 void binaryRepresentation_writeName(Name name, void (*writeFn)(const void * ptr, size_t size, size_t count));
 
+/*
+ * Writes an integer to the binary stream as a zigzag varint, so that integers of small magnitude,
+ * positive or negative, take few bytes (1 byte for -64 to 63, at most 10 bytes).
+ */
+void binaryRepresentation_writeVarInt(int64_t i, void (*writeFn)(const void * ptr, size_t size, size_t count));
+
+/*
+ * Writes a name to the binary stream as a varint of its difference to a base name, e.g. the name
+ * of the containing flower.
+ */
+void binaryRepresentation_writeRelativeName(Name name, Name baseName, void (*writeFn)(const void * ptr, size_t size, size_t count));
+
 /*
  * Writes a float to the binary stream.
  */
@@ -94,7 +108,7 @@ char *binaryRepresentation_getString(void **binaryString);
 
 /*
  * Parses out a string, placing the memory in a buffer owned by the function. Thid buffer
- * will be overidden by the next call to the function.
+ * will be overidden by the next call to the function on the same thread (each thread has its own buffer).
  */
 const char *binaryRepresentation_getStringStatic(void **binaryString);
 
@@ -108,6 +122,16 @@ int64_t binaryRepresentation_getInteger(void **binaryString);
  */
 Name binaryRepresentation_getName(void **binaryString);
 
+/*
+ * Parses a varint written by binaryRepresentation_writeVarInt.
+ */
+int64_t binaryRepresentation_getVarInt(void **binaryString);
+
+/*
+ * Parses a name written by binaryRepresentation_writeRelativeName with the same base name.
+ */
+Name binaryRepresentation_getRelativeName(void **binaryString, Name baseName);
+
 /*
  * Parses a float from the binary string.
  */
@@ -118,9 +142,42 @@ float binaryRepresentation_getFloat(void **binaryString);
  */
 bool binaryRepresentation_getBool(void **binaryString);
 
+/*
+ * A growable buffer that a binary representation is written into.
+ */
+typedef struct _binaryRepresentationBuffer BinaryRepresentationBuffer;
+
+/*
+ * Constructs an empty buffer, with the given initial capacity in bytes.
+ */
+BinaryRepresentationBuffer *binaryRepresentationBuffer_construct(int64_t initialCapacity);
+
+/*
+ * Frees the buffer and its contents.
+ */
+void binaryRepresentationBuffer_destruct(BinaryRepresentationBuffer *buffer);
+
+/*
+ * Appends size*count bytes to the buffer, growing it as needed.
+ */
+void binaryRepresentationBuffer_write(BinaryRepresentationBuffer *buffer, const void *ptr, size_t size, size_t count);
+
+/*
+ * Gets the number of bytes written to the buffer.
+ */
+int64_t binaryRepresentationBuffer_getSize(BinaryRepresentationBuffer *buffer);
+
+/*
+ * Frees the buffer, returning its contents, which must be freed by the caller. The number of bytes
+ * is returned in recordSize.
+ */
+void *binaryRepresentationBuffer_finish(BinaryRepresentationBuffer *buffer, int64_t *recordSize);
+
 /*
  * Makes a binary representation of an object, using a passed function which writes
- * out the representation of the considered object.
+ * out the representation of the considered object. The object is walked once, into a growable
+ * buffer private to the call, so this may be called from several threads at once, and from within
+ * the write function of another call.
  */
 void *binaryRepresentation_makeBinaryRepresentation(void *object, void (*writeBinaryRepresentation)(void *, void (*writeFn)(const void * ptr, size_t size, size_t count)), int64_t *recordSize);
 
@@ -129,5 +186,10 @@ void *binaryRepresentation_makeBinaryRepresentation(void *object, void (*writeBi
  */
 void *binaryRepresentation_resizeObjectAsPowerOf2(void *vA, int64_t *recordSize);
 
+/*
+ * Gets a 64 bit hash of the bytes of a record, for cheaply telling if two records differ.
+ */
+uint64_t binaryRepresentation_fingerprint(const void *record, int64_t recordSize);
+
 
 #endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//String view functions.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+void stringView_construct(StringView *stringView, const char *string, int64_t length, bool strand,
+        CactusDisk *cactusDisk, void *cachedString) {
+    assert(length >= 0);
+    assert(string != NULL || length == 0);
+    assert((cactusDisk == NULL) == (cachedString == NULL));
+    stringView->string = string;
+    stringView->length = length;
+    stringView->strand = strand;
+    stringView->cactusDisk = cactusDisk;
+    stringView->cachedString = cachedString;
+}
+
+int64_t stringView_getLength(StringView *stringView) {
+    return stringView->length;
+}
+
+bool stringView_getStrand(StringView *stringView) {
+    return stringView->strand;
+}
+
+char stringView_getBase(StringView *stringView, int64_t i) {
+    assert(i >= 0 && i < stringView->length);
+    return stringView->strand ? stringView->string[i] :
+            stString_reverseComplementChar(stringView->string[stringView->length - 1 - i]);
+}
+
+void stringView_copy(StringView *stringView, int64_t start, int64_t length, char *string) {
+    assert(start >= 0);
+    assert(length >= 0);
+    assert(start + length <= stringView->length);
+    if (stringView->strand) {
+        memcpy(string, stringView->string + start, sizeof(char) * length);
+    } else {
+        const char *cA = stringView->string + stringView->length - 1 - start;
+        for (int64_t i = 0; i < length; i++) {
+            string[i] = stString_reverseComplementChar(cA[-i]);
+        }
+    }
+}
+
+char *stringView_getString(StringView *stringView) {
+    char *string = st_malloc(sizeof(char) * (stringView->length + 1));
+    stringView_copy(stringView, 0, stringView->length, string);
+    string[stringView->length] = '\0';
+    return string;
+}
+
+void stringView_release(StringView *stringView) {
+    if (stringView->cachedString != NULL) {
+        cactusDisk_unpinString(stringView->cactusDisk, stringView->cachedString);
+        stringView->cactusDisk = NULL;
+        stringView->cachedString = NULL;
+    }
+}
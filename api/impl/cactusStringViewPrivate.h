@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_STRING_VIEW_PRIVATE_H_
+#define CACTUS_STRING_VIEW_PRIVATE_H_
+
+#include "cactusGlobals.h"
+
+/*
+ * Fills in a view of the given forward strand interval. If cachedString is not NULL it is the cached interval
+ * of the cactus disk, already pinned, that is unpinned when the view is released.
+ */
+void stringView_construct(StringView *stringView, const char *string, int64_t length, bool strand,
+        CactusDisk *cactusDisk, void *cachedString);
+
+#endif
@@ -4,6 +4,7 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <time.h>
 #include "cactusGlobalsPrivate.h"
 
 ////////////////////////////////////////////////
@@ -45,11 +46,10 @@ void testCommon_deleteTemporaryCactusDisk(CactusDisk *cactusDisk) {
     testCommon_deleteTemporaryKVDatabase();
 }
 
-Name testCommon_addThreadToFlower(Flower *flower, char *header, int64_t length) {
-    char *dna = stRandom_getRandomDNAString(length, true, true, true);
-    EventTree *eventTree = flower_getEventTree(flower);
-    assert(eventTree != NULL);
-    MetaSequence *metaSequence = metaSequence_construct(2, length, dna, header, event_getName(eventTree_getRootEvent(eventTree)), flower_getCactusDisk(flower));
+static Name addThreadToFlower(Flower *flower, const char *header, Name eventName, const char *dna) {
+    int64_t length = strlen(dna);
+    MetaSequence *metaSequence = metaSequence_construct(2, length, dna, header, eventName,
+            flower_getCactusDisk(flower));
     Sequence *sequence = sequence_construct(metaSequence, flower);
 
     End *end1 = end_construct2(0, 0, flower);
@@ -57,7 +57,64 @@ Name testCommon_addThreadToFlower(Flower *flower, char *header, int64_t length)
     Cap *cap1 = cap_construct2(end1, 1, 1, sequence);
     Cap *cap2 = cap_construct2(end2, length + 2, 1, sequence);
     cap_makeAdjacent(cap1, cap2);
+    return cap_getName(cap1);
+}
 
+Name testCommon_addThreadToFlower(Flower *flower, char *header, int64_t length) {
+    char *dna = stRandom_getRandomDNAString(length, true, true, true);
+    EventTree *eventTree = flower_getEventTree(flower);
+    assert(eventTree != NULL);
+    Name name = addThreadToFlower(flower, header, event_getName(eventTree_getRootEvent(eventTree)), dna);
     free(dna);
-    return cap_getName(cap1);
+    return name;
+}
+
+Name testCommon_addThreadToFlower2(Flower *flower, Event *event, const char *dna) {
+    return addThreadToFlower(flower, event_getHeader(event), event_getName(event), dna);
+}
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Functions shared by the benchmarks.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+double testCommon_getSeconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1.0e9;
+}
+
+void testCommon_benchmarkUsage(const char *programName, const char *benchmarkName, const char **options) {
+    fprintf(stderr, "%s %s [OPTIONS]\n", programName, benchmarkName);
+    fprintf(stderr, "-a --logLevel : Set the log level\n");
+    for (int64_t i = 0; options[i] != NULL; i++) {
+        fprintf(stderr, "%s\n", options[i]);
+    }
+    fprintf(stderr, "-h --help : Print this help screen\n");
+}
+
+static void benchmarksUsage(const char *programName, TestCommonBenchmark *benchmarks, int64_t benchmarkNumber) {
+    fprintf(stderr, "%s BENCHMARK [OPTIONS]\n", programName);
+    fprintf(stderr, "Benchmarks, each of which prints a table of timings:\n");
+    for (int64_t i = 0; i < benchmarkNumber; i++) {
+        fprintf(stderr, "%s : %s\n", benchmarks[i].name, benchmarks[i].description);
+    }
+}
+
+int testCommon_runBenchmark(const char *programName, TestCommonBenchmark *benchmarks, int64_t benchmarkNumber,
+        int argc, char *argv[]) {
+    if (argc < 2) {
+        benchmarksUsage(programName, benchmarks, benchmarkNumber);
+        return 1;
+    }
+    for (int64_t i = 0; i < benchmarkNumber; i++) {
+        if (strcmp(argv[1], benchmarks[i].name) == 0) {
+            return benchmarks[i].run(argc - 1, argv + 1);
+        }
+    }
+    benchmarksUsage(programName, benchmarks, benchmarkNumber);
+    return 1;
 }
@@ -27,5 +27,7 @@
 #include "cactusSequence.h"
 #include "cactusTestCommon.h"
 #include "cactusFlowerWriter.h"
+#include "cactusStringView.h"
+#include "cactusProfile.h"
 
 #endif
@@ -22,6 +22,13 @@
  */
 Block *block_construct(int64_t length, Flower *flower);
 
+/*
+ * As block_construct, but the block and its left and right ends take the names name, name + 1 and name + 2,
+ * which must have been reserved with cactusDisk_getUniqueIDInterval. Used to build many blocks with one
+ * reservation of names.
+ */
+Block *block_construct3(Name name, int64_t length, Flower *flower);
+
 /*
  * Returns string name of the block.
  */
@@ -27,9 +27,40 @@ extern const char *CACTUS_DISK_EXCEPTION_ID;
  * "cache" is true, all DB responses will be cached. If "cache" is
  * false, no responses will be cached, saving memory but possibly
  * decreasing throughput.
+ *
+ * A cactus disk may be shared between threads: loading flowers and meta sequences,
+ * getting strings, the caches, getting unique IDs and writing are all thread safe. The
+ * flowers themselves are not, so each flower (and its nested flowers) should only be
+ * worked on by one thread at a time, and no thread should be working on a flower
+ * while cactusDisk_write or cactusDisk_destruct is called.
  */
 CactusDisk *cactusDisk_construct(stKVDatabaseConf *conf, bool create, bool cache);
 
+/*
+ * As cactusDisk_construct, but lets the caller choose how sequence strings are stored
+ * when the cactus disk is created. If 'packStrings' is non-zero strings are stored
+ * with ACGT packed at 2 bits per base, with separate run tables for
+ * lower case, N and other characters, else strings are stored as plain text. An existing
+ * cactus disk always uses the storage it was created with, and 'packStrings' is ignored.
+ * cactusDisk_construct creates packed cactus disks.
+ */
+CactusDisk *cactusDisk_construct2(stKVDatabaseConf *conf, bool create, bool cache, bool packStrings);
+
+/*
+ * As cactusDisk_construct, but keeps the cactus disk in an embedded database in the given file,
+ * instead of a database described by a stKVDatabaseConf. No database server is needed, but only one
+ * process may have the file open at a time (others will wait for it).
+ */
+CactusDisk *cactusDisk_constructLocal(const char *fileName, bool create, bool cache);
+
+/*
+ * Constructs a cactus disk from a database configuration string, as accepted by
+ * stKVDatabaseConf_constructFromString. A string of the form
+ * <st_kv_database_conf type="local"><local database_file="FILE"/></st_kv_database_conf>
+ * selects an embedded database held in FILE, as cactusDisk_constructLocal.
+ */
+CactusDisk *cactusDisk_constructFromString(const char *databaseString, bool create, bool cache);
+
 /*
  * Destructs the cactus disk and all open flowers and sequences, and
  * then disconnects from the cactus DB.
@@ -37,7 +68,8 @@ CactusDisk *cactusDisk_construct(stKVDatabaseConf *conf, bool create, bool cache
 void cactusDisk_destruct(CactusDisk *cactusDisk);
 
 /*
- * Retrieves the next unique ID.
+ * Retrieves the next unique ID. IDs are handed out from ranges leased from the database, so most calls do not
+ * touch the database.
  */
 int64_t cactusDisk_getUniqueID(CactusDisk *cactusDisk);
 
@@ -96,6 +128,19 @@ void cactusDisk_clearStringCache(CactusDisk *cactusDisk);
  */
 void cactusDisk_clearCache(CactusDisk *cactusDisk);
 
+/*
+ * Sets the byte budgets of the cache of database records and of the string cache,
+ * evicting least recently used entries until each fits. The initial budgets are 10MB each, or
+ * are taken from the CACTUS_DISK_CACHE_SIZE and CACTUS_DISK_STRING_CACHE_SIZE environment variables if set.
+ */
+void cactusDisk_setCacheSizes(CactusDisk *cactusDisk, int64_t cacheSize, int64_t stringCacheSize);
+
+/*
+ * Prints the size, hit, miss and eviction counters of the caches. These are also printed
+ * to stderr when the cactus disk is destructed if the CACTUS_DISK_CACHE_STATS environment variable is set.
+ */
+void cactusDisk_printCacheStats(CactusDisk *cactusDisk, FILE *fileHandle);
+
 /*
  * Get the event tree.
  */
@@ -36,6 +36,7 @@ typedef struct {
     CactusDisk *cactusDisk;
     Flower *curFlower;
     size_t nextIdx;
+    struct _flowerStreamPrefetcher *prefetcher; //NULL unless the stream is prefetching.
 } FlowerStream;
 
 /*
@@ -49,6 +50,21 @@ typedef struct {
  */
 FlowerStream *flowerWriter_getFlowerStream(CactusDisk *cactusDisk, FILE *file);
 
+/*
+ * As flowerWriter_getFlowerStream, but while the caller works on one
+ * flower the stream reads what it will need next from the database on
+ * a background thread: the records of the next batch of flowers and,
+ * if requested, the nested flowers and/or the segment strings of the
+ * next flower. These are loaded (as preCacheNestedFlowers and
+ * cactusDisk_preCacheSegmentStrings would) when the flower is
+ * returned by flowerStream_getNext, so the caller's own calls to those
+ * functions become cheap.
+ *
+ * The stream must be destructed before the cactus disk.
+ */
+FlowerStream *flowerWriter_getPrefetchingFlowerStream(CactusDisk *cactusDisk, FILE *file, bool preCacheNestedFlowers,
+        bool preCacheSegmentStrings);
+
 /*
  * Free a flowerStream.
  */
@@ -57,6 +57,12 @@ Name metaSequence_getEventName(MetaSequence *metaSequence);
  */
 char *metaSequence_getString(MetaSequence *metaSequence, int64_t start, int64_t length, int64_t strand);
 
+/*
+ * As metaSequence_getString, but fills in a view of the subsequence held in the string cache
+ * of the cactus disk instead of allocating a copy. The view must be released, see cactusStringView.h.
+ */
+void metaSequence_getStringView(MetaSequence *metaSequence, int64_t start, int64_t length, int64_t strand, StringView *stringView);
+
 /*
  * Gets the header line associated with the meta sequence.
  */
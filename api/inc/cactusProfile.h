@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_PROFILE_H_
+#define CACTUS_PROFILE_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Profile functions.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * A profile records, for each phase of a program and the flower it was run on, the wall time, the CPU
+ * time (user and system, summed over all threads) and the resident memory at the start, end and peak of
+ * the phase, and writes them out as a JSON report.
+ *
+ * Phases nest: a phase started while another is running is recorded with the enclosing phase as its
+ * parent, and is included in the times and peak of the parent. The peak of a phase is measured on Linux
+ * by resetting the high water mark of the process at the start of each phase, so is that of the phase
+ * itself; elsewhere it is the peak of the process up to the end of the phase.
+ *
+ * All the functions accept a NULL profile and then do nothing, so calls can be left in place in
+ * programs that are not profiling. A profile is not thread safe; phases should be started and ended
+ * by the thread that constructed it.
+ */
+
+/*
+ * Constructs a profile for the given program, which is named in the report.
+ */
+CactusProfile *cactusProfile_construct(const char *programName);
+
+/*
+ * Destructs the profile, ending any phases still running.
+ */
+void cactusProfile_destruct(CactusProfile *profile);
+
+/*
+ * Starts a phase with the given name on the given flower. The flower name may be NULL_NAME for phases
+ * that are not about a single flower.
+ */
+void cactusProfile_startPhase(CactusProfile *profile, Name flowerName, const char *phaseName);
+
+/*
+ * Ends the most recently started phase that is still running.
+ */
+void cactusProfile_endPhase(CactusProfile *profile);
+
+/*
+ * Gets the number of phases that have been ended.
+ */
+int64_t cactusProfile_getPhaseNumber(CactusProfile *profile);
+
+/*
+ * Writes the report of the ended phases, in the order they were started, as a JSON object of the form:
+ *
+ * { "program": ..., "wallSeconds": ..., "cpuSeconds": ..., "peakRssKb": ...,
+ *   "phases": [ { "id": ..., "flower": ..., "phase": ..., "parent": ..., "wallSeconds": ..., "cpuSeconds": ...,
+ *                 "startRssKb": ..., "endRssKb": ..., "peakRssKb": ... }, ... ] }
+ *
+ * where the top level times are those since the profile was constructed. The id of a phase is the number of
+ * phases started before it, and the parent is the id of the enclosing phase, so that phases of the same name
+ * can be told apart. The parent of a phase ended inside a phase that is still running is the id of a phase
+ * missing from the report. The flower and parent are null if there are none.
+ */
+void cactusProfile_writeReport(CactusProfile *profile, FILE *fileHandle);
+
+/*
+ * As cactusProfile_writeReport, but writes the report to the file with the given name, replacing it.
+ */
+void cactusProfile_writeReportToFile(CactusProfile *profile, const char *fileName);
+
+#endif
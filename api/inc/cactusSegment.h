@@ -33,6 +33,13 @@ Segment *segment_construct(Block *block, Event *event);
 Segment *segment_construct2(Block *block,
 		int64_t startCoordinate, bool strand, Sequence *sequence);
 
+/*
+ * As segment_construct2, but the segment and its 5 and 3 prime caps take the names name, name + 1 and name + 2,
+ * which must have been reserved with cactusDisk_getUniqueIDInterval.
+ */
+Segment *segment_construct4(Name name, Block *block,
+		int64_t startCoordinate, bool strand, Sequence *sequence);
+
 /*
  * Gets the encompassing block.
  */
@@ -90,6 +97,12 @@ Sequence *segment_getSequence(Segment *segment);
  */
 char *segment_getString(Segment *segment);
 
+/*
+ * As segment_getString, but fills in a view of the segment's sequence instead of allocating a copy, which must be
+ * released (see cactusStringView.h). Returns zero, filling in nothing, if the segment has no sequence.
+ */
+bool segment_getStringView(Segment *segment, StringView *stringView);
+
 /*
  * Gets the left cap of the segment.
  */
@@ -62,6 +62,12 @@ Event *sequence_getEvent(Sequence *sequence);
  */
 char *sequence_getString(Sequence *sequence, int64_t start, int64_t length, bool strand);
 
+/*
+ * As sequence_getString, but fills in a view of the subsequence instead of allocating a copy.
+ * The view must be released, see cactusStringView.h.
+ */
+void sequence_getStringView(Sequence *sequence, int64_t start, int64_t length, bool strand, StringView *stringView);
+
 /*
  * Gets the header line associated with the sequence.
  */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef CACTUS_STRING_VIEW_H_
+#define CACTUS_STRING_VIEW_H_
+
+#include "cactusGlobals.h"
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//String view functions.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * A string view is a strand aware window onto a substring held in the string cache of
+ * a cactus disk. It does not copy the bases, so it can be kept on the stack and
+ * filled in without a heap allocation. If the strand is negative the view reads as the reverse
+ * complement of the forward strand interval.
+ *
+ * A view pins the cached interval it reads, so it stays valid whatever else is later cached, merged or evicted,
+ * and whichever thread does so, until it is released with stringView_release. Every view filled in by a
+ * cactus disk must be released, before the cactus disk is destructed.
+ */
+struct _stringView {
+    const char *string; //The first base of the interval on the forward strand.
+    int64_t length;
+    bool strand;
+    CactusDisk *cactusDisk; //The disk and cached interval pinned by the view, or NULL if nothing is pinned.
+    void *cachedString;
+};
+
+/*
+ * Gets the length of the view.
+ */
+int64_t stringView_getLength(StringView *stringView);
+
+/*
+ * Gets the strand of the view.
+ */
+bool stringView_getStrand(StringView *stringView);
+
+/*
+ * Gets the ith base of the view, reading along its strand.
+ */
+char stringView_getBase(StringView *stringView, int64_t i);
+
+/*
+ * Copies the bases [start, start+length) of the view, reading along its strand, into the given buffer.
+ * The buffer is not null terminated.
+ */
+void stringView_copy(StringView *stringView, int64_t start, int64_t length, char *string);
+
+/*
+ * Returns a newly allocated, null terminated copy of the view, which must be freed.
+ */
+char *stringView_getString(StringView *stringView);
+
+/*
+ * Releases the view, unpinning the cached interval it reads. The view can not be used afterwards.
+ */
+void stringView_release(StringView *stringView);
+
+#endif
@@ -45,4 +45,45 @@ void testCommon_deleteTemporaryCactusDisk(CactusDisk *cactusDisk);
 // Adds a thread with random nucleotides to the flower, and return its corresponding name in the pinch graph.
 Name testCommon_addThreadToFlower(Flower *flower, char *header, int64_t length);
 
+/*
+ * As testCommon_addThreadToFlower, but the thread is of the given event, with its header, and holds the
+ * given nucleotides.
+ */
+Name testCommon_addThreadToFlower2(Flower *flower, Event *event, const char *dna);
+
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Functions shared by the benchmarks.
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * A benchmark run by a benchmarks program, with its own arguments from the benchmark name on.
+ */
+typedef struct _testCommonBenchmark {
+    const char *name;
+    int (*run)(int argc, char *argv[]);
+    const char *description;
+} TestCommonBenchmark;
+
+/*
+ * Gets the time in seconds from a monotonic clock, for timing the phases of a benchmark.
+ */
+double testCommon_getSeconds(void);
+
+/*
+ * Prints the usage of a benchmark, with the shared log level and help options around the given
+ * NULL terminated list of option descriptions.
+ */
+void testCommon_benchmarkUsage(const char *programName, const char *benchmarkName, const char **options);
+
+/*
+ * Runs the benchmark named by the first argument, printing the list of benchmarks if there is no such
+ * benchmark, and returns its exit status. The main function of each benchmarks program.
+ */
+int testCommon_runBenchmark(const char *programName, TestCommonBenchmark *benchmarks, int64_t benchmarkNumber,
+        int argc, char *argv[]);
+
 #endif
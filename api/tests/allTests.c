@@ -24,6 +24,12 @@ CuSuite *cactusFaceEndTestSuite();
 CuSuite *cactusSequenceTestSuite();
 CuSuite *cactusSerialisationTestSuite();
 CuSuite *cactusFlowerWriterTestSuite();
+CuSuite *cactusPackedSequenceTestSuite();
+CuSuite *cactusCacheTestSuite();
+CuSuite *cactusFlowerSerialisationTestSuite();
+CuSuite *cactusLocalDatabaseTestSuite();
+CuSuite *cactusIDAllocatorTestSuite();
+CuSuite *cactusProfileTestSuite();
 
 
 int cactusAPIRunAllTests(void) {
@@ -47,6 +53,12 @@ int cactusAPIRunAllTests(void) {
 	CuSuiteAddSuite(suite, cactusSequenceTestSuite());
 	CuSuiteAddSuite(suite, cactusSerialisationTestSuite());
 	CuSuiteAddSuite(suite, cactusFlowerWriterTestSuite());
+	CuSuiteAddSuite(suite, cactusPackedSequenceTestSuite());
+	CuSuiteAddSuite(suite, cactusCacheTestSuite());
+	CuSuiteAddSuite(suite, cactusFlowerSerialisationTestSuite());
+	CuSuiteAddSuite(suite, cactusLocalDatabaseTestSuite());
+	CuSuiteAddSuite(suite, cactusIDAllocatorTestSuite());
+	CuSuiteAddSuite(suite, cactusProfileTestSuite());
 	CuSuiteRun(suite);
 	CuSuiteSummary(suite, output);
 	CuSuiteDetails(suite, output);
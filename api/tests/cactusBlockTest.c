@@ -27,6 +27,20 @@ void testBlock_construct(CuTest* testCase) {
     cactusBlockTestTeardown();
 }
 
+void testBlock_construct3(CuTest* testCase) {
+    cactusBlockTestSetup();
+    Name name = cactusDisk_getUniqueIDInterval(cactusDisk, 3);
+    Block *block2 = block_construct3(name, 5, flower);
+    CuAssertTrue(testCase, block_getName(block2) == name);
+    CuAssertTrue(testCase, end_getName(block_get5End(block2)) == name + 1);
+    CuAssertTrue(testCase, end_getName(block_get3End(block2)) == name + 2);
+    CuAssertIntEquals(testCase, 5, block_getLength(block2));
+    CuAssertTrue(testCase, flower_getBlock(flower, name) == block2);
+    CuAssertTrue(testCase, flower_getEnd(flower, name + 1) == block_get5End(block2));
+    CuAssertTrue(testCase, flower_getEnd(flower, name + 2) == block_get3End(block2));
+    cactusBlockTestTeardown();
+}
+
 void testBlock_getName(CuTest* testCase) {
     cactusBlockTestSetup();
     CuAssertTrue(testCase, block_getName(block) != NULL_NAME);
@@ -318,5 +332,6 @@ CuSuite* cactusBlockTestSuite(void) {
     SUITE_ADD_TEST(suite, testBlock_makeNewickString);
     SUITE_ADD_TEST(suite, testBlock_isTrivialChain);
     SUITE_ADD_TEST(suite, testBlock_construct);
+    SUITE_ADD_TEST(suite, testBlock_construct3);
     return suite;
 }
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+
+static int64_t destructedValues;
+
+static void destructFn(void *key, void *value, void *extraArg) {
+    assert(extraArg == &destructedValues);
+    destructedValues++;
+    free(value);
+}
+
+static void *getValue(int64_t size) {
+    return st_calloc(size, 1);
+}
+
+void testCactusCache_setAndGet(CuTest* testCase) {
+    destructedValues = 0;
+    CactusCache *cache = cactusCache_construct("test", 1000, destructFn, &destructedValues);
+    CuAssertTrue(testCase, !cactusCache_contains(cache, (void *) 1));
+    CuAssertTrue(testCase, cactusCache_get(cache, (void *) 1, NULL) == NULL);
+    void *value = getValue(10);
+    cactusCache_set(cache, (void *) 1, value, 10, 5);
+    CuAssertTrue(testCase, cactusCache_contains(cache, (void *) 1));
+    int64_t size;
+    CuAssertTrue(testCase, cactusCache_get(cache, (void *) 1, &size) == value);
+    CuAssertIntEquals(testCase, 10, size);
+    CuAssertIntEquals(testCase, 10, cactusCache_getSize(cache));
+    //Replace the value
+    cactusCache_set(cache, (void *) 1, getValue(20), 20, 20);
+    CuAssertIntEquals(testCase, 1, destructedValues);
+    CuAssertIntEquals(testCase, 20, cactusCache_getSize(cache));
+    cactusCache_remove(cache, (void *) 1);
+    CuAssertIntEquals(testCase, 2, destructedValues);
+    CuAssertIntEquals(testCase, 0, cactusCache_getSize(cache));
+    CuAssertTrue(testCase, !cactusCache_contains(cache, (void *) 1));
+    cactusCache_destruct(cache);
+}
+
+void testCactusCache_leastRecentlyUsedEviction(CuTest* testCase) {
+    destructedValues = 0;
+    CactusCache *cache = cactusCache_construct("test", 100, destructFn, &destructedValues);
+    for (int64_t i = 1; i <= 10; i++) {
+        cactusCache_set(cache, (void *) i, getValue(10), 10, 10);
+    }
+    CuAssertIntEquals(testCase, 100, cactusCache_getSize(cache));
+    CuAssertIntEquals(testCase, 0, destructedValues);
+    //Touch the first key, so the second is now the least recently used
+    CuAssertTrue(testCase, cactusCache_get(cache, (void *) 1, NULL) != NULL);
+    cactusCache_set(cache, (void *) 11, getValue(10), 10, 10);
+    CuAssertIntEquals(testCase, 1, destructedValues);
+    CuAssertTrue(testCase, cactusCache_contains(cache, (void *) 1));
+    CuAssertTrue(testCase, !cactusCache_contains(cache, (void *) 2));
+    CuAssertTrue(testCase, cactusCache_contains(cache, (void *) 11));
+    //A value bigger than the budget is kept, but everything else goes
+    cactusCache_set(cache, (void *) 12, getValue(1000), 1000, 1000);
+    CuAssertIntEquals(testCase, 11, destructedValues);
+    CuAssertTrue(testCase, cactusCache_contains(cache, (void *) 12));
+    CuAssertIntEquals(testCase, 1000, cactusCache_getSize(cache));
+    //Shrinking the budget evicts it
+    cactusCache_setMaxSize(cache, 10);
+    CuAssertIntEquals(testCase, 12, destructedValues);
+    CuAssertIntEquals(testCase, 0, cactusCache_getSize(cache));
+    cactusCache_destruct(cache);
+}
+
+void testCactusCache_clear(CuTest* testCase) {
+    destructedValues = 0;
+    CactusCache *cache = cactusCache_construct("test", 1000, destructFn, &destructedValues);
+    for (int64_t i = 1; i <= 10; i++) {
+        cactusCache_set(cache, (void *) i, getValue(10), 10, 10);
+    }
+    cactusCache_clear(cache);
+    CuAssertIntEquals(testCase, 10, destructedValues);
+    CuAssertIntEquals(testCase, 0, cactusCache_getSize(cache));
+    for (int64_t i = 1; i <= 10; i++) {
+        CuAssertTrue(testCase, !cactusCache_contains(cache, (void *) i));
+    }
+    cactusCache_destruct(cache);
+}
+
+CuSuite* cactusCacheTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testCactusCache_setAndGet);
+    SUITE_ADD_TEST(suite, testCactusCache_leastRecentlyUsedEviction);
+    SUITE_ADD_TEST(suite, testCactusCache_clear);
+    return suite;
+}
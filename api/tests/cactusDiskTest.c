@@ -134,6 +134,150 @@ void testCactusDisk_getUniqueID_UniqueIntervals(CuTest* testCase) {
     cactusDiskTestTeardown();
 }
 
+void testCactusDisk_addUpdateRequest_unchanged(CuTest* testCase) {
+    cactusDiskTestSetup();
+    Flower *flower = flower_construct(cactusDisk);
+    Name name = flower_getName(flower);
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+    cactusDisk = cactusDisk_construct(conf, false, false); //No record cache, so fingerprints are all we have.
+    flower = cactusDisk_getFlower(cactusDisk, name);
+    CuAssertTrue(testCase, flower != NULL);
+    //An unchanged flower should not be written.
+    cactusDisk_addUpdateRequest(cactusDisk, flower);
+    CuAssertIntEquals(testCase, 0, stList_length(cactusDisk->updateRequests));
+    //A changed one should be, but only once.
+    end_construct(1, flower);
+    cactusDisk_addUpdateRequest(cactusDisk, flower);
+    CuAssertIntEquals(testCase, 1, stList_length(cactusDisk->updateRequests));
+    cactusDisk_addUpdateRequest(cactusDisk, flower);
+    CuAssertIntEquals(testCase, 1, stList_length(cactusDisk->updateRequests));
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+    cactusDisk = cactusDisk_construct(conf, false, false);
+    flower = cactusDisk_getFlower(cactusDisk, name);
+    CuAssertIntEquals(testCase, 1, flower_getEndNumber(flower));
+    cactusDiskTestTeardown();
+}
+
+#define STRESS_TEST_FLOWERS 50
+#define STRESS_TEST_JOBS 400
+#define STRESS_TEST_IDS 100
+#define STRESS_TEST_STRING_LENGTH 2000
+
+typedef struct _stressTestJob {
+    int64_t index;
+    Name *flowerNames;
+    Name *metaSequenceNames;
+    char **strings;
+    Flower *flower; //The flower loaded by the job.
+    Name uniqueIDs[STRESS_TEST_IDS];
+    Name constructedFlowerName;
+    bool correct;
+} StressTestJob;
+
+static StressTestJob *testCactusDisk_stressTestJob(StressTestJob *job) {
+    /*
+     * Does a mix of everything that can be done with a shared cactus disk.
+     */
+    int64_t i = job->index % STRESS_TEST_FLOWERS;
+    job->flower = cactusDisk_getFlower(cactusDisk, job->flowerNames[i]);
+    job->correct = job->flower != NULL && flower_getName(job->flower) == job->flowerNames[i];
+    MetaSequence *metaSequence = cactusDisk_getMetaSequence(cactusDisk, job->metaSequenceNames[i]);
+    job->correct = job->correct && metaSequence != NULL;
+    int64_t start = (job->index * 37) % (STRESS_TEST_STRING_LENGTH / 2);
+    char *string = metaSequence_getString(metaSequence, start, STRESS_TEST_STRING_LENGTH / 2, 1);
+    job->correct = job->correct && strncmp(string, job->strings[i] + start, STRESS_TEST_STRING_LENGTH / 2) == 0;
+    free(string);
+    for (int64_t j = 0; j < STRESS_TEST_IDS; j++) {
+        job->uniqueIDs[j] = cactusDisk_getUniqueID(cactusDisk);
+    }
+    Flower *flower = flower_construct(cactusDisk);
+    job->constructedFlowerName = flower_getName(flower);
+    cactusDisk_addUpdateRequest(cactusDisk, flower);
+    if (job->index % 50 == 0) {
+        cactusDisk_clearCache(cactusDisk);
+        cactusDisk_clearStringCache(cactusDisk);
+    }
+    return job;
+}
+
+static void testCactusDisk_stressTestFinish(StressTestJob *job) {
+}
+
+static int testCactusDisk_nameCmp(const void *a, const void *b) {
+    return cactusMisc_nameCompare(*(Name *) a, *(Name *) b);
+}
+
+void testCactusDisk_concurrentAccess(CuTest* testCase) {
+    /*
+     * Hammers one cactus disk from a pool of threads.
+     */
+    cactusDiskTestSetup();
+    Name flowerNames[STRESS_TEST_FLOWERS], metaSequenceNames[STRESS_TEST_FLOWERS];
+    char *strings[STRESS_TEST_FLOWERS];
+    for (int64_t i = 0; i < STRESS_TEST_FLOWERS; i++) {
+        strings[i] = st_malloc(sizeof(char) * (STRESS_TEST_STRING_LENGTH + 1));
+        for (int64_t j = 0; j < STRESS_TEST_STRING_LENGTH; j++) {
+            strings[i][j] = "ACGT"[st_randomInt(0, 4)];
+        }
+        strings[i][STRESS_TEST_STRING_LENGTH] = '\0';
+        MetaSequence *metaSequence = metaSequence_construct(0, STRESS_TEST_STRING_LENGTH, strings[i], "FOO", 10,
+                cactusDisk);
+        Flower *flower = flower_construct(cactusDisk);
+        sequence_construct(metaSequence, flower);
+        flowerNames[i] = flower_getName(flower);
+        metaSequenceNames[i] = metaSequence_getName(metaSequence);
+    }
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+    cactusDisk = cactusDisk_construct(conf, false, true);
+    cactusDisk_setCacheSizes(cactusDisk, 10000, 10000); //Small, so that there is plenty of eviction.
+
+    StressTestJob *jobs = st_calloc(STRESS_TEST_JOBS, sizeof(StressTestJob));
+    stThreadPool *threadPool = stThreadPool_construct(8, (void *(*)(void *)) testCactusDisk_stressTestJob,
+            (void (*)(void *)) testCactusDisk_stressTestFinish);
+    for (int64_t i = 0; i < STRESS_TEST_JOBS; i++) {
+        jobs[i].index = i;
+        jobs[i].flowerNames = flowerNames;
+        jobs[i].metaSequenceNames = metaSequenceNames;
+        jobs[i].strings = strings;
+        stThreadPool_push(threadPool, &jobs[i]);
+    }
+    stThreadPool_wait(threadPool);
+    stThreadPool_destruct(threadPool);
+
+    //Check each flower was loaded once, and that the unique IDs were unique.
+    Name *uniqueIDs = st_malloc(sizeof(Name) * STRESS_TEST_JOBS * (STRESS_TEST_IDS + 1));
+    for (int64_t i = 0; i < STRESS_TEST_JOBS; i++) {
+        CuAssertTrue(testCase, jobs[i].correct);
+        CuAssertPtrEquals(testCase, jobs[i % STRESS_TEST_FLOWERS].flower, jobs[i].flower);
+        CuAssertPtrEquals(testCase, jobs[i].flower, cactusDisk_getFlower(cactusDisk, flowerNames[i % STRESS_TEST_FLOWERS]));
+        memcpy(uniqueIDs + i * (STRESS_TEST_IDS + 1), jobs[i].uniqueIDs, sizeof(Name) * STRESS_TEST_IDS);
+        uniqueIDs[i * (STRESS_TEST_IDS + 1) + STRESS_TEST_IDS] = jobs[i].constructedFlowerName;
+    }
+    qsort(uniqueIDs, STRESS_TEST_JOBS * (STRESS_TEST_IDS + 1), sizeof(Name), testCactusDisk_nameCmp);
+    for (int64_t i = 1; i < STRESS_TEST_JOBS * (STRESS_TEST_IDS + 1); i++) {
+        CuAssertTrue(testCase, uniqueIDs[i - 1] != uniqueIDs[i]);
+    }
+    free(uniqueIDs);
+
+    //The flowers constructed by the threads should all have been written.
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+    cactusDisk = cactusDisk_construct(conf, false, true);
+    for (int64_t i = 0; i < STRESS_TEST_JOBS; i++) {
+        Flower *flower = cactusDisk_getFlower(cactusDisk, jobs[i].constructedFlowerName);
+        CuAssertTrue(testCase, flower != NULL);
+    }
+
+    free(jobs);
+    for (int64_t i = 0; i < STRESS_TEST_FLOWERS; i++) {
+        free(strings[i]);
+    }
+    cactusDiskTestTeardown();
+}
+
 CuSuite* cactusDiskTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testCactusDisk_write);
@@ -142,6 +286,8 @@ CuSuite* cactusDiskTestSuite(void) {
     SUITE_ADD_TEST(suite, testCactusDisk_getUniqueID);
     SUITE_ADD_TEST(suite, testCactusDisk_getUniqueID_Unique);
     SUITE_ADD_TEST(suite, testCactusDisk_getUniqueID_UniqueIntervals);
+    SUITE_ADD_TEST(suite, testCactusDisk_addUpdateRequest_unchanged);
+    SUITE_ADD_TEST(suite, testCactusDisk_concurrentAccess);
     SUITE_ADD_TEST(suite, testCactusDisk_constructAndDestruct);
     return suite;
 }
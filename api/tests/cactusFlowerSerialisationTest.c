@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusChainsTestShared.h"
+
+static void cactusFlowerSerialisationTestSetup() {
+    /*
+     * Adds an end with a cap tree, and caps of each type, to the chains test flower.
+     */
+    cactusChainsSharedTestSetup();
+    EventTree *eventTree = flower_getEventTree(flower);
+    Event *rootEvent = eventTree_getRootEvent(eventTree);
+    Event *leafEvent = event_construct3("LEAF", 0.2, rootEvent, eventTree);
+    MetaSequence *metaSequence = metaSequence_construct(1000, 10, "ACTGACTGAC", ">one", event_getName(leafEvent),
+            cactusDisk);
+    Sequence *sequence = sequence_construct(metaSequence, flower);
+    End *end = end_construct(1, flower);
+    Cap *rootCap = cap_construct(end, rootEvent);
+    Cap *leafCap1 = cap_construct2(end, 1004, 1, sequence);
+    Cap *leafCap2 = cap_construct2(end, 1006, 0, sequence);
+    Cap *leafCap3 = cap_construct(end, leafEvent);
+    cap_setCoordinates(leafCap3, 5, 1, NULL);
+    cap_makeParentAndChild(rootCap, leafCap1);
+    cap_makeParentAndChild(rootCap, leafCap2);
+    cap_makeParentAndChild(rootCap, leafCap3);
+    end_setRootInstance(end, rootCap);
+    End *end2 = end_construct2(1, 0, flower);
+    Cap *cap = cap_construct2(end2, 1007, 1, sequence);
+    cap_makeAdjacent(leafCap1, cap);
+}
+
+static void *getRecord(void (*writeFn)(Flower *, void (*)(const void *, size_t, size_t)), int64_t *recordSize) {
+    return binaryRepresentation_makeBinaryRepresentation(flower,
+            (void (*)(void *, void (*)(const void *, size_t, size_t))) writeFn, recordSize);
+}
+
+static void checkRecordsEqual(CuTest *testCase, void *record1, int64_t recordSize1, void *record2, int64_t recordSize2) {
+    CuAssertIntEquals(testCase, recordSize1, recordSize2);
+    CuAssertTrue(testCase, memcmp(record1, record2, recordSize1) == 0);
+}
+
+static void reloadFlower(void *record) {
+    Name name = flower_getName(flower);
+    flower_destruct(flower, false);
+    void *cA = record;
+    flower = flower_loadFromBinaryRepresentation(&cA, cactusDisk);
+    assert(flower != NULL);
+    assert(flower_getName(flower) == name);
+    (void) name;
+}
+
+void testFlowerSerialisation_columnar(CuTest *testCase) {
+    /*
+     * Checks a flower loaded from the columnar encoding is the same as the original, by comparing the
+     * encodings of the reloaded flower with those of the original.
+     */
+    cactusFlowerSerialisationTestSetup();
+    int64_t legacySize, columnarSize;
+    void *legacyRecord = getRecord(flower_writeLegacyBinaryRepresentation, &legacySize);
+    void *columnarRecord = getRecord(flower_writeBinaryRepresentation, &columnarSize);
+    CuAssertTrue(testCase, columnarSize < legacySize);
+
+    reloadFlower(columnarRecord);
+    int64_t recordSize;
+    void *record = getRecord(flower_writeLegacyBinaryRepresentation, &recordSize);
+    checkRecordsEqual(testCase, legacyRecord, legacySize, record, recordSize);
+    free(record);
+    record = getRecord(flower_writeBinaryRepresentation, &recordSize);
+    checkRecordsEqual(testCase, columnarRecord, columnarSize, record, recordSize);
+    free(record);
+
+    free(legacyRecord);
+    free(columnarRecord);
+    cactusChainsSharedTestTeardown();
+}
+
+void testFlowerSerialisation_legacy(CuTest *testCase) {
+    /*
+     * Checks flowers stored in the original encoding can still be read.
+     */
+    cactusFlowerSerialisationTestSetup();
+    int64_t legacySize, columnarSize;
+    void *legacyRecord = getRecord(flower_writeLegacyBinaryRepresentation, &legacySize);
+    void *columnarRecord = getRecord(flower_writeBinaryRepresentation, &columnarSize);
+
+    reloadFlower(legacyRecord);
+    int64_t recordSize;
+    void *record = getRecord(flower_writeBinaryRepresentation, &recordSize);
+    checkRecordsEqual(testCase, columnarRecord, columnarSize, record, recordSize);
+    free(record);
+    record = getRecord(flower_writeLegacyBinaryRepresentation, &recordSize);
+    checkRecordsEqual(testCase, legacyRecord, legacySize, record, recordSize);
+    free(record);
+
+    free(legacyRecord);
+    free(columnarRecord);
+    cactusChainsSharedTestTeardown();
+}
+
+CuSuite* cactusFlowerSerialisationTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFlowerSerialisation_columnar);
+    SUITE_ADD_TEST(suite, testFlowerSerialisation_legacy);
+    return suite;
+}
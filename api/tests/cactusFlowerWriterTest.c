@@ -53,6 +53,74 @@ static void testFlowerStream(CuTest *testCase) {
     testCommon_deleteTemporaryCactusDisk(cactusDisk);
 }
 
+static void testFlowerStream_prefetching(CuTest *testCase) {
+    /*
+     * Streams enough flowers to span several batches, checking the nested flowers
+     * are loaded by the stream as each flower is returned.
+     */
+    CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+    char *tempPath = getTempFile();
+    FILE *f = fopen(tempPath, "w");
+    int64_t flowerNumber = 120;
+    Flower **flowers = st_malloc(sizeof(Flower *) * flowerNumber);
+    Flower **nestedFlowers = st_calloc(flowerNumber, sizeof(Flower *));
+    for (int64_t i = 0; i < flowerNumber; i++) {
+        flowers[i] = flower_construct(cactusDisk);
+        if (i % 3 == 0) {
+            nestedFlowers[i] = flower_construct(cactusDisk);
+            group_construct(flowers[i], nestedFlowers[i]);
+        }
+    }
+    fprintf(f, "%" PRIi64 " %" PRIi64, flowerNumber, flower_getName(flowers[0]));
+    for (int64_t i = 1; i < flowerNumber; i++) {
+        fprintf(f, " %" PRIi64, flower_getName(flowers[i]) - flower_getName(flowers[i - 1]));
+    }
+    fclose(f);
+    cactusDisk_write(cactusDisk);
+    Name *flowerNames = st_malloc(sizeof(Name) * flowerNumber);
+    Name *nestedFlowerNames = st_malloc(sizeof(Name) * flowerNumber);
+    for (int64_t i = 0; i < flowerNumber; i++) {
+        flowerNames[i] = flower_getName(flowers[i]);
+        nestedFlowerNames[i] = NULL_NAME;
+        if (nestedFlowers[i] != NULL) {
+            nestedFlowerNames[i] = flower_getName(nestedFlowers[i]);
+            flower_destruct(nestedFlowers[i], false);
+        }
+        flower_destruct(flowers[i], false);
+    }
+    CuAssertIntEquals(testCase, 0, stSortedSet_size(cactusDisk->flowers));
+
+    f = fopen(tempPath, "r");
+    FlowerStream *flowerStream = flowerWriter_getPrefetchingFlowerStream(cactusDisk, f, 1, 0);
+    CuAssertIntEquals(testCase, flowerNumber, flowerStream_size(flowerStream));
+    int64_t i = 0;
+    Flower *flower;
+    while ((flower = flowerStream_getNext(flowerStream)) != NULL) {
+        CuAssertTrue(testCase, i < flowerNumber);
+        CuAssertIntEquals(testCase, flowerNames[i], flower_getName(flower));
+        if (nestedFlowerNames[i] != NULL_NAME) {
+            CuAssertTrue(testCase, cactusDisk_flowerIsLoaded(cactusDisk, nestedFlowerNames[i]));
+            Group *group = flower_getFirstGroup(flower);
+            CuAssertTrue(testCase, group != NULL);
+            CuAssertTrue(testCase, group_getNestedFlower(group) != NULL);
+            flower_unload(group_getNestedFlower(group));
+        }
+        i++;
+    }
+    CuAssertIntEquals(testCase, flowerNumber, i);
+
+    // Check that no flowers are loaded.
+    CuAssertIntEquals(testCase, 0, stSortedSet_size(cactusDisk->flowers));
+    flowerStream_destruct(flowerStream);
+    fclose(f);
+    removeTempFile(tempPath);
+    free(flowers);
+    free(nestedFlowers);
+    free(flowerNames);
+    free(nestedFlowerNames);
+    testCommon_deleteTemporaryCactusDisk(cactusDisk);
+}
+
 static void testFlowerWriter(CuTest *testCase) {
     char *tempFile = "./flowerWriterTest.txt";
     FILE *fileHandle = fopen(tempFile, "w");
@@ -101,6 +169,7 @@ static void testFlowerWriter(CuTest *testCase) {
 CuSuite* cactusFlowerWriterTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testFlowerStream);
+    SUITE_ADD_TEST(suite, testFlowerStream_prefetching);
     SUITE_ADD_TEST(suite, testFlowerWriter);
     return suite;
 }
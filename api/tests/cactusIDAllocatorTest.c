@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+typedef struct _idInterval {
+    int64_t start;
+    int64_t length;
+} IDInterval;
+
+static int idInterval_cmp(const void *a, const void *b) {
+    const IDInterval *i = a, *j = b;
+    return i->start < j->start ? -1 : (i->start > j->start ? 1 : 0);
+}
+
+static void checkIntervalsDisjoint(CuTest *testCase, IDInterval *intervals, int64_t intervalNumber) {
+    qsort(intervals, intervalNumber, sizeof(IDInterval), idInterval_cmp);
+    for (int64_t i = 0; i < intervalNumber; i++) {
+        CuAssertTrue(testCase, intervals[i].start > 0);
+        if (i > 0) {
+            CuAssertTrue(testCase, intervals[i - 1].start + intervals[i - 1].length <= intervals[i].start);
+        }
+    }
+}
+
+/*
+ * A store that is just a counter.
+ */
+
+typedef struct _counter {
+    int64_t next;
+    int64_t leaseNumber;
+    bool fail;
+} Counter;
+
+static int64_t counter_lease(Counter *counter, int64_t leaseSize) {
+    if (counter->fail) {
+        stThrowNew(CACTUS_DISK_EXCEPTION_ID, "The store is unavailable");
+    }
+    int64_t firstID = counter->next;
+    counter->next += leaseSize;
+    counter->leaseNumber++;
+    return firstID;
+}
+
+static void testCactusIDAllocator_intervals(CuTest *testCase) {
+    Counter counter = { 1, 0, 0 };
+    CactusIDAllocator *allocator = cactusIDAllocator_construct((int64_t (*)(void *, int64_t)) counter_lease,
+            &counter);
+    CuAssertIntEquals(testCase, CACTUS_ID_ALLOCATOR_MINIMUM_LEASE, cactusIDAllocator_getLeaseSize(allocator));
+    int64_t intervalNumber = 10000;
+    IDInterval *intervals = st_malloc(sizeof(IDInterval) * intervalNumber);
+    for (int64_t i = 0; i < intervalNumber; i++) {
+        //Occasionally ask for more than a lease.
+        intervals[i].length = st_random() < 0.01 ? st_randomInt(CACTUS_ID_ALLOCATOR_MINIMUM_LEASE, 1000000)
+                : st_randomInt(0, 1000);
+        intervals[i].start = cactusIDAllocator_getInterval(allocator, intervals[i].length);
+        CuAssertTrue(testCase, intervals[i].start + intervals[i].length <= counter.next);
+    }
+    checkIntervalsDisjoint(testCase, intervals, intervalNumber);
+    //Each lease goes to the store once, and as they are used up quickly they should have grown.
+    CuAssertIntEquals(testCase, counter.leaseNumber, cactusIDAllocator_getLeaseNumber(allocator));
+    CuAssertTrue(testCase, cactusIDAllocator_getLeaseSize(allocator) > CACTUS_ID_ALLOCATOR_MINIMUM_LEASE);
+    CuAssertTrue(testCase, cactusIDAllocator_getLeaseSize(allocator) <= CACTUS_ID_ALLOCATOR_MAXIMUM_LEASE);
+    free(intervals);
+    cactusIDAllocator_destruct(allocator);
+}
+
+static void testCactusIDAllocator_leaseFailure(CuTest *testCase) {
+    Counter counter = { 1, 0, 1 };
+    CactusIDAllocator *allocator = cactusIDAllocator_construct((int64_t (*)(void *, int64_t)) counter_lease,
+            &counter);
+    stTry {
+        cactusIDAllocator_getInterval(allocator, 1);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertStrEquals(testCase, CACTUS_ID_ALLOCATOR_EXCEPTION_ID, stExcept_getId(except));
+        stExcept_free(except);
+    } stTryEnd;
+    //The allocator should still be usable once the store is back.
+    counter.fail = 0;
+    CuAssertIntEquals(testCase, 1, cactusIDAllocator_getInterval(allocator, 1));
+    CuAssertIntEquals(testCase, 2, cactusIDAllocator_getInterval(allocator, 1));
+    CuAssertIntEquals(testCase, 1, counter.leaseNumber);
+    cactusIDAllocator_destruct(allocator);
+}
+
+static void testCactusIDAllocator_concurrentProcesses(CuTest *testCase) {
+    /*
+     * Many processes take IDs from one local cactus disk, each opening it several times, and
+     * the IDs they get must never overlap. So that the processes really run at the same time, each
+     * opens the disk and then waits until all of the others have it open before taking any IDs.
+     */
+    const char *databaseFile = "temporaryCactusIDAllocatorDatabase";
+    int64_t processNumber = 16, roundNumber = 5, intervalsPerRound = 200;
+    remove(databaseFile);
+    CactusDisk *cactusDisk = cactusDisk_constructLocal(databaseFile, 1, 0);
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+
+    int readyPipe[2], startPipe[2];
+    CuAssertTrue(testCase, pipe(readyPipe) == 0);
+    CuAssertTrue(testCase, pipe(startPipe) == 0);
+    fflush(NULL);
+    pid_t *pids = st_malloc(sizeof(pid_t) * processNumber);
+    for (int64_t i = 0; i < processNumber; i++) {
+        pids[i] = fork();
+        CuAssertTrue(testCase, pids[i] >= 0);
+        if (pids[i] == 0) {
+            int exitStatus = 0;
+            close(readyPipe[0]);
+            close(startPipe[1]);
+            char *intervalsFile = stString_print("%s.%" PRIi64 "", databaseFile, i);
+            FILE *fileHandle = fopen(intervalsFile, "w");
+            stTry {
+                for (int64_t j = 0; j < roundNumber; j++) {
+                    cactusDisk = cactusDisk_constructLocal(databaseFile, 0, 0);
+                    if (j == 0) { //Say the disk is open, then wait for the others.
+                        char c = 0;
+                        if (write(readyPipe[1], &c, 1) != 1 || read(startPipe[0], &c, 1) != 1) {
+                            exitStatus = 1;
+                        }
+                    }
+                    for (int64_t k = 0; k < intervalsPerRound; k++) {
+                        IDInterval interval;
+                        interval.length = st_random() < 0.05 ? st_randomInt(1, 100000) : 1;
+                        interval.start = cactusDisk_getUniqueIDInterval(cactusDisk, interval.length);
+                        fwrite(&interval, sizeof(IDInterval), 1, fileHandle);
+                    }
+                    cactusDisk_destruct(cactusDisk);
+                }
+            } stCatch(except) {
+                fprintf(stderr, "Failed to get unique IDs: %s\n", stExcept_getMsg(except));
+                stExcept_free(except);
+                exitStatus = 1;
+            } stTryEnd;
+            fclose(fileHandle);
+            free(intervalsFile);
+            _exit(exitStatus);
+        }
+    }
+    //Wait, for at most a minute, until every process has the disk open, then let them all go.
+    close(readyPipe[1]);
+    close(startPipe[0]);
+    int64_t readyNumber = 0;
+    struct pollfd readyPoll = { readyPipe[0], POLLIN, 0 };
+    while (readyNumber < processNumber && poll(&readyPoll, 1, 60000) > 0) {
+        char c;
+        if (read(readyPipe[0], &c, 1) != 1) {
+            break;
+        }
+        readyNumber++;
+    }
+    if (readyNumber < processNumber) { //They did not all get the disk open at once.
+        for (int64_t i = 0; i < processNumber; i++) {
+            kill(pids[i], SIGKILL);
+        }
+    }
+    CuAssertIntEquals(testCase, processNumber, readyNumber);
+    for (int64_t i = 0; i < processNumber; i++) {
+        char c = 0;
+        CuAssertTrue(testCase, write(startPipe[1], &c, 1) == 1);
+    }
+    close(readyPipe[0]);
+    close(startPipe[1]);
+    for (int64_t i = 0; i < processNumber; i++) {
+        int status;
+        CuAssertTrue(testCase, waitpid(pids[i], &status, 0) == pids[i]);
+        CuAssertTrue(testCase, WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    free(pids);
+
+    int64_t intervalNumber = processNumber * roundNumber * intervalsPerRound;
+    IDInterval *intervals = st_malloc(sizeof(IDInterval) * intervalNumber);
+    for (int64_t i = 0; i < processNumber; i++) {
+        char *intervalsFile = stString_print("%s.%" PRIi64 "", databaseFile, i);
+        FILE *fileHandle = fopen(intervalsFile, "r");
+        CuAssertTrue(testCase, fileHandle != NULL);
+        CuAssertIntEquals(testCase, roundNumber * intervalsPerRound,
+                fread(intervals + i * roundNumber * intervalsPerRound, sizeof(IDInterval),
+                        roundNumber * intervalsPerRound, fileHandle));
+        fclose(fileHandle);
+        remove(intervalsFile);
+        free(intervalsFile);
+    }
+    checkIntervalsDisjoint(testCase, intervals, intervalNumber);
+    free(intervals);
+    remove(databaseFile);
+}
+
+CuSuite* cactusIDAllocatorTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testCactusIDAllocator_intervals);
+    SUITE_ADD_TEST(suite, testCactusIDAllocator_leaseFailure);
+    SUITE_ADD_TEST(suite, testCactusIDAllocator_concurrentProcesses);
+    return suite;
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+
+static const char *databaseFile = "temporaryCactusLocalDatabase";
+static CactusLocalDatabase *database = NULL;
+
+static void teardown() {
+    if (database != NULL) {
+        cactusLocalDatabase_deleteFromDisk(database);
+        database = NULL;
+    }
+}
+
+static void setup() {
+    teardown();
+    remove(databaseFile);
+    database = cactusLocalDatabase_construct(databaseFile, 1);
+}
+
+static void reopen() {
+    cactusLocalDatabase_destruct(database);
+    database = cactusLocalDatabase_construct(databaseFile, 0);
+}
+
+static void checkRecord(CuTest *testCase, int64_t key, const char *value) {
+    int64_t recordSize;
+    char *record = cactusLocalDatabase_getRecord(database, key, &recordSize);
+    if (value == NULL) {
+        CuAssertPtrEquals(testCase, NULL, record);
+        CuAssertTrue(testCase, !cactusLocalDatabase_containsRecord(database, key));
+    } else {
+        CuAssertTrue(testCase, record != NULL);
+        CuAssertIntEquals(testCase, strlen(value) + 1, recordSize);
+        CuAssertStrEquals(testCase, value, record);
+        CuAssertTrue(testCase, cactusLocalDatabase_containsRecord(database, key));
+    }
+    free(record);
+}
+
+static void testCactusLocalDatabase_insertUpdateRemove(CuTest *testCase) {
+    setup();
+    cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+    cactusLocalDatabase_insertRecord(database, -5, "minus five", 11);
+    checkRecord(testCase, 1, NULL); //Not visible until committed
+    cactusLocalDatabase_commit(database);
+    checkRecord(testCase, 1, "one");
+    checkRecord(testCase, -5, "minus five");
+    CuAssertIntEquals(testCase, 2, cactusLocalDatabase_getNumberOfRecords(database));
+
+    cactusLocalDatabase_updateRecord(database, 1, "uno", 4);
+    cactusLocalDatabase_removeRecord(database, -5);
+    cactusLocalDatabase_commit(database);
+    checkRecord(testCase, 1, "uno");
+    checkRecord(testCase, -5, NULL);
+    CuAssertIntEquals(testCase, 1, cactusLocalDatabase_getNumberOfRecords(database));
+
+    //Everything should survive closing the database.
+    reopen();
+    checkRecord(testCase, 1, "uno");
+    checkRecord(testCase, -5, NULL);
+    CuAssertIntEquals(testCase, 1, cactusLocalDatabase_getNumberOfRecords(database));
+    teardown();
+}
+
+static void testCactusLocalDatabase_insertAndUpdateChecks(CuTest *testCase) {
+    setup();
+    cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+    cactusLocalDatabase_commit(database);
+    stTry {
+        cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertStrEquals(testCase, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, stExcept_getId(except));
+        stExcept_free(except);
+    } stTryEnd;
+    stTry {
+        cactusLocalDatabase_updateRecord(database, 2, "two", 4);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertStrEquals(testCase, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, stExcept_getId(except));
+        stExcept_free(except);
+    } stTryEnd;
+    teardown();
+}
+
+static void testCactusLocalDatabase_abort(CuTest *testCase) {
+    setup();
+    cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+    cactusLocalDatabase_commit(database);
+    cactusLocalDatabase_updateRecord(database, 1, "uno", 4);
+    cactusLocalDatabase_insertRecord(database, 2, "two", 4);
+    cactusLocalDatabase_abort(database);
+    cactusLocalDatabase_commit(database);
+    checkRecord(testCase, 1, "one");
+    checkRecord(testCase, 2, NULL);
+    teardown();
+}
+
+static void testCactusLocalDatabase_uncommittedChangesAreLost(CuTest *testCase) {
+    /*
+     * Closing with staged changes is like crashing before the commit.
+     */
+    setup();
+    cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+    cactusLocalDatabase_commit(database);
+    cactusLocalDatabase_updateRecord(database, 1, "uno", 4);
+    cactusLocalDatabase_insertRecord(database, 2, "two", 4);
+    reopen();
+    checkRecord(testCase, 1, "one");
+    checkRecord(testCase, 2, NULL);
+    //The space of the lost changes should be reused.
+    cactusLocalDatabase_insertRecord(database, 3, "three", 6);
+    cactusLocalDatabase_commit(database);
+    reopen();
+    checkRecord(testCase, 1, "one");
+    checkRecord(testCase, 2, NULL);
+    checkRecord(testCase, 3, "three");
+    teardown();
+}
+
+static void testCactusLocalDatabase_bulkGetRecords(CuTest *testCase) {
+    setup();
+    cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+    cactusLocalDatabase_insertRecord(database, 3, "three", 6);
+    cactusLocalDatabase_commit(database);
+    stList *keys = stList_construct3(0, free);
+    for (int64_t i = 1; i <= 3; i++) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        *key = i;
+        stList_append(keys, key);
+    }
+    stList *results = cactusLocalDatabase_bulkGetRecords(database, keys);
+    CuAssertIntEquals(testCase, 3, stList_length(results));
+    int64_t recordSize;
+    CuAssertStrEquals(testCase, "one", stKVDatabaseBulkResult_getRecord(stList_get(results, 0), &recordSize));
+    CuAssertPtrEquals(testCase, NULL, stKVDatabaseBulkResult_getRecord(stList_get(results, 1), &recordSize));
+    CuAssertStrEquals(testCase, "three", stKVDatabaseBulkResult_getRecord(stList_get(results, 2), &recordSize));
+    stList_destruct(results);
+    stList_destruct(keys);
+    teardown();
+}
+
+static void testCactusLocalDatabase_int64(CuTest *testCase) {
+    setup();
+    cactusLocalDatabase_insertInt64(database, -1, 10);
+    CuAssertIntEquals(testCase, 15, cactusLocalDatabase_incrementInt64(database, -1, 5));
+    CuAssertIntEquals(testCase, 7, cactusLocalDatabase_incrementInt64(database, -2, 7));
+    reopen();
+    CuAssertIntEquals(testCase, 115, cactusLocalDatabase_incrementInt64(database, -1, 100));
+    CuAssertIntEquals(testCase, 8, cactusLocalDatabase_incrementInt64(database, -2, 1));
+    teardown();
+}
+
+static void testCactusLocalDatabase_random(CuTest *testCase) {
+    /*
+     * Checks the database against a hash of the expected contents, over many commits and enough data to
+     * grow the file several times.
+     */
+    setup();
+    stHash *expected = stHash_construct2(NULL, free);
+    for (int64_t i = 0; i < 100; i++) {
+        for (int64_t j = 0; j < 100; j++) {
+            int64_t key = st_randomInt(1, 500);
+            if (st_random() < 0.2) {
+                cactusLocalDatabase_removeRecord(database, key);
+                free(stHash_remove(expected, (void *) key));
+            } else {
+                int64_t length = st_randomInt(0, 2000);
+                char *value = st_malloc(length + 1);
+                for (int64_t k = 0; k < length; k++) {
+                    value[k] = "ACGT"[st_randomInt(0, 4)];
+                }
+                value[length] = '\0';
+                if (stHash_search(expected, (void *) key) != NULL) {
+                    cactusLocalDatabase_updateRecord(database, key, value, strlen(value) + 1);
+                    free(stHash_remove(expected, (void *) key));
+                } else {
+                    cactusLocalDatabase_insertRecord(database, key, value, strlen(value) + 1);
+                }
+                stHash_insert(expected, (void *) key, value);
+            }
+        }
+        cactusLocalDatabase_commit(database);
+        if (i % 10 == 0) {
+            reopen();
+        }
+        CuAssertIntEquals(testCase, stHash_size(expected), cactusLocalDatabase_getNumberOfRecords(database));
+        for (int64_t key = 1; key < 500; key++) {
+            checkRecord(testCase, key, stHash_search(expected, (void *) key));
+        }
+    }
+    stHash_destruct(expected);
+    teardown();
+}
+
+static void testCactusLocalDatabase_sharedFile(CuTest *testCase) {
+    /*
+     * Two handles on the same file, as two processes would have, see each other's commits, and a change
+     * to a record the other has changed since it was staged is refused.
+     */
+    setup();
+    CactusLocalDatabase *database2 = cactusLocalDatabase_construct(databaseFile, 0);
+    cactusLocalDatabase_insertRecord(database, 1, "one", 4);
+    cactusLocalDatabase_commit(database);
+    int64_t recordSize;
+    char *record = cactusLocalDatabase_getRecord(database2, 1, &recordSize);
+    CuAssertStrEquals(testCase, "one", record);
+    free(record);
+
+    //Enough data to grow the file while the other handle has it mapped.
+    char *value = st_calloc(3000000, 1);
+    cactusLocalDatabase_insertRecord(database2, 2, value, 3000000);
+    cactusLocalDatabase_commit(database2);
+    free(value);
+    CuAssertTrue(testCase, cactusLocalDatabase_containsRecord(database, 2));
+    CuAssertIntEquals(testCase, 2, cactusLocalDatabase_getNumberOfRecords(database));
+
+    cactusLocalDatabase_updateRecord(database, 1, "uno", 4);
+    cactusLocalDatabase_updateRecord(database2, 1, "ein", 4);
+    cactusLocalDatabase_commit(database2);
+    stTry {
+        cactusLocalDatabase_commit(database);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertStrEquals(testCase, CACTUS_LOCAL_DATABASE_EXCEPTION_ID, stExcept_getId(except));
+        stExcept_free(except);
+    } stTryEnd;
+    cactusLocalDatabase_abort(database);
+    checkRecord(testCase, 1, "ein");
+
+    CuAssertIntEquals(testCase, 5, cactusLocalDatabase_incrementInt64(database, -1, 5));
+    CuAssertIntEquals(testCase, 8, cactusLocalDatabase_incrementInt64(database2, -1, 3));
+    CuAssertIntEquals(testCase, 9, cactusLocalDatabase_incrementInt64(database, -1, 1));
+    cactusLocalDatabase_destruct(database2);
+    teardown();
+}
+
+static void testCactusLocalDatabase_cactusDisk(CuTest *testCase) {
+    /*
+     * Round trips a cactus disk through a local database, chosen by a configuration string.
+     */
+    remove(databaseFile);
+    char *databaseString = stString_print(
+            "<st_kv_database_conf type=\"local\"><local database_file=\"%s\"/></st_kv_database_conf>", databaseFile);
+    CactusDisk *cactusDisk = cactusDisk_constructFromString(databaseString, 1, 1);
+    Flower *flower = flower_construct(cactusDisk);
+    Name flowerName = flower_getName(flower);
+    MetaSequence *metaSequence = metaSequence_construct(1, 10, "ACTGACTGAG", "FOO", 10, cactusDisk);
+    Name metaSequenceName = metaSequence_getName(metaSequence);
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+
+    cactusDisk = cactusDisk_constructFromString(databaseString, 0, 1);
+    flower = cactusDisk_getFlower(cactusDisk, flowerName);
+    CuAssertTrue(testCase, flower != NULL);
+    metaSequence = cactusDisk_getMetaSequence(cactusDisk, metaSequenceName);
+    CuAssertTrue(testCase, metaSequence != NULL);
+    char *string = metaSequence_getString(metaSequence, 3, 5, 1);
+    CuAssertStrEquals(testCase, "TGACT", string);
+    free(string);
+    //Deleting a flower should remove it from the database.
+    flower_delete(flower);
+    cactusDisk_write(cactusDisk);
+    cactusDisk_destruct(cactusDisk);
+
+    cactusDisk = cactusDisk_constructLocal(databaseFile, 0, 1);
+    CuAssertPtrEquals(testCase, NULL, cactusDisk_getFlower(cactusDisk, flowerName));
+    cactusDisk_destruct(cactusDisk);
+    free(databaseString);
+    remove(databaseFile);
+}
+
+CuSuite* cactusLocalDatabaseTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_insertUpdateRemove);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_insertAndUpdateChecks);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_abort);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_uncommittedChangesAreLost);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_bulkGetRecords);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_int64);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_random);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_sharedFile);
+    SUITE_ADD_TEST(suite, testCactusLocalDatabase_cactusDisk);
+    return suite;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+
+static char *getRandomString(int64_t length) {
+    /*
+     * Gets a random string, made mostly of ACGT but with runs of soft-masked,
+     * N and IUPAC characters.
+     */
+    char cA[] = { 'A', 'C', 'G', 'T', 'a', 'c', 'g', 't', 'N', 'n', 'R', 'y', 'K', 'm', 'S', 'w' };
+    char *string = st_malloc(sizeof(char) * (length + 1));
+    int64_t i = 0;
+    while (i < length) {
+        char c = cA[st_randomInt(0, st_random() > 0.3 ? 4 : 16)];
+        int64_t runLength = st_randomInt(1, 20);
+        for (int64_t j = 0; j < runLength && i < length; j++) {
+            string[i++] = st_random() > 0.3 ? cA[st_randomInt(0, 4)] : c;
+        }
+    }
+    string[length] = '\0';
+    return string;
+}
+
+void testPackedSequence_encodeAndDecode(CuTest* testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        int64_t length = st_randomInt(0, 10000);
+        char *string = getRandomString(length);
+        int64_t recordSize;
+        void *record = packedSequence_encode(string, length, &recordSize);
+        CuAssertIntEquals(testCase, length, packedSequence_getLength(record));
+        char *string2 = st_malloc(sizeof(char) * (length + 1));
+        packedSequence_decode(record, 0, length, string2);
+        string2[length] = '\0';
+        CuAssertStrEquals(testCase, string, string2);
+        //Now check random substrings
+        for (int64_t i = 0; i < 100 && length > 0; i++) {
+            int64_t start = st_randomInt(0, length);
+            int64_t subLength = st_randomInt(0, length - start + 1);
+            packedSequence_decode(record, start, subLength, string2);
+            for (int64_t j = 0; j < subLength; j++) {
+                CuAssertIntEquals(testCase, string[start + j], string2[j]);
+            }
+        }
+        free(string);
+        free(string2);
+        free(record);
+    }
+}
+
+void testPackedSequence_size(CuTest* testCase) {
+    /*
+     * Check the packing is actually compact for unmasked sequence.
+     */
+    int64_t length = 10000;
+    char *string = st_malloc(sizeof(char) * (length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        string[i] = "ACGT"[st_randomInt(0, 4)];
+    }
+    string[length] = '\0';
+    int64_t recordSize;
+    void *record = packedSequence_encode(string, length, &recordSize);
+    CuAssertTrue(testCase, recordSize <= length / 4 + 12);
+    free(string);
+    free(record);
+}
+
+CuSuite* cactusPackedSequenceTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testPackedSequence_encodeAndDecode);
+    SUITE_ADD_TEST(suite, testPackedSequence_size);
+    return suite;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactusGlobalsPrivate.h"
+
+static char *getReport(CactusProfile *profile) {
+    FILE *fileHandle = tmpfile();
+    cactusProfile_writeReport(profile, fileHandle);
+    int64_t length = ftell(fileHandle);
+    rewind(fileHandle);
+    char *report = st_calloc(length + 1, sizeof(char));
+    size_t i = fread(report, sizeof(char), length, fileHandle);
+    (void) i;
+    fclose(fileHandle);
+    return report;
+}
+
+static int64_t getField(const char *report, const char *phaseName, const char *field) {
+    char *phaseString = stString_print("\"phase\": \"%s\"", phaseName);
+    const char *phase = strstr(report, phaseString);
+    free(phaseString);
+    assert(phase != NULL);
+    char *fieldString = stString_print("\"%s\": ", field);
+    const char *value = strstr(phase, fieldString);
+    assert(value != NULL);
+    int64_t i;
+    int64_t j = sscanf(value + strlen(fieldString), "%" SCNi64, &i);
+    (void) j;
+    assert(j == 1);
+    free(fieldString);
+    return i;
+}
+
+static void testCactusProfile_phases(CuTest *testCase) {
+    CactusProfile *profile = cactusProfile_construct("cactusProfileTest");
+    cactusProfile_startPhase(profile, 5, "outer");
+    cactusProfile_startPhase(profile, 5, "inner");
+    //Touch enough memory that it shows up in the resident set.
+    int64_t length = 64 * 1024 * 1024;
+    char *memory = st_malloc(length);
+    memset(memory, 'A', length);
+    cactusProfile_endPhase(profile);
+    free(memory);
+    cactusProfile_startPhase(profile, NULL_NAME, "running");
+    CuAssertIntEquals(testCase, 1, cactusProfile_getPhaseNumber(profile));
+    cactusProfile_endPhase(profile);
+    cactusProfile_startPhase(profile, NULL_NAME, "stillRunning");
+    cactusProfile_endPhase(profile);
+    cactusProfile_endPhase(profile);
+    CuAssertIntEquals(testCase, 4, cactusProfile_getPhaseNumber(profile));
+
+    char *report = getReport(profile);
+    st_logInfo("Profile report:\n%s", report);
+    CuAssertTrue(testCase, strstr(report, "\"program\": \"cactusProfileTest\"") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 0, \"flower\": 5, \"phase\": \"outer\", \"parent\": null,") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 1, \"flower\": 5, \"phase\": \"inner\", \"parent\": 0,") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 2, \"flower\": null, \"phase\": \"running\", \"parent\": 0,") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 3, \"flower\": null, \"phase\": \"stillRunning\", \"parent\": 0,") != NULL);
+    //The phases are reported in the order they were started.
+    CuAssertTrue(testCase, strstr(report, "\"outer\", \"parent\"") < strstr(report, "\"inner\", \"parent\""));
+    CuAssertTrue(testCase, strstr(report, "\"inner\", \"parent\"") < strstr(report, "\"running\", \"parent\""));
+
+    //The peak of the inner phase includes the memory it touched, as does that of the enclosing phase.
+    int64_t innerPeak = getField(report, "inner", "peakRssKb");
+    CuAssertTrue(testCase, innerPeak >= getField(report, "inner", "startRssKb") + length / 1024 / 2);
+    CuAssertTrue(testCase, getField(report, "outer", "peakRssKb") >= innerPeak);
+    free(report);
+    cactusProfile_destruct(profile);
+}
+
+static void testCactusProfile_repeatedNames(CuTest *testCase) {
+    //Phases of the same name are told apart by their ids, as are their parents.
+    CactusProfile *profile = cactusProfile_construct("cactusProfileTest");
+    for (int64_t i = 0; i < 2; i++) {
+        cactusProfile_startPhase(profile, i + 1, "flower");
+        cactusProfile_startPhase(profile, i + 1, "align");
+        cactusProfile_endPhase(profile);
+        cactusProfile_endPhase(profile);
+    }
+    char *report = getReport(profile);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 0, \"flower\": 1, \"phase\": \"flower\", \"parent\": null,") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 1, \"flower\": 1, \"phase\": \"align\", \"parent\": 0,") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 2, \"flower\": 2, \"phase\": \"flower\", \"parent\": null,") != NULL);
+    CuAssertTrue(testCase, strstr(report, "{ \"id\": 3, \"flower\": 2, \"phase\": \"align\", \"parent\": 2,") != NULL);
+    free(report);
+    cactusProfile_destruct(profile);
+}
+
+static void testCactusProfile_null(CuTest *testCase) {
+    //A missing profile is quietly ignored.
+    cactusProfile_startPhase(NULL, 1, "phase");
+    cactusProfile_endPhase(NULL);
+    cactusProfile_writeReport(NULL, stderr);
+    CuAssertIntEquals(testCase, 0, cactusProfile_getPhaseNumber(NULL));
+    cactusProfile_destruct(NULL);
+}
+
+CuSuite* cactusProfileTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testCactusProfile_phases);
+    SUITE_ADD_TEST(suite, testCactusProfile_repeatedNames);
+    SUITE_ADD_TEST(suite, testCactusProfile_null);
+    return suite;
+}
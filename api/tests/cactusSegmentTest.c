@@ -28,6 +28,26 @@ void testSegment_construct(CuTest* testCase) {
 	cactusSegmentTestTeardown();
 }
 
+void testSegment_construct4(CuTest* testCase) {
+	cactusSegmentTestSetup();
+	Name name = cactusDisk_getUniqueIDInterval(cactusDisk, 3);
+	Segment *segment = segment_construct4(name, block_getReverse(block), 3, 0, sequence);
+	CuAssertTrue(testCase, segment_getName(segment) == name);
+	CuAssertTrue(testCase, cap_getName(segment_get5Cap(segment)) == name + 1);
+	CuAssertTrue(testCase, cap_getName(segment_get3Cap(segment)) == name + 2);
+	CuAssertTrue(testCase, segment_getBlock(segment) == block_getReverse(block));
+	CuAssertTrue(testCase, block_getInstance(block_getReverse(block), name) == segment);
+	CuAssertTrue(testCase, flower_getSegment(flower, name) != NULL);
+	CuAssertTrue(testCase, flower_getCap(flower, name + 1) != NULL);
+	CuAssertTrue(testCase, flower_getCap(flower, name + 2) != NULL);
+	//As with segment_construct2, the coordinates are with respect to the positive strand.
+	CuAssertTrue(testCase, !segment_getStrand(segment));
+	CuAssertIntEquals(testCase, 5, segment_getStart(segment));
+	CuAssertIntEquals(testCase, 3, segment_getStart(segment_getReverse(segment)));
+	CuAssertTrue(testCase, segment_getSequence(segment) == sequence);
+	cactusSegmentTestTeardown();
+}
+
 void testSegment_getBlock(CuTest* testCase) {
 	cactusSegmentTestSetup();
 	CuAssertTrue(testCase, segment_getBlock(rootSegment) == block_getReverse(block));
@@ -310,5 +330,6 @@ CuSuite* cactusSegmentTestSuite(void) {
 	SUITE_ADD_TEST(suite, testSegment_getChild);
 	SUITE_ADD_TEST(suite, testSegment_serialisation);
 	SUITE_ADD_TEST(suite, testSegment_construct);
+	SUITE_ADD_TEST(suite, testSegment_construct4);
 	return suite;
 }
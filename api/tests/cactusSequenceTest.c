@@ -17,6 +17,8 @@ static const char *sequenceString = "ACTGGCACTG";
 static const char *headerString = ">one";
 
 static bool nestedTest = 0;
+static bool packStrings = 1;
+static bool smallCaches = 0;
 
 void cactusSequenceTestTeardown() {
 	if(!nestedTest && cactusDisk != NULL) {
@@ -33,7 +35,16 @@ void cactusSequenceTestTeardown() {
 void cactusSequenceTestSetup2() {
 	if(!nestedTest) {
 		cactusSequenceTestTeardown();
-		cactusDisk = testCommon_getTemporaryCactusDisk2();
+		if(packStrings) {
+			cactusDisk = testCommon_getTemporaryCactusDisk2();
+		} else {
+			stKVDatabaseConf *conf = testCommon_getTemporaryKVDatabaseConf();
+			cactusDisk = cactusDisk_construct2(conf, true, true, 0);
+			stKVDatabaseConf_destruct(conf);
+		}
+		if(smallCaches) { //Forces lots of evictions
+			cactusDisk_setCacheSizes(cactusDisk, 1000, 1000);
+		}
 		flower = flower_construct(cactusDisk);
 		eventTree = eventTree_construct2(cactusDisk);
 		event = eventTree_getRootEvent(eventTree);
@@ -96,6 +107,61 @@ void testSequence_getString(CuTest* testCase) {
 	cactusSequenceTestTeardown();
 }
 
+void testSequence_getStringView(CuTest* testCase) {
+	cactusSequenceTestSetup();
+	int64_t i, j;
+	for(i=1; i<11; i++) {
+		for(j=11-i; j>=0; j--) {
+			for(int64_t strand=0; strand<2; strand++) {
+				char *string = sequence_getString(sequence, i, j, strand);
+				StringView stringView;
+				sequence_getStringView(sequence, i, j, strand, &stringView);
+				CuAssertIntEquals(testCase, j, stringView_getLength(&stringView));
+				CuAssertIntEquals(testCase, strand, stringView_getStrand(&stringView));
+				for(int64_t k=0; k<j; k++) {
+					CuAssertIntEquals(testCase, string[k], stringView_getBase(&stringView, k));
+				}
+				char *string2 = stringView_getString(&stringView);
+				CuAssertStrEquals(testCase, string, string2);
+				if(j > 1) { //Copy of an internal interval
+					stringView_copy(&stringView, 1, j-1, string2);
+					for(int64_t k=1; k<j; k++) {
+						CuAssertIntEquals(testCase, string[k], string2[k-1]);
+					}
+				}
+				stringView_release(&stringView);
+				free(string);
+				free(string2);
+			}
+		}
+	}
+	cactusSequenceTestTeardown();
+}
+
+void testSequence_getStringView_pinned(CuTest* testCase) {
+	/*
+	 * A view stays valid while the interval it reads is merged with others and evicted from the cache.
+	 */
+	cactusSequenceTestSetup();
+	cactusDisk_clearStringCache(cactusDisk);
+	for(int64_t strand=0; strand<2; strand++) {
+		char *string = sequence_getString(sequence, 2, 3, strand);
+		cactusDisk_clearStringCache(cactusDisk);
+		StringView stringView;
+		sequence_getStringView(sequence, 2, 3, strand, &stringView);
+		free(sequence_getString(sequence, 4, 5, 1)); //Merged with the pinned interval.
+		free(sequence_getString(sequence, 1, 10, 0));
+		cactusDisk_clearStringCache(cactusDisk);
+		free(sequence_getString(sequence, 1, 10, 1));
+		char *string2 = stringView_getString(&stringView);
+		CuAssertStrEquals(testCase, string, string2);
+		stringView_release(&stringView);
+		free(string);
+		free(string2);
+	}
+	cactusSequenceTestTeardown();
+}
+
 static char *getRandomDNASequence(int64_t minSequenceLength, int64_t maxSequenceLength) {
     int64_t stringLength = st_randomInt(minSequenceLength, maxSequenceLength);
     char *string = st_malloc(sizeof(char) * (stringLength + 1));
@@ -219,6 +285,20 @@ void testSequence_addAndGetBigStrings_preCacheSequences_reopenCactusDisk(CuTest*
     testSequence_addAndGetBigStringsP(testCase, 1, 1, 0, 100000, 100);
 }
 
+void testSequence_addAndGetBigStrings_unpacked(CuTest* testCase) {
+    packStrings = 0;
+    testSequence_addAndGetBigStringsP(testCase, 0, 1, 0, 100000, 50);
+    testSequence_addAndGetBigStringsP(testCase, 1, 1, 0, 100000, 50);
+    packStrings = 1;
+}
+
+void testSequence_addAndGetBigStrings_smallCaches(CuTest* testCase) {
+    smallCaches = 1;
+    testSequence_addAndGetBigStringsP(testCase, 0, 0, 0, 100000, 50);
+    testSequence_addAndGetBigStringsP(testCase, 1, 0, 0, 100000, 50);
+    smallCaches = 0;
+}
+
 void testSequence_addAndGetBigStrings_massive(CuTest* testCase) {
     testSequence_addAndGetBigStringsP(testCase, 1, 1, 5000000, 10000000, 5);
 }
@@ -265,10 +345,14 @@ CuSuite* cactusSequenceTestSuite(void) {
 	SUITE_ADD_TEST(suite, testSequence_getName);
 	SUITE_ADD_TEST(suite, testSequence_getEvent);
 	SUITE_ADD_TEST(suite, testSequence_getString);
+	SUITE_ADD_TEST(suite, testSequence_getStringView);
+	SUITE_ADD_TEST(suite, testSequence_getStringView_pinned);
 	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings);
 	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings_preCacheSequences);
 	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings_reopenCactusDisk);
 	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings_preCacheSequences_reopenCactusDisk);
+	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings_unpacked);
+	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings_smallCaches);
 	SUITE_ADD_TEST(suite, testSequence_addAndGetBigStrings_massive);
 	SUITE_ADD_TEST(suite, testSequence_getHeader);
 	SUITE_ADD_TEST(suite, testSequence_getFlower);
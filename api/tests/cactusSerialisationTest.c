@@ -77,6 +77,40 @@ void testBinaryRepresentation_name(CuTest* testCase) {
     cactusSerialisationTestTeardown();
 }
 
+void testBinaryRepresentation_varInt(CuTest* testCase) {
+    int64_t values[] = { 0, 1, -1, 63, -64, 64, -65, 537869, -720032, 543829676894821452, INT64_MAX, INT64_MIN };
+    int64_t valueNumber = sizeof(values) / sizeof(int64_t);
+    cactusSerialisationTestSetup();
+    void *vA2 = vA;
+    for (int64_t i = 0; i < valueNumber; i++) {
+        binaryRepresentation_writeVarInt(values[i], writeFn);
+    }
+    for (int64_t i = 0; i < valueNumber; i++) {
+        CuAssertTrue(testCase, values[i] == binaryRepresentation_getVarInt(&vA2));
+    }
+    CuAssertTrue(testCase, vA2 == vA3);
+    //Small magnitudes take a single byte
+    cactusSerialisationTestSetup();
+    binaryRepresentation_writeVarInt(63, writeFn);
+    binaryRepresentation_writeVarInt(-64, writeFn);
+    CuAssertTrue(testCase, vA3 == vA + 2);
+    cactusSerialisationTestTeardown();
+}
+
+void testBinaryRepresentation_relativeName(CuTest* testCase) {
+    cactusSerialisationTestSetup();
+    void *vA2 = vA;
+    Name baseName = 543829676894821452;
+    Name names[] = { baseName + 10, baseName - 10, NULL_NAME, 1 };
+    for (int64_t i = 0; i < 4; i++) {
+        binaryRepresentation_writeRelativeName(names[i], baseName, writeFn);
+    }
+    for (int64_t i = 0; i < 4; i++) {
+        CuAssertTrue(testCase, names[i] == binaryRepresentation_getRelativeName(&vA2, baseName));
+    }
+    cactusSerialisationTestTeardown();
+}
+
 void testBinaryRepresentation_float(CuTest* testCase) {
     cactusSerialisationTestSetup();
     void *vA2 = vA;
@@ -117,6 +151,102 @@ void testBinaryRepresentation_makeBinaryRepresentation(CuTest* testCase) {
     cactusSerialisationTestTeardown();
 }
 
+static void testBinaryRepresentation_largeFn(void *object, void(*writeFn)(const void * ptr, size_t size, size_t count)) {
+    int64_t n = *(int64_t *) object;
+    for (int64_t i = 0; i < n; i++) {
+        binaryRepresentation_writeInteger(i, writeFn);
+    }
+}
+
+void testBinaryRepresentation_makeBinaryRepresentation_large(CuTest* testCase) {
+    int64_t n = 100000, recordSize;
+    void *vA = binaryRepresentation_makeBinaryRepresentation(&n, testBinaryRepresentation_largeFn, &recordSize);
+    CuAssertTrue(testCase, recordSize == n * sizeof(int64_t));
+    void *vA2 = vA;
+    for (int64_t i = 0; i < n; i++) {
+        CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == i);
+    }
+    free(vA);
+}
+
+static void testBinaryRepresentation_nestedFn(void *object, void(*writeFn)(const void * ptr, size_t size, size_t count)) {
+    int64_t i = *(int64_t *) object;
+    binaryRepresentation_writeInteger(i, writeFn);
+    //Serialise another object in the middle of this one.
+    int64_t j = i + 1, recordSize;
+    void *vA = binaryRepresentation_makeBinaryRepresentation(&j, testBinaryRepresentation_fn, &recordSize);
+    binaryRepresentation_writeInteger(recordSize, writeFn);
+    writeFn(vA, sizeof(char), recordSize);
+    free(vA);
+    binaryRepresentation_writeInteger(i + 2, writeFn);
+}
+
+void testBinaryRepresentation_makeBinaryRepresentation_nested(CuTest* testCase) {
+    int64_t i = 5, recordSize;
+    void *vA = binaryRepresentation_makeBinaryRepresentation(&i, testBinaryRepresentation_nestedFn, &recordSize);
+    CuAssertTrue(testCase, recordSize == 4 * sizeof(int64_t));
+    void *vA2 = vA;
+    CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == 5);
+    CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == sizeof(int64_t));
+    CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == 6);
+    CuAssertTrue(testCase, binaryRepresentation_getInteger(&vA2) == 7);
+    free(vA);
+}
+
+static void *testBinaryRepresentation_threadFn(void *arg) {
+    int64_t n = *(int64_t *) arg;
+    bool *correct = st_malloc(sizeof(bool));
+    *correct = 1;
+    for (int64_t k = 0; k < 20; k++) {
+        int64_t recordSize;
+        void *vA = binaryRepresentation_makeBinaryRepresentation(&n, testBinaryRepresentation_largeFn, &recordSize);
+        void *vA2 = vA;
+        *correct = *correct && recordSize == n * sizeof(int64_t);
+        for (int64_t i = 0; i < n && *correct; i++) {
+            *correct = binaryRepresentation_getInteger(&vA2) == i;
+        }
+        free(vA);
+    }
+    return correct;
+}
+
+void testBinaryRepresentation_makeBinaryRepresentation_threads(CuTest* testCase) {
+    int64_t threadNumber = 8;
+    pthread_t threads[8];
+    int64_t sizes[8];
+    for (int64_t i = 0; i < threadNumber; i++) {
+        sizes[i] = 1000 * (i + 1);
+        CuAssertIntEquals(testCase, 0, pthread_create(&threads[i], NULL, testBinaryRepresentation_threadFn, &sizes[i]));
+    }
+    for (int64_t i = 0; i < threadNumber; i++) {
+        bool *correct;
+        pthread_join(threads[i], (void **) &correct);
+        CuAssertTrue(testCase, *correct);
+        free(correct);
+    }
+}
+
+void testBinaryRepresentation_fingerprint(CuTest* testCase) {
+    for (int64_t i = 0; i < 100; i++) {
+        int64_t length = st_randomInt(0, 100);
+        char *record = st_malloc(length + 1);
+        for (int64_t j = 0; j < length; j++) {
+            record[j] = st_randomInt(0, 256);
+        }
+        char *record2 = memcpy(st_malloc(length + 1), record, length);
+        CuAssertTrue(testCase, binaryRepresentation_fingerprint(record, length) == binaryRepresentation_fingerprint(record2, length));
+        if (length > 0) {
+            //Changing any byte, or the length, should change the fingerprint.
+            int64_t j = st_randomInt(0, length);
+            record2[j] ^= 1 << st_randomInt(0, 8);
+            CuAssertTrue(testCase, binaryRepresentation_fingerprint(record, length) != binaryRepresentation_fingerprint(record2, length));
+            CuAssertTrue(testCase, binaryRepresentation_fingerprint(record, length) != binaryRepresentation_fingerprint(record, length - 1));
+        }
+        free(record);
+        free(record2);
+    }
+}
+
 static void testBinaryRepresentation_resizeObjectAsPowerOf2(CuTest* testCase) {
     for(int64_t i=0; i<100000; i++) {
         int64_t recordSize = i;
@@ -135,9 +265,15 @@ CuSuite* cactusSerialisationTestSuite(void) {
     SUITE_ADD_TEST(suite, testBinaryRepresentation_integer);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_64BitInteger);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_name);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_varInt);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_relativeName);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_float);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_bool);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_makeBinaryRepresentation);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_makeBinaryRepresentation_large);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_makeBinaryRepresentation_nested);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_makeBinaryRepresentation_threads);
+    SUITE_ADD_TEST(suite, testBinaryRepresentation_fingerprint);
     SUITE_ADD_TEST(suite, testBinaryRepresentation_resizeObjectAsPowerOf2);
     return suite;
 }
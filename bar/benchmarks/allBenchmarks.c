@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactus.h"
+
+int endAlignmentPlannerBenchmark(int argc, char *argv[]);
+
+static TestCommonBenchmark benchmarks[] = {
+    { "endAlignmentPlanner", endAlignmentPlannerBenchmark, "Aligns synthetic low and high divergence ends with fixed and planned settings" },
+};
+
+static int64_t benchmarkNumber = sizeof(benchmarks) / sizeof(TestCommonBenchmark);
+
+int main(int argc, char *argv[]) {
+    return testCommon_runBenchmark("cactus_barBenchmarks", benchmarks, benchmarkNumber, argc, argv);
+}
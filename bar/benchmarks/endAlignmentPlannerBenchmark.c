@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "cactus.h"
+#include "sonLib.h"
+#include "pairwiseAligner.h"
+#include "multipleAligner.h"
+#include "stateMachine.h"
+#include "alignedPairArray.h"
+#include "endAlignmentPlanner.h"
+
+/*
+ * Aligns synthetic ends, made of haplotypes mutated from a common root, with low and with high divergence, first with
+ * the fixed spanning trees and diagonal expansion and then with those chosen by the end alignment planner, timing
+ * each and measuring how accurate the alignments are.
+ */
+
+static char getRandomBase() {
+    return "ACGT"[st_randomInt(0, 4)];
+}
+
+typedef struct _haplotype {
+    char *string;
+    int64_t *rootPositions; //The position in the root of each base, or -1 for inserted bases.
+} Haplotype;
+
+static Haplotype *haplotype_construct(const char *root, double divergence, int64_t deletionStart,
+        int64_t deletionLength) {
+    /*
+     * Mutates the root, with substitutions at the given rate and insertions and deletions each at a tenth of it,
+     * then deletes the given run of the root, which the sketches of the planner cannot see.
+     */
+    int64_t rootLength = strlen(root);
+    Haplotype *haplotype = st_malloc(sizeof(Haplotype));
+    haplotype->string = st_malloc(2 * rootLength + 1);
+    haplotype->rootPositions = st_malloc(2 * rootLength * sizeof(int64_t));
+    int64_t length = 0;
+    for (int64_t i = 0; i < rootLength; i++) {
+        if (i >= deletionStart && i < deletionStart + deletionLength) {
+            continue;
+        }
+        if (st_random() >= divergence / 10) {
+            char base = root[i];
+            if (st_random() < divergence) {
+                while ((base = getRandomBase()) == root[i]);
+            }
+            haplotype->rootPositions[length] = i;
+            haplotype->string[length++] = base;
+        }
+        if (st_random() < divergence / 10) {
+            haplotype->rootPositions[length] = -1;
+            haplotype->string[length++] = getRandomBase();
+        }
+    }
+    haplotype->string[length] = '\0';
+    return haplotype;
+}
+
+static void haplotype_destruct(Haplotype *haplotype) {
+    free(haplotype->string);
+    free(haplotype->rootPositions);
+    free(haplotype);
+}
+
+static AlignedPairArray *align(StateMachine *sM, stList *haplotypes, int64_t spanningTrees,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
+    /*
+     * Aligns the haplotypes as makeEndAlignment would align the sequences of an end, returning the pairs.
+     */
+    stList *seqFrags = stList_construct3(0, (void (*)(void *)) seqFrag_destruct);
+    for (int64_t i = 0; i < stList_length(haplotypes); i++) {
+        stList_append(seqFrags, seqFrag_construct(((Haplotype *) stList_get(haplotypes, i))->string, 0, 1));
+    }
+    MultipleAlignment *mA = makeAlignment(sM, seqFrags, spanningTrees, 100000000, 0, 0.5,
+            pairwiseAlignmentBandingParameters);
+    AlignedPairArray *alignedPairs = alignedPairArray_construct(2 * stList_length(mA->alignedPairs));
+    for (int64_t i = 0; i < stList_length(mA->alignedPairs); i++) {
+        stIntTuple *alignedPair = stList_get(mA->alignedPairs, i);
+        alignedPairArray_add(alignedPairs, stIntTuple_get(alignedPair, 1), stIntTuple_get(alignedPair, 2), 1,
+                stIntTuple_get(alignedPair, 3), stIntTuple_get(alignedPair, 4), 1, stIntTuple_get(alignedPair, 0),
+                stIntTuple_get(alignedPair, 0));
+    }
+    alignedPairArray_sort(alignedPairs);
+    multipleAlignment_destruct(mA);
+    stList_destruct(seqFrags);
+    return alignedPairs;
+}
+
+static bool isTrue(stList *haplotypes, AlignedPairArray *alignedPairs, int64_t i) {
+    /*
+     * Returns non-zero if the pair of the entry aligns two bases descended from the same base of the root.
+     */
+    int64_t j = alignedPairs->reverses[i];
+    Haplotype *haplotype1 = stList_get(haplotypes, alignedPairs->subsequenceIdentifiers[i]);
+    Haplotype *haplotype2 = stList_get(haplotypes, alignedPairs->subsequenceIdentifiers[j]);
+    int64_t rootPosition = haplotype1->rootPositions[alignedPairs->positions[i]];
+    return rootPosition != -1 && rootPosition == haplotype2->rootPositions[alignedPairs->positions[j]];
+}
+
+static const char *benchmarkOptions[] = {
+        "-b --haplotypes : The number of haplotypes in each end (default 50)",
+        "-c --length : The length of the root sequence (default 1000)",
+        "-d --lowDivergence : The substitution rate of the low divergence end (default 0.005)",
+        "-e --highDivergence : The substitution rate of the high divergence end (default 0.1)",
+        "-f --spanningTrees : The fixed number of spanning trees (default 5)",
+        "-g --diagonalExpansion : The fixed diagonal expansion (default that of the banding parameters)",
+        "-i --indelLength : The length of a deletion from the middle of the root in half of the haplotypes (default 0)",
+        NULL };
+
+static void benchmarkUsage() {
+    testCommon_benchmarkUsage("cactus_barBenchmarks", "endAlignmentPlanner", benchmarkOptions);
+}
+
+int endAlignmentPlannerBenchmark(int argc, char *argv[]) {
+    int64_t haplotypeNumber = 50, length = 1000, spanningTrees = 5, indelLength = 0;
+    double divergences[] = { 0.005, 0.1 };
+    PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters = pairwiseAlignmentBandingParameters_construct();
+
+    while (1) {
+        static struct option long_options[] = { { "logLevel", required_argument, 0, 'a' },
+                { "haplotypes", required_argument, 0, 'b' }, { "length", required_argument, 0, 'c' },
+                { "lowDivergence", required_argument, 0, 'd' }, { "highDivergence", required_argument, 0, 'e' },
+                { "spanningTrees", required_argument, 0, 'f' }, { "diagonalExpansion", required_argument, 0, 'g' },
+                { "indelLength", required_argument, 0, 'i' }, { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
+        int option_index = 0;
+        int key = getopt_long(argc, argv, "a:b:c:d:e:f:g:i:h", long_options, &option_index);
+        if (key == -1) {
+            break;
+        }
+        switch (key) {
+            case 'a':
+                st_setLogLevelFromString(optarg);
+                break;
+            case 'b':
+                haplotypeNumber = atol(optarg);
+                break;
+            case 'c':
+                length = atol(optarg);
+                break;
+            case 'd':
+                divergences[0] = atof(optarg);
+                break;
+            case 'e':
+                divergences[1] = atof(optarg);
+                break;
+            case 'f':
+                spanningTrees = atol(optarg);
+                break;
+            case 'g':
+                pairwiseAlignmentBandingParameters->diagonalExpansion = atol(optarg);
+                break;
+            case 'i':
+                indelLength = atol(optarg);
+                break;
+            case 'h':
+                benchmarkUsage();
+                return 0;
+            default:
+                benchmarkUsage();
+                return 1;
+        }
+    }
+
+    StateMachine *sM = stateMachine5_construct(fiveState);
+    EndAlignmentPlannerParameters *planner = endAlignmentPlannerParameters_construct();
+    int64_t diagonalExpansion = pairwiseAlignmentBandingParameters->diagonalExpansion;
+
+    fprintf(stdout, "%" PRIi64 " haplotypes of a root of length %" PRIi64 ", half with a deletion of length %" PRIi64
+            ", %" PRIi64 " spanning trees and a diagonal expansion of %" PRIi64 " when fixed\n", haplotypeNumber,
+            length, indelLength, spanningTrees, diagonalExpansion);
+    fprintf(stdout, "%-10s %-8s %10s %8s %8s %10s %10s %10s %10s\n", "divergence", "setting", "estimated",
+            "trees", "band", "seconds", "pairs", "precision", "recall");
+    for (int64_t i = 0; i < 2; i++) {
+        //An end of haplotypes of a common root.
+        char *root = st_malloc(length + 1);
+        for (int64_t j = 0; j < length; j++) {
+            root[j] = getRandomBase();
+        }
+        root[length] = '\0';
+        stList *haplotypes = stList_construct3(0, (void (*)(void *)) haplotype_destruct);
+        stList *strings = stList_construct();
+        for (int64_t j = 0; j < haplotypeNumber; j++) {
+            Haplotype *haplotype = haplotype_construct(root, divergences[i], (length - indelLength) / 2,
+                    j % 2 == 1 ? indelLength : 0);
+            stList_append(haplotypes, haplotype);
+            stList_append(strings, haplotype->string);
+        }
+        free(root);
+        double estimatedDivergence = endAlignmentPlanner_estimateDivergence(planner, strings);
+
+        //The fixed settings, then the planned settings, the time to plan included.
+        AlignedPairArray *fixedAlignedPairs = NULL;
+        for (int64_t planned = 0; planned < 2; planned++) {
+            double start = testCommon_getSeconds();
+            EndAlignmentPlan plan = { estimatedDivergence, spanningTrees, diagonalExpansion };
+            if (planned) {
+                endAlignmentPlanner_plan(planner, strings, spanningTrees, diagonalExpansion, &plan);
+            }
+            PairwiseAlignmentParameters plannedParameters = *pairwiseAlignmentBandingParameters;
+            plannedParameters.diagonalExpansion = plan.diagonalExpansion;
+            AlignedPairArray *alignedPairs = align(sM, haplotypes, plan.spanningTrees, &plannedParameters);
+            double seconds = testCommon_getSeconds() - start;
+
+            //The precision is of all the pairs, the recall of the true pairs found with the fixed settings.
+            int64_t pairNumber = 0, truePairNumber = 0, fixedTruePairNumber = 0, recoveredPairNumber = 0;
+            for (int64_t j = 0; j < alignedPairs->length; j++) {
+                if (j < alignedPairs->reverses[j]) {
+                    pairNumber++;
+                    truePairNumber += isTrue(haplotypes, alignedPairs, j) ? 1 : 0;
+                }
+            }
+            AlignedPairArray *referencePairs = planned ? fixedAlignedPairs : alignedPairs;
+            for (int64_t j = 0; j < referencePairs->length; j++) {
+                if (j < referencePairs->reverses[j] && isTrue(haplotypes, referencePairs, j)) {
+                    fixedTruePairNumber++;
+                    int64_t k = referencePairs->reverses[j];
+                    recoveredPairNumber += alignedPairArray_search(alignedPairs,
+                            referencePairs->subsequenceIdentifiers[j], referencePairs->positions[j], 1,
+                            referencePairs->subsequenceIdentifiers[k], referencePairs->positions[k], 1) != -1 ? 1 : 0;
+                }
+            }
+            fprintf(stdout, "%-10.3f %-8s %10.3f %8" PRIi64 " %8" PRIi64 " %10.3f %10" PRIi64 " %10.4f %10.4f\n",
+                    divergences[i], planned ? "planned" : "fixed", plan.divergence, plan.spanningTrees,
+                    plan.diagonalExpansion, seconds, pairNumber,
+                    pairNumber > 0 ? ((double) truePairNumber) / pairNumber : 1.0,
+                    fixedTruePairNumber > 0 ? ((double) recoveredPairNumber) / fixedTruePairNumber : 1.0);
+            if (planned) {
+                alignedPairArray_destruct(alignedPairs);
+            } else {
+                fixedAlignedPairs = alignedPairs;
+            }
+        }
+        alignedPairArray_destruct(fixedAlignedPairs);
+        stList_destruct(strings);
+        stList_destruct(haplotypes);
+    }
+
+    endAlignmentPlannerParameters_destruct(planner);
+    stateMachine_destruct(sM);
+    pairwiseAlignmentBandingParameters_destruct(pairwiseAlignmentBandingParameters);
+    return 0;
+}
@@ -70,18 +70,55 @@ void usage() {
 
     fprintf(stderr, "-M --minimumCoverageToRescue : Unaligned segments must have at least this proportion of their bases covered by an outgroup to be rescued.\n");
 
+    fprintf(stderr, "-O --numThreads : The number of threads used to compute end alignments (default 1).\n");
+
+    fprintf(stderr, "-P --endAlignmentsAsText : Write the precomputed end alignments as text, rather than in the binary format.\n");
+
+    fprintf(stderr, "-Q --endAlignmentsToText : Convert the given file of precomputed end alignments to text, written to stdout, then exit.\n");
+
+    fprintf(stderr, "-R --profileFile : Write a JSON report of the wall time, CPU time and memory of each phase for each flower to this file.\n");
+
+    fprintf(stderr, "-S --adaptiveEndAlignments : Choose the spanning trees and diagonal expansion of each end alignment from an estimate of the divergence of its sequences, using at most those given.\n");
+
+    fprintf(stderr, "-T --adaptiveFullCostDivergence : With -S, the estimated divergence at and above which an end is aligned with the spanning trees and diagonal expansion given, below which they are scaled down linearly with the divergence, a heuristic to tune for the sequences aligned; the band is never narrowed below the largest difference in length of the sequences of the end (default 0.1).\n");
+
     fprintf(stderr, "-h --help : Print this help screen\n");
 }
 
-stPinch *getNextAlignedPairAlignment(stSortedSetIterator *it) {
-    AlignedPair *alignedPair = stSortedSet_getNext(it);
-    if (alignedPair == NULL) {
-        return NULL;
+/*
+ * Iterates over the pairs of a flower alignment, as pinches, reading the arrays in place.
+ */
+typedef struct _alignedPairArrayIterator {
+    AlignedPairArray *alignedPairs;
+    int64_t index;
+    stPinch pinch;
+} AlignedPairArrayIterator;
+
+static stPinch *getNextAlignedPairAlignment(AlignedPairArrayIterator *it) {
+    AlignedPairArray *alignedPairs = it->alignedPairs;
+    while (it->index < alignedPairs->length) {
+        int64_t i = it->index++;
+        int64_t j = alignedPairs->reverses[i];
+        if (j > i) { //Each pair is pinched once, from its first entry, skipping removed pairs.
+            stPinch_fillOut(&it->pinch, alignedPairs->subsequenceIdentifiers[i], alignedPairs->subsequenceIdentifiers[j],
+                    alignedPairs->positions[i], alignedPairs->positions[j], 1,
+                    alignedPairs->strands[i] == alignedPairs->strands[j]);
+            return &it->pinch;
+        }
     }
-    static stPinch pinch;
-    stPinch_fillOut(&pinch, alignedPair->subsequenceIdentifier, alignedPair->reverse->subsequenceIdentifier, alignedPair->position,
-            alignedPair->reverse->position, 1, alignedPair->strand == alignedPair->reverse->strand);
-    return &pinch;
+    return NULL;
+}
+
+static AlignedPairArrayIterator *startAlignmentStackForAlignedPairs(AlignedPairArrayIterator *it) {
+    it->index = 0;
+    return it;
+}
+
+static stPinchIterator *getPinchIteratorForAlignedPairs(AlignedPairArray *alignedPairs) {
+    AlignedPairArrayIterator *it = st_calloc(1, sizeof(AlignedPairArrayIterator));
+    it->alignedPairs = alignedPairs;
+    return stPinchIterator_construct(it, (stPinch *(*)(void *)) getNextAlignedPairAlignment,
+            (void *(*)(void *)) startAlignmentStackForAlignedPairs, free);
 }
 
 static int64_t minimumIngroupDegree = 0, minimumOutgroupDegree = 0, minimumDegree = 0, minimumNumberOfSpecies = 0;
@@ -111,6 +148,12 @@ int main(int argc, char *argv[]) {
     char *ingroupCoverageFilePath = NULL;
     int64_t minimumSizeToRescue = 1;
     double minimumCoverageToRescue = 0.0;
+    int64_t numThreads = 1;
+    bool endAlignmentsAsText = 0;
+    char *endAlignmentsToConvertFile = NULL;
+    const char *profileFileName = NULL;
+    EndAlignmentPlannerParameters *planner = NULL;
+    double adaptiveFullCostDivergence = -1.0;
 
     PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters = pairwiseAlignmentBandingParameters_construct();
 
@@ -140,11 +183,17 @@ int main(int argc, char *argv[]) {
                         {"minimumSizeToRescue", required_argument, 0, 'K'},
                         {"minimumCoverageToRescue", required_argument, 0, 'M'},
                         { "minimumNumberOfSpecies", required_argument, 0, 'N' },
+                        { "numThreads", required_argument, 0, 'O' },
+                        { "endAlignmentsAsText", no_argument, 0, 'P' },
+                        { "endAlignmentsToText", required_argument, 0, 'Q' },
+                        { "profileFile", required_argument, 0, 'R' },
+                        { "adaptiveEndAlignments", no_argument, 0, 'S' },
+                        { "adaptiveFullCostDivergence", required_argument, 0, 'T' },
                         { 0, 0, 0, 0 } };
 
         int option_index = 0;
 
-        int key = getopt_long(argc, argv, "a:b:hi:j:kl:o:p:q:r:t:u:wy:A:B:D:E:FGI:J:K:L:M:N:", long_options, &option_index);
+        int key = getopt_long(argc, argv, "a:b:hi:j:kl:o:p:q:r:t:u:wy:A:B:D:E:FGI:J:K:L:M:N:O:PQ:R:ST:", long_options, &option_index);
 
         if (key == -1) {
             break;
@@ -265,6 +314,32 @@ int main(int argc, char *argv[]) {
                     st_errAbort("Error parsing minimumNumberOfSpecies parameter");
                 }
                 break;
+            case 'O':
+                i = sscanf(optarg, "%" PRIi64, &numThreads);
+                if (i != 1 || numThreads < 1) {
+                    st_errAbort("Error parsing numThreads parameter");
+                }
+                break;
+            case 'P':
+                endAlignmentsAsText = 1;
+                break;
+            case 'Q':
+                endAlignmentsToConvertFile = stString_copy(optarg);
+                break;
+            case 'R':
+                profileFileName = stString_copy(optarg);
+                break;
+            case 'S':
+                if (planner == NULL) {
+                    planner = endAlignmentPlannerParameters_construct();
+                }
+                break;
+            case 'T':
+                i = sscanf(optarg, "%lf", &adaptiveFullCostDivergence);
+                if (i != 1 || adaptiveFullCostDivergence <= 0.0) {
+                    st_errAbort("Error parsing adaptiveFullCostDivergence parameter");
+                }
+                break;
             default:
                 usage();
                 return 1;
@@ -273,11 +348,31 @@ int main(int argc, char *argv[]) {
 
     st_setLogLevelFromString(logLevelString);
 
+    if (planner != NULL && adaptiveFullCostDivergence > 0.0) {
+        planner->fullCostDivergence = adaptiveFullCostDivergence;
+    }
+
+    if (endAlignmentsToConvertFile != NULL) {
+        /*
+         * Just convert a file of end alignments to text, which needs no flowers.
+         */
+        FILE *fileHandle = fopen(endAlignmentsToConvertFile, "r");
+        if (fileHandle == NULL) {
+            st_errnoAbort("Opening end alignment file %s failed", endAlignmentsToConvertFile);
+        }
+        int64_t endAlignmentNumber = convertEndAlignmentsToText(fileHandle, stdout);
+        fclose(fileHandle);
+        st_logInfo("Converted %" PRIi64 " end alignments to text\n", endAlignmentNumber);
+        return 0;
+    }
+
     /*
      * Load the flowerdisk
      */
-    stKVDatabaseConf *kvDatabaseConf = stKVDatabaseConf_constructFromString(cactusDiskDatabaseString);
-    CactusDisk *cactusDisk = cactusDisk_construct(kvDatabaseConf, false, true); //We precache the sequences
+    CactusProfile *profile = profileFileName != NULL ? cactusProfile_construct("cactus_bar") : NULL;
+    cactusProfile_startPhase(profile, NULL_NAME, "loadDisk");
+    CactusDisk *cactusDisk = cactusDisk_constructFromString(cactusDiskDatabaseString, false, true); //We precache the sequences
+    cactusProfile_endPhase(profile);
     st_logInfo("Set up the flower disk\n");
 
     /*
@@ -313,17 +408,32 @@ int main(int argc, char *argv[]) {
         if (fileHandle == NULL) {
             st_errnoAbort("Opening end alignment file %s failed", endAlignmentsToPrecomputeOutputFile);
         }
+        stList *ends = stList_construct();
         for(int64_t i=1; i<stList_length(names); i++) {
             End *end = flower_getEnd(flower, *((Name *)stList_get(names, i)));
             if (end == NULL) {
                 st_errAbort("The end %" PRIi64 " was not found in the flower\n", *((Name *)stList_get(names, i)));
             }
-            stSortedSet *endAlignment = makeEndAlignment(sM, end, spanningTrees, maximumLength, useProgressiveMerging,
-                            matchGamma, pairwiseAlignmentBandingParameters);
-            writeEndAlignmentToDisk(end, endAlignment, fileHandle);
-            stSortedSet_destruct(endAlignment);
+            stList_append(ends, end);
+        }
+        //Almost all the time goes into the pair-HMM of the end alignments.
+        cactusProfile_startPhase(profile, flower_getName(flower), "endAlignments");
+        stList *endAlignments = makeEndAlignments(sM, ends, spanningTrees, maximumLength, useProgressiveMerging,
+                matchGamma, pairwiseAlignmentBandingParameters, planner, numThreads);
+        cactusProfile_endPhase(profile);
+        cactusProfile_startPhase(profile, flower_getName(flower), "writeEndAlignments");
+        for(int64_t i=0; i<stList_length(ends); i++) {
+            if (endAlignmentsAsText) {
+                writeEndAlignmentToDisk(stList_get(ends, i), stList_get(endAlignments, i), fileHandle);
+            } else {
+                writeEndAlignmentToDiskAsBinary(stList_get(ends, i), stList_get(endAlignments, i), 1, fileHandle);
+            }
         }
+        stList_destruct(endAlignments);
+        stList_destruct(ends);
         fclose(fileHandle);
+        cactusProfile_endPhase(profile);
+        cactusProfile_writeReportToFile(profile, profileFileName);
         return 0; //avoid cleanup costs
         stList_destruct(names);
         st_logInfo("Finished precomputing end alignments\n");
@@ -369,26 +479,37 @@ int main(int argc, char *argv[]) {
         cactusDisk_preCacheStrings(cactusDisk, flowers);
         for (j = 0; j < stList_length(flowers); j++) {
             flower = stList_get(flowers, j);
+            Name flowerName = flower_getName(flower);
             st_logInfo("Processing a flower\n");
+            cactusProfile_startPhase(profile, flowerName, "flower");
 
-            stSortedSet *alignedPairs = makeFlowerAlignment3(sM, flower, listOfEndAlignmentFiles, spanningTrees, maximumLength,
-                    useProgressiveMerging, matchGamma, pairwiseAlignmentBandingParameters, pruneOutStubAlignments);
-            st_logInfo("Created the alignment: %" PRIi64 " pairs\n", stSortedSet_size(alignedPairs));
-            stPinchIterator *pinchIterator = stPinchIterator_constructFromAlignedPairs(alignedPairs, getNextAlignedPairAlignment);
+            //The end alignments, dominated by the pair-HMM, and the bar pruning of them.
+            cactusProfile_startPhase(profile, flowerName, "flowerAlignment");
+            AlignedPairArray *alignedPairs = makeFlowerAlignment4(sM, flower, listOfEndAlignmentFiles, spanningTrees, maximumLength,
+                    useProgressiveMerging, matchGamma, pairwiseAlignmentBandingParameters, pruneOutStubAlignments,
+                    planner, numThreads);
+            cactusProfile_endPhase(profile);
+            st_logInfo("Created the alignment: %" PRIi64 " pairs\n", alignedPairArray_size(alignedPairs) / 2);
+            stPinchIterator *pinchIterator = getPinchIteratorForAlignedPairs(alignedPairs);
 
             /*
              * Run the cactus caf functions to build cactus.
              */
+            cactusProfile_startPhase(profile, flowerName, "annealing");
             stPinchThreadSet *threadSet = stCaf_setup(flower);
             stCaf_anneal(threadSet, pinchIterator, NULL);
             if (minimumDegree < 2) {
                 stCaf_makeDegreeOneBlocks(threadSet);
             }
+            cactusProfile_endPhase(profile);
             if (minimumIngroupDegree > 0 || minimumOutgroupDegree > 0 || minimumDegree > 1) {
+                cactusProfile_startPhase(profile, flowerName, "melting");
                 stCaf_melt(flower, threadSet, blockFilterFn, 0, 0, 0, INT64_MAX);
+                cactusProfile_endPhase(profile);
             }
 
             if (ingroupCoverageFilePath != NULL) {
+                cactusProfile_startPhase(profile, flowerName, "rescue");
                 // Rescue any sequence that is covered by outgroups
                 // but currently unaligned into single-degree blocks.
                 stPinchThreadSetIt pinchIt = stPinchThreadSet_getIt(threadSet);
@@ -405,19 +526,23 @@ int main(int argc, char *argv[]) {
                                          minimumCoverageToRescue);
                 }
                 stCaf_joinTrivialBoundaries(threadSet);
+                cactusProfile_endPhase(profile);
             }
 
+            cactusProfile_startPhase(profile, flowerName, "finishing");
             stCaf_finish(flower, threadSet, chainLengthForBigFlower, longChain, INT64_MAX, INT64_MAX); //Flower now destroyed.
             stPinchThreadSet_destruct(threadSet);
+            cactusProfile_endPhase(profile);
             st_logInfo("Ran the cactus core script.\n");
 
             /*
              * Cleanup
              */
-            //Clean up the sorted set after cleaning up the iterator
+            //Clean up the aligned pairs after cleaning up the iterator
             stPinchIterator_destruct(pinchIterator);
-            stSortedSet_destruct(alignedPairs);
+            alignedPairArray_destruct(alignedPairs);
 
+            cactusProfile_endPhase(profile);
             st_logInfo("Finished filling in the alignments for the flower\n");
         }
         stList_destruct(flowers);
@@ -425,7 +550,10 @@ int main(int argc, char *argv[]) {
         /*
          * Write and close the cactusdisk.
          */
+        cactusProfile_startPhase(profile, NULL_NAME, "writeDisk");
         cactusDisk_write(cactusDisk);
+        cactusProfile_endPhase(profile);
+        cactusProfile_writeReportToFile(profile, profileFileName);
         return 0; //Exit without clean up is quicker, enable cleanup when doing memory leak detection.
         if (bedRegions != NULL) {
             // Clean up our mapping.
@@ -440,7 +568,6 @@ int main(int argc, char *argv[]) {
 
     stateMachine_destruct(sM);
     cactusDisk_destruct(cactusDisk);
-    stKVDatabaseConf_destruct(kvDatabaseConf);
     //destructCactusCoreInputParameters(cCIP);
     free(cactusDiskDatabaseString);
     if (listOfEndAlignmentFiles != NULL) {
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "alignedPairArray.h"
+
+AlignedPairArray *alignedPairArray_construct(int64_t maxLength) {
+    AlignedPairArray *alignedPairs = st_calloc(1, sizeof(AlignedPairArray));
+    alignedPairs->maxLength = maxLength > 0 ? maxLength : 2;
+    alignedPairs->sorted = 1;
+    alignedPairs->subsequenceIdentifiers = st_malloc(sizeof(int64_t) * alignedPairs->maxLength);
+    alignedPairs->positions = st_malloc(sizeof(int64_t) * alignedPairs->maxLength);
+    alignedPairs->scores = st_malloc(sizeof(int64_t) * alignedPairs->maxLength);
+    alignedPairs->reverses = st_malloc(sizeof(int64_t) * alignedPairs->maxLength);
+    alignedPairs->strands = st_malloc(sizeof(bool) * alignedPairs->maxLength);
+    return alignedPairs;
+}
+
+void alignedPairArray_destruct(AlignedPairArray *alignedPairs) {
+    free(alignedPairs->subsequenceIdentifiers);
+    free(alignedPairs->positions);
+    free(alignedPairs->scores);
+    free(alignedPairs->reverses);
+    free(alignedPairs->strands);
+    free(alignedPairs);
+}
+
+static void setMaxLength(AlignedPairArray *alignedPairs, int64_t maxLength) {
+    alignedPairs->maxLength = maxLength;
+    alignedPairs->subsequenceIdentifiers = st_realloc(alignedPairs->subsequenceIdentifiers, sizeof(int64_t) * maxLength);
+    alignedPairs->positions = st_realloc(alignedPairs->positions, sizeof(int64_t) * maxLength);
+    alignedPairs->scores = st_realloc(alignedPairs->scores, sizeof(int64_t) * maxLength);
+    alignedPairs->reverses = st_realloc(alignedPairs->reverses, sizeof(int64_t) * maxLength);
+    alignedPairs->strands = st_realloc(alignedPairs->strands, sizeof(bool) * maxLength);
+}
+
+static void setEntry(AlignedPairArray *alignedPairs, int64_t i, int64_t subsequenceIdentifier, int64_t position,
+        bool strand, int64_t score, int64_t reverse) {
+    alignedPairs->subsequenceIdentifiers[i] = subsequenceIdentifier;
+    alignedPairs->positions[i] = position;
+    alignedPairs->strands[i] = strand;
+    alignedPairs->scores[i] = score;
+    alignedPairs->reverses[i] = reverse;
+}
+
+int64_t alignedPairArray_add(AlignedPairArray *alignedPairs, int64_t subsequenceIdentifier1, int64_t position1,
+        bool strand1, int64_t subsequenceIdentifier2, int64_t position2, bool strand2, int64_t score1, int64_t score2) {
+    if (alignedPairs->length + 2 > alignedPairs->maxLength) {
+        setMaxLength(alignedPairs, 2 * alignedPairs->maxLength + 2);
+    }
+    int64_t i = alignedPairs->length;
+    setEntry(alignedPairs, i, subsequenceIdentifier1, position1, strand1, score1, i + 1);
+    setEntry(alignedPairs, i + 1, subsequenceIdentifier2, position2, strand2, score2, i);
+    alignedPairs->length += 2;
+    alignedPairs->sorted = 0;
+    return i;
+}
+
+int64_t alignedPairArray_size(AlignedPairArray *alignedPairs) {
+    return alignedPairs->length - alignedPairs->removedNumber;
+}
+
+bool alignedPairArray_isRemoved(AlignedPairArray *alignedPairs, int64_t i) {
+    assert(i >= 0 && i < alignedPairs->length);
+    return alignedPairs->reverses[i] == -1;
+}
+
+void alignedPairArray_remove(AlignedPairArray *alignedPairs, int64_t i) {
+    assert(!alignedPairArray_isRemoved(alignedPairs, i));
+    int64_t j = alignedPairs->reverses[i];
+    alignedPairs->reverses[i] = -1;
+    alignedPairs->reverses[j] = -1;
+    alignedPairs->removedNumber += 2;
+}
+
+/*
+ * Compares a position with the position of an entry.
+ */
+static inline int cmpPosition(int64_t subsequenceIdentifier, int64_t position, bool strand,
+        AlignedPairArray *alignedPairs, int64_t i) {
+    int j = cactusMisc_nameCompare(subsequenceIdentifier, alignedPairs->subsequenceIdentifiers[i]);
+    if (j == 0) {
+        j = position > alignedPairs->positions[i] ? 1 : (position < alignedPairs->positions[i] ? -1 : 0);
+        if (j == 0) {
+            j = strand == alignedPairs->strands[i] ? 0 : (strand ? 1 : -1);
+        }
+    }
+    return j;
+}
+
+int alignedPairArray_cmp(AlignedPairArray *alignedPairs1, int64_t i, AlignedPairArray *alignedPairs2, int64_t j) {
+    assert(!alignedPairArray_isRemoved(alignedPairs1, i));
+    assert(!alignedPairArray_isRemoved(alignedPairs2, j));
+    int k = cmpPosition(alignedPairs1->subsequenceIdentifiers[i], alignedPairs1->positions[i], alignedPairs1->strands[i],
+            alignedPairs2, j);
+    if (k == 0) {
+        i = alignedPairs1->reverses[i];
+        k = cmpPosition(alignedPairs1->subsequenceIdentifiers[i], alignedPairs1->positions[i],
+                alignedPairs1->strands[i], alignedPairs2, alignedPairs2->reverses[j]);
+    }
+    return k;
+}
+
+/*
+ * Sorts the indices of the entries by a bottom up merge sort, as the entries are spread across the arrays.
+ */
+static void sortIndices(AlignedPairArray *alignedPairs, int64_t *indices, int64_t length) {
+    int64_t *buffer = st_malloc(sizeof(int64_t) * length);
+    int64_t *from = indices, *to = buffer;
+    for (int64_t width = 1; width < length; width *= 2) {
+        for (int64_t start = 0; start < length; start += 2 * width) {
+            int64_t middle = start + width < length ? start + width : length;
+            int64_t end = start + 2 * width < length ? start + 2 * width : length;
+            int64_t i = start, j = middle, k = start;
+            while (i < middle && j < end) {
+                to[k++] = alignedPairArray_cmp(alignedPairs, from[j], alignedPairs, from[i]) < 0 ? from[j++] : from[i++];
+            }
+            while (i < middle) {
+                to[k++] = from[i++];
+            }
+            while (j < end) {
+                to[k++] = from[j++];
+            }
+        }
+        int64_t *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != indices) {
+        memcpy(indices, from, sizeof(int64_t) * length);
+    }
+    free(buffer);
+}
+
+void alignedPairArray_sort(AlignedPairArray *alignedPairs) {
+    //Get the indices of the remaining entries, in sorted order.
+    int64_t length = alignedPairArray_size(alignedPairs);
+    int64_t *indices = st_malloc(sizeof(int64_t) * (length + 1));
+    int64_t j = 0;
+    for (int64_t i = 0; i < alignedPairs->length; i++) {
+        if (!alignedPairArray_isRemoved(alignedPairs, i)) {
+            indices[j++] = i;
+        }
+    }
+    assert(j == length);
+    sortIndices(alignedPairs, indices, length);
+
+    //Permute the arrays, the reverses by way of the new index of each old entry.
+    int64_t *newIndices = st_malloc(sizeof(int64_t) * (alignedPairs->length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        newIndices[indices[i]] = i;
+    }
+    int64_t *column = st_malloc(sizeof(int64_t) * (length + 1));
+    for (int64_t i = 0; i < length; i++) {
+        column[i] = newIndices[alignedPairs->reverses[indices[i]]];
+    }
+    memcpy(alignedPairs->reverses, column, sizeof(int64_t) * length);
+    int64_t *columns[] = { alignedPairs->subsequenceIdentifiers, alignedPairs->positions, alignedPairs->scores };
+    for (int64_t c = 0; c < 3; c++) {
+        for (int64_t i = 0; i < length; i++) {
+            column[i] = columns[c][indices[i]];
+        }
+        memcpy(columns[c], column, sizeof(int64_t) * length);
+    }
+    bool *strands = (bool *) column;
+    for (int64_t i = 0; i < length; i++) {
+        strands[i] = alignedPairs->strands[indices[i]];
+    }
+    memcpy(alignedPairs->strands, strands, sizeof(bool) * length);
+    free(column);
+    free(newIndices);
+    free(indices);
+
+    alignedPairs->length = length;
+    alignedPairs->removedNumber = 0;
+    alignedPairs->sorted = 1;
+}
+
+int64_t alignedPairArray_getFirstIndex(AlignedPairArray *alignedPairs, int64_t subsequenceIdentifier,
+        int64_t position) {
+    assert(alignedPairs->sorted);
+    //The negative strand sorts first, so this is the lower bound of the position.
+    int64_t min = 0, max = alignedPairs->length;
+    while (min < max) {
+        int64_t mid = min + (max - min) / 2;
+        if (cmpPosition(subsequenceIdentifier, position, 0, alignedPairs, mid) > 0) {
+            min = mid + 1;
+        } else {
+            max = mid;
+        }
+    }
+    return min;
+}
+
+int64_t alignedPairArray_search(AlignedPairArray *alignedPairs, int64_t subsequenceIdentifier1, int64_t position1,
+        bool strand1, int64_t subsequenceIdentifier2, int64_t position2, bool strand2) {
+    assert(alignedPairs->sorted);
+    for (int64_t i = alignedPairArray_getFirstIndex(alignedPairs, subsequenceIdentifier1, position1);
+            i < alignedPairs->length && cmpPosition(subsequenceIdentifier1, position1, strand1, alignedPairs, i) >= 0;
+            i++) {
+        if (!alignedPairArray_isRemoved(alignedPairs, i)
+                && cmpPosition(subsequenceIdentifier1, position1, strand1, alignedPairs, i) == 0
+                && cmpPosition(subsequenceIdentifier2, position2, strand2, alignedPairs, alignedPairs->reverses[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Gets the next entry at or after i that has not been removed.
+ */
+static int64_t getNextIndex(AlignedPairArray *alignedPairs, int64_t i) {
+    while (i < alignedPairs->length && alignedPairArray_isRemoved(alignedPairs, i)) {
+        i++;
+    }
+    return i;
+}
+
+AlignedPairArray *alignedPairArray_merge(AlignedPairArray *alignedPairs1, AlignedPairArray *alignedPairs2) {
+    assert(alignedPairs1->sorted && alignedPairs2->sorted);
+    AlignedPairArray *alignedPairs = alignedPairArray_construct(
+            alignedPairArray_size(alignedPairs1) + alignedPairArray_size(alignedPairs2));
+    //The new index of each old entry, then the reverses are fixed up.
+    int64_t *newIndices1 = st_malloc(sizeof(int64_t) * (alignedPairs1->length + 1));
+    int64_t *newIndices2 = st_malloc(sizeof(int64_t) * (alignedPairs2->length + 1));
+    bool *fromFirst = st_malloc(sizeof(bool) * (alignedPairs->maxLength + 1));
+    int64_t i = getNextIndex(alignedPairs1, 0), j = getNextIndex(alignedPairs2, 0), k = 0;
+    while (i < alignedPairs1->length || j < alignedPairs2->length) {
+        if (j == alignedPairs2->length
+                || (i < alignedPairs1->length && alignedPairArray_cmp(alignedPairs1, i, alignedPairs2, j) <= 0)) {
+            setEntry(alignedPairs, k, alignedPairs1->subsequenceIdentifiers[i], alignedPairs1->positions[i],
+                    alignedPairs1->strands[i], alignedPairs1->scores[i], alignedPairs1->reverses[i]);
+            fromFirst[k] = 1;
+            newIndices1[i] = k++;
+            i = getNextIndex(alignedPairs1, i + 1);
+        } else {
+            setEntry(alignedPairs, k, alignedPairs2->subsequenceIdentifiers[j], alignedPairs2->positions[j],
+                    alignedPairs2->strands[j], alignedPairs2->scores[j], alignedPairs2->reverses[j]);
+            fromFirst[k] = 0;
+            newIndices2[j] = k++;
+            j = getNextIndex(alignedPairs2, j + 1);
+        }
+    }
+    assert(k == alignedPairs->maxLength || k == 0);
+    for (int64_t l = 0; l < k; l++) {
+        alignedPairs->reverses[l] = (fromFirst[l] ? newIndices1 : newIndices2)[alignedPairs->reverses[l]];
+    }
+    alignedPairs->length = k;
+    free(fromFirst);
+    free(newIndices1);
+    free(newIndices2);
+    return alignedPairs;
+}
+
+AlignedPairArray *alignedPairArray_mergeList(stList *alignedPairArrays) {
+    /*
+     * Merges the arrays in pairs, then the results in pairs and so on, so each entry is copied
+     * a logarithmic number of times.
+     */
+    stList *toMerge = stList_copy(alignedPairArrays, NULL);
+    stSet *merged = stSet_construct();
+    while (stList_length(toMerge) > 1) {
+        stList *toMerge2 = stList_construct();
+        for (int64_t i = 0; i + 1 < stList_length(toMerge); i += 2) {
+            AlignedPairArray *alignedPairs = alignedPairArray_merge(stList_get(toMerge, i), stList_get(toMerge, i + 1));
+            stSet_insert(merged, alignedPairs);
+            stList_append(toMerge2, alignedPairs);
+        }
+        if (stList_length(toMerge) % 2 == 1) {
+            stList_append(toMerge2, stList_peek(toMerge));
+        }
+        stList_destruct(toMerge);
+        toMerge = toMerge2;
+    }
+    AlignedPairArray *empty = alignedPairArray_construct(0);
+    AlignedPairArray *alignedPairs = alignedPairArray_merge(stList_length(toMerge) > 0 ? stList_get(toMerge, 0) : empty,
+            empty);
+    alignedPairArray_destruct(empty);
+    stSetIterator *it = stSet_getIterator(merged);
+    AlignedPairArray *alignedPairs2;
+    while ((alignedPairs2 = stSet_getNext(it)) != NULL) {
+        alignedPairArray_destruct(alignedPairs2);
+    }
+    stSet_destructIterator(it);
+    stSet_destruct(merged);
+    stList_destruct(toMerge);
+    return alignedPairs;
+}
+
+bool alignedPairArray_equals(AlignedPairArray *alignedPairs1, AlignedPairArray *alignedPairs2) {
+    assert(alignedPairs1->sorted && alignedPairs2->sorted);
+    int64_t i = getNextIndex(alignedPairs1, 0), j = getNextIndex(alignedPairs2, 0);
+    while (i < alignedPairs1->length && j < alignedPairs2->length) {
+        if (alignedPairArray_cmp(alignedPairs1, i, alignedPairs2, j) != 0
+                || alignedPairs1->scores[i] != alignedPairs2->scores[j]) {
+            return 0;
+        }
+        i = getNextIndex(alignedPairs1, i + 1);
+        j = getNextIndex(alignedPairs2, j + 1);
+    }
+    return i == alignedPairs1->length && j == alignedPairs2->length;
+}
@@ -9,50 +9,7 @@
 #include "adjacencySequences.h"
 #include "pairwiseAligner.h"
 
-AlignedPair *alignedPair_construct(int64_t subsequenceIdentifier1, int64_t position1, bool strand1,
-        int64_t subsequenceIdentifier2, int64_t position2, bool strand2, int64_t score, int64_t rScore) {
-    AlignedPair *alignedPair = st_malloc(sizeof(AlignedPair));
-    alignedPair->subsequenceIdentifier = subsequenceIdentifier1;
-    alignedPair->position = position1;
-    alignedPair->strand = strand1;
-
-    alignedPair->reverse = st_malloc(sizeof(AlignedPair));
-    alignedPair->reverse->reverse = alignedPair;
-
-    alignedPair->reverse->subsequenceIdentifier = subsequenceIdentifier2;
-    alignedPair->reverse->position = position2;
-    alignedPair->reverse->strand = strand2;
-
-    alignedPair->score = score;
-    alignedPair->reverse->score = rScore;
-
-    return alignedPair;
-}
-
-void alignedPair_destruct(AlignedPair *alignedPair) {
-    free(alignedPair); //We assume the reverse will be free independently.
-}
-
-static int alignedPair_cmpFnP(const AlignedPair *alignedPair1, const AlignedPair *alignedPair2) {
-    int i = cactusMisc_nameCompare(alignedPair1->subsequenceIdentifier, alignedPair2->subsequenceIdentifier);
-    if(i == 0) {
-        i = alignedPair1->position > alignedPair2->position ? 1 : (alignedPair1->position < alignedPair2->position ? -1 : 0);
-        if(i == 0) {
-            i = alignedPair1->strand == alignedPair2->strand ? 0 : (alignedPair1->strand ? 1 : -1);
-        }
-    }
-    return i;
-}
-
-int alignedPair_cmpFn(const AlignedPair *alignedPair1, const AlignedPair *alignedPair2) {
-    int i = alignedPair_cmpFnP(alignedPair1, alignedPair2);
-    if(i == 0) {
-        i = alignedPair_cmpFnP(alignedPair1->reverse, alignedPair2->reverse);
-    }
-    return i;
-}
-
-stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
+AlignedPairArray *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
         bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
     //Make an alignment of the sequences in the ends
@@ -141,9 +98,7 @@ stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees,
     }
 
 	//Convert the alignment pairs to an alignment of the caps..
-    stSortedSet *sortedAlignment =
-                stSortedSet_construct3((int (*)(const void *, const void *))alignedPair_cmpFn,
-                (void (*)(void *))alignedPair_destruct);
+    AlignedPairArray *alignment = alignedPairArray_construct(2 * stList_length(mA->alignedPairs));
     while(stList_length(mA->alignedPairs) > 0) {
         stIntTuple *alignedPair = stList_pop(mA->alignedPairs);
         assert(stIntTuple_length(alignedPair) == 5);
@@ -165,16 +120,19 @@ stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees,
         double *scoreAdjustments = seqFrag1->rightEndId == seqFrag2->rightEndId ? scoreAdjustmentsCommonEnds : scoreAdjustmentsNonCommonEnds;
         assert(scoreAdjustments[seqIndex1] != INT64_MIN);
         assert(scoreAdjustments[seqIndex2] != INT64_MIN);
-        AlignedPair *alignedPair2 = alignedPair_construct(
+        alignedPairArray_add(alignment,
                 i->subsequenceIdentifier, i->start + (i->strand ? offset1 : -offset1), i->strand,
                 j->subsequenceIdentifier, j->start + (j->strand ? offset2 : -offset2), j->strand,
                 score*scoreAdjustments[seqIndex1], score*scoreAdjustments[seqIndex2]); //Do the reweighting here.
-        assert(stSortedSet_search(sortedAlignment, alignedPair2) == NULL);
-        assert(stSortedSet_search(sortedAlignment, alignedPair2->reverse) == NULL);
-        stSortedSet_insert(sortedAlignment, alignedPair2);
-        stSortedSet_insert(sortedAlignment, alignedPair2->reverse);
         stIntTuple_destruct(alignedPair);
     }
+    //Sort the pairs in one go, rather than as they are added.
+    alignedPairArray_sort(alignment);
+#ifndef NDEBUG
+    for(int64_t i=1; i<alignment->length; i++) {
+        assert(alignedPairArray_cmp(alignment, i-1, alignment, i) < 0); //The pairs are distinct.
+    }
+#endif
 
     //Cleanup
     stList_destruct(seqFrags);
@@ -186,41 +144,49 @@ stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees,
     multipleAlignment_destruct(mA);
     stHash_destruct(endInstanceNumbers);
 
-    return sortedAlignment;
+    return alignment;
 }
 
-void writeEndAlignmentToDisk(End *end, stSortedSet *endAlignment, FILE *fileHandle) {
-    fprintf(fileHandle, "%s %" PRIi64 "\n", cactusMisc_nameToStringStatic(end_getName(end)), stSortedSet_size(endAlignment));
-    stSortedSetIterator *it = stSortedSet_getIterator(endAlignment);
-    AlignedPair *aP;
-    while((aP = stSortedSet_getNext(it)) != NULL) {
-        fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " %i %" PRIi64 " ", aP->subsequenceIdentifier, aP->position, aP->strand, aP->score);
-        aP = aP->reverse;
-        fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " %i %" PRIi64 "\n", aP->subsequenceIdentifier, aP->position, aP->strand, aP->score);
+/*
+ * Text end alignments. Each end alignment is a line giving the name of the end and the number of
+ * lines that follow, then a line for each side of each aligned pair, giving the sequence, position,
+ * strand and score of the side, then those of the other side.
+ */
+
+static void writeEndAlignmentAsText(Name endName, AlignedPairArray *endAlignment, FILE *fileHandle) {
+    fprintf(fileHandle, "%s %" PRIi64 "\n", cactusMisc_nameToStringStatic(endName), alignedPairArray_size(endAlignment));
+    for(int64_t i=0; i<endAlignment->length; i++) {
+        if(alignedPairArray_isRemoved(endAlignment, i)) {
+            continue;
+        }
+        int64_t j = endAlignment->reverses[i];
+        fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " %i %" PRIi64 " ", endAlignment->subsequenceIdentifiers[i],
+                endAlignment->positions[i], endAlignment->strands[i], endAlignment->scores[i]);
+        fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " %i %" PRIi64 "\n", endAlignment->subsequenceIdentifiers[j],
+                endAlignment->positions[j], endAlignment->strands[j], endAlignment->scores[j]);
     }
-    stSortedSet_destructIterator(it);
 }
 
-stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end) {
-    stSortedSet *endAlignment =
-                stSortedSet_construct3((int (*)(const void *, const void *))alignedPair_cmpFn,
-                (void (*)(void *))alignedPair_destruct);
+/*
+ * Returns non-zero if the first position comes before the second in the order of a sorted alignment.
+ */
+static bool isBefore(int64_t sI1, int64_t p1, int64_t st1, int64_t sI2, int64_t p2, int64_t st2) {
+    int i = cactusMisc_nameCompare(sI1, sI2);
+    return i < 0 || (i == 0 && (p1 < p2 || (p1 == p2 && st1 < st2)));
+}
+
+static AlignedPairArray *loadEndAlignmentAsText(FILE *fileHandle, Name *endName) {
     char *line = stFile_getLineFromFile(fileHandle);
     if(line == NULL) {
-        *end = NULL;
         return NULL;
     }
-    Name flowerName;
     int64_t lineNumber;
-    int64_t i = sscanf(line, "%" PRIi64 " %" PRIi64 "", &flowerName, &lineNumber);
+    int64_t i = sscanf(line, "%" PRIi64 " %" PRIi64 "", endName, &lineNumber);
     if(i != 2 || lineNumber < 0) {
         st_errAbort("We encountered a mis-specified name in loading the first line of an end alignment from the disk: '%s'\n", line);
     }
     free(line);
-    *end = flower_getEnd(flower, flowerName);
-    if(*end == NULL) {
-        st_errAbort("We encountered an end name that is not in the database: '%s'\n", line);
-    }
+    AlignedPairArray *endAlignment = alignedPairArray_construct(lineNumber);
     for(int64_t i=0; i<lineNumber; i++) {
         line = stFile_getLineFromFile(fileHandle);
         if(line == NULL) {
@@ -233,9 +199,181 @@ stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **en
         if(i != 8) {
             st_errAbort("We encountered a mis-specified name in loading an end alignment from the disk: '%s'\n", line);
         }
-        stSortedSet_insert(endAlignment, alignedPair_construct(sI1, p1, st1, sI2, p2, st2, score1, score2));
+        //Each pair is written twice, once from each side, so is only added from the first.
+        if(isBefore(sI1, p1, st1, sI2, p2, st2)) {
+            alignedPairArray_add(endAlignment, sI1, p1, st1, sI2, p2, st2, score1, score2);
+        }
         free(line);
     }
+    alignedPairArray_sort(endAlignment);
     return endAlignment;
 }
 
+/*
+ * Binary end alignments. Each end alignment is a header of five int64s: the magic number (as eight
+ * characters), the version, the flags, the name of the end and the number of entries (two per pair),
+ * followed by the columns of the sorted array: the subsequence identifiers, positions, scores and
+ * reverses, as int64s, then the strands, one byte each. If the checksum flag is set, a checksum of the
+ * columns follows them. Integers are in the byte order of the machine, as the files are only passed
+ * between the jobs of a run.
+ */
+
+#define BINARY_END_ALIGNMENT_MAGIC "CACTUSEA"
+#define BINARY_END_ALIGNMENT_VERSION 1
+#define BINARY_END_ALIGNMENT_CHECKSUM 1
+
+/*
+ * Folds the given bytes into the checksum, a word at a time. This is FNV-1a over words rather than bytes,
+ * which catches the truncated and mangled files we are worried about at a fraction of the cost.
+ */
+static uint64_t updateChecksum(uint64_t checksum, const void *bytes, int64_t length) {
+    const char *c = bytes;
+    int64_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, c + i, 8);
+        checksum = (checksum ^ word) * 1099511628211ULL;
+    }
+    for(; i < length; i++) {
+        checksum = (checksum ^ (uint8_t)c[i]) * 1099511628211ULL;
+    }
+    return checksum;
+}
+
+static void writeColumn(FILE *fileHandle, const void *column, size_t size, int64_t length, uint64_t *checksum) {
+    if(length > 0 && fwrite(column, size, length, fileHandle) != (size_t)length) {
+        st_errAbort("Could not write a binary end alignment\n");
+    }
+    *checksum = updateChecksum(*checksum, column, size * length);
+}
+
+static void writeEndAlignmentAsBinary(Name endName, AlignedPairArray *endAlignment, bool checksum, FILE *fileHandle) {
+    assert(endAlignment->sorted);
+    //The removed pairs are left out, so the columns can be written as they are.
+    AlignedPairArray *compactEndAlignment = endAlignment;
+    if(endAlignment->removedNumber > 0) {
+        AlignedPairArray *emptyEndAlignment = alignedPairArray_construct(0);
+        compactEndAlignment = alignedPairArray_merge(endAlignment, emptyEndAlignment);
+        alignedPairArray_destruct(emptyEndAlignment);
+    }
+    int64_t header[5] = { 0, BINARY_END_ALIGNMENT_VERSION, checksum ? BINARY_END_ALIGNMENT_CHECKSUM : 0, endName,
+            compactEndAlignment->length };
+    memcpy(header, BINARY_END_ALIGNMENT_MAGIC, 8);
+    if(fwrite(header, sizeof(int64_t), 5, fileHandle) != 5) {
+        st_errAbort("Could not write the header of a binary end alignment\n");
+    }
+    uint64_t columnsChecksum = 14695981039346656037ULL;
+    int64_t length = compactEndAlignment->length;
+    writeColumn(fileHandle, compactEndAlignment->subsequenceIdentifiers, sizeof(int64_t), length, &columnsChecksum);
+    writeColumn(fileHandle, compactEndAlignment->positions, sizeof(int64_t), length, &columnsChecksum);
+    writeColumn(fileHandle, compactEndAlignment->scores, sizeof(int64_t), length, &columnsChecksum);
+    writeColumn(fileHandle, compactEndAlignment->reverses, sizeof(int64_t), length, &columnsChecksum);
+    writeColumn(fileHandle, compactEndAlignment->strands, sizeof(bool), length, &columnsChecksum);
+    if(checksum && fwrite(&columnsChecksum, sizeof(uint64_t), 1, fileHandle) != 1) {
+        st_errAbort("Could not write the checksum of a binary end alignment\n");
+    }
+    if(compactEndAlignment != endAlignment) {
+        alignedPairArray_destruct(compactEndAlignment);
+    }
+}
+
+static void readColumn(FILE *fileHandle, void *column, size_t size, int64_t length, uint64_t *checksum) {
+    if(length > 0 && fread(column, size, length, fileHandle) != (size_t)length) {
+        st_errAbort("Reached the end of the file while loading a binary end alignment\n");
+    }
+    *checksum = updateChecksum(*checksum, column, size * length);
+}
+
+static AlignedPairArray *loadEndAlignmentAsBinary(FILE *fileHandle, Name *endName) {
+    int64_t header[5];
+    size_t i = fread(header, sizeof(int64_t), 5, fileHandle);
+    if(i == 0 && feof(fileHandle)) {
+        return NULL;
+    }
+    if(i != 5 || memcmp(header, BINARY_END_ALIGNMENT_MAGIC, 8) != 0) {
+        st_errAbort("We encountered a mis-specified header in loading a binary end alignment from the disk\n");
+    }
+    if(header[1] != BINARY_END_ALIGNMENT_VERSION) {
+        st_errAbort("We encountered a binary end alignment of version %" PRIi64 ", but can only load version %i\n",
+                header[1], BINARY_END_ALIGNMENT_VERSION);
+    }
+    *endName = header[3];
+    int64_t length = header[4];
+    if(length < 0 || length % 2 != 0) {
+        st_errAbort("We encountered a binary end alignment with %" PRIi64 " entries\n", length);
+    }
+    //The columns are read straight into the array, which was sorted when it was written.
+    AlignedPairArray *endAlignment = alignedPairArray_construct(length);
+    uint64_t columnsChecksum = 14695981039346656037ULL;
+    readColumn(fileHandle, endAlignment->subsequenceIdentifiers, sizeof(int64_t), length, &columnsChecksum);
+    readColumn(fileHandle, endAlignment->positions, sizeof(int64_t), length, &columnsChecksum);
+    readColumn(fileHandle, endAlignment->scores, sizeof(int64_t), length, &columnsChecksum);
+    readColumn(fileHandle, endAlignment->reverses, sizeof(int64_t), length, &columnsChecksum);
+    readColumn(fileHandle, endAlignment->strands, sizeof(bool), length, &columnsChecksum);
+    endAlignment->length = length;
+    if(header[2] & BINARY_END_ALIGNMENT_CHECKSUM) {
+        uint64_t expectedChecksum;
+        if(fread(&expectedChecksum, sizeof(uint64_t), 1, fileHandle) != 1) {
+            st_errAbort("Reached the end of the file while loading the checksum of a binary end alignment\n");
+        }
+        if(expectedChecksum != columnsChecksum) {
+            st_errAbort("The checksum of the binary end alignment of end %" PRIi64 " does not match, the file is corrupt\n", *endName);
+        }
+    }
+    //A bad reverse would corrupt memory later on, so they are always checked.
+    for(int64_t j=0; j<length; j++) {
+        int64_t k = endAlignment->reverses[j];
+        if(k < 0 || k >= length || k == j || endAlignment->reverses[k] != j) {
+            st_errAbort("We encountered a bad pair in the binary end alignment of end %" PRIi64 "\n", *endName);
+        }
+    }
+    return endAlignment;
+}
+
+/*
+ * Loads an end alignment in either format, telling them apart by the first character, returning NULL at the
+ * end of the file.
+ */
+static AlignedPairArray *loadEndAlignment(FILE *fileHandle, Name *endName) {
+    int c = getc(fileHandle);
+    if(c == EOF) {
+        return NULL;
+    }
+    ungetc(c, fileHandle);
+    return c == BINARY_END_ALIGNMENT_MAGIC[0] ? loadEndAlignmentAsBinary(fileHandle, endName)
+            : loadEndAlignmentAsText(fileHandle, endName);
+}
+
+void writeEndAlignmentToDisk(End *end, AlignedPairArray *endAlignment, FILE *fileHandle) {
+    writeEndAlignmentAsText(end_getName(end), endAlignment, fileHandle);
+}
+
+void writeEndAlignmentToDiskAsBinary(End *end, AlignedPairArray *endAlignment, bool checksum, FILE *fileHandle) {
+    writeEndAlignmentAsBinary(end_getName(end), endAlignment, checksum, fileHandle);
+}
+
+AlignedPairArray *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end) {
+    Name endName;
+    AlignedPairArray *endAlignment = loadEndAlignment(fileHandle, &endName);
+    if(endAlignment == NULL) {
+        *end = NULL;
+        return NULL;
+    }
+    *end = flower_getEnd(flower, endName);
+    if(*end == NULL) {
+        st_errAbort("We encountered an end name that is not in the database: '%s'\n", cactusMisc_nameToStringStatic(endName));
+    }
+    return endAlignment;
+}
+
+int64_t convertEndAlignmentsToText(FILE *inputFileHandle, FILE *outputFileHandle) {
+    int64_t endAlignmentNumber = 0;
+    Name endName;
+    AlignedPairArray *endAlignment;
+    while((endAlignment = loadEndAlignment(inputFileHandle, &endName)) != NULL) {
+        writeEndAlignmentAsText(endName, endAlignment, outputFileHandle);
+        alignedPairArray_destruct(endAlignment);
+        endAlignmentNumber++;
+    }
+    return endAlignmentNumber;
+}
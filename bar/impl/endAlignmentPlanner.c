@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <math.h>
+#include "sonLib.h"
+#include "cactus.h"
+#include "adjacencySequences.h"
+#include "endAlignmentPlanner.h"
+
+EndAlignmentPlannerParameters *endAlignmentPlannerParameters_construct() {
+    EndAlignmentPlannerParameters *params = st_malloc(sizeof(EndAlignmentPlannerParameters));
+    params->kmerLength = 12;
+    params->sketchSize = 128;
+    params->maxSampledPairs = 64;
+    params->fullCostDivergence = 0.1;
+    params->minSpanningTrees = 1;
+    params->minDiagonalExpansion = 4;
+    return params;
+}
+
+void endAlignmentPlannerParameters_destruct(EndAlignmentPlannerParameters *params) {
+    free(params);
+}
+
+/*
+ * Sketches.
+ */
+
+typedef struct _sketch {
+    uint64_t *hashes; //Sorted and distinct.
+    int64_t length;
+} Sketch;
+
+static uint64_t hashKmer(uint64_t kmer) {
+    //The splitmix64 finaliser, so the smallest hashes are a random sample of the k-mers.
+    kmer += 0x9E3779B97F4A7C15ULL;
+    kmer = (kmer ^ (kmer >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    kmer = (kmer ^ (kmer >> 27)) * 0x94D049BB133111EBULL;
+    return kmer ^ (kmer >> 31);
+}
+
+static int64_t encodeBase(char base) {
+    switch (base) {
+        case 'A':
+        case 'a':
+            return 0;
+        case 'C':
+        case 'c':
+            return 1;
+        case 'G':
+        case 'g':
+            return 2;
+        case 'T':
+        case 't':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+static int cmpHashes(const void *a, const void *b) {
+    uint64_t i = *(const uint64_t *) a, j = *(const uint64_t *) b;
+    return i < j ? -1 : (i > j ? 1 : 0);
+}
+
+static Sketch *sketch_construct(const char *string, int64_t kmerLength, int64_t sketchSize) {
+    /*
+     * Keeps the sketchSize smallest distinct hashes of the k-mers of the string, skipping
+     * k-mers that include a base other than A, C, G or T.
+     */
+    int64_t stringLength = strlen(string);
+    Sketch *sketch = st_malloc(sizeof(Sketch));
+    sketch->hashes = st_malloc((stringLength > 0 ? stringLength : 1) * sizeof(uint64_t));
+    sketch->length = 0;
+    uint64_t mask = kmerLength >= 32 ? UINT64_MAX : (((uint64_t) 1) << (2 * kmerLength)) - 1;
+    uint64_t kmer = 0;
+    int64_t validLength = 0; //The number of valid bases ending at the current position.
+    for (int64_t i = 0; i < stringLength; i++) {
+        int64_t code = encodeBase(string[i]);
+        if (code == -1) {
+            validLength = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | code) & mask;
+        if (++validLength >= kmerLength) {
+            sketch->hashes[sketch->length++] = hashKmer(kmer);
+        }
+    }
+    qsort(sketch->hashes, sketch->length, sizeof(uint64_t), cmpHashes);
+    int64_t distinctLength = 0;
+    for (int64_t i = 0; i < sketch->length && distinctLength < sketchSize; i++) {
+        if (distinctLength == 0 || sketch->hashes[distinctLength - 1] != sketch->hashes[i]) {
+            sketch->hashes[distinctLength++] = sketch->hashes[i];
+        }
+    }
+    sketch->length = distinctLength;
+    return sketch;
+}
+
+static void sketch_destruct(Sketch *sketch) {
+    free(sketch->hashes);
+    free(sketch);
+}
+
+static double sketch_distance(Sketch *sketch1, Sketch *sketch2, int64_t kmerLength, int64_t sketchSize) {
+    /*
+     * Estimates the Jaccard index of the k-mers from the smallest hashes of the union of the sketches, then
+     * converts it to the expected fraction of differing bases (the Mash distance).
+     */
+    int64_t i = 0, j = 0, unionLength = 0, sharedLength = 0;
+    while (unionLength < sketchSize && (i < sketch1->length || j < sketch2->length)) {
+        if (j == sketch2->length || (i < sketch1->length && sketch1->hashes[i] < sketch2->hashes[j])) {
+            i++;
+        } else if (i == sketch1->length || sketch2->hashes[j] < sketch1->hashes[i]) {
+            j++;
+        } else {
+            sharedLength++;
+            i++;
+            j++;
+        }
+        unionLength++;
+    }
+    if (sharedLength == 0) {
+        return 1.0;
+    }
+    double jaccard = ((double) sharedLength) / unionLength;
+    double distance = -log(2.0 * jaccard / (1.0 + jaccard)) / kmerLength;
+    return distance <= 0.0 ? 0.0 : (distance > 1.0 ? 1.0 : distance);
+}
+
+/*
+ * Planning.
+ */
+
+static int cmpDoubles(const void *a, const void *b) {
+    double i = *(const double *) a, j = *(const double *) b;
+    return i < j ? -1 : (i > j ? 1 : 0);
+}
+
+double endAlignmentPlanner_estimateDivergence(EndAlignmentPlannerParameters *params, stList *strings) {
+    assert(params->kmerLength > 0 && params->kmerLength <= 32);
+    assert(params->sketchSize > 0);
+    stList *sketches = stList_construct3(0, (void (*)(void *)) sketch_destruct);
+    for (int64_t i = 0; i < stList_length(strings); i++) {
+        Sketch *sketch = sketch_construct(stList_get(strings, i), params->kmerLength, params->sketchSize);
+        if (sketch->length > 0) {
+            stList_append(sketches, sketch);
+        } else { //Too short to say anything about.
+            sketch_destruct(sketch);
+        }
+    }
+    int64_t sketchNumber = stList_length(sketches);
+    if (sketchNumber < 2) {
+        stList_destruct(sketches);
+        return params->fullCostDivergence;
+    }
+
+    //Compare every pair if there are few enough, else a sample of them, chosen by a fixed generator so
+    //the plan for an end does not depend on the state of the process.
+    int64_t pairNumber = sketchNumber * (sketchNumber - 1) / 2;
+    int64_t sampledPairNumber = pairNumber < params->maxSampledPairs || params->maxSampledPairs <= 0 ? pairNumber
+            : params->maxSampledPairs;
+    double *distances = st_malloc(sampledPairNumber * sizeof(double));
+    if (sampledPairNumber == pairNumber) {
+        int64_t k = 0;
+        for (int64_t i = 0; i < sketchNumber; i++) {
+            for (int64_t j = i + 1; j < sketchNumber; j++) {
+                distances[k++] = sketch_distance(stList_get(sketches, i), stList_get(sketches, j), params->kmerLength,
+                        params->sketchSize);
+            }
+        }
+    } else {
+        uint64_t state = 0x853C49E6748FEA9BULL ^ (uint64_t) sketchNumber;
+        for (int64_t k = 0; k < sampledPairNumber; k++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            int64_t i = (state >> 33) % sketchNumber;
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            int64_t j = (state >> 33) % (sketchNumber - 1);
+            j += j >= i ? 1 : 0;
+            distances[k] = sketch_distance(stList_get(sketches, i), stList_get(sketches, j), params->kmerLength,
+                    params->sketchSize);
+        }
+    }
+    qsort(distances, sampledPairNumber, sizeof(double), cmpDoubles);
+    double divergence = distances[(sampledPairNumber - 1) * 9 / 10];
+    free(distances);
+    stList_destruct(sketches);
+    return divergence;
+}
+
+static int64_t scale(double fraction, int64_t value, int64_t minValue) {
+    int64_t i = (int64_t) ceil(fraction * value);
+    i = i < minValue ? minValue : i;
+    return i > value ? value : i;
+}
+
+void endAlignmentPlanner_plan(EndAlignmentPlannerParameters *params, stList *strings, int64_t spanningTrees,
+        int64_t diagonalExpansion, EndAlignmentPlan *plan) {
+    plan->divergence = endAlignmentPlanner_estimateDivergence(params, strings);
+    double fraction = params->fullCostDivergence <= 0.0 || plan->divergence >= params->fullCostDivergence ? 1.0
+            : plan->divergence / params->fullCostDivergence;
+    plan->spanningTrees = scale(fraction, spanningTrees, params->minSpanningTrees);
+
+    //The sketches do not see indels, so the band is kept wide enough for the difference in length between any two
+    //of the strings, which an alignment of them must hold at least.
+    int64_t minLength = INT64_MAX, maxLength = 0;
+    for (int64_t i = 0; i < stList_length(strings); i++) {
+        int64_t length = strlen(stList_get(strings, i));
+        minLength = length < minLength ? length : minLength;
+        maxLength = length > maxLength ? length : maxLength;
+    }
+    plan->lengthDifference = stList_length(strings) > 0 ? maxLength - minLength : 0;
+    int64_t minDiagonalExpansion = params->minDiagonalExpansion > plan->lengthDifference ? params->minDiagonalExpansion
+            : plan->lengthDifference;
+    plan->diagonalExpansion = scale(fraction, diagonalExpansion, minDiagonalExpansion);
+    if (plan->diagonalExpansion % 2 != 0) { //The band must be symmetric.
+        plan->diagonalExpansion = plan->diagonalExpansion + 1 <= diagonalExpansion ? plan->diagonalExpansion + 1
+                : plan->diagonalExpansion - 1;
+    }
+}
+
+void endAlignmentPlanner_planEnd(EndAlignmentPlannerParameters *params, End *end, int64_t maxSequenceLength,
+        int64_t spanningTrees, int64_t diagonalExpansion, EndAlignmentPlan *plan) {
+    stList *sequences = stList_construct3(0, (void (*)(void *)) adjacencySequence_destruct);
+    stList *strings = stList_construct();
+    Cap *cap;
+    End_InstanceIterator *it = end_getInstanceIterator(end);
+    while ((cap = end_getNext(it)) != NULL) {
+        if (cap_getSide(cap)) {
+            cap = cap_getReverse(cap);
+        }
+        AdjacencySequence *adjacencySequence = adjacencySequence_construct(cap, maxSequenceLength);
+        stList_append(sequences, adjacencySequence);
+        stList_append(strings, adjacencySequence->string);
+    }
+    end_destructInstanceIterator(it);
+    endAlignmentPlanner_plan(params, strings, spanningTrees, diagonalExpansion, plan);
+    stList_destruct(strings);
+    stList_destruct(sequences);
+}
@@ -5,93 +5,92 @@
  */
 
 #include "endAligner.h"
+#include "flowerAligner.h"
 #include "cactus.h"
 #include "sonLib.h"
 #include "adjacencySequences.h"
 #include "pairwiseAligner.h"
 
-stList *getInducedAlignment(stSortedSet *endAlignment, AdjacencySequence *adjacencySequence) {
+static void appendIndex(int64_t **indices, int64_t *length, int64_t *maxLength, int64_t i) {
+    if (*length == *maxLength) {
+        *maxLength *= 2;
+        *indices = st_realloc(*indices, sizeof(int64_t) * *maxLength);
+    }
+    (*indices)[(*length)++] = i;
+}
+
+int64_t *getInducedAlignment(AlignedPairArray *endAlignment, AdjacencySequence *adjacencySequence, int64_t *length) {
     /*
-     * Gets an ordered list of pairs from the end alignment for the given adjacency sequence.
+     * Gets an ordered array of the indices of the pairs from the end alignment for the given adjacency sequence.
      */
-    stList *inducedAlignment = stList_construct();
+    int64_t maxLength = 16;
+    int64_t *inducedAlignment = st_malloc(sizeof(int64_t) * maxLength);
+    *length = 0;
     if (adjacencySequence->strand) {
-        AlignedPair *alignedPair = alignedPair_construct(adjacencySequence->subsequenceIdentifier,
-                adjacencySequence->start - 1, adjacencySequence->strand, 0, 0, 0, 0, 0);
-        AlignedPair *alignedPair2 = stSortedSet_searchGreaterThan(endAlignment, alignedPair);
-        if (alignedPair2 != NULL) {
-            stSortedSetIterator *it = stSortedSet_getIteratorFrom(endAlignment, alignedPair2);
-            while ((alignedPair2 = stSortedSet_getNext(it)) != NULL) {
-                if (alignedPair2->subsequenceIdentifier == adjacencySequence->subsequenceIdentifier) {
-                    if (alignedPair2->position >= adjacencySequence->start + adjacencySequence->length) {
-                        break;
-                    }
-                    assert(alignedPair2->position >= adjacencySequence->start);
-                    if (alignedPair2->strand == adjacencySequence->strand) {
-                        stList_append(inducedAlignment, alignedPair2);
-                    }
-                } else {
-                    break;
-                }
+        for (int64_t i = alignedPairArray_getFirstIndex(endAlignment, adjacencySequence->subsequenceIdentifier,
+                adjacencySequence->start); i < endAlignment->length; i++) {
+            if (endAlignment->subsequenceIdentifiers[i] != adjacencySequence->subsequenceIdentifier
+                    || endAlignment->positions[i] >= adjacencySequence->start + adjacencySequence->length) {
+                break;
+            }
+            assert(endAlignment->positions[i] >= adjacencySequence->start);
+            if (endAlignment->strands[i] == adjacencySequence->strand && !alignedPairArray_isRemoved(endAlignment, i)) {
+                appendIndex(&inducedAlignment, length, &maxLength, i);
             }
-            stSortedSet_destructIterator(it);
         }
-        alignedPair_destruct(alignedPair->reverse);
-        alignedPair_destruct(alignedPair);
     } else {
-        AlignedPair *alignedPair = alignedPair_construct(adjacencySequence->subsequenceIdentifier,
-                adjacencySequence->start + 1, adjacencySequence->strand, 0, 0, 0, 0, 0);
-        AlignedPair *alignedPair2 = stSortedSet_searchLessThan(endAlignment, alignedPair);
-        if (alignedPair2 != NULL) {
-            stSortedSetIterator *it = stSortedSet_getIteratorFrom(endAlignment, alignedPair2);
-            stSortedSet_getNext(it);
-            stSortedSet_getNext(it); //shift it up..
-            while ((alignedPair2 = stSortedSet_getPrevious(it)) != NULL) {
-                if (alignedPair2->subsequenceIdentifier == adjacencySequence->subsequenceIdentifier) {
-                    if (alignedPair2->position <= adjacencySequence->start - adjacencySequence->length) {
-                        break;
-                    }
-                    assert(alignedPair2->position <= adjacencySequence->start);
-                    if (alignedPair2->strand == adjacencySequence->strand) {
-                        stList_append(inducedAlignment, alignedPair2);
-                    }
-                } else {
-                    break;
-                }
+        for (int64_t i = alignedPairArray_getFirstIndex(endAlignment, adjacencySequence->subsequenceIdentifier,
+                adjacencySequence->start + 1) - 1; i >= 0; i--) {
+            if (endAlignment->subsequenceIdentifiers[i] != adjacencySequence->subsequenceIdentifier
+                    || endAlignment->positions[i] <= adjacencySequence->start - adjacencySequence->length) {
+                break;
+            }
+            assert(endAlignment->positions[i] <= adjacencySequence->start);
+            if (endAlignment->strands[i] == adjacencySequence->strand && !alignedPairArray_isRemoved(endAlignment, i)) {
+                appendIndex(&inducedAlignment, length, &maxLength, i);
             }
-            stSortedSet_destructIterator(it);
         }
-        alignedPair_destruct(alignedPair->reverse);
-        alignedPair_destruct(alignedPair);
     }
     /*
      * Check the induced alignment
      */
-    for (int64_t i = 0; i < stList_length(inducedAlignment); i++) {
-        AlignedPair *alignedPair = stList_get(inducedAlignment, i);
-        (void) alignedPair;
-        assert(alignedPair->subsequenceIdentifier == adjacencySequence->subsequenceIdentifier);
-        assert(alignedPair->strand == adjacencySequence->strand);
+    for (int64_t i = 0; i < *length; i++) {
+        int64_t j = inducedAlignment[i];
+        (void) j;
+        assert(endAlignment->subsequenceIdentifiers[j] == adjacencySequence->subsequenceIdentifier);
+        assert(endAlignment->strands[j] == adjacencySequence->strand);
         if (adjacencySequence->strand) {
-            assert(alignedPair->position >= adjacencySequence->start);
-            assert(alignedPair->position < adjacencySequence->start + adjacencySequence->length);
+            assert(endAlignment->positions[j] >= adjacencySequence->start);
+            assert(endAlignment->positions[j] < adjacencySequence->start + adjacencySequence->length);
         } else {
-            assert(alignedPair->position <= adjacencySequence->start);
-            assert(alignedPair->position > adjacencySequence->start - adjacencySequence->length);
+            assert(endAlignment->positions[j] <= adjacencySequence->start);
+            assert(endAlignment->positions[j] > adjacencySequence->start - adjacencySequence->length);
         }
     }
     return inducedAlignment;
 }
 
+/*
+ * The pairs of an end alignment induced on an adjacency sequence, as indices into the end alignment.
+ */
+typedef struct _inducedAlignment {
+    AlignedPairArray *endAlignment;
+    int64_t *indices;
+    int64_t length;
+} InducedAlignment;
+
+static inline int64_t inducedAlignment_getPosition(InducedAlignment *inducedAlignment, int64_t i) {
+    return inducedAlignment->endAlignment->positions[inducedAlignment->indices[i]];
+}
+
 /*
  * Runs along and cumulate the score of the pairs, traversing forward through the induced alignment.
  */
-static int64_t *cumulateScoreForward(stList *inducedAlignment1) {
-    int64_t *iA = st_malloc(sizeof(int64_t) * stList_length(inducedAlignment1));
+static int64_t *cumulateScoreForward(InducedAlignment *inducedAlignment1) {
+    int64_t *iA = st_malloc(sizeof(int64_t) * (inducedAlignment1->length + 1));
     int64_t totalScore = 0;
-    for (int64_t i = 0; i < stList_length(inducedAlignment1); i++) {
-        AlignedPair *alignedPair = stList_get(inducedAlignment1, i);
-        totalScore += alignedPair->score;
+    for (int64_t i = 0; i < inducedAlignment1->length; i++) {
+        totalScore += inducedAlignment1->endAlignment->scores[inducedAlignment1->indices[i]];
         iA[i] = totalScore;
     }
     return iA;
@@ -100,12 +99,11 @@ static int64_t *cumulateScoreForward(stList *inducedAlignment1) {
 /*
  * Runs along and cumulate the score of the pairs, traversing backward through the induced alignment.
  */
-static int64_t *cumulateScoreBackward(stList *inducedAlignment1) {
-    int64_t *iA = st_malloc(sizeof(int64_t) * stList_length(inducedAlignment1));
+static int64_t *cumulateScoreBackward(InducedAlignment *inducedAlignment1) {
+    int64_t *iA = st_malloc(sizeof(int64_t) * (inducedAlignment1->length + 1));
     int64_t totalScore = 0;
-    for (int64_t i = stList_length(inducedAlignment1) - 1; i >= 0; i--) {
-        AlignedPair *alignedPair = stList_get(inducedAlignment1, i);
-        totalScore += alignedPair->score;
+    for (int64_t i = inducedAlignment1->length - 1; i >= 0; i--) {
+        totalScore += inducedAlignment1->endAlignment->scores[inducedAlignment1->indices[i]];
         iA[i] = totalScore;
     }
     return iA;
@@ -114,15 +112,15 @@ static int64_t *cumulateScoreBackward(stList *inducedAlignment1) {
 /*
  * Chooses a point along the adjacency sequence at which to filter the two alignments,
  */
-static int64_t getCutOff(stList *inducedAlignment1, stList *inducedAlignment2, int64_t *cutOff1, int64_t *cutOff2) {
+static int64_t getCutOff(InducedAlignment *inducedAlignment1, InducedAlignment *inducedAlignment2, int64_t *cutOff1, int64_t *cutOff2) {
     int64_t *cScore1 = cumulateScoreForward(inducedAlignment1);
     int64_t *cScore2 = cumulateScoreBackward(inducedAlignment2);
 
     //Check the score arrays for sanity..
-    for (int64_t i = 1; i < stList_length(inducedAlignment1); i++) {
+    for (int64_t i = 1; i < inducedAlignment1->length; i++) {
         assert(cScore1[i - 1] < cScore1[i]);
     }
-    for (int64_t i = 1; i < stList_length(inducedAlignment2); i++) {
+    for (int64_t i = 1; i < inducedAlignment2->length; i++) {
         assert(cScore2[i - 1] > cScore2[i]);
     }
 
@@ -130,23 +128,23 @@ static int64_t getCutOff(stList *inducedAlignment1, stList *inducedAlignment2, i
     *cutOff1 = 0;
     *cutOff2 = 0;
     int64_t maxScore = -1;
-    if (stList_length(inducedAlignment2) > 0) {
+    if (inducedAlignment2->length > 0) {
         maxScore = cScore2[0];
     }
     int64_t j = 0;
     int64_t pPos1 = INT64_MIN, pPos2 = INT64_MIN;
-    for (int64_t i = 0; i < stList_length(inducedAlignment1); i++) {
-        AlignedPair *alignedPair1 = stList_get(inducedAlignment1, i);
-        assert(alignedPair1->strand);
-        assert(pPos1 <= alignedPair1->position);
-        pPos1 = alignedPair1->position;
-        if (j < stList_length(inducedAlignment2)) {
+    for (int64_t i = 0; i < inducedAlignment1->length; i++) {
+        int64_t position1 = inducedAlignment_getPosition(inducedAlignment1, i);
+        assert(inducedAlignment1->endAlignment->strands[inducedAlignment1->indices[i]]);
+        assert(pPos1 <= position1);
+        pPos1 = position1;
+        if (j < inducedAlignment2->length) {
             do {
-                AlignedPair *alignedPair2 = stList_get(inducedAlignment2, j);
-                assert(!alignedPair2->strand);
-                assert(pPos2 <= alignedPair2->position);
-                pPos2 = alignedPair2->position;
-                if (alignedPair1->position < alignedPair2->position) {
+                int64_t position2 = inducedAlignment_getPosition(inducedAlignment2, j);
+                assert(!inducedAlignment2->endAlignment->strands[inducedAlignment2->indices[j]]);
+                assert(pPos2 <= position2);
+                pPos2 = position2;
+                if (position1 < position2) {
                     if (cScore1[i] + cScore2[j] >= maxScore) {
                         maxScore = cScore1[i] + cScore2[j];
                         *cutOff1 = i + 1;
@@ -156,13 +154,13 @@ static int64_t getCutOff(stList *inducedAlignment1, stList *inducedAlignment2, i
                 } else {
                     j++;
                 }
-            } while (j < stList_length(inducedAlignment2));
+            } while (j < inducedAlignment2->length);
         } else {
             if (cScore1[i] >= maxScore) {
-                *cutOff1 = stList_length(inducedAlignment1);
+                *cutOff1 = inducedAlignment1->length;
                 *cutOff2 = j;
-                assert(cScore1[stList_length(inducedAlignment1) - 1] >= maxScore);
-                maxScore = cScore1[stList_length(inducedAlignment1) - 1];
+                assert(cScore1[inducedAlignment1->length - 1] >= maxScore);
+                maxScore = cScore1[inducedAlignment1->length - 1];
                 break;
             }
         }
@@ -190,44 +188,34 @@ void updateDeletedPairs(int64_t subsequenceIdentifier, stHash *deletedAlignedPai
     (*j)++;
 }
 
-static void pruneAlignmentsP(stList *inducedAlignment, stSortedSet *endAlignment, int64_t start, int64_t end,
-        stSortedSet *pairsToDelete, stHash *deletedAlignedPairCounts) {
+static void pruneAlignmentsP(InducedAlignment *inducedAlignment, int64_t start, int64_t end,
+        stHash *deletedAlignedPairCounts) {
+    AlignedPairArray *endAlignment = inducedAlignment->endAlignment;
     for (int64_t i = start; i < end; i++) {
-        AlignedPair *alignedPair = stList_get(inducedAlignment, i);
-        if (stSortedSet_search(endAlignment, alignedPair) != NULL) { //can be missing if we are pruning the reverse strand alignment at the same time
-            assert(stSortedSet_search(endAlignment, alignedPair->reverse) != NULL);
-            updateDeletedPairs(alignedPair->subsequenceIdentifier, deletedAlignedPairCounts);
-            updateDeletedPairs(alignedPair->reverse->subsequenceIdentifier, deletedAlignedPairCounts);
-            stSortedSet_remove(endAlignment, alignedPair);
-            stSortedSet_remove(endAlignment, alignedPair->reverse);
-            if (stSortedSet_search(pairsToDelete, alignedPair) == NULL) { // &&
-                assert(stSortedSet_search(pairsToDelete, alignedPair->reverse) == NULL);
-                stSortedSet_insert(pairsToDelete, alignedPair);
-                stSortedSet_insert(pairsToDelete, alignedPair->reverse);
-            } else {
-                assert(stSortedSet_search(pairsToDelete, alignedPair->reverse) != NULL);
-            }
+        int64_t j = inducedAlignment->indices[i];
+        if (!alignedPairArray_isRemoved(endAlignment, j)) { //can be removed if we are pruning the reverse strand alignment at the same time
+            updateDeletedPairs(endAlignment->subsequenceIdentifiers[j], deletedAlignedPairCounts);
+            updateDeletedPairs(endAlignment->subsequenceIdentifiers[endAlignment->reverses[j]], deletedAlignedPairCounts);
+            alignedPairArray_remove(endAlignment, j);
         }
     }
 }
 
-static void pruneAlignments(Cap *cap, stList *inducedAlignment1, stList *inducedAlignment2, stSortedSet *endAlignment1,
-        stSortedSet *endAlignment2, void *deletedAlignedPairCounts) {
+static void pruneAlignments(Cap *cap, InducedAlignment *inducedAlignment1, InducedAlignment *inducedAlignment2,
+        void *deletedAlignedPairCounts) {
     /*
      * Chooses a point along the adjacency sequence at which to filter the two alignments,
      * then filters the aligned pairs by this point.
      */
     int64_t cutOff1 = 0, cutOff2 = 0;
     getCutOff(inducedAlignment1, inducedAlignment2, &cutOff1, &cutOff2);
-    stSortedSet *pairsToDelete = stSortedSet_construct2((void(*)(void *)) alignedPair_destruct);
     //Now do the actual filtering of the alignments.
-    pruneAlignmentsP(inducedAlignment1, endAlignment1, cutOff1, stList_length(inducedAlignment1), pairsToDelete, deletedAlignedPairCounts);
-    pruneAlignmentsP(inducedAlignment2, endAlignment2, 0, cutOff2, pairsToDelete, deletedAlignedPairCounts);
-    stSortedSet_destruct(pairsToDelete);
+    pruneAlignmentsP(inducedAlignment1, cutOff1, inducedAlignment1->length, deletedAlignedPairCounts);
+    pruneAlignmentsP(inducedAlignment2, 0, cutOff2, deletedAlignedPairCounts);
 }
 
-void getScore(Cap *cap, stList *inducedAlignment1, stList *inducedAlignment2, stSortedSet *endAlignment1,
-        stSortedSet *endAlignment2, void *capScoresFnHash) {
+static void getScore(Cap *cap, InducedAlignment *inducedAlignment1, InducedAlignment *inducedAlignment2,
+        void *capScoresFnHash) {
 
     int64_t i, j;
     int64_t *maxScore = st_malloc(sizeof(int64_t));
@@ -245,59 +233,58 @@ static int sortCapsFn(const void *cap1, const void *cap2, const void *capScoresF
     return (i > 0) ? 1 : ((i < 0) ? -1 : 0); 
 }
 
-bool isAlignedToStubSequence(AlignedPair *alignedPair, Flower *flower) {
-	Cap *cap = flower_getCap(flower, alignedPair->reverse->subsequenceIdentifier);
+bool isAlignedToStubSequence(AlignedPairArray *endAlignment, int64_t i, Flower *flower) {
+	Cap *cap = flower_getCap(flower, endAlignment->subsequenceIdentifiers[endAlignment->reverses[i]]);
     assert(cap != NULL);
     End *end1 = cap_getEnd(cap), *end2 = cap_getEnd(cap_getAdjacency(cap));
     assert(end1 != NULL && end2 != NULL);
     return (end_isStubEnd(end1) && end_isFree(end1)) || (end_isStubEnd(end2) && end_isFree(end2));
 } 
 
-static int64_t findFirstNonStubAlignment(Flower *flower, stList *inducedAlignment, bool reverse) {
-    AlignedPair *pAlignedPair = NULL;
+static int64_t findFirstNonStubAlignment(Flower *flower, InducedAlignment *inducedAlignment, bool reverse) {
+    AlignedPairArray *endAlignment = inducedAlignment->endAlignment;
+    int64_t pIndex = -1;
     int64_t j = -1;
-    for (int64_t i = reverse ? stList_length(inducedAlignment) - 1 : 0; i < stList_length(inducedAlignment) && i >= 0; i
+    for (int64_t i = reverse ? inducedAlignment->length - 1 : 0; i < inducedAlignment->length && i >= 0; i
             += reverse ? -1 : 1) {
-        AlignedPair *alignedPair = stList_get(inducedAlignment, i);
-        assert(isAlignedToStubSequence(alignedPair->reverse, flower));
-        assert(pAlignedPair == NULL || pAlignedPair->subsequenceIdentifier == alignedPair->subsequenceIdentifier);
-        if (pAlignedPair == NULL || pAlignedPair->position != alignedPair->position) {
-            pAlignedPair = alignedPair;
+        int64_t index = inducedAlignment->indices[i];
+        assert(isAlignedToStubSequence(endAlignment, endAlignment->reverses[index], flower));
+        assert(pIndex == -1 || endAlignment->subsequenceIdentifiers[pIndex] == endAlignment->subsequenceIdentifiers[index]);
+        if (pIndex == -1 || endAlignment->positions[pIndex] != endAlignment->positions[index]) {
+            pIndex = index;
             j = i;
         }
-        if(!isAlignedToStubSequence(alignedPair, flower)) {
+        if(!isAlignedToStubSequence(endAlignment, index, flower)) {
             assert(j != -1);
             return j;
         }
     }
-    return (reverse ? -1 : stList_length(inducedAlignment));
+    return (reverse ? -1 : inducedAlignment->length);
 }
 
-static void pruneStubAlignments(Cap *cap, stList *inducedAlignment1, stList *inducedAlignment2,
-        stSortedSet *endAlignment1, stSortedSet *endAlignment2, void *deletedAlignedPairCounts) {
+static void pruneStubAlignments(Cap *cap, InducedAlignment *inducedAlignment1, InducedAlignment *inducedAlignment2,
+        void *deletedAlignedPairCounts) {
     assert(cap != NULL);
     End *end = cap_getEnd(cap);
     assert(cap_getAdjacency(cap) != NULL);
     End *adjacentEnd = cap_getEnd(cap_getAdjacency(cap));
     assert(end != NULL);
     assert(adjacentEnd != NULL);
-    int64_t cutOff1 = stList_length(inducedAlignment1) - 1;
+    int64_t cutOff1 = inducedAlignment1->length - 1;
     int64_t cutOff2 = 0;
     if (end_isStubEnd(adjacentEnd) && end_isFree(adjacentEnd)) {
         cutOff1 = findFirstNonStubAlignment(end_getFlower(end), inducedAlignment1, 1);
-        assert(stList_length(inducedAlignment2) == 0);
-        cutOff2 = stList_length(inducedAlignment2);
+        assert(inducedAlignment2->length == 0);
+        cutOff2 = inducedAlignment2->length;
     }
     if (end_isStubEnd(end) && end_isFree(end)) {
-        assert(stList_length(inducedAlignment1) == 0);
+        assert(inducedAlignment1->length == 0);
         cutOff1 = -1;
         cutOff2 = findFirstNonStubAlignment(end_getFlower(end), inducedAlignment2, 0);
     }
-    stSortedSet *pairsToDelete = stSortedSet_construct2((void(*)(void *)) alignedPair_destruct);
     //Now do the actual filtering of the alignments.
-    pruneAlignmentsP(inducedAlignment1, endAlignment1, cutOff1 + 1, stList_length(inducedAlignment1), pairsToDelete, deletedAlignedPairCounts);
-    pruneAlignmentsP(inducedAlignment2, endAlignment2, 0, cutOff2, pairsToDelete, deletedAlignedPairCounts);
-    stSortedSet_destruct(pairsToDelete);
+    pruneAlignmentsP(inducedAlignment1, cutOff1 + 1, inducedAlignment1->length, deletedAlignedPairCounts);
+    pruneAlignmentsP(inducedAlignment2, 0, cutOff2, deletedAlignedPairCounts);
 }
 
 /*
@@ -305,17 +292,18 @@ static void pruneStubAlignments(Cap *cap, stList *inducedAlignment1, stList *ind
  */
 
 static int makeFlowerAlignmentP(Cap *cap, stHash *endAlignments,
-        void(*fn)(Cap *, stList *, stList *, stSortedSet *, stSortedSet *, void *), void *extraArg) {
-    stSortedSet *endAlignment1 = stHash_search(endAlignments, end_getPositiveOrientation(cap_getEnd(cap)));
-    assert(endAlignment1 != NULL);
+        void(*fn)(Cap *, InducedAlignment *, InducedAlignment *, void *), void *extraArg) {
+    InducedAlignment inducedAlignment1, inducedAlignment2;
+    inducedAlignment1.endAlignment = stHash_search(endAlignments, end_getPositiveOrientation(cap_getEnd(cap)));
+    assert(inducedAlignment1.endAlignment != NULL);
 
     Cap *adjacentCap = cap_getAdjacency(cap);
     assert(adjacentCap != NULL);
     assert(cap_getSide(adjacentCap));
     assert(cap_getStrand(adjacentCap));
     adjacentCap = cap_getReverse(adjacentCap);
-    stSortedSet *endAlignment2 = stHash_search(endAlignments, end_getPositiveOrientation(cap_getEnd(adjacentCap)));
-    assert(endAlignment2 != NULL);
+    inducedAlignment2.endAlignment = stHash_search(endAlignments, end_getPositiveOrientation(cap_getEnd(adjacentCap)));
+    assert(inducedAlignment2.endAlignment != NULL);
 
     AdjacencySequence *adjacencySequence1 = adjacencySequence_construct(cap, INT64_MAX);
     AdjacencySequence *adjacencySequence2 = adjacencySequence_construct(adjacentCap, INT64_MAX);
@@ -324,21 +312,27 @@ static int makeFlowerAlignmentP(Cap *cap, stHash *endAlignments,
     assert(adjacencySequence1->strand == !adjacencySequence2->strand);
     assert(adjacencySequence2->start == adjacencySequence1->start + adjacencySequence1->length - 1);
 
-    stList *inducedAlignment1 = getInducedAlignment(endAlignment1, adjacencySequence1);
-    stList *inducedAlignment2 = getInducedAlignment(endAlignment2, adjacencySequence2);
-    stList_reverse(inducedAlignment2);
+    inducedAlignment1.indices = getInducedAlignment(inducedAlignment1.endAlignment, adjacencySequence1,
+            &inducedAlignment1.length);
+    inducedAlignment2.indices = getInducedAlignment(inducedAlignment2.endAlignment, adjacencySequence2,
+            &inducedAlignment2.length);
+    for (int64_t i = 0, j = inducedAlignment2.length - 1; i < j; i++, j--) { //Reverse the second alignment.
+        int64_t k = inducedAlignment2.indices[i];
+        inducedAlignment2.indices[i] = inducedAlignment2.indices[j];
+        inducedAlignment2.indices[j] = k;
+    }
 
-    fn(cap, inducedAlignment1, inducedAlignment2, endAlignment1, endAlignment2, extraArg);
+    fn(cap, &inducedAlignment1, &inducedAlignment2, extraArg);
 
     //Cleanup.
     adjacencySequence_destruct(adjacencySequence1);
     adjacencySequence_destruct(adjacencySequence2);
-    stList_destruct(inducedAlignment1);
-    stList_destruct(inducedAlignment2);
+    free(inducedAlignment1.indices);
+    free(inducedAlignment2.indices);
     return 1;
 }
 
-static stSortedSet *makeFlowerAlignment2(Flower *flower, stHash *endAlignments, bool pruneOutStubAlignments) {
+static AlignedPairArray *makeFlowerAlignment2(Flower *flower, stHash *endAlignments, bool pruneOutStubAlignments) {
     /*
      * Makes the alignments of the ends, in "endAlignments", consistent with one another using the bar algorithm.
      */
@@ -413,28 +407,14 @@ static stSortedSet *makeFlowerAlignment2(Flower *flower, stHash *endAlignments,
     }
     stList_destruct(freeStubCaps);
 
-    //Now convert to set of final aligned pairs to return.
-    stSortedSet *sortedAlignment = stSortedSet_construct3((int(*)(const void *, const void *)) alignedPair_cmpFn,
-            (void(*)(void *)) alignedPair_destruct);
+    //Now merge the pruned end alignments into the final aligned pairs to return.
     stList *endAlignmentsList = stHash_getValues(endAlignments);
-    while (stList_length(endAlignmentsList) > 0) {
-        stSortedSet *endAlignment = stList_pop(endAlignmentsList);
-        while (stSortedSet_size(endAlignment) > 0) {
-            AlignedPair *alignedPair = stSortedSet_getFirst(endAlignment);
-            stSortedSet_remove(endAlignment, alignedPair);
-            assert(stSortedSet_search(endAlignment, alignedPair->reverse) != NULL);
-            stSortedSet_remove(endAlignment, alignedPair->reverse);
-            assert(stSortedSet_search(sortedAlignment, alignedPair) == NULL);
-            assert(stSortedSet_search(sortedAlignment, alignedPair->reverse) == NULL);
-            stSortedSet_insert(sortedAlignment, alignedPair);
-            stSortedSet_insert(sortedAlignment, alignedPair->reverse);
-        }
-    }
+    AlignedPairArray *alignment = alignedPairArray_mergeList(endAlignmentsList);
     stList_destruct(endAlignmentsList);
     stHash_destruct(endAlignments);
     stHash_destruct(deletedAlignedPairCounts);
 
-    return sortedAlignment;
+    return alignment;
 }
 
 /*
@@ -516,6 +496,123 @@ static stSortedSet *getEndsToAlign(Flower *flower, int64_t maxSequenceLength) {
     return endsToAlign;
 }
 
+/*
+ * Functions to make a list of end alignments using a pool of threads.
+ */
+
+typedef struct _endAlignmentJob {
+    StateMachine *sM;
+    End *end;
+    int64_t size;
+    int64_t spanningTrees;
+    int64_t maxSequenceLength;
+    bool useProgressiveMerging;
+    float gapGamma;
+    PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters;
+    EndAlignmentPlannerParameters *planner;
+    AlignedPairArray *endAlignment;
+} EndAlignmentJob;
+
+static EndAlignmentJob *endAlignmentJob_run(EndAlignmentJob *job) {
+    if (job->planner == NULL) {
+        job->endAlignment = makeEndAlignment(job->sM, job->end, job->spanningTrees, job->maxSequenceLength,
+                job->useProgressiveMerging, job->gapGamma, job->pairwiseAlignmentBandingParameters);
+        return job;
+    }
+    EndAlignmentPlan plan;
+    endAlignmentPlanner_planEnd(job->planner, job->end, job->maxSequenceLength, job->spanningTrees,
+            job->pairwiseAlignmentBandingParameters->diagonalExpansion, &plan);
+    st_logDebug("Planned the alignment of end %" PRIi64 ", with estimated divergence %f and length difference %" PRIi64
+            ", to use %" PRIi64 " spanning trees and a diagonal expansion of %" PRIi64 "\n", end_getName(job->end),
+            plan.divergence, plan.lengthDifference, plan.spanningTrees, plan.diagonalExpansion);
+    //The parameters are shared by the jobs, so each planned job changes its own copy.
+    PairwiseAlignmentParameters pairwiseAlignmentBandingParameters = *job->pairwiseAlignmentBandingParameters;
+    pairwiseAlignmentBandingParameters.diagonalExpansion = plan.diagonalExpansion;
+    job->endAlignment = makeEndAlignment(job->sM, job->end, plan.spanningTrees, job->maxSequenceLength,
+            job->useProgressiveMerging, job->gapGamma, &pairwiseAlignmentBandingParameters);
+    return job;
+}
+
+static void endAlignmentJob_finish(EndAlignmentJob *job) {
+    /*
+     * The pool needs a finisher, but there is nothing to do here: makeEndAlignments collects the
+     * alignments from the jobs, in the order of the ends, once the pool has been waited on.
+     */
+}
+
+static int endAlignmentJob_cmpBySize(const void *a, const void *b) {
+    //Largest first, so the biggest ends are started first, ties broken by name so the order is deterministic.
+    const EndAlignmentJob *job1 = *(EndAlignmentJob **) a, *job2 = *(EndAlignmentJob **) b;
+    if (job1->size != job2->size) {
+        return job1->size > job2->size ? -1 : 1;
+    }
+    return cactusMisc_nameCompare(end_getName(job1->end), end_getName(job2->end));
+}
+
+static int64_t getEndAlignmentSize(End *end, int64_t maxSequenceLength) {
+    /*
+     * The number of bases that will be aligned for the end, as each adjacency sequence is
+     * cut to maxSequenceLength.
+     */
+    End_InstanceIterator *capIt = end_getInstanceIterator(end);
+    Cap *cap;
+    int64_t size = 0;
+    while ((cap = end_getNext(capIt)) != NULL) {
+        int64_t adjacencyLength = llabs(cap_getCoordinate(cap_getAdjacency(cap)) - cap_getCoordinate(cap)) - 1;
+        size += adjacencyLength > maxSequenceLength ? maxSequenceLength : adjacencyLength;
+    }
+    end_destructInstanceIterator(capIt);
+    return size;
+}
+
+stList *makeEndAlignments(StateMachine *sM, stList *ends, int64_t spanningTrees, int64_t maxSequenceLength,
+        bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, EndAlignmentPlannerParameters *planner,
+        int64_t numThreads) {
+    assert(numThreads >= 1);
+    int64_t endNumber = stList_length(ends);
+    EndAlignmentJob *jobs = st_calloc(endNumber, sizeof(EndAlignmentJob));
+    for (int64_t i = 0; i < endNumber; i++) {
+        EndAlignmentJob *job = &jobs[i];
+        job->sM = sM;
+        job->end = stList_get(ends, i);
+        job->spanningTrees = spanningTrees;
+        job->maxSequenceLength = maxSequenceLength;
+        job->useProgressiveMerging = useProgressiveMerging;
+        job->gapGamma = gapGamma;
+        job->pairwiseAlignmentBandingParameters = pairwiseAlignmentBandingParameters;
+        job->planner = planner;
+    }
+    if (numThreads == 1 || endNumber <= 1) {
+        for (int64_t i = 0; i < endNumber; i++) {
+            endAlignmentJob_run(&jobs[i]);
+        }
+    } else {
+        //Each alignment only reads the flower and the (thread safe) string cache of the cactus disk.
+        stList *jobsBySize = stList_construct();
+        for (int64_t i = 0; i < endNumber; i++) {
+            jobs[i].size = getEndAlignmentSize(jobs[i].end, maxSequenceLength);
+            stList_append(jobsBySize, &jobs[i]);
+        }
+        stList_sort(jobsBySize, endAlignmentJob_cmpBySize);
+        stThreadPool *threadPool = stThreadPool_construct(numThreads, (void *(*)(void *)) endAlignmentJob_run,
+                (void (*)(void *)) endAlignmentJob_finish);
+        for (int64_t i = 0; i < endNumber; i++) {
+            stThreadPool_push(threadPool, stList_get(jobsBySize, i));
+        }
+        stThreadPool_wait(threadPool);
+        stThreadPool_destruct(threadPool);
+        stList_destruct(jobsBySize);
+    }
+    //The alignments are returned in the order of the ends, whatever order they were made in.
+    stList *endAlignments = stList_construct3(endNumber, (void (*)(void *)) alignedPairArray_destruct);
+    for (int64_t i = 0; i < endNumber; i++) {
+        stList_set(endAlignments, i, jobs[i].endAlignment);
+    }
+    free(jobs);
+    return endAlignments;
+}
+
 /*
  * Functions that either create end alignments or load end alignments into memory from disk, and which
  * then call the makeFlowerAlignment2 consistency generating function.
@@ -523,7 +620,8 @@ static stSortedSet *getEndsToAlign(Flower *flower, int64_t maxSequenceLength) {
 
 static void computeMissingEndAlignments(StateMachine *sM, Flower *flower, stHash *endAlignments, int64_t spanningTrees,
         int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
-        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters) {
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, EndAlignmentPlannerParameters *planner,
+        int64_t numThreads) {
     /*
      * Creates end alignments for the ends that
      * do not have an alignment in the "endAlignments" hash, only creating
@@ -531,32 +629,37 @@ static void computeMissingEndAlignments(StateMachine *sM, Flower *flower, stHash
      */
     //Make the end alignments, representing each as an adjacency alignment.
     stSortedSet *endsToAlign = getEndsToAlign(flower, maxSequenceLength);
+    stList *ends = stList_construct();
     End *end;
     Flower_EndIterator *endIterator = flower_getEndIterator(flower);
     while ((end = flower_getNextEnd(endIterator)) != NULL) {
         if (stHash_search(endAlignments, end) == NULL) {
             if (stSortedSet_search(endsToAlign, end) != NULL) {
-                stHash_insert(
-                        endAlignments,
-                        end,
-                        makeEndAlignment(sM, end, spanningTrees, maxSequenceLength,
-                                useProgressiveMerging, gapGamma,
-                                pairwiseAlignmentBandingParameters));
+                stList_append(ends, end);
             } else {
-                stHash_insert(endAlignments, end, stSortedSet_construct());
+                stHash_insert(endAlignments, end, alignedPairArray_construct(0));
             }
         }
     }
     flower_destructEndIterator(endIterator);
     stSortedSet_destruct(endsToAlign);
+
+    stList *newEndAlignments = makeEndAlignments(sM, ends, spanningTrees, maxSequenceLength, useProgressiveMerging,
+            gapGamma, pairwiseAlignmentBandingParameters, planner, numThreads);
+    stList_setDestructor(newEndAlignments, NULL);
+    for (int64_t i = 0; i < stList_length(ends); i++) {
+        stHash_insert(endAlignments, stList_get(ends, i), stList_get(newEndAlignments, i));
+    }
+    stList_destruct(newEndAlignments);
+    stList_destruct(ends);
 }
 
-stSortedSet *makeFlowerAlignment(StateMachine *sM, Flower *flower, int64_t spanningTrees, int64_t maxSequenceLength,
+AlignedPairArray *makeFlowerAlignment(StateMachine *sM, Flower *flower, int64_t spanningTrees, int64_t maxSequenceLength,
         bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, bool pruneOutStubAlignments) {
-    stHash *endAlignments = stHash_construct2(NULL, (void(*)(void *)) stSortedSet_destruct);
+    stHash *endAlignments = stHash_construct2(NULL, (void(*)(void *)) alignedPairArray_destruct);
     computeMissingEndAlignments(sM, flower, endAlignments, spanningTrees, maxSequenceLength,
-            useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters);
+            useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters, NULL, 1);
     return makeFlowerAlignment2(flower, endAlignments, pruneOutStubAlignments);
 }
 
@@ -567,7 +670,7 @@ static void loadEndAlignments(Flower *flower, stHash *endAlignments, stList *lis
     for (int64_t i = 0; i < stList_length(listOfEndAlignments); i++) {
         End *end;
         FILE *fileHandle = fopen(stList_get(listOfEndAlignments, i), "r");
-        stSortedSet *alignment;
+        AlignedPairArray *alignment;
         while((alignment = loadEndAlignmentFromDisk(flower, fileHandle, &end)) != NULL) {
             assert(stHash_search(endAlignments, end) == NULL);
             stHash_insert(endAlignments, end, alignment);
@@ -576,15 +679,23 @@ static void loadEndAlignments(Flower *flower, stHash *endAlignments, stList *lis
     }
 }
 
-stSortedSet *makeFlowerAlignment3(StateMachine *sM, Flower *flower, stList *listOfEndAlignmentFiles, int64_t spanningTrees,
+AlignedPairArray *makeFlowerAlignment3(StateMachine *sM, Flower *flower, stList *listOfEndAlignmentFiles, int64_t spanningTrees,
         int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, bool pruneOutStubAlignments) {
-    stHash *endAlignments = stHash_construct2(NULL, (void(*)(void *)) stSortedSet_destruct);
+    return makeFlowerAlignment4(sM, flower, listOfEndAlignmentFiles, spanningTrees, maxSequenceLength,
+            useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters, pruneOutStubAlignments, NULL, 1);
+}
+
+AlignedPairArray *makeFlowerAlignment4(StateMachine *sM, Flower *flower, stList *listOfEndAlignmentFiles, int64_t spanningTrees,
+        int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, bool pruneOutStubAlignments,
+        EndAlignmentPlannerParameters *planner, int64_t numThreads) {
+    stHash *endAlignments = stHash_construct2(NULL, (void(*)(void *)) alignedPairArray_destruct);
     if(listOfEndAlignmentFiles != NULL) {
         loadEndAlignments(flower, endAlignments, listOfEndAlignmentFiles);
     }
     computeMissingEndAlignments(sM, flower, endAlignments, spanningTrees, maxSequenceLength,
-            useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters);
+            useProgressiveMerging, gapGamma, pairwiseAlignmentBandingParameters, planner, numThreads);
     return makeFlowerAlignment2(flower, endAlignments, pruneOutStubAlignments);
 }
 
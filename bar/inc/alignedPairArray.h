@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * alignedPairArray.h
+ *
+ * A packed container of aligned pairs, held as parallel arrays rather than as objects in a sorted set.
+ */
+
+#ifndef ALIGNED_PAIR_ARRAY_H_
+#define ALIGNED_PAIR_ARRAY_H_
+
+#include "sonLib.h"
+#include "cactus.h"
+
+/*
+ * Each aligned pair is held as two entries, one for each of the aligned positions, each pointing at the
+ * other by its index in reverses. Entry i aligns position positions[i] on strand strands[i] of the
+ * subsequence subsequenceIdentifiers[i], with score scores[i], to the position of entry reverses[i].
+ *
+ * Pairs are added in any order, then sorted in bulk. Once sorted the entries are ordered by subsequence,
+ * then position, then strand, then likewise by the position they are aligned to, and can be searched.
+ * Removing a pair only marks its two entries as removed (by setting their reverses to -1), so the
+ * indices of the other entries do not change; they are dropped when arrays are sorted or merged.
+ *
+ * The arrays may be read directly, but should only be changed by the functions below.
+ */
+typedef struct _alignedPairArray {
+    int64_t length; //The number of entries, including removed entries.
+    int64_t maxLength;
+    int64_t removedNumber;
+    bool sorted;
+    int64_t *subsequenceIdentifiers;
+    int64_t *positions;
+    int64_t *scores;
+    int64_t *reverses;
+    bool *strands;
+} AlignedPairArray;
+
+/*
+ * Constructs an empty array, with space for the given number of entries (two per pair) before it
+ * needs to grow.
+ */
+AlignedPairArray *alignedPairArray_construct(int64_t maxLength);
+
+void alignedPairArray_destruct(AlignedPairArray *alignedPairs);
+
+/*
+ * Adds a pair, as the two entries for its positions, returning the index of the first. The array is
+ * then unsorted.
+ */
+int64_t alignedPairArray_add(AlignedPairArray *alignedPairs, int64_t subsequenceIdentifier1, int64_t position1,
+        bool strand1, int64_t subsequenceIdentifier2, int64_t position2, bool strand2, int64_t score1, int64_t score2);
+
+/*
+ * The number of entries that have not been removed, which is twice the number of pairs.
+ */
+int64_t alignedPairArray_size(AlignedPairArray *alignedPairs);
+
+/*
+ * Returns non-zero if the entry belongs to a removed pair.
+ */
+bool alignedPairArray_isRemoved(AlignedPairArray *alignedPairs, int64_t i);
+
+/*
+ * Removes the pair of the given entry, i.e. the entry and its reverse.
+ */
+void alignedPairArray_remove(AlignedPairArray *alignedPairs, int64_t i);
+
+/*
+ * Compares two entries, from the same or different arrays, in the order of a sorted array. Neither may
+ * be removed.
+ */
+int alignedPairArray_cmp(AlignedPairArray *alignedPairs1, int64_t i, AlignedPairArray *alignedPairs2, int64_t j);
+
+/*
+ * Sorts the entries, updating the reverses to match. Removed pairs are dropped.
+ */
+void alignedPairArray_sort(AlignedPairArray *alignedPairs);
+
+/*
+ * Gets the index of the first entry in the sorted array at or after the given position of the
+ * given subsequence, which is the length of the array if there is none.
+ */
+int64_t alignedPairArray_getFirstIndex(AlignedPairArray *alignedPairs, int64_t subsequenceIdentifier,
+        int64_t position);
+
+/*
+ * Gets the index of the entry in the sorted array aligning the first position to the second, or -1 if it
+ * is not in the array or has been removed.
+ */
+int64_t alignedPairArray_search(AlignedPairArray *alignedPairs, int64_t subsequenceIdentifier1, int64_t position1,
+        bool strand1, int64_t subsequenceIdentifier2, int64_t position2, bool strand2);
+
+/*
+ * Merges two sorted arrays into a new sorted array, leaving out the removed pairs. The arrays
+ * are not changed.
+ */
+AlignedPairArray *alignedPairArray_merge(AlignedPairArray *alignedPairs1, AlignedPairArray *alignedPairs2);
+
+/*
+ * Merges a list of sorted arrays, as alignedPairArray_merge. The list is not changed.
+ */
+AlignedPairArray *alignedPairArray_mergeList(stList *alignedPairArrays);
+
+/*
+ * Returns non-zero if the two sorted arrays hold the same pairs, with the same scores.
+ */
+bool alignedPairArray_equals(AlignedPairArray *alignedPairs1, AlignedPairArray *alignedPairs2);
+
+#endif /* ALIGNED_PAIR_ARRAY_H_ */
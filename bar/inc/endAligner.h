@@ -17,49 +17,37 @@
 #include "sonLib.h"
 #include "cactus.h"
 #include "pairwiseAligner.h"
-
-typedef struct _AlignedPair {
-    int64_t subsequenceIdentifier;
-    int64_t position;
-    bool strand;
-    int64_t score;
-    struct _AlignedPair *reverse;
-} AlignedPair;
-
-/*
- * Constructs the an aligned pair.
- */
-AlignedPair *alignedPair_construct(int64_t subsequenceIdentifier1, int64_t position1, bool strand1,
-        int64_t subsequenceIdentifier2, int64_t position2, bool strand2, int64_t score1, int64_t score2);
+#include "alignedPairArray.h"
 
 /*
- * Destruct the aligned pair.
+ * Creates a global alignment (as a sorted array of aligned pairs) of the sequences from the end.
  */
-void alignedPair_destruct(AlignedPair *alignedPair);
+AlignedPairArray *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
+        bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters);
 
 /*
- * Compares two aligned pairs.
+ * Writes an end alignment to the given file, as text.
  */
-int alignedPair_cmpFn(const AlignedPair *alignedPair1, const AlignedPair *alignedPair2);
+void writeEndAlignmentToDisk(End *end, AlignedPairArray *endAlignment, FILE *fileHandle);
 
 /*
- * Creates a global alignment (as a set of aligned pairs) of the sequences from the end,
- * the pairs returned are ordered according
- * to the alignerPair comparison function.
+ * Writes an end alignment to the given file in the binary format, which is loaded by reading the sorted
+ * arrays in bulk. If checksum is non-zero a checksum is written, which is checked when the alignment is loaded.
  */
-stSortedSet *makeEndAlignment(StateMachine *sM, End *end, int64_t spanningTrees, int64_t maxSequenceLength,
-        bool useProgressiveMerging, float gapGamma,
-        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters);
+void writeEndAlignmentToDiskAsBinary(End *end, AlignedPairArray *endAlignment, bool checksum, FILE *fileHandle);
 
 /*
- * Writes an end alignment to the given file.
+ * Loads the next end alignment from the given file, which may be in either format, or returns NULL
+ * (setting end to NULL) at the end of the file. Aborts if the alignment is malformed.
  */
-void writeEndAlignmentToDisk(End *end, stSortedSet *endAlignment, FILE *fileHandle);
+AlignedPairArray *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end);
 
 /*
- * Loads an end alignment from the given file.
+ * Converts the end alignments in the given file, in either format, to text, for debugging. Returns the number
+ * of end alignments converted.
  */
-stSortedSet *loadEndAlignmentFromDisk(Flower *flower, FILE *fileHandle, End **end);
+int64_t convertEndAlignmentsToText(FILE *inputFileHandle, FILE *outputFileHandle);
 
 
 #endif /* ENDALIGNER_H_ */
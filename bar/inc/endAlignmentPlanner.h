@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * endAlignmentPlanner.h
+ *
+ * Chooses how much work to put into the alignment of each end, from a cheap estimate of how diverged its
+ * sequences are.
+ */
+
+#ifndef END_ALIGNMENT_PLANNER_H_
+#define END_ALIGNMENT_PLANNER_H_
+
+#include "sonLib.h"
+#include "cactus.h"
+
+/*
+ * The divergence of the sequences of an end is estimated from MinHash sketches of their k-mers, comparing
+ * a sample of the pairs of sequences. Ends whose estimated divergence is at least fullCostDivergence are
+ * aligned with the given number of spanning trees and diagonal expansion, as without a planner. Less
+ * diverged ends are aligned with proportionally fewer spanning trees (and so fewer guide pairwise
+ * alignments) and a proportionally narrower band, down to the given minimums.
+ *
+ * The linear scaling is a heuristic, not derived from a model of the alignments: it assumes the spanning trees
+ * and band needed grow in proportion to the divergence, and fullCostDivergence should be tuned against the
+ * endAlignmentPlanner benchmark for the sequences aligned. As the sketches only see substitutions, the band is
+ * never narrowed below the largest difference in length between two of the sequences (but is not widened beyond
+ * the given diagonal expansion), so that sequences differing by a large indel keep a band that can hold it.
+ */
+typedef struct _endAlignmentPlannerParameters {
+    int64_t kmerLength; //The length of the k-mers sketched, at most 32.
+    int64_t sketchSize; //The number of smallest k-mer hashes kept for each sequence.
+    int64_t maxSampledPairs; //The maximum number of pairs of sequences compared.
+    double fullCostDivergence;
+    int64_t minSpanningTrees;
+    int64_t minDiagonalExpansion; //Must be even, as for the banding parameters.
+} EndAlignmentPlannerParameters;
+
+/*
+ * The choices made for an end.
+ */
+typedef struct _endAlignmentPlan {
+    double divergence; //The estimated divergence of the sequences, between 0 and 1.
+    int64_t spanningTrees;
+    int64_t diagonalExpansion;
+    int64_t lengthDifference; //The largest difference in length between two of the sequences.
+} EndAlignmentPlan;
+
+/*
+ * Constructs the default parameters.
+ */
+EndAlignmentPlannerParameters *endAlignmentPlannerParameters_construct();
+
+void endAlignmentPlannerParameters_destruct(EndAlignmentPlannerParameters *params);
+
+/*
+ * Estimates the divergence (the expected fraction of differing bases) of the given list of strings, as the
+ * 0.9 quantile of the estimates for the sampled pairs, so that a few diverged sequences are not hidden
+ * by many similar ones. If there are fewer than two strings that can be sketched the divergence is
+ * taken to be fullCostDivergence. The sample of pairs is deterministic.
+ */
+double endAlignmentPlanner_estimateDivergence(EndAlignmentPlannerParameters *params, stList *strings);
+
+/*
+ * Plans the alignment of the given strings, which would otherwise be aligned with the given number of spanning trees
+ * and diagonal expansion. The plan never asks for more than either.
+ */
+void endAlignmentPlanner_plan(EndAlignmentPlannerParameters *params, stList *strings, int64_t spanningTrees,
+        int64_t diagonalExpansion, EndAlignmentPlan *plan);
+
+/*
+ * Plans the alignment of the adjacency sequences of the end, each cut to maxSequenceLength, as makeEndAlignment
+ * would align them.
+ */
+void endAlignmentPlanner_planEnd(EndAlignmentPlannerParameters *params, End *end, int64_t maxSequenceLength,
+        int64_t spanningTrees, int64_t diagonalExpansion, EndAlignmentPlan *plan);
+
+#endif /* END_ALIGNMENT_PLANNER_H_ */
@@ -15,25 +15,48 @@
 #define FLOWER_ALIGNER_H_
 
 #include "pairwiseAligner.h"
+#include "alignedPairArray.h"
+#include "endAlignmentPlanner.h"
 
 /*
  * Constructs an alignment for the flower by constructing an alignment for each end
  * then filtering the alignments against each other so each position is a member of only one
  * end alignment. Spanning trees controls the number of pairwise alignments used
  * to construct the alignment, maxSequenceLength is the maximum length of a sequence to consider in the end alignment.
- * Model parameters is the parameters of the pairwise alignment model.
+ * Model parameters is the parameters of the pairwise alignment model. The pairs are returned as a sorted array.
  */
-stSortedSet *makeFlowerAlignment(StateMachine *sM, Flower *flower, int64_t spanningTrees,
+AlignedPairArray *makeFlowerAlignment(StateMachine *sM, Flower *flower, int64_t spanningTrees,
         int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, bool pruneOutStubAlignments);
 
 /*
  * As above, but including alignments from disk.
  */
-stSortedSet *makeFlowerAlignment3(StateMachine *sM, Flower *flower, stList *listOfEndAlignmentFiles, int64_t spanningTrees,
+AlignedPairArray *makeFlowerAlignment3(StateMachine *sM, Flower *flower, stList *listOfEndAlignmentFiles, int64_t spanningTrees,
         int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
         PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, bool pruneOutStubAlignments);
 
+/*
+ * As above, but making the end alignments with the given number of threads, and with the given planner if
+ * it is not NULL (see makeEndAlignments). The flower alignment is the same whatever the number of threads.
+ */
+AlignedPairArray *makeFlowerAlignment4(StateMachine *sM, Flower *flower, stList *listOfEndAlignmentFiles, int64_t spanningTrees,
+        int64_t maxSequenceLength, bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, bool pruneOutStubAlignments,
+        EndAlignmentPlannerParameters *planner, int64_t numThreads);
+
+/*
+ * Makes an alignment of each of the given ends, as makeEndAlignment, using a pool of the given number of threads.
+ * The largest ends, by the number of bases to align, are started first so that they are not left running
+ * on their own at the end. The alignments are returned in a list in the same order as the ends.
+ * If planner is not NULL the spanning trees and diagonal expansion are chosen for each end by
+ * endAlignmentPlanner_planEnd, never exceeding those given; otherwise those given are used for every end.
+ */
+stList *makeEndAlignments(StateMachine *sM, stList *ends, int64_t spanningTrees, int64_t maxSequenceLength,
+        bool useProgressiveMerging, float gapGamma,
+        PairwiseAlignmentParameters *pairwiseAlignmentBandingParameters, EndAlignmentPlannerParameters *planner,
+        int64_t numThreads);
+
 /*
  * Ascertain which ends should be aligned separately.
  */
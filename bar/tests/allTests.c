@@ -12,6 +12,7 @@
 
 CuSuite* adjacencySequenceTestSuite(void);
 CuSuite* endAlignerTestSuite(void);
+CuSuite* endAlignmentPlannerTestSuite(void);
 CuSuite* flowerAlignerTestSuite(void);
 CuSuite* rescueTestSuite(void);
 
@@ -20,6 +21,7 @@ int stBaseAlignerRunAllTests(void) {
 	CuSuite* suite = CuSuiteNew();
 	CuSuiteAddSuite(suite, adjacencySequenceTestSuite());
 	CuSuiteAddSuite(suite, endAlignerTestSuite());
+	CuSuiteAddSuite(suite, endAlignmentPlannerTestSuite());
 	CuSuiteAddSuite(suite, flowerAlignerTestSuite());
     CuSuiteAddSuite(suite, rescueTestSuite());
 	CuSuiteRun(suite);
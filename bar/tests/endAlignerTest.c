@@ -9,57 +9,90 @@
 #include "adjacencySequences.h"
 #include "pairwiseAligner.h"
 
-void test_alignedPair_cmpFn(CuTest *testCase) {
-    stList *list = stList_construct3(0, (void (*)(void *))alignedPair_destruct);
-
-    //(int (*)(const void *, const void *))alignedPair_cmpFn,
+void test_alignedPairArray_sort(CuTest *testCase) {
+    AlignedPairArray *alignedPairs = alignedPairArray_construct(0);
 
     Name seq1 = 5;
     Name seq2 = 10;
 
-    AlignedPair *aP1 = alignedPair_construct(seq1, 2, 1,
-                        seq1, 7, 1, 90, 90);
-    AlignedPair *aP2 = alignedPair_construct(seq1, 2, 1,
-            seq2, 4, 0, 10, 10);
-    AlignedPair *aP3 = alignedPair_construct(seq1, 2, 1,
-                seq2, 4, 1, 75, 72);
-    AlignedPair *aP4 = alignedPair_construct(seq1, 3, 1,
-                        seq2, 4, 0, 10, 1);
-    AlignedPair *aP5 = alignedPair_construct(seq1, 4, 1,
-                            seq2, 4, 1, 90, 100);
-
-    AlignedPair *ordering[5] = { aP2, aP1, aP4, aP5, aP3 };
+    //The pairs as { sequence, position, strand, other sequence, other position, other strand }.
+    int64_t aP1[] = { seq1, 2, 1, seq1, 7, 1 };
+    int64_t aP2[] = { seq1, 2, 1, seq2, 4, 0 };
+    int64_t aP3[] = { seq1, 2, 1, seq2, 4, 1 };
+    int64_t aP4[] = { seq1, 3, 1, seq2, 4, 0 };
+    int64_t aP5[] = { seq1, 4, 1, seq2, 4, 1 };
+
+    int64_t *ordering[5] = { aP2, aP1, aP4, aP5, aP3 };
     for(int64_t i=0; i<5; i++) {
-        AlignedPair *aP = ordering[i];
-        st_logInfo("I got %" PRIi64 " %" PRIi64 "\n", aP, aP->reverse);
-        stList_append(list, aP);
-        stList_append(list, aP->reverse);
+        int64_t *aP = ordering[i];
+        alignedPairArray_add(alignedPairs, aP[0], aP[1], aP[2], aP[3], aP[4], aP[5], 10 * i, 10 * i + 1);
     }
+    CuAssertTrue(testCase, !alignedPairs->sorted);
+    alignedPairArray_sort(alignedPairs);
+    CuAssertTrue(testCase, alignedPairs->sorted);
+    CuAssertIntEquals(testCase, 10, alignedPairArray_size(alignedPairs));
 
-    stList_sort(list, (int (*)(const void *, const void *))alignedPair_cmpFn);
-
-    AlignedPair *correctOrdering[10] = { aP1, aP2, aP3, aP4, aP5, aP1->reverse, aP2->reverse, aP4->reverse, aP3->reverse, aP5->reverse };
-    for(int64_t i=0; i<10; i++) {
-        st_logInfo("Checking %" PRIi64 " %" PRIi64 "\n", correctOrdering[i], stList_get(list, i));
-        CuAssertTrue(testCase, correctOrdering[i] == stList_get(list, i));
+    //The forward entries, then the reverse entries in the order of their positions.
+    int64_t *correctOrdering[5] = { aP1, aP2, aP3, aP4, aP5 };
+    for(int64_t i=0; i<5; i++) {
+        int64_t *aP = correctOrdering[i];
+        CuAssertIntEquals(testCase, i, alignedPairArray_search(alignedPairs, aP[0], aP[1], aP[2], aP[3], aP[4], aP[5]));
     }
-
-
-    stList_destruct(list);
+    int64_t *correctReverseOrdering[5] = { aP1, aP2, aP4, aP3, aP5 };
+    for(int64_t i=0; i<5; i++) {
+        int64_t *aP = correctReverseOrdering[i];
+        CuAssertIntEquals(testCase, i + 5, alignedPairArray_search(alignedPairs, aP[3], aP[4], aP[5], aP[0], aP[1], aP[2]));
+    }
+    //The reverses and scores follow their entries.
+    for(int64_t i=0; i<alignedPairs->length; i++) {
+        CuAssertIntEquals(testCase, i, alignedPairs->reverses[alignedPairs->reverses[i]]);
+        CuAssertTrue(testCase, llabs(alignedPairs->scores[i] - alignedPairs->scores[alignedPairs->reverses[i]]) == 1);
+    }
+    CuAssertIntEquals(testCase, 0, alignedPairArray_getFirstIndex(alignedPairs, seq1, 0));
+    CuAssertIntEquals(testCase, 3, alignedPairArray_getFirstIndex(alignedPairs, seq1, 3));
+    CuAssertIntEquals(testCase, 5, alignedPairArray_getFirstIndex(alignedPairs, seq1, 5));
+    CuAssertIntEquals(testCase, 10, alignedPairArray_getFirstIndex(alignedPairs, seq2, 5));
+    CuAssertIntEquals(testCase, -1, alignedPairArray_search(alignedPairs, seq1, 2, 0, seq1, 7, 1));
+
+    //Removing a pair removes both of its entries, without moving the others.
+    int64_t i = alignedPairArray_search(alignedPairs, aP3[0], aP3[1], aP3[2], aP3[3], aP3[4], aP3[5]);
+    alignedPairArray_remove(alignedPairs, alignedPairs->reverses[i]);
+    CuAssertTrue(testCase, alignedPairArray_isRemoved(alignedPairs, i));
+    CuAssertIntEquals(testCase, 8, alignedPairArray_size(alignedPairs));
+    CuAssertIntEquals(testCase, -1, alignedPairArray_search(alignedPairs, aP3[0], aP3[1], aP3[2], aP3[3], aP3[4], aP3[5]));
+    CuAssertIntEquals(testCase, 3, alignedPairArray_search(alignedPairs, aP4[0], aP4[1], aP4[2], aP4[3], aP4[4], aP4[5]));
+
+    //Merging drops the removed pair.
+    AlignedPairArray *alignedPairs2 = alignedPairArray_construct(0);
+    alignedPairArray_add(alignedPairs2, aP3[0], aP3[1], aP3[2], aP3[3], aP3[4], aP3[5], 1, 2);
+    alignedPairArray_sort(alignedPairs2);
+    AlignedPairArray *mergedAlignedPairs = alignedPairArray_merge(alignedPairs, alignedPairs2);
+    CuAssertIntEquals(testCase, 10, mergedAlignedPairs->length);
+    CuAssertIntEquals(testCase, 2, alignedPairArray_search(mergedAlignedPairs, aP3[0], aP3[1], aP3[2], aP3[3], aP3[4], aP3[5]));
+    CuAssertTrue(testCase, !alignedPairArray_equals(mergedAlignedPairs, alignedPairs));
+    alignedPairArray_remove(mergedAlignedPairs, 2);
+    CuAssertTrue(testCase, alignedPairArray_equals(mergedAlignedPairs, alignedPairs));
+    alignedPairArray_sort(mergedAlignedPairs);
+    CuAssertIntEquals(testCase, 8, mergedAlignedPairs->length);
+    CuAssertTrue(testCase, alignedPairArray_equals(mergedAlignedPairs, alignedPairs));
+
+    alignedPairArray_destruct(alignedPairs);
+    alignedPairArray_destruct(alignedPairs2);
+    alignedPairArray_destruct(mergedAlignedPairs);
 }
 
-int64_t isInAdjacencySequence(AlignedPair *alignedPair, AdjacencySequence *adjacencySequence) {
-    if (alignedPair->subsequenceIdentifier == adjacencySequence->subsequenceIdentifier) {
-        if (alignedPair->strand == adjacencySequence->strand) {
-            if (alignedPair->strand) {
-                if (alignedPair->position >= adjacencySequence->start
-                        && alignedPair->position < adjacencySequence->start
+int64_t isInAdjacencySequence(AlignedPairArray *alignedPairs, int64_t i, AdjacencySequence *adjacencySequence) {
+    if (alignedPairs->subsequenceIdentifiers[i] == adjacencySequence->subsequenceIdentifier) {
+        if (alignedPairs->strands[i] == adjacencySequence->strand) {
+            if (alignedPairs->strands[i]) {
+                if (alignedPairs->positions[i] >= adjacencySequence->start
+                        && alignedPairs->positions[i] < adjacencySequence->start
                                 + adjacencySequence->length) {
                     return 1;
                 }
             } else {
-                if (alignedPair->position <= adjacencySequence->start
-                        && alignedPair->position > adjacencySequence->start
+                if (alignedPairs->positions[i] <= adjacencySequence->start
+                        && alignedPairs->positions[i] > adjacencySequence->start
                                 - adjacencySequence->length) {
                     return 1;
                 }
@@ -73,7 +106,7 @@ int64_t isInAdjacencySequence(AlignedPair *alignedPair, AdjacencySequence *adjac
 /*
  * Checks that the position referred to is in an adjacency coming from the end.
  */
-int64_t isInAdjacency(AlignedPair *alignedPair, End *end, int64_t maxLength) {
+int64_t isInAdjacency(AlignedPairArray *alignedPairs, int64_t j, End *end, int64_t maxLength) {
     Cap *cap;
     End_InstanceIterator *it = end_getInstanceIterator(end);
     while ((cap = end_getNext(it)) != NULL) {
@@ -82,7 +115,7 @@ int64_t isInAdjacency(AlignedPair *alignedPair, End *end, int64_t maxLength) {
         }
         AdjacencySequence *adjacencySequence = adjacencySequence_construct(cap,
                 maxLength);
-        int64_t i = isInAdjacencySequence(alignedPair, adjacencySequence);
+        int64_t i = isInAdjacencySequence(alignedPairs, j, adjacencySequence);
         adjacencySequence_destruct(adjacencySequence);
         if(i) {
             end_destructInstanceIterator(it);
@@ -99,21 +132,21 @@ static void testMakeEndAlignments(CuTest *testCase) {
     int64_t maxLength = 4;
     for (int64_t endIndex = 0; endIndex < 3; endIndex++) {
         End *end = ends[endIndex];
-        stSortedSet *endAlignment = makeEndAlignment(stateMachine, end, 5, maxLength, end_getInstanceNumber(end) > 50, 0.5, pairwiseParameters);
+        AlignedPairArray *endAlignment = makeEndAlignment(stateMachine, end, 5, maxLength, end_getInstanceNumber(end) > 50, 0.5, pairwiseParameters);
+        CuAssertTrue(testCase, endAlignment->sorted);
 
-        stSortedSetIterator *iterator = stSortedSet_getIterator(endAlignment);
-        AlignedPair *alignedPair;
         //Check pairs are part of valid sequences from end
-
-        while ((alignedPair = stSortedSet_getNext(iterator)) != NULL) {
-            CuAssertTrue(testCase, alignedPair->score > 0); //Check score is valid.
-            CuAssertTrue(testCase, alignedPair->score <= PAIR_ALIGNMENT_PROB_1);
-            CuAssertTrue(testCase, stSortedSet_search(endAlignment, alignedPair->reverse) != NULL); //Check other end is in.
+        for (int64_t i = 0; i < endAlignment->length; i++) {
+            CuAssertTrue(testCase, endAlignment->scores[i] > 0); //Check score is valid.
+            CuAssertTrue(testCase, endAlignment->scores[i] <= PAIR_ALIGNMENT_PROB_1);
+            CuAssertTrue(testCase, endAlignment->reverses[endAlignment->reverses[i]] == i); //Check other end is in.
+            if (i > 0) {
+                CuAssertTrue(testCase, alignedPairArray_cmp(endAlignment, i - 1, endAlignment, i) < 0);
+            }
             //Check coordinates are in sequence..
-            CuAssertTrue(testCase, isInAdjacency(alignedPair, end, maxLength));
+            CuAssertTrue(testCase, isInAdjacency(endAlignment, i, end, maxLength));
         }
-        stSortedSet_destructIterator(iterator);
-        stSortedSet_destruct(endAlignment);
+        alignedPairArray_destruct(endAlignment);
     }
     teardown();
 }
@@ -124,7 +157,7 @@ static void testReadAndWriteEndAlignments(CuTest *testCase) {
     int64_t maxLength = 4;
     for (int64_t endIndex = 0; endIndex < 3; endIndex++) {
         End *end = ends[endIndex];
-        stSortedSet *endAlignment = makeEndAlignment(stateMachine, end, 5, maxLength, end_getInstanceNumber(end) > 50, 0.5, pairwiseParameters);
+        AlignedPairArray *endAlignment = makeEndAlignment(stateMachine, end, 5, maxLength, end_getInstanceNumber(end) > 50, 0.5, pairwiseParameters);
         char *temporaryEndAlignmentFile = "temporaryEndAlignmentFile.end";
         FILE *fileHandle = fopen(temporaryEndAlignmentFile, "w");
         writeEndAlignmentToDisk(end, endAlignment, fileHandle);
@@ -132,19 +165,73 @@ static void testReadAndWriteEndAlignments(CuTest *testCase) {
         fclose(fileHandle);
         fileHandle = fopen(temporaryEndAlignmentFile, "r");
         End *end2;
-        stSortedSet *endAlignment2 = loadEndAlignmentFromDisk(flower, fileHandle, &end2);
+        AlignedPairArray *endAlignment2 = loadEndAlignmentFromDisk(flower, fileHandle, &end2);
         CuAssertPtrEquals(testCase, end, end2);
-        stSortedSet *endAlignment3 = loadEndAlignmentFromDisk(flower, fileHandle, &end2);
+        AlignedPairArray *endAlignment3 = loadEndAlignmentFromDisk(flower, fileHandle, &end2);
         CuAssertPtrEquals(testCase, end, end2);
         CuAssertTrue(testCase, loadEndAlignmentFromDisk(flower, fileHandle, &end2) == NULL);
         CuAssertTrue(testCase, end2 == NULL);
         fclose(fileHandle);
-        CuAssertTrue(testCase, stSortedSet_equals(endAlignment, endAlignment2));
-        CuAssertTrue(testCase, stSortedSet_equals(endAlignment, endAlignment3));
-        stSortedSet_destruct(endAlignment);
-        stSortedSet_destruct(endAlignment2);
-        stSortedSet_destruct(endAlignment3);
+        CuAssertTrue(testCase, alignedPairArray_equals(endAlignment, endAlignment2));
+        CuAssertTrue(testCase, alignedPairArray_equals(endAlignment, endAlignment3));
+        alignedPairArray_destruct(endAlignment);
+        alignedPairArray_destruct(endAlignment2);
+        alignedPairArray_destruct(endAlignment3);
+        stFile_rmrf(temporaryEndAlignmentFile);
+    }
+    teardown();
+}
+
+static void testReadAndWriteBinaryEndAlignments(CuTest *testCase) {
+    setup();
+    End *ends[3] = { end1, end2, end3 };
+    int64_t maxLength = 4;
+    for (int64_t endIndex = 0; endIndex < 3; endIndex++) {
+        End *end = ends[endIndex];
+        AlignedPairArray *endAlignment = makeEndAlignment(stateMachine, end, 5, maxLength, end_getInstanceNumber(end) > 50, 0.5, pairwiseParameters);
+        //Removed pairs are left out of the file.
+        if (endAlignment->length > 0) {
+            alignedPairArray_remove(endAlignment, st_randomInt(0, endAlignment->length));
+        }
+        char *temporaryEndAlignmentFile = "temporaryEndAlignmentFile.end";
+        FILE *fileHandle = fopen(temporaryEndAlignmentFile, "w");
+        writeEndAlignmentToDiskAsBinary(end, endAlignment, 1, fileHandle);
+        writeEndAlignmentToDisk(end, endAlignment, fileHandle); //The formats can be mixed in a file.
+        writeEndAlignmentToDiskAsBinary(end, endAlignment, 0, fileHandle);
+        fclose(fileHandle);
+        fileHandle = fopen(temporaryEndAlignmentFile, "r");
+        for (int64_t i = 0; i < 3; i++) {
+            End *end2;
+            AlignedPairArray *endAlignment2 = loadEndAlignmentFromDisk(flower, fileHandle, &end2);
+            CuAssertPtrEquals(testCase, end, end2);
+            CuAssertTrue(testCase, endAlignment2->sorted);
+            CuAssertIntEquals(testCase, alignedPairArray_size(endAlignment), endAlignment2->length);
+            CuAssertTrue(testCase, alignedPairArray_equals(endAlignment, endAlignment2));
+            alignedPairArray_destruct(endAlignment2);
+        }
+        End *end2;
+        CuAssertTrue(testCase, loadEndAlignmentFromDisk(flower, fileHandle, &end2) == NULL);
+        CuAssertTrue(testCase, end2 == NULL);
+        fclose(fileHandle);
+
+        //Converting to text gives the same text as writing it directly.
+        char *temporaryTextFile = "temporaryEndAlignmentFile.txt";
+        fileHandle = fopen(temporaryEndAlignmentFile, "r");
+        FILE *textFileHandle = fopen(temporaryTextFile, "w");
+        CuAssertIntEquals(testCase, 3, convertEndAlignmentsToText(fileHandle, textFileHandle));
+        fclose(fileHandle);
+        fclose(textFileHandle);
+        fileHandle = fopen(temporaryEndAlignmentFile, "w");
+        for (int64_t i = 0; i < 3; i++) {
+            writeEndAlignmentToDisk(end, endAlignment, fileHandle);
+        }
+        fclose(fileHandle);
+        CuAssertTrue(testCase, stFile_exists(temporaryTextFile));
+        CuAssertIntEquals(testCase, 0, st_system("cmp -s %s %s", temporaryEndAlignmentFile, temporaryTextFile));
+
+        alignedPairArray_destruct(endAlignment);
         stFile_rmrf(temporaryEndAlignmentFile);
+        stFile_rmrf(temporaryTextFile);
     }
     teardown();
 }
@@ -153,6 +240,7 @@ CuSuite* endAlignerTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testMakeEndAlignments);
     SUITE_ADD_TEST(suite, testReadAndWriteEndAlignments);
-    SUITE_ADD_TEST(suite, test_alignedPair_cmpFn);
+    SUITE_ADD_TEST(suite, testReadAndWriteBinaryEndAlignments);
+    SUITE_ADD_TEST(suite, test_alignedPairArray_sort);
     return suite;
 }
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "CuTest.h"
+#include "sonLib.h"
+#include "cactus.h"
+#include "endAlignmentPlanner.h"
+
+static char getRandomBase() {
+    return "ACGT"[st_randomInt(0, 4)];
+}
+
+static char *getRandomString(int64_t length) {
+    char *string = st_malloc(length + 1);
+    for (int64_t i = 0; i < length; i++) {
+        string[i] = getRandomBase();
+    }
+    string[length] = '\0';
+    return string;
+}
+
+static char *getMutatedString(const char *string, double substitutionRate) {
+    /*
+     * Copies the string, substituting each base for a different base with the given probability.
+     */
+    char *mutatedString = stString_copy(string);
+    for (int64_t i = 0; mutatedString[i] != '\0'; i++) {
+        if (st_random() < substitutionRate) {
+            char base;
+            while ((base = getRandomBase()) == mutatedString[i]);
+            mutatedString[i] = base;
+        }
+    }
+    return mutatedString;
+}
+
+static void checkPlan(CuTest *testCase, EndAlignmentPlannerParameters *params, stList *strings,
+        double minDivergence, double maxDivergence, EndAlignmentPlan *plan) {
+    endAlignmentPlanner_plan(params, strings, 10, 20, plan);
+    st_logInfo("Estimated divergence %f, planned %" PRIi64 " spanning trees and a diagonal expansion of %" PRIi64 "\n",
+            plan->divergence, plan->spanningTrees, plan->diagonalExpansion);
+    CuAssertTrue(testCase, plan->divergence >= minDivergence);
+    CuAssertTrue(testCase, plan->divergence <= maxDivergence);
+    CuAssertTrue(testCase, plan->spanningTrees >= params->minSpanningTrees && plan->spanningTrees <= 10);
+    CuAssertTrue(testCase, plan->diagonalExpansion >= params->minDiagonalExpansion && plan->diagonalExpansion <= 20);
+    CuAssertTrue(testCase, plan->diagonalExpansion % 2 == 0);
+}
+
+static void test_endAlignmentPlanner_identical(CuTest *testCase) {
+    //Identical sequences get the cheapest plan.
+    EndAlignmentPlannerParameters *params = endAlignmentPlannerParameters_construct();
+    stList *strings = stList_construct3(0, free);
+    char *string = getRandomString(2000);
+    for (int64_t i = 0; i < 20; i++) {
+        stList_append(strings, stString_copy(string));
+    }
+    free(string);
+    EndAlignmentPlan plan;
+    checkPlan(testCase, params, strings, 0.0, 0.001, &plan);
+    CuAssertIntEquals(testCase, params->minSpanningTrees, plan.spanningTrees);
+    CuAssertIntEquals(testCase, params->minDiagonalExpansion, plan.diagonalExpansion);
+    stList_destruct(strings);
+    endAlignmentPlannerParameters_destruct(params);
+}
+
+static void test_endAlignmentPlanner_unrelated(CuTest *testCase) {
+    //Unrelated sequences get the full plan.
+    EndAlignmentPlannerParameters *params = endAlignmentPlannerParameters_construct();
+    stList *strings = stList_construct3(0, free);
+    for (int64_t i = 0; i < 20; i++) {
+        stList_append(strings, getRandomString(2000));
+    }
+    EndAlignmentPlan plan;
+    checkPlan(testCase, params, strings, params->fullCostDivergence, 1.0, &plan);
+    CuAssertIntEquals(testCase, 10, plan.spanningTrees);
+    CuAssertIntEquals(testCase, 20, plan.diagonalExpansion);
+    stList_destruct(strings);
+    endAlignmentPlannerParameters_destruct(params);
+}
+
+static void test_endAlignmentPlanner_diverged(CuTest *testCase) {
+    //A pair of sequences with about 5% of their bases differing gets an intermediate plan.
+    EndAlignmentPlannerParameters *params = endAlignmentPlannerParameters_construct();
+    stList *strings = stList_construct3(0, free);
+    char *string = getRandomString(2000);
+    stList_append(strings, getMutatedString(string, 0.05));
+    stList_append(strings, string);
+    EndAlignmentPlan plan;
+    checkPlan(testCase, params, strings, 0.025, 0.09, &plan);
+    CuAssertTrue(testCase, plan.spanningTrees > params->minSpanningTrees && plan.spanningTrees < 10);
+    CuAssertTrue(testCase, plan.diagonalExpansion > params->minDiagonalExpansion && plan.diagonalExpansion < 20);
+
+    //A single diverged sequence among many identical ones is not hidden.
+    for (int64_t i = 0; i < 8; i++) {
+        stList_append(strings, stString_copy(string));
+    }
+    checkPlan(testCase, params, strings, 0.025, 0.09, &plan);
+    stList_destruct(strings);
+    endAlignmentPlannerParameters_destruct(params);
+}
+
+static void test_endAlignmentPlanner_tooShort(CuTest *testCase) {
+    //Sequences too short to sketch, or too few of them, get the full plan.
+    EndAlignmentPlannerParameters *params = endAlignmentPlannerParameters_construct();
+    stList *strings = stList_construct3(0, free);
+    stList_append(strings, stString_copy("ACGTACGTACGT"));
+    EndAlignmentPlan plan;
+    checkPlan(testCase, params, strings, params->fullCostDivergence, params->fullCostDivergence, &plan);
+    CuAssertIntEquals(testCase, 10, plan.spanningTrees);
+    stList_append(strings, stString_copy("ACGTNNNNACGTACGT"));
+    stList_append(strings, stString_copy(""));
+    checkPlan(testCase, params, strings, params->fullCostDivergence, params->fullCostDivergence, &plan);
+    CuAssertIntEquals(testCase, 20, plan.diagonalExpansion);
+    stList_destruct(strings);
+    endAlignmentPlannerParameters_destruct(params);
+}
+
+static void test_endAlignmentPlanner_largeIndel(CuTest *testCase) {
+    //Sequences that differ by a large deletion look identical to the sketches, but keep a band that holds it.
+    EndAlignmentPlannerParameters *params = endAlignmentPlannerParameters_construct();
+    stList *strings = stList_construct3(0, free);
+    char *string = getRandomString(2000);
+    for (int64_t i = 0; i < 9; i++) {
+        stList_append(strings, stString_copy(string));
+    }
+    char *deletedString = stString_copy(string);
+    memmove(deletedString + 1000, deletedString + 1013, strlen(deletedString + 1013) + 1);
+    stList_append(strings, deletedString);
+    EndAlignmentPlan plan;
+    checkPlan(testCase, params, strings, 0.0, 0.025, &plan);
+    CuAssertIntEquals(testCase, 13, plan.lengthDifference);
+    CuAssertIntEquals(testCase, params->minSpanningTrees, plan.spanningTrees);
+    CuAssertIntEquals(testCase, 14, plan.diagonalExpansion);
+
+    //A deletion longer than the band given gets the band given, and no more.
+    deletedString[1500] = '\0';
+    checkPlan(testCase, params, strings, 0.0, 0.05, &plan);
+    CuAssertIntEquals(testCase, 500, plan.lengthDifference);
+    CuAssertIntEquals(testCase, 20, plan.diagonalExpansion);
+    free(string);
+    stList_destruct(strings);
+    endAlignmentPlannerParameters_destruct(params);
+}
+
+CuSuite* endAlignmentPlannerTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_endAlignmentPlanner_identical);
+    SUITE_ADD_TEST(suite, test_endAlignmentPlanner_unrelated);
+    SUITE_ADD_TEST(suite, test_endAlignmentPlanner_diverged);
+    SUITE_ADD_TEST(suite, test_endAlignmentPlanner_tooShort);
+    SUITE_ADD_TEST(suite, test_endAlignmentPlanner_largeIndel);
+    return suite;
+}
@@ -10,7 +10,7 @@
 #include "adjacencySequences.h"
 #include "pairwiseAligner.h"
 
-stList *getInducedAlignment(stSortedSet *endAlignment, AdjacencySequence *adjacencySequence);
+int64_t *getInducedAlignment(AlignedPairArray *endAlignment, AdjacencySequence *adjacencySequence, int64_t *length);
 
 static int getRandomPosition(AdjacencySequence *adjacencySequence) {
     if(adjacencySequence->strand) {
@@ -21,19 +21,15 @@ static int getRandomPosition(AdjacencySequence *adjacencySequence) {
     }
 }
 
-int64_t isInAdjacencySequence(AlignedPair *alignedPair, AdjacencySequence *adjacencySequence);
+int64_t isInAdjacencySequence(AlignedPairArray *alignedPairs, int64_t i, AdjacencySequence *adjacencySequence);
 
-stList *getinducedAlignment2(stSortedSet *endAlignment, AdjacencySequence *adjacencySequence) {
-    stList *inducedAlignment = stList_construct();
-    stSortedSetIterator *it = stSortedSet_getIterator(endAlignment);
-    AlignedPair *alignedPair;
-    while((alignedPair = stSortedSet_getNext(it)) != NULL) {
-        if(isInAdjacencySequence(alignedPair, adjacencySequence)) {
-            stList_append(inducedAlignment, alignedPair);
+stList *getinducedAlignment2(AlignedPairArray *endAlignment, AdjacencySequence *adjacencySequence) {
+    stList *inducedAlignment = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    for(int64_t i=0; i<endAlignment->length; i++) {
+        if(!alignedPairArray_isRemoved(endAlignment, i) && isInAdjacencySequence(endAlignment, i, adjacencySequence)) {
+            stList_append(inducedAlignment, stIntTuple_construct1(i));
         }
     }
-    stSortedSet_destructIterator(it);
-    stList_sort(inducedAlignment, (int (*)(const void *, const void *))alignedPair_cmpFn);
     if(!adjacencySequence->strand) {
         stList_reverse(inducedAlignment);
     }
@@ -44,8 +40,7 @@ void test_getInducedAlignment(CuTest *testCase) {
     for(int64_t test=0; test<100; test++) {
         setup();
 
-        stSortedSet *sortedAlignment = stSortedSet_construct3((int (*)(const void *, const void *))alignedPair_cmpFn,
-                       (void (*)(void *))alignedPair_destruct);
+        AlignedPairArray *sortedAlignment = alignedPairArray_construct(0);
 
 
         stList *adjacencySequences = stList_construct3(0, (void (*)(void *))adjacencySequence_destruct);
@@ -61,48 +56,53 @@ void test_getInducedAlignment(CuTest *testCase) {
             AdjacencySequence *aS1 = st_randomChoice(adjacencySequences);
             AdjacencySequence *aS2 = st_randomChoice(adjacencySequences);
             if(aS1 != aS2) {
-                AlignedPair *alignedPair =
-                        alignedPair_construct(aS1->subsequenceIdentifier, getRandomPosition(aS1), aS1->strand,
-                                              aS2->subsequenceIdentifier, getRandomPosition(aS2), aS2->strand,
-                                              st_randomInt(0, PAIR_ALIGNMENT_PROB_1), st_randomInt(0, PAIR_ALIGNMENT_PROB_1));
-                stSortedSet_insert(sortedAlignment, alignedPair);
-                stSortedSet_insert(sortedAlignment, alignedPair->reverse);
+                alignedPairArray_add(sortedAlignment, aS1->subsequenceIdentifier, getRandomPosition(aS1), aS1->strand,
+                                     aS2->subsequenceIdentifier, getRandomPosition(aS2), aS2->strand,
+                                     st_randomInt(0, PAIR_ALIGNMENT_PROB_1), st_randomInt(0, PAIR_ALIGNMENT_PROB_1));
+            }
+        }
+        alignedPairArray_sort(sortedAlignment);
+        //Remove some pairs, which should not be induced.
+        for(int64_t i=0; i<sortedAlignment->length; i++) {
+            if(!alignedPairArray_isRemoved(sortedAlignment, i) && st_random() > 0.9) {
+                alignedPairArray_remove(sortedAlignment, i);
             }
         }
 
         for(int64_t i=0; i<stList_length(adjacencySequences); i++) {
             AdjacencySequence *adjacencySequence = stList_get(adjacencySequences, i);
-            stList *inducedAlignment = getInducedAlignment(sortedAlignment, adjacencySequence);
+            int64_t length;
+            int64_t *inducedAlignment = getInducedAlignment(sortedAlignment, adjacencySequence, &length);
             stList *inducedAlignment2 = getinducedAlignment2(sortedAlignment, adjacencySequence);
 
-            /*st_logInfo("The lengths are %" PRIi64 " %" PRIi64 "\n", stList_length(inducedAlignment), stList_length(inducedAlignment2));
-            st_logInfo("Adj %" PRIi64 " %" PRIi64 " %" PRIi64 " %" PRIi64 "\n", adjacencySequence->sequenceName, adjacencySequence->start, adjacencySequence->length, adjacencySequence->strand);
-
-            for(int64_t j=0; j<stList_length(inducedAlignment); j++) {
-                AlignedPair *aP = stList_get(inducedAlignment, j);
-                st_logInfo("Hello %" PRIi64 " %" PRIi64 " %" PRIi64 "\n", aP->sequence, aP->position, aP->strand);
+            CuAssertTrue(testCase, length == stList_length(inducedAlignment2));
+            for(int64_t j=0; j<length; j++) {
+                CuAssertTrue(testCase, inducedAlignment[j] == stIntTuple_get(stList_get(inducedAlignment2, j), 0));
             }
 
-            for(int64_t j=0; j<stList_length(inducedAlignment2); j++) {
-                AlignedPair *aP = stList_get(inducedAlignment2, j);
-                st_logInfo("Goodbye %" PRIi64 " %" PRIi64 " %" PRIi64 "\n", aP->sequence, aP->position, aP->strand);
-            }*/
-
-            CuAssertTrue(testCase, stList_length(inducedAlignment) == stList_length(inducedAlignment2));
-            for(int64_t j=0; j<stList_length(inducedAlignment); j++) {
-                CuAssertTrue(testCase, stList_get(inducedAlignment, j) == stList_get(inducedAlignment2, j));
-            }
-
-            stList_destruct(inducedAlignment);
+            free(inducedAlignment);
             stList_destruct(inducedAlignment2);
         }
 
         //cleanup
-        stSortedSet_destruct(sortedAlignment);
+        alignedPairArray_destruct(sortedAlignment);
         teardown();
     }
 }
 
+static void checkFlowerAlignment(CuTest *testCase, AlignedPairArray *flowerAlignment) {
+    CuAssertTrue(testCase, flowerAlignment->sorted);
+    CuAssertIntEquals(testCase, flowerAlignment->length, alignedPairArray_size(flowerAlignment));
+    for(int64_t i=0; i<flowerAlignment->length; i++) {
+        CuAssertTrue(testCase, flowerAlignment->scores[i] > 0); //Check score is valid
+        CuAssertTrue(testCase, flowerAlignment->scores[i] <= PAIR_ALIGNMENT_PROB_1);
+        CuAssertTrue(testCase, flowerAlignment->reverses[flowerAlignment->reverses[i]] == i); //Check other end is in.
+        if(i > 0) {
+            CuAssertTrue(testCase, alignedPairArray_cmp(flowerAlignment, i-1, flowerAlignment, i) < 0);
+        }
+    }
+}
+
 /*
  * Just runs the flower alignment through, doesn't really check its okay.
  */
@@ -110,18 +110,66 @@ void test_flowerAlignerRandom(CuTest *testCase) {
     setup();
     int64_t maxLength = 5;
     StateMachine *sM = stateMachine5_construct(fiveState);
-    stSortedSet *flowerAlignment = makeFlowerAlignment(sM, flower, 5, maxLength, 1, 0.5, pairwiseParameters, st_random() > 0.5);
+    AlignedPairArray *flowerAlignment = makeFlowerAlignment(sM, flower, 5, maxLength, 1, 0.5, pairwiseParameters, st_random() > 0.5);
     stateMachine_destruct(sM);
     //Check the aligned pairs are all good..
-    stSortedSetIterator *iterator = stSortedSet_getIterator(flowerAlignment);
-    AlignedPair *alignedPair;
-    while((alignedPair = stSortedSet_getNext(iterator)) != NULL) {
-        CuAssertTrue(testCase, alignedPair->score > 0); //Check score is valid
-        CuAssertTrue(testCase, alignedPair->score <= PAIR_ALIGNMENT_PROB_1);
-        CuAssertTrue(testCase, stSortedSet_search(flowerAlignment, alignedPair->reverse) != NULL); //Check other end is in.
+    checkFlowerAlignment(testCase, flowerAlignment);
+    alignedPairArray_destruct(flowerAlignment);
+
+    teardown();
+}
+
+static bool alignedPairIsInEnd(AlignedPairArray *alignedPairs, int64_t i, End *end) {
+    Cap *cap;
+    End_InstanceIterator *it = end_getInstanceIterator(end);
+    bool found = 0;
+    while((cap = end_getNext(it)) != NULL) {
+        if(cap_getSide(cap)) {
+            cap = cap_getReverse(cap);
+        }
+        AdjacencySequence *adjacencySequence = adjacencySequence_construct(cap, INT64_MAX);
+        found = found || isInAdjacencySequence(alignedPairs, i, adjacencySequence);
+        adjacencySequence_destruct(adjacencySequence);
     }
-    stSortedSet_destructIterator(iterator);
-    stSortedSet_destruct(flowerAlignment);
+    end_destructInstanceIterator(it);
+    return found;
+}
+
+/*
+ * Makes the end alignments with a pool of threads, checking each alignment comes back in the place of its end.
+ */
+void test_makeEndAlignmentsInParallel(CuTest *testCase) {
+    setup();
+    StateMachine *sM = stateMachine5_construct(fiveState);
+    stList *ends = stList_construct();
+    for(int64_t i=0; i<10; i++) {
+        End *ends2[] = { end1, end2, end3 };
+        stList_append(ends, ends2[i % 3]);
+    }
+    //Without and then with a planner, which chooses the settings of each end.
+    EndAlignmentPlannerParameters *planner = endAlignmentPlannerParameters_construct();
+    EndAlignmentPlannerParameters *planners[] = { NULL, planner };
+    for(int64_t k=0; k<2; k++) {
+        stList *endAlignments = makeEndAlignments(sM, ends, 5, INT64_MAX, 1, 0.5, pairwiseParameters, planners[k], 4);
+        CuAssertIntEquals(testCase, stList_length(ends), stList_length(endAlignments));
+        for(int64_t i=0; i<stList_length(ends); i++) {
+            AlignedPairArray *endAlignment = stList_get(endAlignments, i);
+            for(int64_t j=0; j<endAlignment->length; j++) {
+                CuAssertTrue(testCase, alignedPairIsInEnd(endAlignment, j, stList_get(ends, i)));
+                CuAssertTrue(testCase, endAlignment->reverses[endAlignment->reverses[j]] == j);
+            }
+        }
+        stList_destruct(endAlignments);
+
+        //The whole flower, as in test_flowerAlignerRandom.
+        AlignedPairArray *flowerAlignment = makeFlowerAlignment4(sM, flower, NULL, 5, 5, 1, 0.5, pairwiseParameters, 0,
+                planners[k], 4);
+        checkFlowerAlignment(testCase, flowerAlignment);
+        alignedPairArray_destruct(flowerAlignment);
+    }
+    endAlignmentPlannerParameters_destruct(planner);
+    stList_destruct(ends);
+    stateMachine_destruct(sM);
 
     teardown();
 }
@@ -130,5 +178,6 @@ CuSuite* flowerAlignerTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_getInducedAlignment);
     SUITE_ADD_TEST(suite, test_flowerAlignerRandom);
+    SUITE_ADD_TEST(suite, test_makeEndAlignmentsInParallel);
     return suite;
 }
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "cactus.h"
+
+int filteringBenchmark(int argc, char *argv[]);
+int phylogenyBenchmark(int argc, char *argv[]);
+int giantComponentBenchmark(int argc, char *argv[]);
+int finishingBenchmark(int argc, char *argv[]);
+
+static TestCommonBenchmark benchmarks[] = {
+    { "filtering", filteringBenchmark, "Anneals a synthetic many genome flower with each alignment filter" },
+    { "phylogeny", phylogenyBenchmark, "Splits ancient paralogs in a synthetic duplicated flower with more and more threads" },
+    { "giantComponent", giantComponentBenchmark, "Breaks up a synthetic giant component, bare and in a pinch graph" },
+    { "finishing", finishingBenchmark, "Converts the pinch graph of a synthetic flower to flowers and writes them" },
+};
+
+static int64_t benchmarkNumber = sizeof(benchmarks) / sizeof(TestCommonBenchmark);
+
+int main(int argc, char *argv[]) {
+    return testCommon_runBenchmark("stCafBenchmarks", benchmarks, benchmarkNumber, argc, argv);
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "cactus.h"
+#include "sonLib.h"
+#include "stPinchGraphs.h"
+#include "stPinchIterator.h"
+#include "stCaf.h"
+
+/*
+ * Anneals the same set of random alignments between the threads of a synthetic flower, with many genomes,
+ * using each of the alignment filters in turn, and reports the time taken.
+ */
+
+typedef struct _filter {
+    const char *name;
+    bool (*filterFn)(stPinchSegment *, stPinchSegment *);
+} Filter;
+
+static Filter filters[] = {
+    { "none", NULL },
+    { "filterByOutgroup", stCaf_filterByOutgroup },
+    { "relaxedFilterByOutgroup", stCaf_relaxedFilterByOutgroup },
+    { "filterByRepeatSpecies", stCaf_filterByRepeatSpecies },
+    { "relaxedFilterByRepeatSpecies", stCaf_relaxedFilterByRepeatSpecies },
+    { "singleCopyIngroup", stCaf_singleCopyIngroup },
+    { "relaxedSingleCopyIngroup", stCaf_relaxedSingleCopyIngroup },
+    { "singleCopyChr", stCaf_singleCopyChr },
+    { "cycleFreeIsolatedComponents", stCaf_filterToEnsureCycleFreeIsolatedComponents },
+};
+
+typedef struct _pinchArray {
+    stPinch *pinches;
+    int64_t pinchNumber;
+    int64_t index;
+    stPinch pinch;
+} PinchArray;
+
+static stPinch *pinchArray_getNext(PinchArray *pinchArray) {
+    if (pinchArray->index == pinchArray->pinchNumber) {
+        return NULL;
+    }
+    pinchArray->pinch = pinchArray->pinches[pinchArray->index++];
+    return &pinchArray->pinch;
+}
+
+static PinchArray *pinchArray_reset(PinchArray *pinchArray) {
+    pinchArray->index = 0;
+    return pinchArray;
+}
+
+static void pinchArray_destruct(PinchArray *pinchArray) {
+    free(pinchArray->pinches);
+    free(pinchArray);
+}
+
+static stPinch *getRandomAlignments(Name *threadNames, int64_t threadNumber, int64_t threadLength,
+        int64_t pinchNumber) {
+    /*
+     * Mostly roughly colinear alignments, as between orthologous sequences, with some between
+     * unrelated positions, as between paralogs.
+     */
+    stPinch *pinches = st_malloc(sizeof(stPinch) * pinchNumber);
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        stPinch *pinch = &pinches[i];
+        pinch->name1 = threadNames[st_randomInt(0, threadNumber)];
+        pinch->name2 = threadNames[st_randomInt(0, threadNumber)];
+        pinch->length = st_randomInt(1, 100);
+        pinch->start1 = st_randomInt(2, threadLength + 2 - pinch->length);
+        if (st_random() > 0.1) {
+            pinch->start2 = pinch->start1 + st_randomInt(-10, 11);
+            pinch->start2 = pinch->start2 < 2 ? 2 : pinch->start2;
+            pinch->start2 = pinch->start2 > threadLength + 2 - pinch->length ? threadLength + 2 - pinch->length
+                    : pinch->start2;
+            pinch->strand = 1;
+        } else {
+            pinch->start2 = st_randomInt(2, threadLength + 2 - pinch->length);
+            pinch->strand = st_random() > 0.5;
+        }
+    }
+    return pinches;
+}
+
+static const char *benchmarkOptions[] = {
+        "-b --ingroups : The number of ingroup genomes (default 50)",
+        "-c --outgroups : The number of outgroup genomes (default 4)",
+        "-d --threadsPerGenome : The number of sequences in each genome (default 2)",
+        "-e --threadLength : The length of each sequence (default 2000)",
+        "-f --alignments : The number of alignments to anneal (default 50000)",
+        "-g --annealingThreads : The number of threads to anneal with (default 1)",
+        NULL };
+
+static void benchmarkUsage() {
+    testCommon_benchmarkUsage("stCafBenchmarks", "filtering", benchmarkOptions);
+}
+
+int filteringBenchmark(int argc, char *argv[]) {
+    int64_t ingroupNumber = 50, outgroupNumber = 4, threadsPerGenome = 2, threadLength = 2000;
+    int64_t pinchNumber = 50000, annealingThreads = 1;
+
+    while (1) {
+        static struct option long_options[] = { { "logLevel", required_argument, 0, 'a' },
+                { "ingroups", required_argument, 0, 'b' }, { "outgroups", required_argument, 0, 'c' },
+                { "threadsPerGenome", required_argument, 0, 'd' }, { "threadLength", required_argument, 0, 'e' },
+                { "alignments", required_argument, 0, 'f' }, { "annealingThreads", required_argument, 0, 'g' },
+                { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
+        int option_index = 0;
+        int key = getopt_long(argc, argv, "a:b:c:d:e:f:g:h", long_options, &option_index);
+        if (key == -1) {
+            break;
+        }
+        switch (key) {
+            case 'a':
+                st_setLogLevelFromString(optarg);
+                break;
+            case 'b':
+                ingroupNumber = atol(optarg);
+                break;
+            case 'c':
+                outgroupNumber = atol(optarg);
+                break;
+            case 'd':
+                threadsPerGenome = atol(optarg);
+                break;
+            case 'e':
+                threadLength = atol(optarg);
+                break;
+            case 'f':
+                pinchNumber = atol(optarg);
+                break;
+            case 'g':
+                annealingThreads = atol(optarg);
+                break;
+            case 'h':
+                benchmarkUsage();
+                return 0;
+            default:
+                benchmarkUsage();
+                return 1;
+        }
+    }
+
+    //Build a flower with a star shaped tree of ingroups and outgroups.
+    CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+    EventTree *eventTree = eventTree_construct2(cactusDisk);
+    Flower *flower = flower_construct(cactusDisk);
+    group_construct2(flower);
+    Event *rootEvent = eventTree_getRootEvent(eventTree);
+    Event *ancestor = event_construct3("ancestor", 0.1, rootEvent, eventTree);
+    int64_t threadNumber = (ingroupNumber + outgroupNumber) * threadsPerGenome;
+    Name *threadNames = st_malloc(sizeof(Name) * threadNumber);
+    Event *hgvmEvent = NULL;
+    for (int64_t i = 0; i < ingroupNumber + outgroupNumber; i++) {
+        char *header = stString_print("%s%" PRIi64 "", i < ingroupNumber ? "ingroup" : "outgroup", i);
+        Event *event = event_construct3(header, 0.1, i < ingroupNumber ? ancestor : rootEvent, eventTree);
+        event_setOutgroupStatus(event, i >= ingroupNumber);
+        hgvmEvent = hgvmEvent == NULL ? event : hgvmEvent;
+        for (int64_t j = 0; j < threadsPerGenome; j++) {
+            char *dna = stRandom_getRandomDNAString(threadLength, true, true, true);
+            threadNames[i * threadsPerGenome + j] = testCommon_addThreadToFlower2(flower, event, dna);
+            free(dna);
+        }
+        free(header);
+    }
+    PinchArray *pinchArray = st_calloc(1, sizeof(PinchArray));
+    pinchArray->pinches = getRandomAlignments(threadNames, threadNumber, threadLength, pinchNumber);
+    pinchArray->pinchNumber = pinchNumber;
+    stPinchIterator *pinchIterator = stPinchIterator_construct(pinchArray,
+            (stPinch *(*)(void *)) pinchArray_getNext, (void *(*)(void *)) pinchArray_reset,
+            (void (*)(void *)) pinchArray_destruct);
+
+    fprintf(stdout, "%" PRIi64 " ingroups, %" PRIi64 " outgroups, %" PRIi64 " threads of length %" PRIi64
+            ", %" PRIi64 " alignments, %" PRIi64 " annealing threads\n", ingroupNumber, outgroupNumber,
+            threadNumber, threadLength, pinchNumber, annealingThreads);
+    fprintf(stdout, "%-30s %12s %12s\n", "filter", "seconds", "blocks");
+    for (int64_t i = 0; i < sizeof(filters) / sizeof(Filter); i++) {
+        stCaf_setFlowerForAlignmentFiltering(flower);
+        stPinchThreadSet *threadSet = stCaf_setup(flower);
+        int64_t threads = annealingThreads;
+        if (filters[i].filterFn == stCaf_filterToEnsureCycleFreeIsolatedComponents) {
+            stCaf_setupHGVMFiltering(flower, threadSet, (char *) event_getHeader(hgvmEvent));
+            threads = 1;
+        }
+        double start = testCommon_getSeconds();
+        stCaf_annealInParallel(threadSet, pinchIterator, filters[i].filterFn, threads);
+        double seconds = testCommon_getSeconds() - start;
+        fprintf(stdout, "%-30s %12.3f %12" PRIi64 "\n", filters[i].name, seconds,
+                stPinchThreadSet_getTotalBlockNumber(threadSet));
+        stPinchThreadSet_destruct(threadSet);
+    }
+
+    stPinchIterator_destruct(pinchIterator);
+    free(threadNames);
+    testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "cactus.h"
+#include "sonLib.h"
+#include "stPinchGraphs.h"
+#include "stCaf.h"
+
+/*
+ * Takes the pinch graph of a synthetic flower of colinear genomes all the way to flowers written to the cactus
+ * disk, timing the conversion of the pinch graph to flowers by stCaf_finish and the write separately.
+ */
+
+static const char *benchmarkOptions[] = {
+        "-b --genomes : The number of genomes (default 20)",
+        "-c --threadsPerGenome : The number of sequences in each genome (default 5)",
+        "-d --threadLength : The length of each sequence (default 200000)",
+        "-e --blockLength : The average length of the aligned blocks (default 50)",
+        NULL };
+
+static void benchmarkUsage() {
+    testCommon_benchmarkUsage("stCafBenchmarks", "finishing", benchmarkOptions);
+}
+
+int finishingBenchmark(int argc, char *argv[]) {
+    int64_t genomeNumber = 20, threadsPerGenome = 5, threadLength = 200000, blockLength = 50;
+
+    while (1) {
+        static struct option long_options[] = { { "logLevel", required_argument, 0, 'a' },
+                { "genomes", required_argument, 0, 'b' }, { "threadsPerGenome", required_argument, 0, 'c' },
+                { "threadLength", required_argument, 0, 'd' }, { "blockLength", required_argument, 0, 'e' },
+                { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
+        int option_index = 0;
+        int key = getopt_long(argc, argv, "a:b:c:d:e:h", long_options, &option_index);
+        if (key == -1) {
+            break;
+        }
+        switch (key) {
+            case 'a':
+                st_setLogLevelFromString(optarg);
+                break;
+            case 'b':
+                genomeNumber = atol(optarg);
+                break;
+            case 'c':
+                threadsPerGenome = atol(optarg);
+                break;
+            case 'd':
+                threadLength = atol(optarg);
+                break;
+            case 'e':
+                blockLength = atol(optarg);
+                break;
+            case 'h':
+                benchmarkUsage();
+                return 0;
+            default:
+                benchmarkUsage();
+                return 1;
+        }
+    }
+
+    //A star shaped tree of genomes, each with the same number of sequences.
+    CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+    EventTree *eventTree = eventTree_construct2(cactusDisk);
+    Flower *flower = flower_construct2(0, cactusDisk);
+    group_construct2(flower);
+    Event *rootEvent = eventTree_getRootEvent(eventTree);
+    Name *threadNames = st_malloc(sizeof(Name) * genomeNumber * threadsPerGenome);
+    for (int64_t i = 0; i < genomeNumber; i++) {
+        char *header = stString_print("genome%" PRIi64 "", i);
+        Event *event = event_construct3(header, 0.1, rootEvent, eventTree);
+        for (int64_t j = 0; j < threadsPerGenome; j++) {
+            char *dna = stRandom_getRandomDNAString(threadLength, true, true, true);
+            threadNames[i * threadsPerGenome + j] = testCommon_addThreadToFlower2(flower, event, dna);
+            free(dna);
+        }
+        free(header);
+    }
+
+    //Align each sequence colinearly to the same sequence of the first genome, leaving gaps between the blocks,
+    //so every sequence ends up in one long chain of blocks.
+    double start = testCommon_getSeconds();
+    stPinchThreadSet *threadSet = stCaf_setup(flower);
+    for (int64_t j = 0; j < threadsPerGenome; j++) {
+        stPinchThread *referenceThread = stPinchThreadSet_getThread(threadSet, threadNames[j]);
+        for (int64_t position = 2; position + 2 * blockLength < threadLength + 2; position += 2 * blockLength) {
+            int64_t length = st_randomInt(1, blockLength + 1);
+            for (int64_t i = 1; i < genomeNumber; i++) {
+                stPinchThread_pinch(referenceThread, stPinchThreadSet_getThread(threadSet, threadNames[i * threadsPerGenome + j]),
+                        position, position, length, 1);
+            }
+        }
+    }
+    stCaf_melt(flower, threadSet, NULL, 0, 0, 0, INT64_MAX);
+    int64_t blockNumber = 0, segmentNumber = 0;
+    stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+    stPinchBlock *block;
+    while ((block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL) {
+        blockNumber++;
+        segmentNumber += stPinchBlock_getDegree(block);
+    }
+    double pinchingSeconds = testCommon_getSeconds() - start;
+
+    start = testCommon_getSeconds();
+    stCaf_finish(flower, threadSet, INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX);
+    double finishingSeconds = testCommon_getSeconds() - start;
+    stPinchThreadSet_destruct(threadSet);
+
+    start = testCommon_getSeconds();
+    cactusDisk_write(cactusDisk);
+    double writingSeconds = testCommon_getSeconds() - start;
+
+    fprintf(stdout, "%" PRIi64 " genomes of %" PRIi64 " sequences of length %" PRIi64 ", %" PRIi64
+            " blocks with %" PRIi64 " segments\n", genomeNumber, threadsPerGenome, threadLength, blockNumber,
+            segmentNumber);
+    fprintf(stdout, "%-12s %12s\n", "stage", "seconds");
+    fprintf(stdout, "%-12s %12.3f\n", "pinching", pinchingSeconds);
+    fprintf(stdout, "%-12s %12.3f\n", "finishing", finishingSeconds);
+    fprintf(stdout, "%-12s %12.3f\n", "writing", writingSeconds);
+
+    free(threadNames);
+    testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include "cactus.h"
+#include "sonLib.h"
+#include "stPinchGraphs.h"
+#include "stGiantComponent.h"
+
+/*
+ * Breaks up a synthetic giant component, first as a bare weighted graph given straight to the breakup
+ * engine, then as the adjacency component of a pinch graph in which random alignments between repeats
+ * have joined most of the blocks together, and reports the time taken and the peak memory.
+ */
+
+static int64_t getPeakMegabytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+static int64_t getLargestAdjacencyComponentSize(stPinchThreadSet *threadSet) {
+    stList *adjacencyComponents = stPinchThreadSet_getAdjacencyComponents(threadSet);
+    int64_t largestAdjacencyComponentSize = 0;
+    for (int64_t i = 0; i < stList_length(adjacencyComponents); i++) {
+        stList *adjacencyComponent = stList_get(adjacencyComponents, i);
+        if (stList_length(adjacencyComponent) > largestAdjacencyComponentSize) {
+            largestAdjacencyComponentSize = stList_length(adjacencyComponent);
+        }
+    }
+    stList_destruct(adjacencyComponents);
+    return largestAdjacencyComponentSize;
+}
+
+static const char *benchmarkOptions[] = {
+        "-b --nodes : The number of nodes in the bare graph (default 2000000)",
+        "-c --edgesPerNode : The number of edges per node in the bare graph (default 4)",
+        "-d --maxComponentSize : The largest component to leave in the bare graph (default 100)",
+        "-e --threads : The number of threads in the pinch graph (default 100)",
+        "-f --threadLength : The length of each thread (default 100000)",
+        "-g --alignments : The number of alignments to pinch (default 200000)",
+        "-i --ratio : The maximum adjacency component size ratio for the pinch graph (default 10)",
+        NULL };
+
+static void benchmarkUsage() {
+    testCommon_benchmarkUsage("stCafBenchmarks", "giantComponent", benchmarkOptions);
+}
+
+int giantComponentBenchmark(int argc, char *argv[]) {
+    int64_t nodeNumber = 2000000, edgesPerNode = 4, maxComponentSize = 100;
+    int64_t threadNumber = 100, threadLength = 100000, pinchNumber = 200000;
+    float maximumAdjacencyComponentSizeRatio = 10;
+
+    while (1) {
+        static struct option long_options[] = { { "logLevel", required_argument, 0, 'a' },
+                { "nodes", required_argument, 0, 'b' }, { "edgesPerNode", required_argument, 0, 'c' },
+                { "maxComponentSize", required_argument, 0, 'd' }, { "threads", required_argument, 0, 'e' },
+                { "threadLength", required_argument, 0, 'f' }, { "alignments", required_argument, 0, 'g' },
+                { "ratio", required_argument, 0, 'i' }, { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
+        int option_index = 0;
+        int key = getopt_long(argc, argv, "a:b:c:d:e:f:g:i:h", long_options, &option_index);
+        if (key == -1) {
+            break;
+        }
+        switch (key) {
+            case 'a':
+                st_setLogLevelFromString(optarg);
+                break;
+            case 'b':
+                nodeNumber = atol(optarg);
+                break;
+            case 'c':
+                edgesPerNode = atol(optarg);
+                break;
+            case 'd':
+                maxComponentSize = atol(optarg);
+                break;
+            case 'e':
+                threadNumber = atol(optarg);
+                break;
+            case 'f':
+                threadLength = atol(optarg);
+                break;
+            case 'g':
+                pinchNumber = atol(optarg);
+                break;
+            case 'i':
+                maximumAdjacencyComponentSizeRatio = atof(optarg);
+                break;
+            case 'h':
+                benchmarkUsage();
+                return 0;
+            default:
+                benchmarkUsage();
+                return 1;
+        }
+    }
+
+    //A bare graph of random edges, which is connected with high probability.
+    int64_t edgeNumber = nodeNumber * edgesPerNode;
+    stCaf_WeightedEdge *edges = st_malloc(sizeof(stCaf_WeightedEdge) * (edgeNumber + 1));
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        edges[i].weight = st_randomInt(1, 100);
+        edges[i].node1 = st_randomInt(0, nodeNumber);
+        edges[i].node2 = st_randomInt(0, nodeNumber);
+    }
+    double start = testCommon_getSeconds();
+    int64_t rejectedEdges = stCaf_breakupComponentGreedily2(nodeNumber, edges, edgeNumber, maxComponentSize);
+    double graphSeconds = testCommon_getSeconds() - start;
+    free(edges);
+
+    //A pinch graph in which random alignments join most blocks into one adjacency component.
+    stPinchThreadSet *threadSet = stPinchThreadSet_construct();
+    for (int64_t i = 0; i < threadNumber; i++) {
+        stPinchThreadSet_addThread(threadSet, i, 0, threadLength);
+    }
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        int64_t length = st_randomInt(1, 50);
+        stPinchThread *thread1 = stPinchThreadSet_getThread(threadSet, st_randomInt(0, threadNumber));
+        stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet, st_randomInt(0, threadNumber));
+        stPinchThread_pinch(thread1, thread2, st_randomInt(0, threadLength - length), st_randomInt(0, threadLength - length),
+                length, st_random() > 0.5);
+    }
+    int64_t blocksBefore = stPinchThreadSet_getTotalBlockNumber(threadSet);
+    int64_t largestBefore = getLargestAdjacencyComponentSize(threadSet);
+    start = testCommon_getSeconds();
+    stCaf_breakupComponentsGreedily(threadSet, maximumAdjacencyComponentSizeRatio);
+    double pinchGraphSeconds = testCommon_getSeconds() - start;
+    int64_t largestAfter = getLargestAdjacencyComponentSize(threadSet);
+
+    fprintf(stdout, "Bare graph of %" PRIi64 " nodes and %" PRIi64 " edges, max component size %" PRIi64 "\n", nodeNumber,
+            edgeNumber, maxComponentSize);
+    fprintf(stdout, "%-12s %12s\n", "seconds", "rejected");
+    fprintf(stdout, "%-12.3f %12" PRIi64 "\n", graphSeconds, rejectedEdges);
+    fprintf(stdout, "Pinch graph of %" PRIi64 " threads of length %" PRIi64 " and %" PRIi64 " alignments, ratio %f\n",
+            threadNumber, threadLength, pinchNumber, maximumAdjacencyComponentSizeRatio);
+    fprintf(stdout, "%-12s %12s %12s %12s %12s\n", "seconds", "blocksBefore", "blocksAfter", "largestBefore",
+            "largestAfter");
+    fprintf(stdout, "%-12.3f %12" PRIi64 " %12" PRIi64 " %12" PRIi64 " %12" PRIi64 "\n", pinchGraphSeconds, blocksBefore,
+            stPinchThreadSet_getTotalBlockNumber(threadSet), largestBefore, largestAfter);
+    fprintf(stdout, "Peak memory %" PRIi64 "MB\n", getPeakMegabytes());
+
+    stPinchThreadSet_destruct(threadSet);
+    return 0;
+}
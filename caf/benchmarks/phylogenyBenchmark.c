@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "cactus.h"
+#include "sonLib.h"
+#include "stPinchGraphs.h"
+#include "stCaf.h"
+#include "stCafPhylogeny.h"
+
+/*
+ * Builds trees to remove ancient homologies on a synthetic flower full of gene families, each of which was
+ * duplicated before the ingroups and outgroup diverged, using increasing numbers of tree-building threads.
+ * All the copies of each family are aligned to each other, so the trees must split the paralogs apart.
+ */
+
+static void mutate(char *dna, int64_t length, double substitutionRate) {
+    const char *bases = "ACGT";
+    for (int64_t i = 0; i < length; i++) {
+        if (st_random() < substitutionRate) {
+            char base;
+            while ((base = bases[st_randomInt(0, 4)]) == dna[i]);
+            dna[i] = base;
+        }
+    }
+}
+
+static const char *benchmarkOptions[] = {
+        "-b --ingroups : The number of ingroup genomes (default 6)",
+        "-c --families : The number of gene families (default 500)",
+        "-d --geneLength : The length of each gene (default 200)",
+        "-e --maxThreads : Double the number of tree-building threads up to this (default 8)",
+        "-f --numTrees : The number of trees to build for each unit (default 10)",
+        NULL };
+
+static void benchmarkUsage() {
+    testCommon_benchmarkUsage("stCafBenchmarks", "phylogeny", benchmarkOptions);
+}
+
+int phylogenyBenchmark(int argc, char *argv[]) {
+    int64_t ingroupNumber = 6, familyNumber = 500, geneLength = 200, maxThreads = 8, numTrees = 10;
+
+    while (1) {
+        static struct option long_options[] = { { "logLevel", required_argument, 0, 'a' },
+                { "ingroups", required_argument, 0, 'b' }, { "families", required_argument, 0, 'c' },
+                { "geneLength", required_argument, 0, 'd' }, { "maxThreads", required_argument, 0, 'e' },
+                { "numTrees", required_argument, 0, 'f' }, { "help", no_argument, 0, 'h' }, { 0, 0, 0, 0 } };
+        int option_index = 0;
+        int key = getopt_long(argc, argv, "a:b:c:d:e:f:h", long_options, &option_index);
+        if (key == -1) {
+            break;
+        }
+        switch (key) {
+            case 'a':
+                st_setLogLevelFromString(optarg);
+                break;
+            case 'b':
+                ingroupNumber = atol(optarg);
+                break;
+            case 'c':
+                familyNumber = atol(optarg);
+                break;
+            case 'd':
+                geneLength = atol(optarg);
+                break;
+            case 'e':
+                maxThreads = atol(optarg);
+                break;
+            case 'f':
+                numTrees = atol(optarg);
+                break;
+            case 'h':
+                benchmarkUsage();
+                return 0;
+            default:
+                benchmarkUsage();
+                return 1;
+        }
+    }
+
+    //The species tree is ((ingroup0, ingroup1, ...)ancestor, outgroup)root.
+    CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+    EventTree *eventTree = eventTree_construct2(cactusDisk);
+    Flower *flower = flower_construct(cactusDisk);
+    group_construct2(flower);
+    Event *rootEvent = eventTree_getRootEvent(eventTree);
+    Event *ancestor = event_construct3("ancestor", 0.05, rootEvent, eventTree);
+    Event *outgroup = event_construct3("outgroup", 0.1, rootEvent, eventTree);
+    event_setOutgroupStatus(outgroup, true);
+    int64_t genomeNumber = ingroupNumber + 1;
+    Event **genomes = st_malloc(sizeof(Event *) * genomeNumber);
+    for (int64_t i = 0; i < ingroupNumber; i++) {
+        char *header = stString_print("ingroup%" PRIi64 "", i);
+        genomes[i] = event_construct3(header, 0.05, ancestor, eventTree);
+        free(header);
+    }
+    genomes[ingroupNumber] = outgroup;
+
+    //Each genome is a single thread holding two copies of every family, the paralogs having diverged before
+    //the speciations.
+    int64_t copyNumber = 2, genomeLength = familyNumber * copyNumber * geneLength;
+    char **genomeStrings = st_malloc(sizeof(char *) * genomeNumber);
+    for (int64_t i = 0; i < genomeNumber; i++) {
+        genomeStrings[i] = st_calloc(genomeLength + 1, sizeof(char));
+    }
+    for (int64_t f = 0; f < familyNumber; f++) {
+        char *family = stRandom_getRandomDNAString(geneLength, false, false, true);
+        for (int64_t c = 0; c < copyNumber; c++) {
+            char *paralog = stString_copy(family);
+            mutate(paralog, geneLength, 0.15);
+            for (int64_t i = 0; i < genomeNumber; i++) {
+                char *gene = genomeStrings[i] + (f * copyNumber + c) * geneLength;
+                memcpy(gene, paralog, geneLength);
+                mutate(gene, geneLength, i == ingroupNumber ? 0.1 : 0.05);
+            }
+            free(paralog);
+        }
+        free(family);
+    }
+    Name *threadNames = st_malloc(sizeof(Name) * genomeNumber);
+    for (int64_t i = 0; i < genomeNumber; i++) {
+        threadNames[i] = testCommon_addThreadToFlower2(flower, genomes[i], genomeStrings[i]);
+        free(genomeStrings[i]);
+    }
+    free(genomeStrings);
+
+    stCaf_PhylogenyParameters params;
+    params.distanceCorrectionMethod = JUKES_CANTOR;
+    enum stCaf_TreeBuildingMethod treeBuildingMethod = GUIDED_NEIGHBOR_JOINING;
+    params.treeBuildingMethods = stList_construct();
+    stList_append(params.treeBuildingMethods, &treeBuildingMethod);
+    params.rootingMethod = BEST_RECON;
+    params.scoringMethod = COMBINED_LIKELIHOOD;
+    params.breakpointScalingFactor = 1.0;
+    params.nucleotideScalingFactor = 1.0;
+    params.skipSingleCopyBlocks = 0;
+    params.keepSingleDegreeBlocks = 0;
+    params.costPerDupPerBase = 0.2;
+    params.costPerLossPerBase = 0.2;
+    params.maxBaseDistance = 1000;
+    params.maxBlockDistance = 100;
+    params.numTrees = numTrees;
+    params.ignoreUnalignedBases = 1;
+    params.onlyIncludeCompleteFeatureBlocks = 0;
+    params.doSplitsWithSupportHigherThanThisAllAtOnce = 1.0;
+
+    stList *results = stList_construct3(0, free);
+    for (int64_t threads = 1; threads <= maxThreads; threads *= 2) {
+        //Align every copy of each family to the first copy in the first genome.
+        stPinchThreadSet *threadSet = stCaf_setup(flower);
+        stPinchThread *referenceThread = stPinchThreadSet_getThread(threadSet, threadNames[0]);
+        for (int64_t f = 0; f < familyNumber; f++) {
+            for (int64_t i = 0; i < genomeNumber; i++) {
+                for (int64_t c = 0; c < copyNumber; c++) {
+                    if (i != 0 || c != 0) {
+                        stPinchThread_pinch(referenceThread, stPinchThreadSet_getThread(threadSet, threadNames[i]),
+                                2 + f * copyNumber * geneLength, 2 + (f * copyNumber + c) * geneLength, geneLength, 1);
+                    }
+                }
+            }
+        }
+        int64_t blocksBefore = stPinchThreadSet_getTotalBlockNumber(threadSet);
+        stCaf_ThreadStringProvider *threadStrings = stCaf_ThreadStringProvider_construct(flower,
+                ST_CAF_THREAD_STRING_CACHE_SIZE);
+        stSet *outgroupThreads = stCaf_getOutgroupThreads(flower, threadSet);
+        params.numTreeBuildingThreads = threads;
+
+        double start = testCommon_getSeconds();
+        stCaf_buildTreesToRemoveAncientHomologies(threadSet, BLOCK, threadStrings, outgroupThreads, flower, &params,
+                NULL, "ingroup0");
+        double seconds = testCommon_getSeconds() - start;
+
+        stList_append(results, stString_print("%-10" PRIi64 " %12.3f %12" PRIi64 " %12" PRIi64 "", threads, seconds,
+                blocksBefore, stPinchThreadSet_getTotalBlockNumber(threadSet)));
+        stCaf_ThreadStringProvider_destruct(threadStrings);
+        stSet_destruct(outgroupThreads);
+        stPinchThreadSet_destruct(threadSet);
+    }
+
+    fprintf(stdout, "%" PRIi64 " ingroups and an outgroup, %" PRIi64 " families of %" PRIi64 " copies of length %"
+            PRIi64 ", %" PRIi64 " trees per unit\n", ingroupNumber, familyNumber, copyNumber, geneLength, numTrees);
+    fprintf(stdout, "%-10s %12s %12s %12s\n", "threads", "seconds", "blocksBefore", "blocksAfter");
+    for (int64_t i = 0; i < stList_length(results); i++) {
+        fprintf(stdout, "%s\n", (char *) stList_get(results, i));
+    }
+
+    stList_destruct(results);
+    stList_destruct(params.treeBuildingMethods);
+    free(threadNames);
+    free(genomes);
+    testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include "stCaf.h"
 #include "stPinchGraphs.h"
 #include "stPinchIterator.h"
+#include "stBinaryAlignments.h"
 #include "stLastzAlignments.h"
 #include "stGiantComponent.h"
 #include "stCafPhylogeny.h"
@@ -89,6 +90,8 @@ static void usage() {
     fprintf(stderr, "-P --referenceEventHeader : name of reference event (necessary for phylogeny estimation)\n");
     fprintf(stderr, "-Q --phylogenyDoSplitsWithSupportHigherThanThisAllAtOnce : assume that this support value or greater means a very confident split, and that they will not be changed by the greedy split algorithm. Do all these very confident splits at once, to save a lot of computation time.\n");
     fprintf(stderr, "-R --numTreeBuildingThreads : Number of threads in the tree-building thread pool. Must be greater than 1. Default 2.\n");
+    fprintf(stderr, "-3 --annealingThreads : Number of threads used to add alignments to the pinch graph. Default 1.\n");
+    fprintf(stderr, "-4 --profileFile : Write a JSON report of the wall time, CPU time and memory of each phase for each flower to this file.\n");
     fprintf(stderr, "-S --phylogeny : Run the tree-building code and split ancient homologies away.\n");
     fprintf(stderr, "-T --minimumBlockHomologySupport: Minimum fraction of possible homologies required not to be considered a transitively collapsed megablock.\n");
     fprintf(stderr, "-U --phylogenyNucleotideScalingFactor: Weighting for the nucleotide information in the distance matrix used to build each tree.\n");
@@ -280,7 +283,6 @@ int main(int argc, char *argv[]) {
      * Script for adding alignments to cactus tree.
      */
     int64_t startTime;
-    stKVDatabaseConf *kvDatabaseConf;
     CactusDisk *cactusDisk;
     int key, k;
 
@@ -337,9 +339,11 @@ int main(int argc, char *argv[]) {
     double phylogenyCostPerDupPerBase = 0.2;
     double phylogenyCostPerLossPerBase = 0.2;
     const char *debugFileName = NULL;
+    const char *profileFileName = NULL;
     const char *referenceEventHeader = NULL;
     double phylogenyDoSplitsWithSupportHigherThanThisAllAtOnce = 1.0;
     int64_t numTreeBuildingThreads = 2;
+    int64_t numAnnealingThreads = 1;
     int64_t minimumBlockDegreeToCheckSupport = 10;
     double minimumBlockHomologySupport = 0.7;
     double nucleotideScalingFactor = 1.0;
@@ -390,6 +394,8 @@ int main(int argc, char *argv[]) {
                         { "phylogenyDistanceCorrectionMethod", required_argument, 0, 'Z' },
                         { "maxRecoverableChainsIterations", required_argument, 0, '1' },
                         { "maxRecoverableChainLength", required_argument, 0, '2' },
+                        { "annealingThreads", required_argument, 0, '3' },
+                        { "profileFile", required_argument, 0, '4' },
                         { 0, 0, 0, 0 } };
 
         int option_index = 0;
@@ -676,6 +682,15 @@ int main(int argc, char *argv[]) {
                     st_errAbort("Error parsing the maxRecoverableChainLength argument");
                 }
                 break;
+            case '3':
+                k = sscanf(optarg, "%" PRIi64, &numAnnealingThreads);
+                if (k != 1 || numAnnealingThreads < 1) {
+                    st_errAbort("Error parsing the annealingThreads argument");
+                }
+                break;
+            case '4':
+                profileFileName = stString_copy(optarg);
+                break;
             default:
                 usage();
                 return 1;
@@ -722,8 +737,9 @@ int main(int argc, char *argv[]) {
     //Load the database
     //////////////////////////////////////////////
 
-    kvDatabaseConf = stKVDatabaseConf_constructFromString(cactusDiskDatabaseString);
-    cactusDisk = cactusDisk_construct(kvDatabaseConf, false, true);
+    CactusProfile *profile = profileFileName != NULL ? cactusProfile_construct("cactus_caf") : NULL;
+    cactusProfile_startPhase(profile, NULL_NAME, "loadDisk");
+    cactusDisk = cactusDisk_constructFromString(cactusDiskDatabaseString, false, true);
     st_logInfo("Set up the flower disk\n");
 
     ///////////////////////////////////////////////////////////////////////////
@@ -746,66 +762,89 @@ int main(int argc, char *argv[]) {
     if (alignmentsFile == NULL) {
         cactusDisk_preCacheStrings(cactusDisk, flowers);
     }
+    cactusProfile_endPhase(profile);
     char *tempFile1 = NULL;
+    char *tempFile2 = NULL;
     for (int64_t i = 0; i < stList_length(flowers); i++) {
         flower = stList_get(flowers, i);
         if (!flower_builtBlocks(flower)) { // Do nothing if the flower already has defined blocks
             st_logDebug("Processing flower: %lli\n", flower_getName(flower));
 
             stCaf_setFlowerForAlignmentFiltering(flower);
+            Name flowerName = flower_getName(flower);
+            cactusProfile_startPhase(profile, flowerName, "flower");
 
             //Set up the graph and add the initial alignments
+            cactusProfile_startPhase(profile, flowerName, "setup");
             stPinchThreadSet *threadSet = stCaf_setup(flower);
+            cactusProfile_endPhase(profile);
 
             //Build the set of outgroup threads
+            cactusProfile_startPhase(profile, flowerName, "outgroupThreads");
             outgroupThreads = stCaf_getOutgroupThreads(flower, threadSet);
+            cactusProfile_endPhase(profile);
 
+            //The HGVM filter updates global state as it goes, so can only be used serially.
+            int64_t annealingThreads = numAnnealingThreads;
             if (filterFn == stCaf_filterToEnsureCycleFreeIsolatedComponents) {
                 stCaf_setupHGVMFiltering(flower, threadSet, hgvmEventName);
+                annealingThreads = 1;
             }
 
             //Setup the alignments
+            cactusProfile_startPhase(profile, flowerName, "alignment");
             stPinchIterator *pinchIterator;
-            stList *alignmentsList = NULL;
             if (alignmentsFile != NULL) {
                 assert(i == 0);
                 assert(stList_length(flowers) == 1);
-                if (sortAlignments) {
+                //Convert the cigars once, so each annealing round reads the pinches rather than reparsing the cigars.
+                const char *binaryAlignmentsFile = alignmentsFile;
+                if (!stCaf_isBinaryAlignmentsFile(alignmentsFile)) {
                     tempFile1 = getTempFile();
-                    stCaf_sortCigarsFileByScoreInDescendingOrder(alignmentsFile, tempFile1);
-                    pinchIterator = stPinchIterator_constructFromFile(tempFile1);
-                } else {
-                    pinchIterator = stPinchIterator_constructFromFile(alignmentsFile);
+                    int64_t alignmentNumber = stCaf_convertCigarsFileToBinaryAlignments(alignmentsFile, tempFile1);
+                    st_logDebug("Converted %" PRIi64 " alignments to the binary format\n", alignmentNumber);
+                    binaryAlignmentsFile = tempFile1;
+                }
+                if (sortAlignments) {
+                    cactusProfile_startPhase(profile, flowerName, "sorting");
+                    tempFile2 = getTempFile();
+                    stCaf_sortBinaryAlignmentsFileByScoreInDescendingOrder(binaryAlignmentsFile, tempFile2,
+                            ST_BINARY_ALIGNMENTS_SORT_MEMORY);
+                    binaryAlignmentsFile = tempFile2;
+                    cactusProfile_endPhase(profile);
                 }
+                pinchIterator = stPinchIterator_constructFromBinaryFile(binaryAlignmentsFile);
             } else {
                 if (tempFile1 == NULL) {
                     tempFile1 = getTempFile();
                 }
-                alignmentsList = stCaf_selfAlignFlower(flower, minimumSequenceLengthForBlast, lastzArguments, realign, realignArguments, tempFile1);
-                if (sortAlignments) {
-                    stCaf_sortCigarsByScoreInDescendingOrder(alignmentsList);
-                }
-                st_logDebug("Ran lastz and have %" PRIi64 " alignments\n", stList_length(alignmentsList));
-                pinchIterator = stPinchIterator_constructFromList(alignmentsList);
+                //Anneal the alignments as lastz produces them, unless they must first be sorted.
+                pinchIterator = stCaf_selfAlignFlowerAsStream(flower, minimumSequenceLengthForBlast, lastzArguments,
+                        realign, realignArguments, sortAlignments, tempFile1);
             }
+            cactusProfile_endPhase(profile);
 
             for (int64_t annealingRound = 0; annealingRound < annealingRoundsLength; annealingRound++) {
                 int64_t minimumChainLength = annealingRounds[annealingRound];
                 int64_t alignmentTrim = annealingRound < alignmentTrimLength ? alignmentTrims[annealingRound] : 0;
                 st_logDebug("Starting annealing round with a minimum chain length of %" PRIi64 " and an alignment trim of %" PRIi64 "\n", minimumChainLength, alignmentTrim);
+                char *phaseName = stString_print("annealingRound%" PRIi64 "", annealingRound);
+                cactusProfile_startPhase(profile, flowerName, phaseName);
+                free(phaseName);
                 stPinchIterator_setTrim(pinchIterator, alignmentTrim);
 
                 //Add back in the constraints
                 if (pinchIteratorForConstraints != NULL) {
-                    stCaf_anneal(threadSet, pinchIteratorForConstraints, filterFn);
+                    stCaf_annealInParallel(threadSet, pinchIteratorForConstraints, filterFn, annealingThreads);
                 }
 
                 //Do the annealing
                 if (annealingRound == 0) {
-                    stCaf_anneal(threadSet, pinchIterator, filterFn);
+                    stCaf_annealInParallel(threadSet, pinchIterator, filterFn, annealingThreads);
                 } else {
-                    stCaf_annealBetweenAdjacencyComponents(threadSet, pinchIterator, filterFn);
+                    stCaf_annealBetweenAdjacencyComponentsInParallel(threadSet, pinchIterator, filterFn, annealingThreads);
                 }
+                cactusProfile_endPhase(profile);
 
                 // Dump the block degree and length distribution to a file
                 if (debugFileName != NULL) {
@@ -839,21 +878,25 @@ int main(int argc, char *argv[]) {
                 }
 
                 //Do the melting rounds
-                for (int64_t meltingRound = 0; meltingRound < meltingRoundsLength; meltingRound++) {
-                    int64_t minimumChainLengthForMeltingRound = meltingRounds[meltingRound];
-                    st_logDebug("Starting melting round with a minimum chain length of %" PRIi64 " \n", minimumChainLengthForMeltingRound);
-                    if (minimumChainLengthForMeltingRound >= minimumChainLength) {
-                        break;
-                    }
-                    stCaf_melt(flower, threadSet, NULL, 0, minimumChainLengthForMeltingRound, 0, INT64_MAX);
-                } st_logDebug("Last melting round of cycle with a minimum chain length of %" PRIi64 " \n", minimumChainLength);
+                phaseName = stString_print("meltingRound%" PRIi64 "", annealingRound);
+                cactusProfile_startPhase(profile, flowerName, phaseName);
+                free(phaseName);
+                int64_t meltingRoundNumber = 0;
+                while (meltingRoundNumber < meltingRoundsLength && meltingRounds[meltingRoundNumber] < minimumChainLength) {
+                    meltingRoundNumber++;
+                }
+                stCaf_meltInRounds(flower, threadSet, meltingRounds, meltingRoundNumber);
+                st_logDebug("Last melting round of cycle with a minimum chain length of %" PRIi64 " \n", minimumChainLength);
                 stCaf_melt(flower, threadSet, NULL, 0, minimumChainLength, breakChainsAtReverseTandems, maximumMedianSequenceLengthBetweenLinkedEnds);
                 //This does the filtering of blocks that do not have the required species/tree-coverage/degree.
                 stCaf_melt(flower, threadSet, blockFilterFn, blockTrim, 0, 0, INT64_MAX);
+                cactusProfile_endPhase(profile);
             }
 
             if (removeRecoverableChains) {
+                cactusProfile_startPhase(profile, flowerName, "recoverableChains");
                 stCaf_meltRecoverableChains(flower, threadSet, breakChainsAtReverseTandems, maximumMedianSequenceLengthBetweenLinkedEnds, recoverableChainsFilter, maxRecoverableChainsIterations, maxRecoverableChainLength);
+                cactusProfile_endPhase(profile);
             }
             if (debugFileName != NULL) {
                 dumpBlockInfo(threadSet, stString_print("%s-blockStats-postMelting", debugFileName));
@@ -869,8 +912,9 @@ int main(int argc, char *argv[]) {
 
             if (stSet_size(outgroupThreads) > 0 && doPhylogeny) {
                 st_logDebug("Starting to build trees and partition ingroup homologies\n");
-                stHash *threadStrings = stCaf_getThreadStrings(flower, threadSet);
-                st_logDebug("Got sets of thread strings and set of threads that are outgroups\n");
+                cactusProfile_startPhase(profile, flowerName, "phylogeny");
+                stCaf_ThreadStringProvider *threadStrings = stCaf_ThreadStringProvider_construct(flower,
+                        ST_CAF_THREAD_STRING_CACHE_SIZE);
                 stCaf_PhylogenyParameters params;
                 params.distanceCorrectionMethod = phylogenyDistanceCorrectionMethod;
                 params.treeBuildingMethods = phylogenyTreeBuildingMethods;
@@ -895,7 +939,7 @@ int main(int argc, char *argv[]) {
                 stCaf_buildTreesToRemoveAncientHomologies(
                     threadSet, phylogenyHomologyUnitType, threadStrings, outgroupThreads, flower, &params,
                     debugFileName == NULL ? NULL : stString_print("%s-phylogeny", debugFileName), referenceEventHeader);
-                stHash_destruct(threadStrings);
+                stCaf_ThreadStringProvider_destruct(threadStrings);
                 st_logDebug("Finished building trees\n");
 
                 if (removeRecoverableChains) {
@@ -908,6 +952,7 @@ int main(int argc, char *argv[]) {
                 // Enforce the block constraints on minimum degree,
                 // etc. after splitting.
                 stCaf_melt(flower, threadSet, blockFilterFn, 0, 0, 0, INT64_MAX);
+                cactusProfile_endPhase(profile);
             }
 
             //Sort out case when we allow blocks of degree 1
@@ -917,22 +962,23 @@ int main(int argc, char *argv[]) {
                 stCaf_melt(flower, threadSet, blockFilterFn, blockTrim, 0, 0, INT64_MAX);
             } else if (maximumAdjacencyComponentSizeRatio < INT64_MAX) { //Deal with giant components
                 st_logDebug("Breaking up components greedily\n");
+                cactusProfile_startPhase(profile, flowerName, "giantComponent");
                 stCaf_breakupComponentsGreedily(threadSet, maximumAdjacencyComponentSizeRatio);
+                cactusProfile_endPhase(profile);
             }
 
             //Finish up
+            cactusProfile_startPhase(profile, flowerName, "finishing");
             stCaf_finish(flower, threadSet, chainLengthForBigFlower, longChain, minLengthForChromosome,
                     proportionOfUnalignedBasesForNewChromosome); //Flower is then destroyed at this point.
+            cactusProfile_endPhase(profile);
             st_logInfo("Ran the cactus core script\n");
 
             //Cleanup
             stPinchThreadSet_destruct(threadSet);
             stPinchIterator_destruct(pinchIterator);
             stSet_destruct(outgroupThreads);
-
-            if (alignmentsList != NULL) {
-                stList_destruct(alignmentsList);
-            }
+            cactusProfile_endPhase(profile);
             st_logInfo("Cleaned up from main loop\n");
         } else {
             st_logInfo("We've already built blocks / alignments for this flower\n");
@@ -942,6 +988,9 @@ int main(int argc, char *argv[]) {
     if (tempFile1 != NULL) {
         st_system("rm %s", tempFile1);
     }
+    if (tempFile2 != NULL) {
+        st_system("rm %s", tempFile2);
+    }
 
     if (constraintsFile != NULL) {
         stPinchIterator_destruct(pinchIteratorForConstraints);
@@ -951,7 +1000,9 @@ int main(int argc, char *argv[]) {
     // Write the flower to disk.
     ///////////////////////////////////////////////////////////////////////////
     st_logDebug("Writing the flowers to disk\n");
+    cactusProfile_startPhase(profile, NULL_NAME, "writeDisk");
     cactusDisk_write(cactusDisk);
+    cactusProfile_endPhase(profile);
     st_logInfo("Updated the flower on disk and %" PRIi64 " seconds have elapsed\n", time(NULL) - startTime);
 
     ///////////////////////////////////////////////////////////////////////////
@@ -959,4 +1010,8 @@ int main(int argc, char *argv[]) {
     ///////////////////////////////////////////////////////////////////////////
 
     cactusDisk_destruct(cactusDisk);
+    if (profile != NULL) {
+        cactusProfile_writeReportToFile(profile, profileFileName);
+        cactusProfile_destruct(profile);
+    }
 }
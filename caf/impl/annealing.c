@@ -54,6 +54,7 @@ static void stCaf_annealWithFilter2(stPinchThreadSet *threadSet, stPinch *(*pinc
 
 void stCaf_anneal(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, bool (*filterFn)(stPinchSegment *, stPinchSegment *)) {
     stPinchIterator_reset(pinchIterator);
+    stCaf_resetAlignmentFilteringCache();
     if(filterFn != NULL) {
         stCaf_annealWithFilter2(threadSet, (stPinch *(*)(void *)) stPinchIterator_getNext, pinchIterator, filterFn);
     }
@@ -172,6 +173,213 @@ void stCaf_annealBetweenAdjacencyComponents2(stPinchThreadSet *threadSet, stPinc
 
 void stCaf_annealBetweenAdjacencyComponents(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, bool (*filterFn)(stPinchSegment *, stPinchSegment *)) {
     stPinchIterator_reset(pinchIterator);
+    stCaf_resetAlignmentFilteringCache();
     stCaf_annealBetweenAdjacencyComponents2(threadSet, (stPinch *(*)(void *)) stPinchIterator_getNext, pinchIterator, filterFn);
     stCaf_joinTrivialBoundaries(threadSet);
 }
+
+///////////////////////////////////////////////////////////////////////////
+// Parallel annealing. The threads are partitioned into components, joined by
+// the blocks of the graph and by the pinches being added, and the pinches of each
+// component are applied on a separate thread, in their original order. Pinches in
+// different components touch disjoint threads and blocks, so the result is
+// identical to annealing serially. Pinches are annealed in batches of up to
+// ANNEALING_BATCH_SIZE, or of as many as have arrived when a streamed iterator
+// would have to wait for more.
+///////////////////////////////////////////////////////////////////////////
+
+#define ANNEALING_BATCH_SIZE 1000000
+
+typedef struct _annealingJob {
+    stPinchThreadSet *threadSet;
+    stPinch *pinches;
+    int64_t *pinchIndices; //The indices of the pinches of the component, in order.
+    int64_t length;
+    stSortedSet *adjacencyComponentIntervals; //If non-NULL, pinches are only made within adjacency components.
+    bool (*filterFn)(stPinchSegment *, stPinchSegment *);
+} AnnealingJob;
+
+static void applyPinch(stPinch *pinch, stPinchThreadSet *threadSet, stSortedSet *adjacencyComponentIntervals,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *)) {
+    if (adjacencyComponentIntervals != NULL) {
+        alignSameComponents(pinch, threadSet, adjacencyComponentIntervals, filterFn);
+        return;
+    }
+    stPinchThread *thread1 = stPinchThreadSet_getThread(threadSet, pinch->name1);
+    stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet, pinch->name2);
+    assert(thread1 != NULL && thread2 != NULL);
+    if (filterFn != NULL) {
+        stPinchThread_filterPinch(thread1, thread2, pinch->start1, pinch->start2, pinch->length, pinch->strand, filterFn);
+    } else {
+        stPinchThread_pinch(thread1, thread2, pinch->start1, pinch->start2, pinch->length, pinch->strand);
+    }
+}
+
+static AnnealingJob *annealingJob_run(AnnealingJob *job) {
+    for (int64_t i = 0; i < job->length; i++) {
+        applyPinch(&job->pinches[job->pinchIndices[i]], job->threadSet, job->adjacencyComponentIntervals, job->filterFn);
+    }
+    return job;
+}
+
+static void annealingJob_finish(AnnealingJob *job) {
+    /*
+     * The pool needs a finisher, but there is nothing to do here: the jobs of a batch are destructed by
+     * annealBatch once the pool has been waited on.
+     */
+}
+
+static void annealingJob_destruct(AnnealingJob *job) {
+    free(job->pinchIndices);
+    free(job);
+}
+
+static int annealingJob_cmpByLength(const void *a, const void *b) {
+    //Longest first, so the biggest components are started first.
+    int64_t i = ((AnnealingJob *) a)->length, j = ((AnnealingJob *) b)->length;
+    return i > j ? -1 : (i < j ? 1 : 0);
+}
+
+static stUnionFind *getThreadComponents(stPinchThreadSet *threadSet) {
+    /*
+     * Gets the threads partitioned into the components connected by blocks.
+     */
+    stUnionFind *threadComponents = stUnionFind_construct();
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet);
+    stPinchThread *thread;
+    while ((thread = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        stUnionFind_add(threadComponents, thread);
+    }
+    stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+    stPinchBlock *block;
+    while ((block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL) {
+        stPinchThread *firstThread = stPinchSegment_getThread(stPinchBlock_getFirst(block));
+        stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(block);
+        stPinchSegment *segment;
+        while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+            stUnionFind_union(threadComponents, firstThread, stPinchSegment_getThread(segment));
+        }
+    }
+    return threadComponents;
+}
+
+static void annealBatch(stPinchThreadSet *threadSet, stPinch *pinches, int64_t pinchNumber,
+        stUnionFind *threadComponents, stSortedSet *adjacencyComponentIntervals,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), stThreadPool *threadPool) {
+    /*
+     * Adds the pinches to the thread components, then makes a job for each component.
+     * A pinch that is filtered out still joins the components of its threads, which only costs parallelism.
+     */
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        stUnionFind_union(threadComponents, stPinchThreadSet_getThread(threadSet, pinches[i].name1),
+                stPinchThreadSet_getThread(threadSet, pinches[i].name2));
+    }
+    stHash *componentsToJobs = stHash_construct();
+    stList *jobs = stList_construct3(0, (void (*)(void *)) annealingJob_destruct);
+    AnnealingJob **pinchesToJobs = st_malloc(sizeof(AnnealingJob *) * pinchNumber);
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        void *component = stUnionFind_find(threadComponents, stPinchThreadSet_getThread(threadSet, pinches[i].name1));
+        AnnealingJob *job = stHash_search(componentsToJobs, component);
+        if (job == NULL) {
+            job = st_calloc(1, sizeof(AnnealingJob));
+            job->threadSet = threadSet;
+            job->pinches = pinches;
+            job->adjacencyComponentIntervals = adjacencyComponentIntervals;
+            job->filterFn = filterFn;
+            stHash_insert(componentsToJobs, component, job);
+            stList_append(jobs, job);
+        }
+        job->length++;
+        pinchesToJobs[i] = job;
+    }
+    for (int64_t i = 0; i < stList_length(jobs); i++) {
+        AnnealingJob *job = stList_get(jobs, i);
+        job->pinchIndices = st_malloc(sizeof(int64_t) * job->length);
+        job->length = 0;
+    }
+    for (int64_t i = 0; i < pinchNumber; i++) {
+        pinchesToJobs[i]->pinchIndices[pinchesToJobs[i]->length++] = i;
+    }
+    free(pinchesToJobs);
+    stHash_destruct(componentsToJobs);
+
+    if (stList_length(jobs) == 1) {
+        annealingJob_run(stList_get(jobs, 0));
+    } else {
+        stList_sort(jobs, annealingJob_cmpByLength);
+        for (int64_t i = 0; i < stList_length(jobs); i++) {
+            stThreadPool_push(threadPool, stList_get(jobs, i));
+        }
+        stThreadPool_wait(threadPool);
+    }
+    stList_destruct(jobs);
+}
+
+void stCaf_annealInParallel2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *),
+        bool (*isNextPinchReady)(void *), void *extraArg, stSortedSet *adjacencyComponentIntervals,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads, int64_t batchSize) {
+    stUnionFind *threadComponents = getThreadComponents(threadSet);
+    stThreadPool *threadPool = stThreadPool_construct(numThreads, (void *(*)(void *)) annealingJob_run,
+            (void (*)(void *)) annealingJob_finish);
+    //The batch grows as pinches arrive, so small inputs do not pay for a full batch.
+    stPinch *pinches = NULL;
+    int64_t pinchNumber = 0, pinchCapacity = 0;
+    stPinch *pinch;
+    while (1) {
+        if (pinchNumber > 0 && isNextPinchReady != NULL && !isNextPinchReady(extraArg)) {
+            //The stream has stalled, so anneal what has arrived rather than wait for a full batch.
+            annealBatch(threadSet, pinches, pinchNumber, threadComponents, adjacencyComponentIntervals, filterFn,
+                    threadPool);
+            pinchNumber = 0;
+        }
+        if ((pinch = pinchIterator(extraArg)) == NULL) {
+            break;
+        }
+        if (pinchNumber == pinchCapacity) {
+            pinchCapacity = pinchCapacity * 2 + 1 < batchSize ? pinchCapacity * 2 + 1 : batchSize;
+            pinches = st_realloc(pinches, sizeof(stPinch) * pinchCapacity);
+        }
+        pinches[pinchNumber++] = *pinch;
+        if (pinchNumber == batchSize) {
+            annealBatch(threadSet, pinches, pinchNumber, threadComponents, adjacencyComponentIntervals, filterFn,
+                    threadPool);
+            pinchNumber = 0;
+        }
+    }
+    annealBatch(threadSet, pinches, pinchNumber, threadComponents, adjacencyComponentIntervals, filterFn, threadPool);
+    free(pinches);
+    stThreadPool_destruct(threadPool);
+    stUnionFind_destruct(threadComponents);
+}
+
+void stCaf_annealInParallel(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads) {
+    if (numThreads <= 1) {
+        stCaf_anneal(threadSet, pinchIterator, filterFn);
+        return;
+    }
+    stPinchIterator_reset(pinchIterator);
+    stCaf_resetAlignmentFilteringCache();
+    stCaf_annealInParallel2(threadSet, (stPinch *(*)(void *)) stPinchIterator_getNext,
+            (bool (*)(void *)) stPinchIterator_isNextReady, pinchIterator, NULL, filterFn, numThreads,
+            ANNEALING_BATCH_SIZE);
+    stCaf_joinTrivialBoundaries(threadSet);
+}
+
+void stCaf_annealBetweenAdjacencyComponentsInParallel(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads) {
+    if (numThreads <= 1) {
+        stCaf_annealBetweenAdjacencyComponents(threadSet, pinchIterator, filterFn);
+        return;
+    }
+    stPinchIterator_reset(pinchIterator);
+    stCaf_resetAlignmentFilteringCache();
+    stList *adjacencyComponents;
+    stSortedSet *adjacencyComponentIntervals = getAdjacencyComponentIntervals(threadSet, &adjacencyComponents);
+    stCaf_annealInParallel2(threadSet, (stPinch *(*)(void *)) stPinchIterator_getNext,
+            (bool (*)(void *)) stPinchIterator_isNextReady, pinchIterator, adjacencyComponentIntervals, filterFn,
+            numThreads, ANNEALING_BATCH_SIZE);
+    stSortedSet_destruct(adjacencyComponentIntervals);
+    stList_destruct(adjacencyComponents);
+    stCaf_joinTrivialBoundaries(threadSet);
+}
@@ -0,0 +1,450 @@
+/*
+ * binaryAlignments.c
+ *
+ * The file is a header, followed by a record for each alignment. A record is its length in bytes, as a
+ * varint, followed by the score of the alignment, as a double, the names of its two contigs, the strand of
+ * its pinches, the number of pinches and then the pinches. Each pinch is the difference of its two starts
+ * from those of the previous pinch of the alignment and its length. Signed integers are zigzag encoded
+ * varints. The score is first so that sorting need not decode the rest of the record.
+ */
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sonLib.h"
+#include "stPinchGraphs.h"
+#include "stPinchIterator.h"
+#include "stBinaryAlignments.h"
+#include "pairwiseAlignment.h"
+#include "cactus.h"
+
+#define BINARY_ALIGNMENTS_MAGIC "CACTUSBA"
+#define BINARY_ALIGNMENTS_VERSION 1
+#define BINARY_ALIGNMENTS_HEADER_SIZE 16
+
+///////////////////////////////////////////////////////////////////////////
+// Encoding
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct _byteBuffer {
+    char *bytes;
+    int64_t length;
+    int64_t capacity;
+} ByteBuffer;
+
+static void byteBuffer_append(ByteBuffer *buffer, const void *bytes, int64_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        buffer->capacity = (buffer->length + length) * 2;
+        buffer->bytes = st_realloc(buffer->bytes, buffer->capacity);
+    }
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static int64_t encodeVarint(uint64_t i, char *bytes) {
+    int64_t length = 0;
+    while (i >= 0x80) {
+        bytes[length++] = (char) ((i & 0x7F) | 0x80);
+        i >>= 7;
+    }
+    bytes[length++] = (char) i;
+    return length;
+}
+
+static void byteBuffer_appendVarint(ByteBuffer *buffer, uint64_t i) {
+    char bytes[10];
+    byteBuffer_append(buffer, bytes, encodeVarint(i, bytes));
+}
+
+static uint64_t zigzag(int64_t i) {
+    return ((uint64_t) i << 1) ^ (uint64_t) (i >> 63);
+}
+
+static int64_t unzigzag(uint64_t i) {
+    return (int64_t) (i >> 1) ^ -(int64_t) (i & 1);
+}
+
+static uint64_t decodeVarint(const char *bytes, int64_t *offset, int64_t length) {
+    uint64_t i = 0;
+    for (int64_t shift = 0; shift < 64; shift += 7) {
+        if (*offset >= length) {
+            st_errAbort("Reached the end of a binary alignments record while decoding it");
+        }
+        uint8_t byte = (uint8_t) bytes[(*offset)++];
+        i |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return i;
+        }
+    }
+    st_errAbort("Found a malformed integer in a binary alignments record");
+    return 0;
+}
+
+static bool readVarint(FILE *fileHandle, uint64_t *i) {
+    /*
+     * Reads a varint from the file, returning false at the end of the file.
+     */
+    *i = 0;
+    for (int64_t shift = 0; shift < 64; shift += 7) {
+        int c = getc(fileHandle);
+        if (c == EOF) {
+            if (shift == 0) {
+                return 0;
+            }
+            st_errAbort("Reached the end of a binary alignments file while reading a record length");
+        }
+        *i |= (uint64_t) (c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return 1;
+        }
+    }
+    st_errAbort("Found a malformed record length in a binary alignments file");
+    return 0;
+}
+
+static void writeHeader(FILE *fileHandle) {
+    int64_t version = BINARY_ALIGNMENTS_VERSION;
+    if (fwrite(BINARY_ALIGNMENTS_MAGIC, 1, 8, fileHandle) != 8 || fwrite(&version, sizeof(int64_t), 1, fileHandle) != 1) {
+        st_errAbort("Could not write the header of a binary alignments file");
+    }
+}
+
+static void writeRecord(FILE *fileHandle, const char *record, int64_t length) {
+    char bytes[10];
+    int64_t i = encodeVarint(length, bytes);
+    if (fwrite(bytes, 1, i, fileHandle) != (size_t) i || fwrite(record, 1, length, fileHandle) != (size_t) length) {
+        st_errAbort("Could not write a record to a binary alignments file");
+    }
+}
+
+static FILE *openFile(const char *file, const char *mode) {
+    FILE *fileHandle = fopen(file, mode);
+    if (fileHandle == NULL) {
+        st_errAbort("Could not open the alignments file: %s", file);
+    }
+    return fileHandle;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writer
+///////////////////////////////////////////////////////////////////////////
+
+struct _stBinaryAlignmentWriter {
+    FILE *fileHandle;
+    ByteBuffer record;
+};
+
+stBinaryAlignmentWriter *stBinaryAlignmentWriter_construct(const char *binaryFile) {
+    stBinaryAlignmentWriter *writer = st_calloc(1, sizeof(stBinaryAlignmentWriter));
+    writer->fileHandle = openFile(binaryFile, "w");
+    writeHeader(writer->fileHandle);
+    return writer;
+}
+
+void stBinaryAlignmentWriter_writeAlignment(stBinaryAlignmentWriter *writer,
+        struct PairwiseAlignment *pairwiseAlignment) {
+    stList *pinches = stPinchIterator_getPinchesOfPairwiseAlignment(pairwiseAlignment);
+    ByteBuffer *record = &writer->record;
+    record->length = 0;
+    double score = pairwiseAlignment->score;
+    byteBuffer_append(record, &score, sizeof(double));
+    byteBuffer_appendVarint(record, zigzag(cactusMisc_stringToName(pairwiseAlignment->contig1)));
+    byteBuffer_appendVarint(record, zigzag(cactusMisc_stringToName(pairwiseAlignment->contig2)));
+    byteBuffer_appendVarint(record, pairwiseAlignment->strand1 == pairwiseAlignment->strand2);
+    byteBuffer_appendVarint(record, stList_length(pinches));
+    int64_t start1 = 0, start2 = 0;
+    for (int64_t i = 0; i < stList_length(pinches); i++) {
+        stPinch *pinch = stList_get(pinches, i);
+        byteBuffer_appendVarint(record, zigzag(pinch->start1 - start1));
+        byteBuffer_appendVarint(record, zigzag(pinch->start2 - start2));
+        byteBuffer_appendVarint(record, pinch->length);
+        start1 = pinch->start1;
+        start2 = pinch->start2;
+    }
+    stList_destruct(pinches);
+    writeRecord(writer->fileHandle, record->bytes, record->length);
+}
+
+void stBinaryAlignmentWriter_destruct(stBinaryAlignmentWriter *writer) {
+    if (fclose(writer->fileHandle) != 0) {
+        st_errAbort("Could not close a binary alignments file");
+    }
+    free(writer->record.bytes);
+    free(writer);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Reader
+///////////////////////////////////////////////////////////////////////////
+
+struct _stBinaryAlignmentReader {
+    char *map;
+    int64_t length;
+    int64_t offset;
+    int64_t recordEnd;
+    int64_t pinchesLeft; //In the current record.
+    stPinch pinch;
+};
+
+static char *mapFile(const char *file, int64_t *length) {
+    int fileHandle = open(file, O_RDONLY);
+    if (fileHandle < 0) {
+        st_errAbort("Could not open the alignments file: %s", file);
+    }
+    struct stat fileStat;
+    if (fstat(fileHandle, &fileStat) != 0) {
+        st_errAbort("Could not get the size of the alignments file: %s", file);
+    }
+    *length = fileStat.st_size;
+    if (*length < BINARY_ALIGNMENTS_HEADER_SIZE) {
+        st_errAbort("The file is not a binary alignments file: %s", file);
+    }
+    char *map = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fileHandle, 0);
+    close(fileHandle);
+    if (map == MAP_FAILED) {
+        st_errAbort("Could not map the alignments file: %s", file);
+    }
+    int64_t version;
+    memcpy(&version, map + 8, sizeof(int64_t));
+    if (memcmp(map, BINARY_ALIGNMENTS_MAGIC, 8) != 0 || version != BINARY_ALIGNMENTS_VERSION) {
+        st_errAbort("The file is not a binary alignments file of the current version: %s", file);
+    }
+    madvise(map, *length, MADV_SEQUENTIAL);
+    return map;
+}
+
+stBinaryAlignmentReader *stBinaryAlignmentReader_construct(const char *binaryFile) {
+    stBinaryAlignmentReader *reader = st_calloc(1, sizeof(stBinaryAlignmentReader));
+    reader->map = mapFile(binaryFile, &reader->length);
+    return stBinaryAlignmentReader_reset(reader);
+}
+
+stBinaryAlignmentReader *stBinaryAlignmentReader_reset(stBinaryAlignmentReader *reader) {
+    reader->offset = BINARY_ALIGNMENTS_HEADER_SIZE;
+    reader->recordEnd = BINARY_ALIGNMENTS_HEADER_SIZE;
+    reader->pinchesLeft = 0;
+    return reader;
+}
+
+stPinch *stBinaryAlignmentReader_getNextPinch(stBinaryAlignmentReader *reader) {
+    while (reader->pinchesLeft == 0) {
+        reader->offset = reader->recordEnd;
+        if (reader->offset >= reader->length) {
+            return NULL;
+        }
+        int64_t recordLength = decodeVarint(reader->map, &reader->offset, reader->length);
+        reader->recordEnd = reader->offset + recordLength;
+        if (reader->recordEnd > reader->length) {
+            st_errAbort("Found a truncated record in a binary alignments file");
+        }
+        reader->offset += sizeof(double); //Skip the score
+        reader->pinch.name1 = unzigzag(decodeVarint(reader->map, &reader->offset, reader->recordEnd));
+        reader->pinch.name2 = unzigzag(decodeVarint(reader->map, &reader->offset, reader->recordEnd));
+        reader->pinch.strand = decodeVarint(reader->map, &reader->offset, reader->recordEnd);
+        reader->pinchesLeft = decodeVarint(reader->map, &reader->offset, reader->recordEnd);
+        reader->pinch.start1 = 0;
+        reader->pinch.start2 = 0;
+    }
+    reader->pinch.start1 += unzigzag(decodeVarint(reader->map, &reader->offset, reader->recordEnd));
+    reader->pinch.start2 += unzigzag(decodeVarint(reader->map, &reader->offset, reader->recordEnd));
+    reader->pinch.length = decodeVarint(reader->map, &reader->offset, reader->recordEnd);
+    reader->pinchesLeft--;
+    return &reader->pinch;
+}
+
+void stBinaryAlignmentReader_destruct(stBinaryAlignmentReader *reader) {
+    munmap(reader->map, reader->length);
+    free(reader);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Conversion
+///////////////////////////////////////////////////////////////////////////
+
+bool stCaf_isBinaryAlignmentsFile(const char *file) {
+    FILE *fileHandle = fopen(file, "r");
+    if (fileHandle == NULL) {
+        return 0;
+    }
+    char magic[8];
+    bool isBinary = fread(magic, 1, 8, fileHandle) == 8 && memcmp(magic, BINARY_ALIGNMENTS_MAGIC, 8) == 0;
+    fclose(fileHandle);
+    return isBinary;
+}
+
+int64_t stCaf_convertCigarsFileToBinaryAlignments(const char *cigarsFile, const char *binaryFile) {
+    FILE *fileHandle = openFile(cigarsFile, "r");
+    stBinaryAlignmentWriter *writer = stBinaryAlignmentWriter_construct(binaryFile);
+    struct PairwiseAlignment *pairwiseAlignment;
+    int64_t alignmentNumber = 0;
+    while ((pairwiseAlignment = cigarRead(fileHandle)) != NULL) {
+        stBinaryAlignmentWriter_writeAlignment(writer, pairwiseAlignment);
+        destructPairwiseAlignment(pairwiseAlignment);
+        alignmentNumber++;
+    }
+    stBinaryAlignmentWriter_destruct(writer);
+    fclose(fileHandle);
+    return alignmentNumber;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sorting. Runs of the file that fit in memory are sorted and written to
+// temporary files, then the runs are merged. Ties are broken by position in the
+// file: within a run by the stable order of the sort, between runs by the run order.
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct _sortEntry {
+    double score;
+    int64_t offset; //Of the record body in the input.
+    int64_t length; //Of the record body.
+} SortEntry;
+
+static int sortEntry_cmp(const void *a, const void *b) {
+    const SortEntry *i = a, *j = b;
+    if (i->score != j->score) {
+        return i->score > j->score ? -1 : 1;
+    }
+    return i->offset < j->offset ? -1 : (i->offset > j->offset ? 1 : 0);
+}
+
+static void writeRun(FILE *fileHandle, const char *map, SortEntry *entries, int64_t entryNumber) {
+    qsort(entries, entryNumber, sizeof(SortEntry), sortEntry_cmp);
+    for (int64_t i = 0; i < entryNumber; i++) {
+        writeRecord(fileHandle, map + entries[i].offset, entries[i].length);
+    }
+}
+
+typedef struct _run {
+    FILE *fileHandle;
+    ByteBuffer record;
+    double score;
+} Run;
+
+static bool run_readNext(Run *run) {
+    uint64_t length;
+    if (!readVarint(run->fileHandle, &length)) {
+        return 0;
+    }
+    run->record.length = 0;
+    if (run->record.capacity < (int64_t) length) {
+        run->record.capacity = length * 2;
+        run->record.bytes = st_realloc(run->record.bytes, run->record.capacity);
+    }
+    if (fread(run->record.bytes, 1, length, run->fileHandle) != length) {
+        st_errAbort("Found a truncated record in a temporary sort file");
+    }
+    run->record.length = length;
+    memcpy(&run->score, run->record.bytes, sizeof(double));
+    return 1;
+}
+
+static bool run_before(Run *runs, int64_t i, int64_t j) {
+    return runs[i].score != runs[j].score ? runs[i].score > runs[j].score : i < j;
+}
+
+static void heap_siftDown(int64_t *heap, int64_t heapSize, Run *runs, int64_t i) {
+    while (1) {
+        int64_t smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < heapSize && run_before(runs, heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < heapSize && run_before(runs, heap[right], heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        int64_t k = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = k;
+        i = smallest;
+    }
+}
+
+static void mergeRuns(stList *runFiles, FILE *outputHandle) {
+    int64_t runNumber = stList_length(runFiles);
+    Run *runs = st_calloc(runNumber, sizeof(Run));
+    int64_t *heap = st_malloc(sizeof(int64_t) * runNumber);
+    int64_t heapSize = 0;
+    for (int64_t i = 0; i < runNumber; i++) {
+        runs[i].fileHandle = openFile(stList_get(runFiles, i), "r");
+        if (run_readNext(&runs[i])) {
+            heap[heapSize++] = i;
+        }
+    }
+    for (int64_t i = heapSize / 2 - 1; i >= 0; i--) {
+        heap_siftDown(heap, heapSize, runs, i);
+    }
+    while (heapSize > 0) {
+        Run *run = &runs[heap[0]];
+        writeRecord(outputHandle, run->record.bytes, run->record.length);
+        if (!run_readNext(run)) {
+            heap[0] = heap[--heapSize];
+        }
+        heap_siftDown(heap, heapSize, runs, 0);
+    }
+    for (int64_t i = 0; i < runNumber; i++) {
+        fclose(runs[i].fileHandle);
+        free(runs[i].record.bytes);
+    }
+    free(runs);
+    free(heap);
+}
+
+void stCaf_sortBinaryAlignmentsFileByScoreInDescendingOrder(const char *binaryFile, const char *sortedFile,
+        int64_t memoryLimit) {
+    int64_t length;
+    char *map = mapFile(binaryFile, &length);
+    int64_t entryCapacity = 1024, entryNumber = 0, runBytes = 0;
+    SortEntry *entries = st_malloc(sizeof(SortEntry) * entryCapacity);
+    stList *runFiles = stList_construct3(0, free);
+    FILE *outputHandle = openFile(sortedFile, "w");
+    writeHeader(outputHandle);
+    int64_t offset = BINARY_ALIGNMENTS_HEADER_SIZE;
+    while (offset < length) {
+        int64_t recordLength = decodeVarint(map, &offset, length);
+        if (offset + recordLength > length || recordLength < (int64_t) sizeof(double)) {
+            st_errAbort("Found a malformed record in the binary alignments file: %s", binaryFile);
+        }
+        //Write out the current run once it has used its share of memory.
+        if (runBytes + recordLength + (int64_t) sizeof(SortEntry) > memoryLimit && entryNumber > 0) {
+            char *runFile = stString_print("%s.run%" PRIi64 "", sortedFile, stList_length(runFiles));
+            FILE *runHandle = openFile(runFile, "w");
+            writeRun(runHandle, map, entries, entryNumber);
+            fclose(runHandle);
+            stList_append(runFiles, runFile);
+            entryNumber = 0;
+            runBytes = 0;
+        }
+        if (entryNumber == entryCapacity) {
+            entryCapacity *= 2;
+            entries = st_realloc(entries, sizeof(SortEntry) * entryCapacity);
+        }
+        memcpy(&entries[entryNumber].score, map + offset, sizeof(double));
+        entries[entryNumber].offset = offset;
+        entries[entryNumber++].length = recordLength;
+        runBytes += recordLength + sizeof(SortEntry);
+        offset += recordLength;
+    }
+    if (stList_length(runFiles) == 0) { //It all fitted in memory
+        writeRun(outputHandle, map, entries, entryNumber);
+    } else {
+        char *runFile = stString_print("%s.run%" PRIi64 "", sortedFile, stList_length(runFiles));
+        FILE *runHandle = openFile(runFile, "w");
+        writeRun(runHandle, map, entries, entryNumber);
+        fclose(runHandle);
+        stList_append(runFiles, runFile);
+        mergeRuns(runFiles, outputHandle);
+        for (int64_t i = 0; i < stList_length(runFiles); i++) {
+            remove(stList_get(runFiles, i));
+        }
+    }
+    if (fclose(outputHandle) != 0) {
+        st_errAbort("Could not write the sorted alignments file: %s", sortedFile);
+    }
+    stList_destruct(runFiles);
+    free(entries);
+    munmap(map, length);
+}
@@ -1,3 +1,5 @@
+#include <pthread.h>
+#include <string.h>
 #include "cactus.h"
 #include "sonLib.h"
 #include "commonC.h"
@@ -8,8 +10,184 @@
 // parameter.
 static Flower *flower;
 
+/*
+ * Summaries of the events in each block, used by the alignment filters.
+ *
+ * Each event of the flower is given a bit, and a further bit marks the threads
+ * set by stCaf_setThreadsToBeCycleFreeIsolatedComponents. The summary of a block is
+ * the union of the bits of its segments' threads. Blocks belong to the pinch graph
+ * library, so the summaries are held in a direct mapped cache keyed by block, and an
+ * entry is used only if the block has the same first segment and degree as when the
+ * entry was made. While annealing, segments are not freed and the degree of every
+ * block containing a given segment only grows, merges being the only way blocks gain
+ * segments, so a matching entry is always current. Anything else that changes the
+ * graph must be followed by stCaf_resetAlignmentFilteringCache.
+ */
+
+#define BLOCK_EVENTS_CACHE_SIZE 65536
+#define BLOCK_EVENTS_LOCK_NUMBER 256
+
+typedef struct _threadEvent {
+    Name name;
+    int64_t eventIndex;
+} ThreadEvent;
+
+typedef struct _blockEventsEntry {
+    stPinchBlock *block;
+    stPinchSegment *firstSegment;
+    uint64_t degree;
+    uint64_t generation;
+} BlockEventsEntry;
+
+static ThreadEvent *threadEvents; //Sorted by name.
+static int64_t threadEventNumber;
+static int64_t eventWords = 1;
+static int64_t specialThreadBit; //Equal to the number of events.
+static uint64_t *allEvents, *outgroupEvents, *ingroupEvents;
+static BlockEventsEntry *blockEventsEntries;
+static uint64_t *blockEventsStore; //eventWords words per entry.
+static uint64_t blockEventsGeneration;
+static pthread_mutex_t blockEventsLocks[BLOCK_EVENTS_LOCK_NUMBER];
+static pthread_once_t blockEventsLocksOnce = PTHREAD_ONCE_INIT;
+static stSet *specialThreads;
+
+static void initialiseBlockEventsLocks(void) {
+    for (int64_t i = 0; i < BLOCK_EVENTS_LOCK_NUMBER; i++) {
+        pthread_mutex_init(&blockEventsLocks[i], NULL);
+    }
+}
+
+static int threadEvent_cmp(const void *a, const void *b) {
+    const ThreadEvent *i = a, *j = b;
+    return i->name < j->name ? -1 : (i->name > j->name ? 1 : 0);
+}
+
+void stCaf_resetAlignmentFilteringCache(void) {
+    pthread_once(&blockEventsLocksOnce, initialiseBlockEventsLocks);
+    if (blockEventsEntries == NULL) {
+        blockEventsEntries = st_calloc(BLOCK_EVENTS_CACHE_SIZE, sizeof(BlockEventsEntry));
+    }
+    blockEventsStore = st_realloc(blockEventsStore, sizeof(uint64_t) * BLOCK_EVENTS_CACHE_SIZE * eventWords);
+    blockEventsGeneration++;
+}
+
+static void setEvent(uint64_t *events, int64_t index) {
+    events[index / 64] |= ((uint64_t) 1) << (index % 64);
+}
+
+static bool intersects(uint64_t *events1, uint64_t *events2, uint64_t *mask) {
+    for (int64_t i = 0; i < eventWords; i++) {
+        if (events1[i] & events2[i] & mask[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int64_t getEventIndex(Name name) {
+    ThreadEvent key = { name, 0 };
+    ThreadEvent *threadEvent = bsearch(&key, threadEvents, threadEventNumber, sizeof(ThreadEvent), threadEvent_cmp);
+    if (threadEvent == NULL) {
+        st_errAbort("The thread %" PRIi64 " is not in the flower given for alignment filtering", name);
+    }
+    return threadEvent->eventIndex;
+}
+
+static void addSegmentEvents(stPinchSegment *segment, uint64_t *events) {
+    if (threadEvents != NULL) {
+        setEvent(events, getEventIndex(stPinchSegment_getName(segment)));
+    }
+    if (specialThreads != NULL && stSet_search(specialThreads, stPinchSegment_getThread(segment))) {
+        setEvent(events, specialThreadBit);
+    }
+}
+
+static void getBlockEvents(stPinchBlock *block, uint64_t *events) {
+    stPinchSegment *firstSegment = stPinchBlock_getFirst(block);
+    uint64_t degree = stPinchBlock_getDegree(block);
+    uint64_t slot = (((uintptr_t) block) >> 4) * 0x9E3779B97F4A7C15ULL >> 48;
+    BlockEventsEntry *entry = &blockEventsEntries[slot];
+    uint64_t *entryEvents = blockEventsStore + slot * eventWords;
+    pthread_mutex_t *lock = &blockEventsLocks[slot % BLOCK_EVENTS_LOCK_NUMBER];
+
+    pthread_mutex_lock(lock);
+    if (entry->block == block && entry->firstSegment == firstSegment && entry->degree == degree
+            && entry->generation == blockEventsGeneration) {
+        memcpy(events, entryEvents, sizeof(uint64_t) * eventWords);
+        pthread_mutex_unlock(lock);
+        return;
+    }
+    pthread_mutex_unlock(lock);
+
+    memset(events, 0, sizeof(uint64_t) * eventWords);
+    stPinchBlockIt it = stPinchBlock_getSegmentIterator(block);
+    stPinchSegment *segment;
+    while ((segment = stPinchBlockIt_getNext(&it)) != NULL) {
+        addSegmentEvents(segment, events);
+    }
+
+    pthread_mutex_lock(lock);
+    entry->block = block;
+    entry->firstSegment = firstSegment;
+    entry->degree = degree;
+    entry->generation = blockEventsGeneration;
+    memcpy(entryEvents, events, sizeof(uint64_t) * eventWords);
+    pthread_mutex_unlock(lock);
+}
+
+static void getEvents(stPinchSegment *segment, uint64_t *events) {
+    stPinchBlock *block = stPinchSegment_getBlock(segment);
+    if (block != NULL) {
+        getBlockEvents(block, events);
+    } else {
+        memset(events, 0, sizeof(uint64_t) * eventWords);
+        addSegmentEvents(segment, events);
+    }
+}
+
 void stCaf_setFlowerForAlignmentFiltering(Flower *input) {
     flower = input;
+
+    //Number the events.
+    EventTree *eventTree = flower_getEventTree(flower);
+    int64_t eventNumber = eventTree_getEventNumber(eventTree);
+    specialThreadBit = eventNumber;
+    eventWords = eventNumber / 64 + 1;
+    free(allEvents);
+    free(outgroupEvents);
+    free(ingroupEvents);
+    allEvents = st_calloc(eventWords, sizeof(uint64_t));
+    outgroupEvents = st_calloc(eventWords, sizeof(uint64_t));
+    ingroupEvents = st_calloc(eventWords, sizeof(uint64_t));
+    stHash *eventIndices = stHash_construct2(NULL, free);
+    EventTree_Iterator *eventIt = eventTree_getIterator(eventTree);
+    Event *event;
+    while ((event = eventTree_getNext(eventIt)) != NULL) {
+        int64_t *index = st_malloc(sizeof(int64_t));
+        *index = stHash_size(eventIndices);
+        stHash_insert(eventIndices, event, index);
+        setEvent(allEvents, *index);
+        setEvent(event_isOutgroup(event) ? outgroupEvents : ingroupEvents, *index);
+    }
+    eventTree_destructIterator(eventIt);
+
+    //Map the names of the caps, which name the threads, to their events.
+    free(threadEvents);
+    threadEvents = st_malloc(sizeof(ThreadEvent) * (flower_getCapNumber(flower) + 1));
+    threadEventNumber = 0;
+    Flower_CapIterator *capIt = flower_getCapIterator(flower);
+    Cap *cap;
+    while ((cap = flower_getNextCap(capIt)) != NULL) {
+        int64_t *index = stHash_search(eventIndices, cap_getEvent(cap));
+        assert(index != NULL);
+        threadEvents[threadEventNumber].name = cap_getName(cap);
+        threadEvents[threadEventNumber++].eventIndex = *index;
+    }
+    flower_destructCapIterator(capIt);
+    qsort(threadEvents, threadEventNumber, sizeof(ThreadEvent), threadEvent_cmp);
+    stHash_destruct(eventIndices);
+
+    stCaf_resetAlignmentFilteringCache();
 }
 
 /*
@@ -23,28 +201,19 @@ Event *stCaf_getEvent(stPinchSegment *segment, Flower *flower) {
 }
 
 /*
- * Filtering by presence of outgroup. This code is efficient and scales linearly with depth.
+ * Filtering by presence of outgroup. The event summaries make this constant time in the depth of the blocks.
  */
 
-static bool containsOutgroupSegment(stPinchBlock *block, Flower *flower) {
-    stPinchBlockIt it = stPinchBlock_getSegmentIterator(block);
-    stPinchSegment *segment;
-    while ((segment = stPinchBlockIt_getNext(&it)) != NULL) {
-        if (event_isOutgroup(stCaf_getEvent(segment, flower))) {
-            stPinchSegment_putSegmentFirstInBlock(segment);
-            assert(stPinchBlock_getFirst(block) == segment);
-            return 1;
-        }
-    }
-    return 0;
+static bool containsOutgroupSegment(stPinchBlock *block) {
+    uint64_t events[eventWords];
+    getBlockEvents(block, events);
+    return intersects(events, outgroupEvents, allEvents);
 }
 
-static bool isOutgroupSegment(stPinchSegment *segment, Flower *flower) {
-    if (event_isOutgroup(stCaf_getEvent(segment, flower))) {
-        return 1;
-    } else {
-        return 0;
-    }
+static bool isOutgroupSegment(stPinchSegment *segment) {
+    uint64_t events[eventWords];
+    getEvents(segment, events);
+    return intersects(events, outgroupEvents, allEvents);
 }
 
 bool stCaf_filterByOutgroup(stPinchSegment *segment1,
@@ -53,19 +222,16 @@ bool stCaf_filterByOutgroup(stPinchSegment *segment1,
     if ((block1 = stPinchSegment_getBlock(segment1)) != NULL) {
         if ((block2 = stPinchSegment_getBlock(segment2)) != NULL) {
             if (block1 == block2) {
-                return stPinchBlock_getLength(block1) == 1 ? 0 : containsOutgroupSegment(block1, flower);
-            }
-            if (stPinchBlock_getDegree(block1) < stPinchBlock_getDegree(block2)) {
-                return containsOutgroupSegment(block1, flower) && containsOutgroupSegment(block2, flower);
+                return stPinchBlock_getLength(block1) == 1 ? 0 : containsOutgroupSegment(block1);
             }
-            return containsOutgroupSegment(block2, flower) && containsOutgroupSegment(block1, flower);
+            return containsOutgroupSegment(block1) && containsOutgroupSegment(block2);
         }
-        return isOutgroupSegment(segment2, flower) && containsOutgroupSegment(block1, flower);
+        return isOutgroupSegment(segment2) && containsOutgroupSegment(block1);
     }
     if ((block2 = stPinchSegment_getBlock(segment2)) != NULL) {
-        return isOutgroupSegment(segment1, flower) && containsOutgroupSegment(block2, flower);
+        return isOutgroupSegment(segment1) && containsOutgroupSegment(block2);
     }
-    return isOutgroupSegment(segment1, flower) && isOutgroupSegment(segment2, flower);
+    return isOutgroupSegment(segment1) && isOutgroupSegment(segment2);
 }
 
 bool stCaf_relaxedFilterByOutgroup(stPinchSegment *segment1,
@@ -74,12 +240,9 @@ bool stCaf_relaxedFilterByOutgroup(stPinchSegment *segment1,
     if ((block1 = stPinchSegment_getBlock(segment1)) != NULL) {
         if ((block2 = stPinchSegment_getBlock(segment2)) != NULL) {
             if (block1 == block2) {
-                return stPinchBlock_getLength(block1) == 1 ? 0 : containsOutgroupSegment(block1, flower);
+                return stPinchBlock_getLength(block1) == 1 ? 0 : containsOutgroupSegment(block1);
             }
-            if (stPinchBlock_getDegree(block1) < stPinchBlock_getDegree(block2)) {
-                return containsOutgroupSegment(block1, flower) && containsOutgroupSegment(block2, flower);
-            }
-            return containsOutgroupSegment(block2, flower) && containsOutgroupSegment(block1, flower);
+            return containsOutgroupSegment(block1) && containsOutgroupSegment(block2);
         }
     }
     // If we get here, we are just adding a segment to a block, not
@@ -88,42 +251,40 @@ bool stCaf_relaxedFilterByOutgroup(stPinchSegment *segment1,
 }
 
 /*
- * Filtering by presence of repeat species in block. This code is inefficient and does not scale.
+ * Filtering by presence of repeat species in block.
  */
 
-static bool checkIntersection(stSortedSet *names1, stSortedSet *names2) {
-    stSortedSet *n12 = stSortedSet_getIntersection(names1, names2);
-    bool b = stSortedSet_size(n12) > 0;
-    stSortedSet_destruct(names1);
-    stSortedSet_destruct(names2);
-    stSortedSet_destruct(n12);
-    return b;
-}
-
-static stSortedSet *getEvents(stPinchSegment *segment, Flower *flower) {
-    stSortedSet *events = stSortedSet_construct();
-    if (stPinchSegment_getBlock(segment) != NULL) {
-        stPinchBlock *block = stPinchSegment_getBlock(segment);
-        stPinchBlockIt it = stPinchBlock_getSegmentIterator(block);
-        while ((segment = stPinchBlockIt_getNext(&it)) != NULL) {
-            stSortedSet_insert(events, stCaf_getEvent(segment, flower));
-        }
-    } else {
-        stSortedSet_insert(events, stCaf_getEvent(segment, flower));
-    }
-    return events;
+static bool eventsIntersect(stPinchSegment *segment1, stPinchSegment *segment2, uint64_t *mask) {
+    uint64_t events1[eventWords], events2[eventWords];
+    getEvents(segment1, events1);
+    getEvents(segment2, events2);
+    return intersects(events1, events2, mask);
 }
 
 bool stCaf_filterByRepeatSpecies(stPinchSegment *segment1,
                                  stPinchSegment *segment2) {
-    return checkIntersection(getEvents(segment1, flower), getEvents(segment2, flower));
+    return eventsIntersect(segment1, segment2, allEvents);
 }
 
 bool stCaf_relaxedFilterByRepeatSpecies(stPinchSegment *segment1,
                                         stPinchSegment *segment2) {
     return stPinchSegment_getBlock(segment1) != NULL
         && stPinchSegment_getBlock(segment2) != NULL
-        && checkIntersection(getEvents(segment1, flower), getEvents(segment2, flower));
+        && eventsIntersect(segment1, segment2, allEvents);
+}
+
+/*
+ * Filtering by presence of repeat chromosomes in block. There are too many
+ * sequences to summarise, so this walks the blocks and does not scale.
+ */
+
+static bool checkIntersection(stSortedSet *names1, stSortedSet *names2) {
+    stSortedSet *n12 = stSortedSet_getIntersection(names1, names2);
+    bool b = stSortedSet_size(n12) > 0;
+    stSortedSet_destruct(names1);
+    stSortedSet_destruct(names2);
+    stSortedSet_destruct(n12);
+    return b;
 }
 
 static stSortedSet *getChrNames(stPinchSegment *segment, Flower *flower) {
@@ -149,36 +310,16 @@ bool stCaf_singleCopyChr(stPinchSegment *segment1,
     return checkIntersection(getChrNames(segment1, flower), getChrNames(segment2, flower));
 }
 
-static stSortedSet *getIngroupEvents(stPinchSegment *segment, Flower *flower) {
-    stSortedSet *events = stSortedSet_construct();
-    if (stPinchSegment_getBlock(segment) != NULL) {
-        stPinchBlock *block = stPinchSegment_getBlock(segment);
-        stPinchBlockIt it = stPinchBlock_getSegmentIterator(block);
-        while ((segment = stPinchBlockIt_getNext(&it)) != NULL) {
-            Event *event = stCaf_getEvent(segment, flower);
-            if (!event_isOutgroup(event)) {
-                stSortedSet_insert(events, event);
-            }
-        }
-    } else {
-        Event *event = stCaf_getEvent(segment, flower);
-        if (!event_isOutgroup(event)) {
-            stSortedSet_insert(events, event);
-        }
-    }
-    return events;
-}
-
 bool stCaf_singleCopyIngroup(stPinchSegment *segment1,
                              stPinchSegment *segment2) {
-    return checkIntersection(getIngroupEvents(segment1, flower), getIngroupEvents(segment2, flower));
+    return eventsIntersect(segment1, segment2, ingroupEvents);
 }
 
 bool stCaf_relaxedSingleCopyIngroup(stPinchSegment *segment1,
                                     stPinchSegment *segment2) {
     return stPinchSegment_getBlock(segment1) != NULL
         && stPinchSegment_getBlock(segment2) != NULL
-        && checkIntersection(getIngroupEvents(segment1, flower), getIngroupEvents(segment2, flower));
+        && eventsIntersect(segment1, segment2, ingroupEvents);
 }
 
 /*
@@ -188,7 +329,6 @@ bool stCaf_relaxedSingleCopyIngroup(stPinchSegment *segment1,
 
 static stUnionFind *threadToComponent;
 static stSet *specialComponents;
-static stSet *specialThreads;
 
 void stCaf_setupHGVMFiltering(Flower *flower, stPinchThreadSet *threadSet,
                               char *hgvmEventName) {
@@ -236,21 +376,14 @@ void stCaf_setThreadsToBeCycleFreeIsolatedComponents(stPinchThreadSet *threadSet
         stSet_insert(specialThreads, thread);
         stSet_insert(specialComponents, stUnionFind_find(threadToComponent, thread));
     }
+    stSet_destructIterator(it);
+    stCaf_resetAlignmentFilteringCache();
 }
 
 static bool containsSpecialThread(stPinchSegment *segment) {
-    stPinchBlock *block = stPinchSegment_getBlock(segment);
-    if (block != NULL) {
-        stPinchBlockIt it = stPinchBlock_getSegmentIterator(block);
-        stPinchSegment *segment2;
-        while ((segment2 = stPinchBlockIt_getNext(&it)) != NULL) {
-            if (stSet_search(specialThreads, stPinchSegment_getThread(segment2))) {
-                return true;
-            }
-        }
-        return false;
-    }
-    return stSet_search(specialThreads, stPinchSegment_getThread(segment));
+    uint64_t events[eventWords];
+    getEvents(segment, events);
+    return (events[specialThreadBit / 64] >> (specialThreadBit % 64)) & 1;
 }
 
 bool stCaf_filterToEnsureCycleFreeIsolatedComponents(stPinchSegment *segment1,
@@ -80,32 +80,51 @@ static End *convertCactusEdgeEndToEnd(stCactusEdgeEnd *cactusEdgeEnd, stHash *pi
 
 //Functions to create blocks
 
+static stHash *getThreadsToMetaSequencesHash(stPinchThreadSet *threadSet, Flower *parentFlower) {
+    /*
+     * The meta sequence of each thread, looked up once so that making the segments of the blocks doesn't need to
+     * search the caps of the parent flower for every segment.
+     */
+    stHash *threadsToMetaSequences = stHash_construct();
+    stPinchThreadSetIt pinchThreadIt = stPinchThreadSet_getIt(threadSet);
+    stPinchThread *pinchThread;
+    while ((pinchThread = stPinchThreadSetIt_getNext(&pinchThreadIt))) {
+        Cap *parentCap = flower_getCap(parentFlower, stPinchThread_getName(pinchThread));
+        assert(parentCap != NULL);
+        Sequence *parentSequence = cap_getSequence(parentCap);
+        assert(parentSequence != NULL);
+        stHash_insert(threadsToMetaSequences, pinchThread, sequence_getMetaSequence(parentSequence));
+    }
+    return threadsToMetaSequences;
+}
+
 static void makeBlockP(stPinchEnd *pinchEnd, End *end, stHash *pinchEndsToEnds) {
     assert(stHash_search(pinchEndsToEnds, pinchEnd) == NULL);
     stHash_insert(pinchEndsToEnds, stPinchEnd_construct(stPinchEnd_getBlock(pinchEnd), stPinchEnd_getOrientation(pinchEnd)), end);
 }
 
-static void makeBlock(stCactusEdgeEnd *cactusEdgeEnd, Flower *parentFlower, Flower *flower, stHash *pinchEndsToEnds) {
+static void makeBlock(stCactusEdgeEnd *cactusEdgeEnd, Flower *flower, stHash *threadsToMetaSequences, stHash *pinchEndsToEnds) {
     stPinchEnd *pinchEnd = stCactusEdgeEnd_getObject(cactusEdgeEnd);
     assert(pinchEnd != NULL);
     stPinchBlock *pinchBlock = stPinchEnd_getBlock(pinchEnd);
-    Block *block = block_construct(stPinchBlock_getLength(pinchBlock), flower);
+    //Reserve the names of the block, its ends, its segments and their caps all at once.
+    Name name = cactusDisk_getUniqueIDInterval(flower_getCactusDisk(flower), 3 + 3 * stPinchBlock_getDegree(pinchBlock));
+    Block *block = block_construct3(name, stPinchBlock_getLength(pinchBlock), flower);
+    name += 3;
     stPinchSegment *pinchSegment;
     stPinchBlockIt pinchSegmentIt = stPinchBlock_getSegmentIterator(pinchBlock);
     while ((pinchSegment = stPinchBlockIt_getNext(&pinchSegmentIt))) {
-        Cap *parentCap = flower_getCap(parentFlower, stPinchSegment_getName(pinchSegment)); //The following three lines isolates the sequence associated with a segment.
-        assert(parentCap != NULL);
-        Sequence *parentSequence = cap_getSequence(parentCap);
-        assert(parentSequence != NULL);
-        Sequence *sequence = flower_getSequence(flower, sequence_getName(parentSequence));
+        MetaSequence *metaSequence = stHash_search(threadsToMetaSequences, stPinchSegment_getThread(pinchSegment));
+        assert(metaSequence != NULL);
+        Sequence *sequence = flower_getSequence(flower, metaSequence_getName(metaSequence));
         if (sequence == NULL) {
-            sequence = sequence_construct(cactusDisk_getMetaSequence(flower_getCactusDisk(flower), sequence_getName(parentSequence)),
-                    flower);
+            sequence = sequence_construct(metaSequence, flower);
         }
         assert(sequence != NULL);
-        segment_construct2(
+        segment_construct4(name,
                 stPinchEnd_getOrientation(pinchEnd) ^ stPinchSegment_getBlockOrientation(pinchSegment) ? block_getReverse(block) : block,
                 stPinchSegment_getStart(pinchSegment), 1, sequence);
+        name += 3;
     }
     makeBlockP(pinchEnd, block_get5End(block), pinchEndsToEnds);
     stPinchEnd *otherPinchBlockEnd = stCactusEdgeEnd_getObject(stCactusEdgeEnd_getOtherEdgeEnd(cactusEdgeEnd));
@@ -116,18 +135,18 @@ static void makeBlock(stCactusEdgeEnd *cactusEdgeEnd, Flower *parentFlower, Flow
 
 static void makeFlower(stCactusNode *cactusNode, Flower *flower, bool orientation,
         stPinchThreadSet *threadSet,  Flower *parentFlower,
-        stList *deadEndComponent, stSet *bigFlowers, stHash *pinchEndsToEnds);
+        stList *deadEndComponent, stSet *bigFlowers, stHash *threadsToMetaSequences, stHash *pinchEndsToEnds);
 
 static void makeChain(stCactusEdgeEnd *cactusEdgeEnd, Flower *flower, bool orientation, bool makeSpacerFlowers,
         stPinchThreadSet *threadSet,  Flower *parentFlower,
-                stList *deadEndComponent, stSet *bigFlowers, stHash *pinchEndsToEnds) {
+                stList *deadEndComponent, stSet *bigFlowers, stHash *threadsToMetaSequences, stHash *pinchEndsToEnds) {
     cactusEdgeEnd = stCactusEdgeEnd_getOtherEdgeEnd(cactusEdgeEnd);
     if (!stCactusEdgeEnd_isChainEnd(cactusEdgeEnd)) { //We have a non-trivial chain
         Chain *chain = chain_construct(flower);
         do {
             stCactusEdgeEnd *linkedCactusEdgeEnd = stCactusEdgeEnd_getLink(cactusEdgeEnd);
             if (convertCactusEdgeEndToEnd(linkedCactusEdgeEnd, pinchEndsToEnds, flower) == NULL) { //Make subsequent block
-                makeBlock(linkedCactusEdgeEnd, parentFlower, flower, pinchEndsToEnds);
+                makeBlock(linkedCactusEdgeEnd, flower, threadsToMetaSequences, pinchEndsToEnds);
             }
             assert(stCactusEdgeEnd_getNode(cactusEdgeEnd) == stCactusEdgeEnd_getNode(linkedCactusEdgeEnd));
             Group *group = group_construct2(flower);
@@ -166,7 +185,8 @@ static void makeChain(stCactusEdgeEnd *cactusEdgeEnd, Flower *flower, bool orien
                 end_copyConstruct(nestedEnd2, nestedFlower);
             }
             //Fill out stack
-            makeFlower(stCactusEdgeEnd_getNode(cactusEdgeEnd), nestedFlower, orientation, threadSet, parentFlower, deadEndComponent, bigFlowers, pinchEndsToEnds);
+            makeFlower(stCactusEdgeEnd_getNode(cactusEdgeEnd), nestedFlower, orientation, threadSet, parentFlower, deadEndComponent, bigFlowers,
+                    threadsToMetaSequences, pinchEndsToEnds);
 
             if(makeSpacerFlowers) { //Cleanup memory of spacer flowers
                 stCaf_addAdjacencies(spacerFlower);
@@ -185,7 +205,7 @@ static void makeChain(stCactusEdgeEnd *cactusEdgeEnd, Flower *flower, bool orien
 
 static void makeChains(stCactusNode *cactusNode, Flower *flower, bool orientation,
         stPinchThreadSet *threadSet,  Flower *parentFlower,
-        stList *deadEndComponent, stSet *bigFlowers, stHash *pinchEndsToEnds) {
+        stList *deadEndComponent, stSet *bigFlowers, stHash *threadsToMetaSequences, stHash *pinchEndsToEnds) {
     bool makeSpacerFlowers = stSet_search(bigFlowers, cactusNode) != NULL;
     stCactusNodeEdgeEndIt cactusEdgeEndIt = stCactusNode_getEdgeEndIt(cactusNode);
     stCactusEdgeEnd *cactusEdgeEnd;
@@ -210,24 +230,25 @@ static void makeChains(stCactusNode *cactusNode, Flower *flower, bool orientatio
                     if (end_getSide(end)) {
                         startCactusEdgeEnd = linkedCactusEdgeEnd;
                     } else {
-                        makeBlock(cactusEdgeEnd, parentFlower, flower, pinchEndsToEnds);
+                        makeBlock(cactusEdgeEnd, flower, threadsToMetaSequences, pinchEndsToEnds);
                         startCactusEdgeEnd = cactusEdgeEnd;
                     }
                     orientation2 = !end_getSide(end);
                 } else {
                     if(orientation) {
-                        makeBlock(cactusEdgeEnd, parentFlower, flower, pinchEndsToEnds);
+                        makeBlock(cactusEdgeEnd, flower, threadsToMetaSequences, pinchEndsToEnds);
                         startCactusEdgeEnd = cactusEdgeEnd;
                     }
                     else {
-                        makeBlock(linkedCactusEdgeEnd, parentFlower, flower, pinchEndsToEnds);
+                        makeBlock(linkedCactusEdgeEnd, flower, threadsToMetaSequences, pinchEndsToEnds);
                         startCactusEdgeEnd = linkedCactusEdgeEnd;
                     }
                     orientation2 = orientation;
                 }
             }
             assert(startCactusEdgeEnd != NULL);
-            makeChain(startCactusEdgeEnd, flower, orientation2, makeSpacerFlowers, threadSet, parentFlower, deadEndComponent, bigFlowers, pinchEndsToEnds);
+            makeChain(startCactusEdgeEnd, flower, orientation2, makeSpacerFlowers, threadSet, parentFlower, deadEndComponent, bigFlowers,
+                    threadsToMetaSequences, pinchEndsToEnds);
         }
     }
 }
@@ -268,9 +289,10 @@ static void makeTangles(stCactusNode *cactusNode, Flower *flower, stHash *pinchE
 
 static void makeFlower(stCactusNode *cactusNode, Flower *flower, bool orientation,
         stPinchThreadSet *threadSet,  Flower *parentFlower,
-        stList *deadEndComponent, stSet *bigFlowers, stHash *pinchEndsToEnds) {
+        stList *deadEndComponent, stSet *bigFlowers, stHash *threadsToMetaSequences, stHash *pinchEndsToEnds) {
     assert(flower_getAttachedStubEndNumber(flower) > 0);
-    makeChains(cactusNode, flower, orientation, threadSet, parentFlower, deadEndComponent, bigFlowers, pinchEndsToEnds); //This call is recursive
+    makeChains(cactusNode, flower, orientation, threadSet, parentFlower, deadEndComponent, bigFlowers, threadsToMetaSequences,
+            pinchEndsToEnds); //This call is recursive
     makeTangles(cactusNode, flower, pinchEndsToEnds, deadEndComponent);
     stCaf_addAdjacencies(flower);
     if(flower_isLeaf(flower) && flower_getBlockNumber(flower) == 0 && flower != parentFlower) { //We have a leaf with no blocks - it's effectively empty and can be removed.
@@ -287,7 +309,10 @@ static void makeFlower(stCactusNode *cactusNode, Flower *flower, bool orientatio
 static void stCaf_convertCactusGraphToFlowers(stPinchThreadSet *threadSet, stCactusNode *startCactusNode, Flower *parentFlower,
         stList *deadEndComponent, stSet *bigFlowers) {
     stHash *pinchEndsToEnds = getPinchEndsToEndsHash(threadSet, parentFlower);
-    makeFlower(startCactusNode, parentFlower, 1, threadSet, parentFlower, deadEndComponent, bigFlowers, pinchEndsToEnds);
+    stHash *threadsToMetaSequences = getThreadsToMetaSequencesHash(threadSet, parentFlower);
+    makeFlower(startCactusNode, parentFlower, 1, threadSet, parentFlower, deadEndComponent, bigFlowers, threadsToMetaSequences,
+            pinchEndsToEnds);
+    stHash_destruct(threadsToMetaSequences);
     stHash_destruct(pinchEndsToEnds);
 }
 
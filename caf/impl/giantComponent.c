@@ -7,106 +7,166 @@
 
 #include "sonLib.h"
 #include "stPinchGraphs.h"
+#include "stGiantComponent.h"
 #include <math.h>
 #include <stdlib.h>
 
-static void *getValue(stHash *hash, int64_t node) {
-    stIntTuple *nodeTuple = stIntTuple_construct1(node);
-    void *object = stHash_search(hash, nodeTuple);
-    stIntTuple_destruct(nodeTuple);
-    return object;
+/*
+ * Union-find over nodes numbered 0 to nodeNumber - 1, tracking the size of each component at its root.
+ */
+
+static int64_t getComponent(int64_t *parents, int64_t node) {
+    while (parents[node] != node) {
+        parents[node] = parents[parents[node]]; //Path halving
+        node = parents[node];
+    }
+    return node;
 }
 
-stList *stCaf_breakupComponentGreedily(stList *nodes, stList *edges, int64_t maxComponentSize) {
-    /*
-     * Make a component for each node in the graph
-     */
-    stHash *nodeToComponents = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
-            (int(*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
-    stListIterator *listIt = stList_getIterator(nodes);
-    stIntTuple *node;
-    while ((node = stList_getNext(listIt)) != NULL) {
-        stSortedSet *component = stSortedSet_construct();
-        stSortedSet_insert(component, node);
-        assert(stHash_search(nodeToComponents, node) == NULL);
-        stHash_insert(nodeToComponents, node, component);
-    }
-    stList_destructIterator(listIt);
-
-    stList *sortedEdges = stList_copy(edges, NULL); //copy, to avoid messing input
-    stList_sort(sortedEdges, (int(*)(const void *, const void *)) stIntTuple_cmpFn); //Sort in ascending order, so best edge first
-    int64_t edgeScore = INT64_MAX;
-    //While edges exist, try and put them into the graph.
-    stList *edgesToDelete = stList_construct();
-    int64_t totalComponents = stList_length(nodes);
-    while (stList_length(sortedEdges) > 0) {
-        stIntTuple *edge = stList_pop(sortedEdges);
-        assert(edgeScore >= stIntTuple_get(edge, 0));
-        edgeScore = stIntTuple_get(edge, 0);
-        stSortedSet *component1 = getValue(nodeToComponents, stIntTuple_get(edge, 1));
-        stSortedSet *component2 = getValue(nodeToComponents, stIntTuple_get(edge, 2));
-        assert(component1 != NULL && component2 != NULL);
+/*
+ * A max-heap of edges, in place in the edge array, ordered by weight, then nodes.
+ */
+
+static int weightedEdge_cmp(const stCaf_WeightedEdge *edge1, const stCaf_WeightedEdge *edge2) {
+    if (edge1->weight != edge2->weight) {
+        return edge1->weight < edge2->weight ? -1 : 1;
+    }
+    if (edge1->node1 != edge2->node1) {
+        return edge1->node1 < edge2->node1 ? -1 : 1;
+    }
+    return edge1->node2 < edge2->node2 ? -1 : (edge1->node2 > edge2->node2 ? 1 : 0);
+}
+
+static void siftDown(stCaf_WeightedEdge *edges, int64_t edgeNumber, int64_t i) {
+    while (2 * i + 1 < edgeNumber) {
+        int64_t child = 2 * i + 1;
+        if (child + 1 < edgeNumber && weightedEdge_cmp(&edges[child], &edges[child + 1]) < 0) {
+            child++;
+        }
+        if (weightedEdge_cmp(&edges[i], &edges[child]) >= 0) {
+            return;
+        }
+        stCaf_WeightedEdge edge = edges[i];
+        edges[i] = edges[child];
+        edges[child] = edge;
+        i = child;
+    }
+}
+
+int64_t stCaf_breakupComponentGreedily2(int64_t nodeNumber, stCaf_WeightedEdge *edges, int64_t edgeNumber,
+        int64_t maxComponentSize) {
+    int64_t *parents = st_malloc(sizeof(int64_t) * nodeNumber);
+    int64_t *sizes = st_malloc(sizeof(int64_t) * nodeNumber);
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        parents[i] = i;
+        sizes[i] = 1;
+    }
+    for (int64_t i = edgeNumber / 2 - 1; i >= 0; i--) {
+        siftDown(edges, edgeNumber, i);
+    }
+    //Pop the best remaining edge to the end of the heap and try and put it into the graph.
+    int64_t rejectedEdges = 0;
+    for (int64_t heapSize = edgeNumber; heapSize > 0; heapSize--) {
+        stCaf_WeightedEdge edge = edges[0];
+        edges[0] = edges[heapSize - 1];
+        siftDown(edges, heapSize - 1, 0);
+        edges[heapSize - 1] = edge;
+        stCaf_WeightedEdge *poppedEdge = &edges[heapSize - 1];
+        poppedEdge->rejected = 0;
+        assert(edge.node1 >= 0 && edge.node1 < nodeNumber && edge.node2 >= 0 && edge.node2 < nodeNumber);
+        int64_t component1 = getComponent(parents, edge.node1);
+        int64_t component2 = getComponent(parents, edge.node2);
         if (component1 == component2) { //We're golden, as the edge is already contained within one component.
             continue;
         }
-        if (stSortedSet_size(component1) + stSortedSet_size(component2) > maxComponentSize) { //This edge would make a too large component, so reject
-            stList_append(edgesToDelete, edge);
+        if (sizes[component1] + sizes[component2] > maxComponentSize) { //This edge would make a too large component, so reject
+            poppedEdge->rejected = 1;
+            rejectedEdges++;
             continue;
         }
-        //Merge the components and replace references in the hash.
-        if (stSortedSet_size(component1) < stSortedSet_size(component2)) {
-            stSortedSet *component3 = component1;
+        //Merge the smaller component into the larger.
+        if (sizes[component1] < sizes[component2]) {
+            int64_t component3 = component1;
             component1 = component2;
             component2 = component3;
         }
-        assert(stSortedSet_size(component1) >= stSortedSet_size(component2));
-        while (stSortedSet_size(component2) > 0) {
-            node = stSortedSet_getLast(component2);
-            stSortedSet_remove(component2, node);
-            assert(stSortedSet_search(component1, node) == NULL);
-            stSortedSet_insert(component1, node);
-            stHash_insert(nodeToComponents, node, component1);
+        parents[component2] = component1;
+        sizes[component1] += sizes[component2];
+    }
+    free(parents);
+    free(sizes);
+    return rejectedEdges;
+}
+
+stList *stCaf_breakupComponentGreedily(stList *nodes, stList *edges, int64_t maxComponentSize) {
+    //Number the nodes
+    stHash *nodesToIndices = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
+            (int(*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
+    for (int64_t i = 0; i < stList_length(nodes); i++) {
+        stIntTuple *node = stList_get(nodes, i);
+        assert(stHash_search(nodesToIndices, node) == NULL);
+        stHash_insert(nodesToIndices, node, (void *) (intptr_t) (i + 1)); //Offset by one, so no index is NULL
+    }
+    stCaf_WeightedEdge *weightedEdges = st_malloc(sizeof(stCaf_WeightedEdge) * (stList_length(edges) + 1));
+    for (int64_t i = 0; i < stList_length(edges); i++) {
+        stIntTuple *edge = stList_get(edges, i);
+        stIntTuple *node1 = stIntTuple_construct1(stIntTuple_get(edge, 1));
+        stIntTuple *node2 = stIntTuple_construct1(stIntTuple_get(edge, 2));
+        assert(stHash_search(nodesToIndices, node1) != NULL && stHash_search(nodesToIndices, node2) != NULL);
+        weightedEdges[i].weight = stIntTuple_get(edge, 0);
+        weightedEdges[i].node1 = (intptr_t) stHash_search(nodesToIndices, node1) - 1;
+        weightedEdges[i].node2 = (intptr_t) stHash_search(nodesToIndices, node2) - 1;
+        stIntTuple_destruct(node1);
+        stIntTuple_destruct(node2);
+    }
+    stHash_destruct(nodesToIndices);
+
+    int64_t rejectedEdges = stCaf_breakupComponentGreedily2(stList_length(nodes), weightedEdges,
+            stList_length(edges), maxComponentSize);
+
+    //Report the rejected edges in the order they were rejected, best first.
+    stList *edgesToDelete = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    for (int64_t i = stList_length(edges) - 1; i >= 0; i--) {
+        stCaf_WeightedEdge *edge = &weightedEdges[i];
+        if (edge->rejected) {
+            stList_append(edgesToDelete, stIntTuple_construct3(edge->weight,
+                    stIntTuple_get(stList_get(nodes, edge->node1), 0), stIntTuple_get(stList_get(nodes, edge->node2), 0)));
         }
-        stSortedSet_destruct(component2);
-        totalComponents -= 1;
     }
+    assert(stList_length(edgesToDelete) == rejectedEdges);
+    free(weightedEdges);
 
     st_logDebug(
-            "We broke a graph with %" PRIi64 " nodes and %" PRIi64 " edges for a max component size of %" PRIi64 " into %" PRIi64 " distinct components with %" PRIi64 " edges, discarding %" PRIi64 " edges\n",
-            stList_length(nodes), stList_length(edges), maxComponentSize, totalComponents,
-            stList_length(edges) - stList_length(edgesToDelete), stList_length(edgesToDelete));
-
-    //Cleanup
-    stList_destruct(sortedEdges);
-    stList *components = stHash_getValues(nodeToComponents);
-    stSortedSet *componentsSet = stList_getSortedSet(components, NULL);
-    stList_destruct(components);
-    stSortedSet_setDestructor(componentsSet, (void(*)(void *)) stSortedSet_destruct);
-    stSortedSet_destruct(componentsSet);
-    stHash_destruct(nodeToComponents);
+            "We broke a graph with %" PRIi64 " nodes and %" PRIi64 " edges for a max component size of %" PRIi64 ", discarding %" PRIi64 " edges\n",
+            stList_length(nodes), stList_length(edges), maxComponentSize, rejectedEdges);
 
     return edgesToDelete;
 }
 
-static void convertToNodesAndEdges(stList *adjacencyComponent, stList **nodes, stList **edges) {
-    //Make nodes
-    *nodes = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+static int nodePair_cmp(const int64_t *pair1, const int64_t *pair2) {
+    if (pair1[0] != pair2[0]) {
+        return pair1[0] < pair2[0] ? -1 : 1;
+    }
+    return pair1[1] < pair2[1] ? -1 : (pair1[1] > pair2[1] ? 1 : 0);
+}
+
+static stCaf_WeightedEdge *convertToEdges(stList *adjacencyComponent, int64_t *edgeNumber) {
+    /*
+     * The nodes are the indices of the pinch ends in the adjacency component. Each edge is weighted by
+     * the number of adjacencies between its ends, counting each from both of its ends.
+     */
     stHash *pinchEndsToNodesHash = stHash_construct3(stPinchEnd_hashFn, stPinchEnd_equalsFn, NULL, NULL);
     for (int64_t i = 0; i < stList_length(adjacencyComponent); i++) {
-        stIntTuple *node = stIntTuple_construct1(i);
-        stList_append(*nodes, node);
         assert(stHash_search(pinchEndsToNodesHash, stList_get(adjacencyComponent, i)) == NULL);
-        stHash_insert(pinchEndsToNodesHash, stList_get(adjacencyComponent, i), node);
+        stHash_insert(pinchEndsToNodesHash, stList_get(adjacencyComponent, i), (void *) (intptr_t) (i + 1)); //Offset by one, so no node is NULL
     }
-    //Make edges
 
-    //First build a hash of edges to their multiplicity
-    stHash *edgesToMultiplicityHash = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
-            (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct,
-            (void(*)(void *)) stIntTuple_destruct);
+    //First list every adjacency as an ordered pair of nodes
+    int64_t pairNumber = 0, maxPairNumber = 16;
+    int64_t (*pairs)[2] = st_malloc(sizeof(int64_t) * 2 * maxPairNumber);
     for (int64_t i = 0; i < stList_length(adjacencyComponent); i++) {
         stPinchEnd *pinchEnd1 = stList_get(adjacencyComponent, i);
-        int64_t node1 = stIntTuple_get(stHash_search(pinchEndsToNodesHash, pinchEnd1), 0);
+        int64_t node1 = i;
         stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(stPinchEnd_getBlock(pinchEnd1));
         stPinchSegment *segment;
         while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
@@ -117,17 +177,15 @@ static void convertToNodesAndEdges(stList *adjacencyComponent, stList **nodes, s
                     stPinchEnd pinchEnd2 = stPinchEnd_constructStatic(stPinchSegment_getBlock(segment2),
                             stPinchEnd_endOrientation(traverse5Prime, segment2));
                     assert(stHash_search(pinchEndsToNodesHash, &pinchEnd2) != NULL);
-                    int64_t node2 = stIntTuple_get(stHash_search(pinchEndsToNodesHash, &pinchEnd2), 0);
+                    int64_t node2 = (intptr_t) stHash_search(pinchEndsToNodesHash, &pinchEnd2) - 1;
                     if (node1 != node2) { //Ignore self edges
-                        stIntTuple *edge = node1 < node2 ? stIntTuple_construct2(node1, node2) : stIntTuple_construct2(node2, node1);
-                        int64_t multiplicity = 1;
-                        if (stHash_search(edgesToMultiplicityHash, edge) != NULL) {
-                            stIntTuple *count = stHash_removeAndFreeKey(edgesToMultiplicityHash, edge);
-                            multiplicity += stIntTuple_get(count, 0);
-                            stIntTuple_destruct(count);
-                            assert(multiplicity > 1);
+                        if (pairNumber == maxPairNumber) {
+                            maxPairNumber *= 2;
+                            pairs = st_realloc(pairs, sizeof(int64_t) * 2 * maxPairNumber);
                         }
-                        stHash_insert(edgesToMultiplicityHash, edge, stIntTuple_construct1(multiplicity));
+                        pairs[pairNumber][0] = node1 < node2 ? node1 : node2;
+                        pairs[pairNumber][1] = node1 < node2 ? node2 : node1;
+                        pairNumber++;
                     }
                     break;
                 }
@@ -135,18 +193,26 @@ static void convertToNodesAndEdges(stList *adjacencyComponent, stList **nodes, s
             }
         }
     }
+    stHash_destruct(pinchEndsToNodesHash);
+
     //Now build edges, scoring them according to their multiplicity
-    *edges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
-    stHashIterator *hashIt = stHash_getIterator(edgesToMultiplicityHash);
-    stIntTuple *edge;
-    while ((edge = stHash_getNext(hashIt)) != NULL) {
-        stIntTuple *count = stHash_search(edgesToMultiplicityHash, edge);
-        stList_append(*edges, stIntTuple_construct3(stIntTuple_get(count, 0), stIntTuple_get(edge, 0), stIntTuple_get(edge, 1)));
+    qsort(pairs, pairNumber, sizeof(int64_t) * 2, (int (*)(const void *, const void *)) nodePair_cmp);
+    stCaf_WeightedEdge *edges = st_malloc(sizeof(stCaf_WeightedEdge) * (pairNumber + 1));
+    *edgeNumber = 0;
+    for (int64_t i = 0; i < pairNumber;) {
+        int64_t j = i + 1;
+        while (j < pairNumber && nodePair_cmp(pairs[i], pairs[j]) == 0) {
+            j++;
+        }
+        edges[*edgeNumber].weight = j - i;
+        edges[*edgeNumber].node1 = pairs[i][0];
+        edges[*edgeNumber].node2 = pairs[i][1];
+        edges[*edgeNumber].rejected = 0;
+        (*edgeNumber)++;
+        i = j;
     }
-
-    //Cleanup
-    stHash_destruct(pinchEndsToNodesHash);
-    stHash_destruct(edgesToMultiplicityHash);
+    free(pairs);
+    return edges;
 }
 
 static void breakEdges(stPinchThreadSet *threadSet, stPinchEnd *pinchEnd1, stPinchEnd *pinchEnd2) {
@@ -196,17 +262,21 @@ void stCaf_breakupComponentsGreedily(stPinchThreadSet *threadSet, float maximumA
         stList *adjacencyComponent = stList_get(adjacencyComponents, i);
         if (maximumAdjacencyComponentSize < stList_length(adjacencyComponent)) {
             //Get graph description
-            stList *nodes, *edges;
-            convertToNodesAndEdges(adjacencyComponent, &nodes, &edges);
+            int64_t edgeNumber;
+            stCaf_WeightedEdge *edges = convertToEdges(adjacencyComponent, &edgeNumber);
             //Get the edges to remove
-            stList *edgesToDelete = stCaf_breakupComponentGreedily(nodes, edges, maximumAdjacencyComponentSize);
-            //Break edges;
+            int64_t edgesToDelete = stCaf_breakupComponentGreedily2(stList_length(adjacencyComponent), edges, edgeNumber,
+                    maximumAdjacencyComponentSize);
+            //Break edges, in the order they were rejected, best first
             int64_t unbrokenEdges = 0;
-            for (int64_t j = 0; j < stList_length(edgesToDelete); j++) {
-                stIntTuple *edge = stList_get(edgesToDelete, j);
-                assert(stIntTuple_get(edge, 1) < stIntTuple_get(edge, 2));
-                stPinchEnd *pinchEnd1 = stList_get(adjacencyComponent, stIntTuple_get(edge, 1));
-                stPinchEnd *pinchEnd2 = stList_get(adjacencyComponent, stIntTuple_get(edge, 2));
+            for (int64_t j = edgeNumber - 1; j >= 0; j--) {
+                stCaf_WeightedEdge *edge = &edges[j];
+                if (!edge->rejected) {
+                    continue;
+                }
+                assert(edge->node1 < edge->node2);
+                stPinchEnd *pinchEnd1 = stList_get(adjacencyComponent, edge->node1);
+                stPinchEnd *pinchEnd2 = stList_get(adjacencyComponent, edge->node2);
                 if (stPinchBlock_getDegree(stPinchEnd_getBlock(pinchEnd1)) > 1 && stPinchBlock_getDegree(stPinchEnd_getBlock(pinchEnd2))
                         > 1) {
                     breakEdges(threadSet, pinchEnd1, pinchEnd2);
@@ -214,14 +284,12 @@ void stCaf_breakupComponentsGreedily(stPinchThreadSet *threadSet, float maximumA
                     unbrokenEdges++;
                 }
             }
-            if (stList_length(edgesToDelete) > 0) {
+            if (edgesToDelete > 0) {
                 printf("Pinch graph component with %" PRIi64 " nodes and %" PRIi64 " edges is being split up by breaking %" PRIi64 " edges to reduce size to less than %" PRIi64 " max, but found %" PRIi64 " pointless edges \n",
-                    stList_length(nodes), stList_length(edges), stList_length(edgesToDelete), maximumAdjacencyComponentSize, unbrokenEdges);
+                    stList_length(adjacencyComponent), edgeNumber, edgesToDelete, maximumAdjacencyComponentSize, unbrokenEdges);
             }
             //Cleanup
-            stList_destruct(edges);
-            stList_destruct(nodes);
-            stList_destruct(edgesToDelete);
+            free(edges);
         }
     }
     stList_destruct(adjacencyComponents);
@@ -12,6 +12,24 @@
 #include "sonLib.h"
 #include "pairwiseAlignment.h"
 #include "blastAlignmentLib.h"
+#include "stPinchGraphs.h"
+#include "stPinchIterator.h"
+#include <pthread.h>
+
+static char *getSelfAlignmentCommand(const char *lastzArgs, bool realign, const char *realignArgs,
+        const char *sequencesFile) {
+    if(realign) {
+        return stString_print(
+                "cPecanLastz --format=cigar %s %s[multiple][nameparse=darkspace] %s[nameparse=darkspace] --notrivial | cPecanRealign %s %s",
+                lastzArgs, sequencesFile, sequencesFile, realignArgs, sequencesFile);
+    }
+    //return stString_print(
+    //        "cPecanLastz --format=cigar %s %s[multiple][nameparse=darkspace] --self",
+    //        lastzArgs, sequencesFile);
+    return stString_print(
+            "cPecanLastz --format=cigar %s %s[multiple][nameparse=darkspace] %s[nameparse=darkspace] --notrivial",
+            lastzArgs, sequencesFile, sequencesFile);
+}
 
 stList *stCaf_selfAlignFlower(Flower *flower, int64_t minimumSequenceLength, const char *lastzArgs,
         bool realign, const char *realignArgs,
@@ -25,20 +43,7 @@ stList *stCaf_selfAlignFlower(Flower *flower, int64_t minimumSequenceLength, con
         /*
          * Run lastz.
          */
-        char *command = NULL;
-        if(realign) {
-            command = stString_print(
-                                "cPecanLastz --format=cigar %s %s[multiple][nameparse=darkspace] %s[nameparse=darkspace] --notrivial | cPecanRealign %s %s",
-                                lastzArgs, tempFile1, tempFile1, realignArgs, tempFile1);
-        }
-        else {
-            command = stString_print(
-                    "cPecanLastz --format=cigar %s %s[multiple][nameparse=darkspace] %s[nameparse=darkspace] --notrivial",
-                    lastzArgs, tempFile1, tempFile1);
-        }
-        //char *command = stString_print(
-        //        "cPecanLastz --format=cigar %s %s[multiple][nameparse=darkspace] --self",
-        //        lastzArgs, tempFile1);
+        char *command = getSelfAlignmentCommand(lastzArgs, realign, realignArgs, tempFile1);
         FILE *fileHandle = popen(command, "r");
         if (fileHandle == NULL) {
             st_errAbort("Problems with lastz pipe");
@@ -64,6 +69,201 @@ stList *stCaf_selfAlignFlower(Flower *flower, int64_t minimumSequenceLength, con
     return cigars;
 }
 
+/*
+ * A stream of the pinches of the alignments written by a command. A thread reads the alignments from the command
+ * as it produces them, keeping just their pinches, while the iterator hands the pinches out, waiting for more as
+ * needed. Once the command has finished the pinches can be iterated over again, optionally ordered by the score
+ * of their alignments.
+ */
+
+typedef struct _alignmentRecord {
+    double score;
+    int64_t firstPinch;
+    int64_t pinchNumber;
+} AlignmentRecord;
+
+typedef struct _alignmentStream {
+    char *command;
+    FILE *fileHandle;
+    bool convertCoordinates;
+    bool sortByScore;
+    pthread_t thread;
+    bool threadStarted;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    //Added to by the reading thread, holding the lock.
+    stPinch *pinches;
+    int64_t pinchNumber;
+    int64_t pinchCapacity;
+    AlignmentRecord *alignments;
+    int64_t alignmentNumber;
+    int64_t alignmentCapacity;
+    bool finished;
+    //Used by the iterator.
+    bool sorted;
+    int64_t alignmentIndex;
+    int64_t pinchIndex;
+    stPinch pinch;
+} AlignmentStream;
+
+static void alignmentStream_addAlignment(AlignmentStream *stream, double score, stList *pinches) {
+    pthread_mutex_lock(&stream->lock);
+    if (stream->pinchNumber + stList_length(pinches) > stream->pinchCapacity) {
+        stream->pinchCapacity = (stream->pinchNumber + stList_length(pinches)) * 2;
+        stream->pinches = st_realloc(stream->pinches, sizeof(stPinch) * stream->pinchCapacity);
+    }
+    if (stream->alignmentNumber == stream->alignmentCapacity) {
+        stream->alignmentCapacity = stream->alignmentCapacity * 2 + 1;
+        stream->alignments = st_realloc(stream->alignments, sizeof(AlignmentRecord) * stream->alignmentCapacity);
+    }
+    AlignmentRecord *alignment = &stream->alignments[stream->alignmentNumber++];
+    alignment->score = score;
+    alignment->firstPinch = stream->pinchNumber;
+    alignment->pinchNumber = stList_length(pinches);
+    for (int64_t i = 0; i < stList_length(pinches); i++) {
+        stream->pinches[stream->pinchNumber++] = *(stPinch *) stList_get(pinches, i);
+    }
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+static void *alignmentStream_read(void *arg) {
+    AlignmentStream *stream = arg;
+    struct PairwiseAlignment *pairwiseAlignment;
+    while ((pairwiseAlignment = cigarRead(stream->fileHandle)) != NULL) {
+        if (stream->convertCoordinates) {
+            convertCoordinatesOfPairwiseAlignment(pairwiseAlignment, TRUE, TRUE);
+        }
+        stList *pinches = stPinchIterator_getPinchesOfPairwiseAlignment(pairwiseAlignment);
+        if (stList_length(pinches) > 0) {
+            alignmentStream_addAlignment(stream, pairwiseAlignment->score, pinches);
+        }
+        stList_destruct(pinches);
+        destructPairwiseAlignment(pairwiseAlignment);
+    }
+    int i = pclose(stream->fileHandle);
+    if (i != 0) {
+        st_errAbort("Lastz failed: %s\n", stream->command);
+    }
+    pthread_mutex_lock(&stream->lock);
+    stream->finished = 1;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+static int alignmentRecord_cmpByScore(const void *a, const void *b) {
+    //Alignments with equal scores keep the order they were read in.
+    const AlignmentRecord *i = a, *j = b;
+    if (i->score != j->score) {
+        return i->score > j->score ? -1 : 1;
+    }
+    return i->firstPinch < j->firstPinch ? -1 : (i->firstPinch > j->firstPinch ? 1 : 0);
+}
+
+static void alignmentStream_waitUntilFinished(AlignmentStream *stream) {
+    if (!stream->sorted) {
+        pthread_mutex_lock(&stream->lock);
+        while (!stream->finished) {
+            pthread_cond_wait(&stream->cond, &stream->lock);
+        }
+        pthread_mutex_unlock(&stream->lock);
+        qsort(stream->alignments, stream->alignmentNumber, sizeof(AlignmentRecord), alignmentRecord_cmpByScore);
+        stream->sorted = 1;
+    }
+}
+
+static stPinch *alignmentStream_getNext(AlignmentStream *stream) {
+    if (stream->sortByScore) {
+        alignmentStream_waitUntilFinished(stream);
+        while (stream->alignmentIndex < stream->alignmentNumber) {
+            AlignmentRecord *alignment = &stream->alignments[stream->alignmentIndex];
+            if (stream->pinchIndex < alignment->pinchNumber) {
+                stream->pinch = stream->pinches[alignment->firstPinch + stream->pinchIndex++];
+                return &stream->pinch;
+            }
+            stream->alignmentIndex++;
+            stream->pinchIndex = 0;
+        }
+        return NULL;
+    }
+    pthread_mutex_lock(&stream->lock);
+    while (stream->pinchIndex == stream->pinchNumber && !stream->finished) {
+        pthread_cond_wait(&stream->cond, &stream->lock);
+    }
+    stPinch *pinch = NULL;
+    if (stream->pinchIndex < stream->pinchNumber) {
+        stream->pinch = stream->pinches[stream->pinchIndex++];
+        pinch = &stream->pinch;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return pinch;
+}
+
+static bool alignmentStream_isNextReady(AlignmentStream *stream) {
+    if (stream->sortByScore) { //Only the first pinch waits, for the command to finish.
+        return stream->sorted;
+    }
+    pthread_mutex_lock(&stream->lock);
+    bool isNextReady = stream->pinchIndex < stream->pinchNumber || stream->finished;
+    pthread_mutex_unlock(&stream->lock);
+    return isNextReady;
+}
+
+static AlignmentStream *alignmentStream_reset(AlignmentStream *stream) {
+    stream->alignmentIndex = 0;
+    stream->pinchIndex = 0;
+    return stream;
+}
+
+static void alignmentStream_destruct(AlignmentStream *stream) {
+    if (stream->threadStarted) {
+        pthread_join(stream->thread, NULL);
+    }
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->cond);
+    free(stream->pinches);
+    free(stream->alignments);
+    free(stream->command);
+    free(stream);
+}
+
+stPinchIterator *stCaf_streamAlignmentsFromCommand(const char *command, bool convertCoordinates, bool sortByScore) {
+    AlignmentStream *stream = st_calloc(1, sizeof(AlignmentStream));
+    stream->convertCoordinates = convertCoordinates;
+    stream->sortByScore = sortByScore;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    if (command == NULL) {
+        stream->finished = 1;
+    } else {
+        stream->command = stString_copy(command);
+        stream->fileHandle = popen(command, "r");
+        if (stream->fileHandle == NULL) {
+            st_errAbort("Problems with lastz pipe");
+        }
+        if (pthread_create(&stream->thread, NULL, alignmentStream_read, stream) != 0) {
+            st_errAbort("Could not start a thread to read alignments from: %s\n", command);
+        }
+        stream->threadStarted = 1;
+    }
+    stPinchIterator *pinchIterator = stPinchIterator_construct(stream, (stPinch *(*)(void *)) alignmentStream_getNext,
+            (void *(*)(void *)) alignmentStream_reset, (void (*)(void *)) alignmentStream_destruct);
+    stPinchIterator_setIsNextReady(pinchIterator, (bool (*)(void *)) alignmentStream_isNextReady);
+    return pinchIterator;
+}
+
+stPinchIterator *stCaf_selfAlignFlowerAsStream(Flower *flower, int64_t minimumSequenceLength, const char *lastzArgs,
+        bool realign, const char *realignArgs, bool sortByScore, char *tempFile1) {
+    if (writeFlowerSequencesInFile(flower, tempFile1, minimumSequenceLength) == 0) {
+        return stCaf_streamAlignmentsFromCommand(NULL, 1, sortByScore);
+    }
+    char *command = getSelfAlignmentCommand(lastzArgs, realign, realignArgs, tempFile1);
+    stPinchIterator *pinchIterator = stCaf_streamAlignmentsFromCommand(command, 1, sortByScore);
+    free(command);
+    return pinchIterator;
+}
+
 static int compareByScore(struct PairwiseAlignment *pA, struct PairwiseAlignment *pA2) {
     return pA->score == pA2->score ? 0 : (pA->score > pA2->score ? -1 : 1);
 }
@@ -142,6 +142,205 @@ void stCaf_melt(Flower *flower, stPinchThreadSet *threadSet, bool blockFilterfn(
     stCaf_joinTrivialBoundaries(threadSet);
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Melting in rounds of increasing minimum chain length
+///////////////////////////////////////////////////////////////////////////
+
+/*
+ * Removing a chain from the pinch graph contracts its cycle in the cactus graph to a single node,
+ * leaving every other chain, and its length, as it was. So the chains of one cactus graph, sorted
+ * by length, serve for a whole sequence of melting rounds, each removing the next shortest chains.
+ * Trivial boundaries are only joined after the last round, as joining only merges blocks within
+ * a chain.
+ *
+ * The exception is the top level flower, where every thread component must be attached to the dead
+ * end component. If removing chains splits off a thread component that has no attached thread, a new
+ * thread would be attached, changing the cactus graph, so the graph is then rebuilt.
+ */
+
+typedef struct _meltingChain {
+    int64_t length;
+    int64_t firstBlock; //Index of the chain's first block in the list of blocks.
+    int64_t blockNumber;
+} MeltingChain;
+
+typedef struct _meltingGraph {
+    Flower *flower;
+    stPinchThreadSet *threadSet;
+    stList *blocks; //The blocks of the chains, other than the thread ends, grouped by chain.
+    MeltingChain *chains; //In increasing order of length.
+    int64_t chainNumber;
+    int64_t nextChain; //The chains before this have been melted.
+    stSet *attachedThreads; //The threads attached to the dead end component, if the flower is the top level flower.
+} MeltingGraph;
+
+static int meltingChain_cmpByLength(const void *a, const void *b) {
+    const MeltingChain *i = a, *j = b;
+    return i->length < j->length ? -1 : (i->length > j->length ? 1 : 0);
+}
+
+static void meltingGraph_build(MeltingGraph *meltingGraph) {
+    stCactusNode *startCactusNode;
+    stList *deadEndComponent;
+    stCactusGraph *cactusGraph = stCaf_getCactusGraphForThreadSet(meltingGraph->flower, meltingGraph->threadSet,
+            &startCactusNode, &deadEndComponent, 0, INT64_MAX, 0.0, 0, INT64_MAX);
+    meltingGraph->blocks = stList_construct();
+    int64_t chainCapacity = 16;
+    meltingGraph->chains = st_malloc(sizeof(MeltingChain) * chainCapacity);
+    meltingGraph->chainNumber = 0;
+    meltingGraph->nextChain = 0;
+    stCactusGraphNodeIt *nodeIt = stCactusGraphNodeIterator_construct(cactusGraph);
+    stCactusNode *cactusNode;
+    while ((cactusNode = stCactusGraphNodeIterator_getNext(nodeIt)) != NULL) {
+        stCactusNodeEdgeEndIt cactusEdgeEndIt = stCactusNode_getEdgeEndIt(cactusNode);
+        stCactusEdgeEnd *cactusEdgeEnd;
+        while ((cactusEdgeEnd = stCactusNodeEdgeEndIt_getNext(&cactusEdgeEndIt)) != NULL) {
+            if (stCactusEdgeEnd_isChainEnd(cactusEdgeEnd) && stCactusEdgeEnd_getLinkOrientation(cactusEdgeEnd)) {
+                if (meltingGraph->chainNumber == chainCapacity) {
+                    chainCapacity *= 2;
+                    meltingGraph->chains = st_realloc(meltingGraph->chains, sizeof(MeltingChain) * chainCapacity);
+                }
+                MeltingChain *chain = &meltingGraph->chains[meltingGraph->chainNumber++];
+                chain->length = getChainLength(cactusEdgeEnd);
+                chain->firstBlock = stList_length(meltingGraph->blocks);
+                processChain(cactusEdgeEnd, addBlock, meltingGraph->blocks, 0);
+                chain->blockNumber = stList_length(meltingGraph->blocks) - chain->firstBlock;
+            }
+        }
+    }
+    stCactusGraphNodeIterator_destruct(nodeIt);
+    qsort(meltingGraph->chains, meltingGraph->chainNumber, sizeof(MeltingChain), meltingChain_cmpByLength);
+
+    //Only the top level flower has thread components attached to the dead end component
+    meltingGraph->attachedThreads = NULL;
+    if (flower_getName(meltingGraph->flower) == 0) {
+        meltingGraph->attachedThreads = stSet_construct();
+        for (int64_t i = 0; i < stList_length(deadEndComponent); i++) {
+            stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(stPinchEnd_getBlock(stList_get(deadEndComponent, i)));
+            stPinchSegment *segment;
+            while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+                stSet_insert(meltingGraph->attachedThreads, stPinchSegment_getThread(segment));
+            }
+        }
+    }
+    stCactusGraph_destruct(cactusGraph);
+}
+
+static void meltingGraph_clear(MeltingGraph *meltingGraph) {
+    stList_destruct(meltingGraph->blocks);
+    free(meltingGraph->chains);
+    if (meltingGraph->attachedThreads != NULL) {
+        stSet_destruct(meltingGraph->attachedThreads);
+    }
+}
+
+static bool threadComponentIsAttached(stPinchThread *thread, stSet *attachedThreads, stSet *threadsSeen) {
+    /*
+     * Searches the thread component containing the thread for an attached thread, stopping at the first found.
+     * The threads searched are added to threadsSeen.
+     */
+    stList *stack = stList_construct();
+    stList_append(stack, thread);
+    stSet_insert(threadsSeen, thread);
+    bool attached = 0;
+    while (stList_length(stack) > 0) {
+        thread = stList_pop(stack);
+        if (stSet_search(attachedThreads, thread) != NULL) {
+            attached = 1;
+            break;
+        }
+        stPinchSegment *segment = stPinchThread_getFirst(thread);
+        while (segment != NULL) {
+            stPinchBlock *block = stPinchSegment_getBlock(segment);
+            if (block != NULL) {
+                stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(block);
+                stPinchSegment *segment2;
+                while ((segment2 = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+                    stPinchThread *thread2 = stPinchSegment_getThread(segment2);
+                    if (stSet_search(threadsSeen, thread2) == NULL) {
+                        stSet_insert(threadsSeen, thread2);
+                        stList_append(stack, thread2);
+                    }
+                }
+            }
+            segment = stPinchSegment_get3Prime(segment);
+        }
+    }
+    stList_destruct(stack);
+    return attached;
+}
+
+static bool allThreadComponentsAttached(stSet *threads, stSet *attachedThreads) {
+    /*
+     * Returns non-zero if each of the threads is in a thread component with an attached thread.
+     */
+    stSet *threadsSeen = stSet_construct();
+    bool attached = 1;
+    stSetIterator *threadIt = stSet_getIterator(threads);
+    stPinchThread *thread;
+    while (attached && (thread = stSet_getNext(threadIt)) != NULL) {
+        if (stSet_search(threadsSeen, thread) == NULL) { //Threads seen are all in attached components
+            attached = threadComponentIsAttached(thread, attachedThreads, threadsSeen);
+        }
+    }
+    stSet_destructIterator(threadIt);
+    stSet_destruct(threadsSeen);
+    return attached;
+}
+
+static void meltingGraph_melt(MeltingGraph *meltingGraph, int64_t minimumChainLength) {
+    stList *blocksToDelete = stList_construct3(0, (void(*)(void *)) stPinchBlock_destruct);
+    while (meltingGraph->nextChain < meltingGraph->chainNumber
+            && meltingGraph->chains[meltingGraph->nextChain].length < minimumChainLength) {
+        MeltingChain *chain = &meltingGraph->chains[meltingGraph->nextChain++];
+        for (int64_t i = 0; i < chain->blockNumber; i++) {
+            stList_append(blocksToDelete, stList_get(meltingGraph->blocks, chain->firstBlock + i));
+        }
+    }
+
+    printf("A melting round is destroying %" PRIi64 " blocks with an average degree "
+           "of %lf from chains with length less than %" PRIi64 ". Total aligned bases"
+           " lost: %" PRIu64 "\n",
+           stList_length(blocksToDelete), stCaf_averageBlockDegree(blocksToDelete),
+           minimumChainLength, stCaf_totalAlignedBases(blocksToDelete));
+
+    //Get the threads whose components may be split
+    stSet *threads = stSet_construct();
+    if (meltingGraph->attachedThreads != NULL) {
+        for (int64_t i = 0; i < stList_length(blocksToDelete); i++) {
+            stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(stList_get(blocksToDelete, i));
+            stPinchSegment *segment;
+            while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+                stSet_insert(threads, stPinchSegment_getThread(segment));
+            }
+        }
+    }
+    stList_destruct(blocksToDelete); //This will destroy the blocks
+
+    if (stSet_size(threads) > 0 && !allThreadComponentsAttached(threads, meltingGraph->attachedThreads)) {
+        st_logDebug("Rebuilding the cactus graph for melting as a thread component has become unattached\n");
+        meltingGraph_clear(meltingGraph);
+        meltingGraph_build(meltingGraph);
+    }
+    stSet_destruct(threads);
+}
+
+void stCaf_meltInRounds(Flower *flower, stPinchThreadSet *threadSet, int64_t *minimumChainLengths, int64_t roundNumber) {
+    if (roundNumber > 0) {
+        MeltingGraph meltingGraph;
+        meltingGraph.flower = flower;
+        meltingGraph.threadSet = threadSet;
+        meltingGraph_build(&meltingGraph);
+        for (int64_t i = 0; i < roundNumber; i++) {
+            st_logDebug("Starting melting round with a minimum chain length of %" PRIi64 " \n", minimumChainLengths[i]);
+            meltingGraph_melt(&meltingGraph, minimumChainLengths[i]);
+        }
+        meltingGraph_clear(&meltingGraph);
+        //Now heal up the trivial boundaries
+        stCaf_joinTrivialBoundaries(threadSet);
+    }
+}
+
 static bool isTelomere(stPinchEnd *end, stSet *deadEndComponent) {
     stPinchSegment *segment = stPinchBlock_getFirst(end->block);
     bool atEndOfThread = stPinchThread_getFirst(stPinchSegment_getThread(segment)) == segment || stPinchThread_getLast(stPinchSegment_getThread(segment)) == segment;
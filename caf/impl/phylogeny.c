@@ -18,7 +18,7 @@
 // just in case we ever need to run in parallel on sub-flowers or
 // something weird.
 typedef struct {
-    stHash *threadStrings;
+    stCaf_ThreadStringProvider *threadStrings;
     stSet *outgroupThreads;
     Flower *flower;
     stCaf_PhylogenyParameters *params;
@@ -35,6 +35,8 @@ typedef struct {
     HomologyUnit *homologyUnit;
     TreeBuildingConstants *constants;
     stHash *homologyUnitsToTrees;
+    stTree *oldTree; // The tree the unit had before, if any.
+    stSortedSet *splitBranches;
 } TreeBuildingInput;
 
 // Gets returned from buildTreeForHomologyUnit and passed into
@@ -45,6 +47,12 @@ typedef struct {
     HomologyUnit *homologyUnit;
     bool wasSimple;
     bool wasSingleCopy;
+    stSortedSet *splitBranches;
+    // The split branches of the old tree, to remove from
+    // splitBranches, and of the new tree, to add to it. These are
+    // found by the worker so the finisher only has to merge them.
+    stSortedSet *oldSplitBranches;
+    stSortedSet *newSplitBranches;
 } TreeBuildingResult;
 
 // Globals for collecting statistics that are later output.  Globals
@@ -870,6 +878,29 @@ static void getSpeciesToSplitOn(stTree *speciesTree, EventTree *eventTree,
     } while (aSpeciesToSplitOn != NULL);
 }
 
+// Get the thread strings the feature blocks of the unit can need,
+// which must be released with stCaf_ThreadStringProvider_releaseStrings.
+static stHash *getStringsForHomologyUnit(HomologyUnit *unit,
+                                         stCaf_ThreadStringProvider *threadStrings,
+                                         int64_t maxBaseDistance,
+                                         int64_t maxBlockDistance,
+                                         bool ignoreUnalignedBases,
+                                         bool fillBases) {
+    stHash *(*getStrings)(stCaf_ThreadStringProvider *, stList *, int64_t, int64_t, bool) =
+        fillBases ? stCaf_ThreadStringProvider_getStrings : stCaf_ThreadStringProvider_getUnfilledStrings;
+    stHash *strings;
+    if (unit->unitType == BLOCK) {
+        stList *blocks = stList_construct();
+        stList_append(blocks, unit->unit);
+        strings = getStrings(threadStrings, blocks, maxBaseDistance, maxBlockDistance, ignoreUnalignedBases);
+        stList_destruct(blocks);
+    } else {
+        assert(unit->unitType == CHAIN);
+        strings = getStrings(threadStrings, unit->unit, maxBaseDistance, maxBlockDistance, ignoreUnalignedBases);
+    }
+    return strings;
+}
+
 // Add any homology units close enough to the given block to be
 // affected by its breakpoint information to the given set.
 static void addContextualHomologyUnitsToSet(HomologyUnit *unit,
@@ -877,9 +908,14 @@ static void addContextualHomologyUnitsToSet(HomologyUnit *unit,
                                             int64_t maxBlockDistance,
                                             bool ignoreUnalignedBases,
                                             bool onlyIncludeCompleteFeatureBlocks,
-                                            stHash *strings,
+                                            stCaf_ThreadStringProvider *threadStrings,
                                             stHash *blocksToHomologyUnits,
                                             stSet *contextualHomologyUnits) {
+    // Finding the contextual blocks only walks the pinch graph: the
+    // feature segments it builds point into the strings but their bases
+    // are never read, so they are not fetched.
+    stHash *strings = getStringsForHomologyUnit(unit, threadStrings, maxBaseDistance,
+                                                maxBlockDistance, ignoreUnalignedBases, 0);
     stList *contextualBlocks;
     if (unit->unitType == BLOCK) {
         contextualBlocks = stFeatureBlock_getContextualBlocks(
@@ -898,6 +934,7 @@ static void addContextualHomologyUnitsToSet(HomologyUnit *unit,
         stSet_insert(contextualHomologyUnits, contextualUnit);
     }
     stList_destruct(contextualBlocks);
+    stCaf_ThreadStringProvider_releaseStrings(strings);
 }
 
 // Remove any split branches that appear in this tree from the
@@ -938,17 +975,32 @@ static double getAvgSupportValue(stSortedSet *splitBranches) {
     return totalSupport/stSortedSet_size(splitBranches);
 }
 
-// Small wrapper function to tell the pool to build, reconcile, and
-// bootstrap a tree for a homology unit.
-static void pushHomologyUnitToPool(HomologyUnit *unit,
-                                   TreeBuildingConstants *constants,
-                                   stHash *homologyUnitsToTrees,
-                                   stThreadPool *threadPool) {
-    TreeBuildingInput *input = st_malloc(sizeof(TreeBuildingInput));
-    input->constants = constants;
-    input->homologyUnit = unit;
-    input->homologyUnitsToTrees = homologyUnitsToTrees;
-    stThreadPool_push(threadPool, input);
+// Tells the pool to build, reconcile, and bootstrap a tree for each
+// homology unit in the set. The pool must be idle: the old trees are
+// all looked up before the first unit is pushed, as the finisher
+// changes the hash as soon as the workers start returning trees.
+static void pushHomologyUnitsToPool(stSet *units,
+                                    TreeBuildingConstants *constants,
+                                    stHash *homologyUnitsToTrees,
+                                    stSortedSet *splitBranches,
+                                    stThreadPool *threadPool) {
+    stList *inputs = stList_construct();
+    stSetIterator *unitIt = stSet_getIterator(units);
+    HomologyUnit *unit;
+    while ((unit = stSet_getNext(unitIt)) != NULL) {
+        TreeBuildingInput *input = st_malloc(sizeof(TreeBuildingInput));
+        input->constants = constants;
+        input->homologyUnit = unit;
+        input->homologyUnitsToTrees = homologyUnitsToTrees;
+        input->oldTree = stHash_search(homologyUnitsToTrees, unit);
+        input->splitBranches = splitBranches;
+        stList_append(inputs, input);
+    }
+    stSet_destructIterator(unitIt);
+    for (int64_t i = 0; i < stList_length(inputs); i++) {
+        stThreadPool_push(threadPool, stList_get(inputs, i));
+    }
+    stList_destruct(inputs);
 }
 
 static stTree *chooseBestAndMostResolvedTree(stList *trees,
@@ -984,29 +1036,27 @@ static stTree *chooseBestAndMostResolvedTree(stList *trees,
     return bestTree;
 }
 
-// Gets run as a worker in a thread.
-static TreeBuildingResult *buildTreeForHomologyUnit(TreeBuildingInput *input) {
+// Builds the tree for the unit of the input, filling in the result.
+static void buildTreeForHomologyUnit2(TreeBuildingInput *input, TreeBuildingResult *ret) {
     HomologyUnit *unit = input->homologyUnit;
     stCaf_PhylogenyParameters *params = input->constants->params;
 
-    TreeBuildingResult *ret = st_calloc(1, sizeof(TreeBuildingResult));
-    ret->homologyUnitsToTrees = input->homologyUnitsToTrees;
-    ret->homologyUnit = unit;
-
     if (stCaf_hasSimplePhylogeny(unit, input->constants->flower)) {
         // No point trying to build a phylogeny for certain blocks.
-        free(input);
         ret->wasSimple = true;
-        return ret;
+        return;
     }
     if (stCaf_isSingleCopy(unit, input->constants->flower)
         && params->skipSingleCopyBlocks) {
         ret->wasSingleCopy = true;
-        free(input);
-        return ret;
+        return;
     }
 
-    // Get the feature blocks.
+    // Get the feature blocks, from just the bases around the unit.
+    stHash *strings = getStringsForHomologyUnit(unit, input->constants->threadStrings,
+                                                params->maxBaseDistance,
+                                                params->maxBlockDistance,
+                                                params->ignoreUnalignedBases, 1);
     stList *featureBlocks;
 
     if (unit->unitType == BLOCK) {
@@ -1015,7 +1065,7 @@ static TreeBuildingResult *buildTreeForHomologyUnit(TreeBuildingInput *input) {
             params->maxBlockDistance,
             params->ignoreUnalignedBases,
             params->onlyIncludeCompleteFeatureBlocks,
-            input->constants->threadStrings);
+            strings);
     } else {
         assert(unit->unitType == CHAIN);
         featureBlocks = stFeatureBlock_getContextualFeatureBlocksForChainedBlocks(
@@ -1023,7 +1073,7 @@ static TreeBuildingResult *buildTreeForHomologyUnit(TreeBuildingInput *input) {
             params->maxBlockDistance,
             params->ignoreUnalignedBases,
             params->onlyIncludeCompleteFeatureBlocks,
-            input->constants->threadStrings);
+            strings);
     }
 
     // Make feature columns
@@ -1117,15 +1167,38 @@ static TreeBuildingResult *buildTreeForHomologyUnit(TreeBuildingInput *input) {
     stList_destruct(featureColumns);
     stList_destruct(featureBlocks);
     stList_destruct(outgroups);
-    free(input);
+    stCaf_ThreadStringProvider_releaseStrings(strings);
 
     ret->tree = bestTree;
+}
+
+// Gets run as a worker in a thread. Builds the tree and finds the
+// split branches of both the old and new trees, so that only merging
+// them into the shared set is left for the finisher.
+static TreeBuildingResult *buildTreeForHomologyUnit(TreeBuildingInput *input) {
+    TreeBuildingResult *ret = st_calloc(1, sizeof(TreeBuildingResult));
+    ret->homologyUnitsToTrees = input->homologyUnitsToTrees;
+    ret->homologyUnit = input->homologyUnit;
+    ret->splitBranches = input->splitBranches;
 
+    buildTreeForHomologyUnit2(input, ret);
+
+    ret->oldSplitBranches = stSortedSet_construct3((int (*)(const void *, const void *)) stCaf_SplitBranch_cmp, free);
+    if (input->oldTree != NULL) {
+        stCaf_findSplitBranches(input->homologyUnit, input->oldTree, ret->oldSplitBranches,
+                                input->constants->speciesToSplitOn);
+    }
+    ret->newSplitBranches = stSortedSet_construct3((int (*)(const void *, const void *)) stCaf_SplitBranch_cmp, NULL);
+    if (ret->tree != NULL) {
+        stCaf_findSplitBranches(input->homologyUnit, ret->tree, ret->newSplitBranches,
+                                input->constants->speciesToSplitOn);
+    }
+    free(input);
     return ret;
 }
 
 // Gets run as a "finisher" in the thread pool, so it's run in series
-// and we don't have to lock the hash.
+// and we don't have to lock the hash or the set of split branches.
 static void addTreeToHash(TreeBuildingResult *result) {
     if (stHash_search(result->homologyUnitsToTrees, result->homologyUnit)) {
         stHash_remove(result->homologyUnitsToTrees, result->homologyUnit);
@@ -1139,6 +1212,19 @@ static void addTreeToHash(TreeBuildingResult *result) {
             numSingleCopyBlocksSkipped++;
         }
     }
+    stSortedSetIterator *it = stSortedSet_getIterator(result->oldSplitBranches);
+    stCaf_SplitBranch *splitBranch;
+    while ((splitBranch = stSortedSet_getNext(it)) != NULL) {
+        stSortedSet_remove(result->splitBranches, splitBranch);
+    }
+    stSortedSet_destructIterator(it);
+    it = stSortedSet_getIterator(result->newSplitBranches);
+    while ((splitBranch = stSortedSet_getNext(it)) != NULL) {
+        stSortedSet_insert(result->splitBranches, splitBranch);
+    }
+    stSortedSet_destructIterator(it);
+    stSortedSet_destruct(result->oldSplitBranches);
+    stSortedSet_destruct(result->newSplitBranches);
     free(result); // Sucks to have to do this in a critical section,
                   // but shouldn't matter too much.
 }
@@ -1329,41 +1415,20 @@ static void destructTree(stTree *tree) {
 
 // Update the trees that belong to each block in the homologyUnitsToUpdate
 // set. Invalidates all pointers to the old trees or their split
-// branches, and adds the new split branches to the set.
+// branches, and adds the new split branches to the set. The split
+// branches of the old and new trees are found by the tree-building
+// workers, so all the work for each unit is done in parallel.
 static void recomputeAffectedTrees(stSet *homologyUnitsToUpdate,
                                    TreeBuildingConstants *constants,
                                    stThreadPool *treeBuildingPool,
                                    stHash *homologyUnitsToTrees,
                                    stSortedSet *splitBranches) {
-    stSetIterator *homologyUnitsToUpdateIt = stSet_getIterator(homologyUnitsToUpdate);
-    stList *unitsToPush = stList_construct();
-    HomologyUnit *unitToUpdate;
-    while ((unitToUpdate = stSet_getNext(homologyUnitsToUpdateIt)) != NULL) {
-        totalNumberOfBlocksRecomputed++;
-        stTree *oldTree = stHash_search(homologyUnitsToTrees, unitToUpdate);
-        stCaf_removeSplitBranches(unitToUpdate, oldTree,
-                                  constants->speciesToSplitOn, splitBranches);
-        stList_append(unitsToPush, unitToUpdate);
-    }
-    stSet_destructIterator(homologyUnitsToUpdateIt);
-
-    for (int64_t i = 0; i < stList_length(unitsToPush); i++) {
-        pushHomologyUnitToPool(stList_get(unitsToPush, i), constants,
-                               homologyUnitsToTrees, treeBuildingPool);
-    }
+    totalNumberOfBlocksRecomputed += stSet_size(homologyUnitsToUpdate);
+    pushHomologyUnitsToPool(homologyUnitsToUpdate, constants, homologyUnitsToTrees,
+                            splitBranches, treeBuildingPool);
 
     // Wait for the trees to be done.
     stThreadPool_wait(treeBuildingPool);
-    homologyUnitsToUpdateIt = stSet_getIterator(homologyUnitsToUpdate);
-    while ((unitToUpdate = stSet_getNext(homologyUnitsToUpdateIt)) != NULL) {
-        stTree *tree = stHash_search(homologyUnitsToTrees, unitToUpdate);
-        if (tree != NULL) {
-            stCaf_findSplitBranches(unitToUpdate, tree,
-                                    splitBranches, constants->speciesToSplitOn);
-        }
-    }
-    stList_destruct(unitsToPush);
-    stSet_destructIterator(homologyUnitsToUpdateIt);
 }
 
 // Split on a single branch and update the blocks affected immediately.
@@ -1679,48 +1744,90 @@ static stHash *getBadDivergences(stSet *homologyUnits, TreeBuildingConstants *co
     return speciesPairToBadDivergence;
 }
 
-static stHash *getDistanceMatricesForUnits(stSet *homologyUnits, TreeBuildingConstants *constants, stCaf_PhylogenyParameters *params) {
-    stHash *unitToDistanceMatrix = stHash_construct2(NULL, (void (*)(void *)) stMatrix_destruct);
-    stSetIterator *it = stSet_getIterator(homologyUnits);
+// Gets passed to getDistanceMatrixForUnit and then to
+// addDistanceMatrixToHash.
+typedef struct {
     HomologyUnit *unit;
-    while ((unit = stSet_getNext(it)) != NULL) {
-        assert(unit->unitType == CHAIN);
-        stList *featureBlocks = stFeatureBlock_getContextualFeatureBlocksForChainedBlocks(
-            unit->unit, params->maxBaseDistance,
-            params->maxBlockDistance,
-            params->ignoreUnalignedBases,
-            params->onlyIncludeCompleteFeatureBlocks,
-            constants->threadStrings);
+    TreeBuildingConstants *constants;
+    stCaf_PhylogenyParameters *params;
+    stHash *unitToDistanceMatrix;
+    stMatrix *distanceMatrix;
+} DistanceMatrixJob;
 
-        // Make feature columns
-        stList *featureColumns = stFeatureColumn_getFeatureColumns(featureBlocks);
+// Gets run as a worker in a thread.
+static DistanceMatrixJob *getDistanceMatrixForUnit(DistanceMatrixJob *job) {
+    HomologyUnit *unit = job->unit;
+    TreeBuildingConstants *constants = job->constants;
+    stCaf_PhylogenyParameters *params = job->params;
+    assert(unit->unitType == CHAIN);
+    stHash *strings = getStringsForHomologyUnit(unit, constants->threadStrings,
+                                                params->maxBaseDistance,
+                                                params->maxBlockDistance,
+                                                params->ignoreUnalignedBases, 1);
+    stList *featureBlocks = stFeatureBlock_getContextualFeatureBlocksForChainedBlocks(
+        unit->unit, params->maxBaseDistance,
+        params->maxBlockDistance,
+        params->ignoreUnalignedBases,
+        params->onlyIncludeCompleteFeatureBlocks,
+        strings);
 
-        // Get the degree (= number of segments in the block/chain).
-        int64_t degree = stPinchBlock_getDegree(getCanonicalBlockForHomologyUnit(unit));
+    // Make feature columns
+    stList *featureColumns = stFeatureColumn_getFeatureColumns(featureBlocks);
 
-        // Get the matrix diffs.
-        stMatrixDiffs *snpDiffs = stPinchPhylogeny_getMatrixDiffsFromSubstitutions(featureColumns, degree, NULL);
+    // Get the degree (= number of segments in the block/chain).
+    int64_t degree = stPinchBlock_getDegree(getCanonicalBlockForHomologyUnit(unit));
 
-        // Make substitution matrix
-        stMatrix *substitutionMatrix = stPinchPhylogeny_constructMatrixFromDiffs(snpDiffs, false, 0);
+    // Get the matrix diffs.
+    stMatrixDiffs *snpDiffs = stPinchPhylogeny_getMatrixDiffsFromSubstitutions(featureColumns, degree, NULL);
 
-        //Combine the matrices into distance matrices
-        stMatrix *substitutionDistanceMatrix = stPinchPhylogeny_getSymmetricDistanceMatrix(substitutionMatrix);
-        if (params->distanceCorrectionMethod == JUKES_CANTOR) {
-            stPhylogeny_applyJukesCantorCorrection(substitutionDistanceMatrix);
-        } else {
-            assert(params->distanceCorrectionMethod == NONE);
-        }
+    // Make substitution matrix
+    stMatrix *substitutionMatrix = stPinchPhylogeny_constructMatrixFromDiffs(snpDiffs, false, 0);
 
-        stHash_insert(unitToDistanceMatrix, unit, substitutionDistanceMatrix);
+    //Combine the matrices into distance matrices
+    stMatrix *substitutionDistanceMatrix = stPinchPhylogeny_getSymmetricDistanceMatrix(substitutionMatrix);
+    if (params->distanceCorrectionMethod == JUKES_CANTOR) {
+        stPhylogeny_applyJukesCantorCorrection(substitutionDistanceMatrix);
+    } else {
+        assert(params->distanceCorrectionMethod == NONE);
+    }
+
+    job->distanceMatrix = substitutionDistanceMatrix;
 
-        stList_destruct(featureBlocks);
-        stList_destruct(featureColumns);
+    stList_destruct(featureBlocks);
+    stList_destruct(featureColumns);
+    stCaf_ThreadStringProvider_releaseStrings(strings);
 
-        stMatrix_destruct(substitutionMatrix);
+    stMatrix_destruct(substitutionMatrix);
 
-        stMatrixDiffs_destruct(snpDiffs);
+    stMatrixDiffs_destruct(snpDiffs);
+    return job;
+}
+
+// Gets run as a "finisher" in the thread pool, so it's run in series
+// and we don't have to lock the hash.
+static void addDistanceMatrixToHash(DistanceMatrixJob *job) {
+    stHash_insert(job->unitToDistanceMatrix, job->unit, job->distanceMatrix);
+    free(job);
+}
+
+static stHash *getDistanceMatricesForUnits(stSet *homologyUnits, TreeBuildingConstants *constants, stCaf_PhylogenyParameters *params) {
+    stHash *unitToDistanceMatrix = stHash_construct2(NULL, (void (*)(void *)) stMatrix_destruct);
+    stThreadPool *threadPool = stThreadPool_construct(params->numTreeBuildingThreads,
+                                                      (void *(*)(void *)) getDistanceMatrixForUnit,
+                                                      (void (*)(void *)) addDistanceMatrixToHash);
+    stSetIterator *it = stSet_getIterator(homologyUnits);
+    HomologyUnit *unit;
+    while ((unit = stSet_getNext(it)) != NULL) {
+        DistanceMatrixJob *job = st_calloc(1, sizeof(DistanceMatrixJob));
+        job->unit = unit;
+        job->constants = constants;
+        job->params = params;
+        job->unitToDistanceMatrix = unitToDistanceMatrix;
+        stThreadPool_push(threadPool, job);
     }
+    stSet_destructIterator(it);
+    stThreadPool_wait(threadPool);
+    stThreadPool_destruct(threadPool);
     return unitToDistanceMatrix;
 }
 
@@ -1909,7 +2016,7 @@ static void stCaf_removeBadChains(stPinchThreadSet *threadSet,
 
 void stCaf_buildTreesToRemoveAncientHomologies(stPinchThreadSet *threadSet,
                                                HomologyUnitType unitType,
-                                               stHash *threadStrings,
+                                               stCaf_ThreadStringProvider *threadStrings,
                                                stSet *outgroupThreads,
                                                Flower *flower,
                                                stCaf_PhylogenyParameters *params,
@@ -2012,13 +2119,8 @@ void stCaf_buildTreesToRemoveAncientHomologies(stPinchThreadSet *threadSet,
         stSet_destruct(badChains);
     }
 
-    // The loop to build a tree for each homology unit
-    stSetIterator *homologyUnitIt = stSet_getIterator(homologyUnits);
-    HomologyUnit *unit;
-    while ((unit = stSet_getNext(homologyUnitIt)) != NULL) {
-        pushHomologyUnitToPool(unit, &constants, homologyUnitsToTrees, treeBuildingPool);
-    }
-    stSet_destructIterator(homologyUnitIt);
+    // Build a tree for each homology unit
+    pushHomologyUnitsToPool(homologyUnits, &constants, homologyUnitsToTrees, splitBranches, treeBuildingPool);
 
     // We need the trees to be done before we can continue.
     stThreadPool_wait(treeBuildingPool);
@@ -2046,14 +2148,8 @@ void stCaf_buildTreesToRemoveAncientHomologies(stPinchThreadSet *threadSet,
         stSet_destruct(chainHomologyUnits);
     }
 
-    // All the blocks have their trees computed. Find the split
-    // branches in those trees.
-    stHashIterator *homologyUnitsToTreesIt = stHash_getIterator(homologyUnitsToTrees);
-    while ((unit = stHash_getNext(homologyUnitsToTreesIt)) != NULL) {
-        stTree *tree = stHash_search(homologyUnitsToTrees, unit);
-        assert(tree != NULL);
-        stCaf_findSplitBranches(unit, tree, splitBranches, speciesToSplitOn);
-    }
+    // All the blocks have their trees computed, and the split
+    // branches in those trees were found as they were built.
 
     fprintf(stdout, "Before partitioning, there were %" PRIi64 " bases lost in between single-degree blocks\n", countBasesBetweenSingleDegreeBlocks(threadSet));
     fprintf(stdout, "Found %" PRIi64 " split branches initially in %" PRIi64
@@ -9,6 +9,7 @@
 #include "sonLib.h"
 #include "stPinchGraphs.h"
 #include "stPinchIterator.h"
+#include "stBinaryAlignments.h"
 #include "pairwiseAlignment.h"
 #include "cactus.h"
 
@@ -18,6 +19,7 @@ struct _stPinchIterator {
     stPinch *(*getNextAlignment)(void *);
     void *(*startAlignmentStack)(void *);
     void (*destructAlignmentArg)(void *);
+    bool (*isNextReady)(void *);
 };
 
 stPinch *stPinchIterator_getNext(stPinchIterator *pinchIterator) {
@@ -63,53 +65,69 @@ static PairwiseAlignmentToPinch *pairwiseAlignmentToPinch_construct(void *alignm
     return pairwiseAlignmentToPinch;
 }
 
+static void pairwiseAlignmentToPinch_startAlignment(PairwiseAlignmentToPinch *pA,
+        struct PairwiseAlignment *pairwiseAlignment) {
+    pA->pairwiseAlignment = pairwiseAlignment;
+    pA->alignmentIndex = 0;
+    pA->xCoordinate = pairwiseAlignment->start1;
+    pA->yCoordinate = pairwiseAlignment->start2;
+    pA->xName = cactusMisc_stringToName(pairwiseAlignment->contig1);
+    pA->yName = cactusMisc_stringToName(pairwiseAlignment->contig2);
+}
+
+static bool pairwiseAlignmentToPinch_getNextOfAlignment(PairwiseAlignmentToPinch *pA, stPinch *pinch) {
+    /*
+     * Gets the next pinch of the current alignment, returning false once there are no more.
+     */
+    while (pA->alignmentIndex < pA->pairwiseAlignment->operationList->length) {
+        struct AlignmentOperation *op = pA->pairwiseAlignment->operationList->list[pA->alignmentIndex++];
+        if (op->opType == PAIRWISE_MATCH && op->length >= 1) { //deal with the possibility of a zero length match (strange, but not illegal)
+            if (pA->pairwiseAlignment->strand1) {
+                if (pA->pairwiseAlignment->strand2) {
+                    stPinch_fillOut(pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 1);
+                    pA->yCoordinate += op->length;
+                } else {
+                    pA->yCoordinate -= op->length;
+                    stPinch_fillOut(pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 0);
+                }
+                pA->xCoordinate += op->length;
+            } else {
+                pA->xCoordinate -= op->length;
+                if (pA->pairwiseAlignment->strand2) {
+                    stPinch_fillOut(pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 0);
+                    pA->yCoordinate += op->length;
+                } else {
+                    pA->yCoordinate -= op->length;
+                    stPinch_fillOut(pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 1);
+                }
+            }
+            return 1;
+        }
+        if (op->opType != PAIRWISE_INDEL_Y) {
+            pA->xCoordinate += pA->pairwiseAlignment->strand1 ? op->length : -op->length;
+        }
+        if (op->opType != PAIRWISE_INDEL_X) {
+            pA->yCoordinate += pA->pairwiseAlignment->strand2 ? op->length : -op->length;
+        }
+    }
+    assert(pA->xCoordinate == pA->pairwiseAlignment->end1);
+    assert(pA->yCoordinate == pA->pairwiseAlignment->end2);
+    return 0;
+}
+
 static stPinch *pairwiseAlignmentToPinch_getNext(PairwiseAlignmentToPinch *pA) {
     static stPinch pinch;
     while (1) {
         if (pA->pairwiseAlignment == NULL) {
-            pA->pairwiseAlignment = pA->getPairwiseAlignment(pA->alignmentArg);
-            if (pA->pairwiseAlignment == NULL) {
+            struct PairwiseAlignment *pairwiseAlignment = pA->getPairwiseAlignment(pA->alignmentArg);
+            if (pairwiseAlignment == NULL) {
                 return NULL;
             }
-            pA->alignmentIndex = 0;
-            pA->xCoordinate = pA->pairwiseAlignment->start1;
-            pA->yCoordinate = pA->pairwiseAlignment->start2;
-            pA->xName = cactusMisc_stringToName(pA->pairwiseAlignment->contig1);
-            pA->yName = cactusMisc_stringToName(pA->pairwiseAlignment->contig2);
+            pairwiseAlignmentToPinch_startAlignment(pA, pairwiseAlignment);
         }
-        while (pA->alignmentIndex < pA->pairwiseAlignment->operationList->length) {
-            struct AlignmentOperation *op = pA->pairwiseAlignment->operationList->list[pA->alignmentIndex++];
-            if (op->opType == PAIRWISE_MATCH && op->length >= 1) { //deal with the possibility of a zero length match (strange, but not illegal)
-                if (pA->pairwiseAlignment->strand1) {
-                    if (pA->pairwiseAlignment->strand2) {
-                        stPinch_fillOut(&pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 1);
-                        pA->yCoordinate += op->length;
-                    } else {
-                        pA->yCoordinate -= op->length;
-                        stPinch_fillOut(&pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 0);
-                    }
-                    pA->xCoordinate += op->length;
-                } else {
-                    pA->xCoordinate -= op->length;
-                    if (pA->pairwiseAlignment->strand2) {
-                        stPinch_fillOut(&pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 0);
-                        pA->yCoordinate += op->length;
-                    } else {
-                        pA->yCoordinate -= op->length;
-                        stPinch_fillOut(&pinch, pA->xName, pA->yName, pA->xCoordinate, pA->yCoordinate, op->length, 1);
-                    }
-                }
-                return &pinch;
-            }
-            if (op->opType != PAIRWISE_INDEL_Y) {
-                pA->xCoordinate += pA->pairwiseAlignment->strand1 ? op->length : -op->length;
-            }
-            if (op->opType != PAIRWISE_INDEL_X) {
-                pA->yCoordinate += pA->pairwiseAlignment->strand2 ? op->length : -op->length;
-            }
+        if (pairwiseAlignmentToPinch_getNextOfAlignment(pA, &pinch)) {
+            return &pinch;
         }
-        assert(pA->xCoordinate == pA->pairwiseAlignment->end1);
-        assert(pA->yCoordinate == pA->pairwiseAlignment->end2);
         if (pA->freeAlignments) {
             destructPairwiseAlignment(pA->pairwiseAlignment);
         }
@@ -118,6 +136,19 @@ static stPinch *pairwiseAlignmentToPinch_getNext(PairwiseAlignmentToPinch *pA) {
     return NULL;
 }
 
+stList *stPinchIterator_getPinchesOfPairwiseAlignment(struct PairwiseAlignment *pairwiseAlignment) {
+    stList *pinches = stList_construct3(0, free);
+    PairwiseAlignmentToPinch pA;
+    pairwiseAlignmentToPinch_startAlignment(&pA, pairwiseAlignment);
+    stPinch pinch;
+    while (pairwiseAlignmentToPinch_getNextOfAlignment(&pA, &pinch)) {
+        stPinch *pinchCopy = st_malloc(sizeof(stPinch));
+        *pinchCopy = pinch;
+        stList_append(pinches, pinchCopy);
+    }
+    return pinches;
+}
+
 static PairwiseAlignmentToPinch *pairwiseAlignmentToPinch_resetForFile(PairwiseAlignmentToPinch *pA) {
     fseek(pA->alignmentArg, 0, SEEK_SET);
     pA->pairwiseAlignment = NULL;
@@ -129,6 +160,24 @@ static void pairwiseAlignmentToPinch_destructForFile(PairwiseAlignmentToPinch *p
     free(pA);
 }
 
+stPinchIterator *stPinchIterator_construct(void *alignmentArg, stPinch *(*getNextAlignment)(void *),
+        void *(*startAlignmentStack)(void *), void (*destructAlignmentArg)(void *)) {
+    stPinchIterator *pinchIterator = st_calloc(1, sizeof(stPinchIterator));
+    pinchIterator->alignmentArg = alignmentArg;
+    pinchIterator->getNextAlignment = getNextAlignment;
+    pinchIterator->destructAlignmentArg = destructAlignmentArg;
+    pinchIterator->startAlignmentStack = startAlignmentStack;
+    return pinchIterator;
+}
+
+void stPinchIterator_setIsNextReady(stPinchIterator *pinchIterator, bool (*isNextReady)(void *)) {
+    pinchIterator->isNextReady = isNextReady;
+}
+
+bool stPinchIterator_isNextReady(stPinchIterator *pinchIterator) {
+    return pinchIterator->isNextReady == NULL || pinchIterator->isNextReady(pinchIterator->alignmentArg);
+}
+
 stPinchIterator *stPinchIterator_constructFromFile(const char *alignmentFile) {
     stPinchIterator *pinchIterator = st_calloc(1, sizeof(stPinchIterator));
     pinchIterator->alignmentArg = pairwiseAlignmentToPinch_construct(fopen(alignmentFile, "r"),
@@ -139,6 +188,15 @@ stPinchIterator *stPinchIterator_constructFromFile(const char *alignmentFile) {
     return pinchIterator;
 }
 
+stPinchIterator *stPinchIterator_constructFromBinaryFile(const char *binaryFile) {
+    stPinchIterator *pinchIterator = st_calloc(1, sizeof(stPinchIterator));
+    pinchIterator->alignmentArg = stBinaryAlignmentReader_construct(binaryFile);
+    pinchIterator->getNextAlignment = (stPinch *(*)(void *)) stBinaryAlignmentReader_getNextPinch;
+    pinchIterator->destructAlignmentArg = (void(*)(void *)) stBinaryAlignmentReader_destruct;
+    pinchIterator->startAlignmentStack = (void *(*)(void *)) stBinaryAlignmentReader_reset;
+    return pinchIterator;
+}
+
 static PairwiseAlignmentToPinch *pairwiseAlignmentToPinch_resetForList(PairwiseAlignmentToPinch *pA) {
     while (stList_getPrevious(pA->alignmentArg) != NULL)
         ;
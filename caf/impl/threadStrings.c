@@ -0,0 +1,402 @@
+/*
+ * threadStrings.c
+ *
+ * Provides the strings of the threads of a pinch graph around the blocks of homology units, fetching just
+ * the windows needed from the cactus disk rather than the whole of every thread.
+ */
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include "sonLib.h"
+#include "cactus.h"
+#include "stPinchGraphs.h"
+#include "stCafPhylogeny.h"
+
+/*
+ * The strings are fetched and cached in chunks of this many bases, aligned to multiples of it in thread
+ * coordinates.
+ */
+#define THREAD_STRING_CHUNK_SIZE 65536
+
+typedef struct _stringChunk StringChunk;
+
+struct _stringChunk {
+    Name name; //The name of the thread.
+    int64_t index; //The chunk covers thread coordinates [index * THREAD_STRING_CHUNK_SIZE, (index + 1) * THREAD_STRING_CHUNK_SIZE).
+    int64_t start; //The bases of the thread actually in the chunk, which excludes the caps.
+    int64_t length;
+    char *string;
+    int64_t pinCount; //The number of getStrings calls copying from the chunk, which may not evict it.
+    StringChunk *previous, *next; //The chunks in order of use, most recent first.
+};
+
+struct _stCaf_ThreadStringProvider {
+    Flower *flower;
+    int64_t maxCacheSize;
+    int64_t cacheSize;
+    stHash *chunks;
+    StringChunk *first, *last;
+    pthread_mutex_t lock;
+};
+
+static uint64_t stringChunk_hashKey(const StringChunk *chunk) {
+    return (uint64_t) chunk->name * 1000003 + chunk->index;
+}
+
+static int stringChunk_equalsKey(const StringChunk *chunk1, const StringChunk *chunk2) {
+    return chunk1->name == chunk2->name && chunk1->index == chunk2->index;
+}
+
+static void stringChunk_destruct(StringChunk *chunk) {
+    free(chunk->string);
+    free(chunk);
+}
+
+stCaf_ThreadStringProvider *stCaf_ThreadStringProvider_construct(Flower *flower, int64_t maxCacheSize) {
+    stCaf_ThreadStringProvider *provider = st_calloc(1, sizeof(stCaf_ThreadStringProvider));
+    provider->flower = flower;
+    provider->maxCacheSize = maxCacheSize;
+    provider->chunks = stHash_construct3((uint64_t (*)(const void *)) stringChunk_hashKey,
+            (int (*)(const void *, const void *)) stringChunk_equalsKey, (void (*)(void *)) stringChunk_destruct, NULL);
+    pthread_mutex_init(&provider->lock, NULL);
+    return provider;
+}
+
+void stCaf_ThreadStringProvider_destruct(stCaf_ThreadStringProvider *provider) {
+    stHash_destruct(provider->chunks);
+    pthread_mutex_destroy(&provider->lock);
+    free(provider);
+}
+
+int64_t stCaf_ThreadStringProvider_getCacheSize(stCaf_ThreadStringProvider *provider) {
+    return provider->cacheSize;
+}
+
+static void unlinkChunk(stCaf_ThreadStringProvider *provider, StringChunk *chunk) {
+    if (chunk->previous != NULL) {
+        chunk->previous->next = chunk->next;
+    } else {
+        provider->first = chunk->next;
+    }
+    if (chunk->next != NULL) {
+        chunk->next->previous = chunk->previous;
+    } else {
+        provider->last = chunk->previous;
+    }
+    chunk->previous = NULL;
+    chunk->next = NULL;
+}
+
+static void linkChunkFirst(stCaf_ThreadStringProvider *provider, StringChunk *chunk) {
+    chunk->next = provider->first;
+    if (provider->first != NULL) {
+        provider->first->previous = chunk;
+    } else {
+        provider->last = chunk;
+    }
+    provider->first = chunk;
+}
+
+static StringChunk *stringChunk_construct(stPinchThread *thread, int64_t index) {
+    StringChunk *chunk = st_calloc(1, sizeof(StringChunk));
+    chunk->name = stPinchThread_getName(thread);
+    chunk->index = index;
+    //The first and last positions of the thread represent the caps, and have no bases.
+    int64_t basesStart = stPinchThread_getStart(thread) + 1;
+    int64_t basesEnd = stPinchThread_getStart(thread) + stPinchThread_getLength(thread) - 1;
+    chunk->start = index * THREAD_STRING_CHUNK_SIZE > basesStart ? index * THREAD_STRING_CHUNK_SIZE : basesStart;
+    int64_t end = (index + 1) * THREAD_STRING_CHUNK_SIZE < basesEnd ? (index + 1) * THREAD_STRING_CHUNK_SIZE : basesEnd;
+    chunk->length = end > chunk->start ? end - chunk->start : 0;
+    return chunk;
+}
+
+static void fetchChunk(stCaf_ThreadStringProvider *provider, StringChunk *chunk) {
+    /*
+     * Reads the bases of the chunk from the cactus disk, without the lock.
+     */
+    if (chunk->length > 0) {
+        Cap *cap = flower_getCap(provider->flower, chunk->name);
+        assert(cap != NULL);
+        Sequence *sequence = cap_getSequence(cap);
+        assert(sequence != NULL);
+        chunk->string = sequence_getString(sequence, chunk->start, chunk->length, 1);
+    }
+}
+
+static void pinChunk(stCaf_ThreadStringProvider *provider, StringChunk *chunk) {
+    chunk->pinCount++;
+    unlinkChunk(provider, chunk);
+    linkChunkFirst(provider, chunk);
+}
+
+static void evictChunks(stCaf_ThreadStringProvider *provider) {
+    /*
+     * Evicts the least recently used chunks that are not pinned until the cache fits. Must be called with
+     * the lock held.
+     */
+    StringChunk *chunk = provider->last;
+    while (provider->cacheSize > provider->maxCacheSize && chunk != NULL) {
+        StringChunk *previous = chunk->previous;
+        if (chunk->pinCount == 0) {
+            unlinkChunk(provider, chunk);
+            provider->cacheSize -= chunk->length;
+            stHash_remove(provider->chunks, chunk);
+            stringChunk_destruct(chunk);
+        }
+        chunk = previous;
+    }
+}
+
+static stHash *chunkSet_construct(void) {
+    return stHash_construct3((uint64_t (*)(const void *)) stringChunk_hashKey,
+            (int (*)(const void *, const void *)) stringChunk_equalsKey, NULL, NULL);
+}
+
+/*
+ * Windows of a thread that need bases, as pairs of start and end coordinates.
+ */
+
+static void addInterval(stHash *threadsToIntervals, stPinchSegment *segment) {
+    stPinchThread *thread = stPinchSegment_getThread(segment);
+    stList *intervals = stHash_search(threadsToIntervals, thread);
+    if (intervals == NULL) {
+        intervals = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+        stHash_insert(threadsToIntervals, thread, intervals);
+    }
+    stList_append(intervals, stIntTuple_construct2(stPinchSegment_getStart(segment),
+            stPinchSegment_getStart(segment) + stPinchSegment_getLength(segment)));
+}
+
+static void addBlockIntervals(stHash *threadsToIntervals, stPinchBlock *block) {
+    stPinchBlockIt blockIt = stPinchBlock_getSegmentIterator(block);
+    stPinchSegment *segment;
+    while ((segment = stPinchBlockIt_getNext(&blockIt)) != NULL) {
+        addInterval(threadsToIntervals, segment);
+    }
+}
+
+static void addContextIntervals(stHash *threadsToIntervals, stPinchSegment *segment, bool fivePrime,
+        int64_t maxBaseDistance, int64_t maxBlockDistance, bool ignoreUnalignedBases) {
+    /*
+     * Walks along the thread from the segment as far as the contextual blocks of a unit can reach, adding the
+     * segments of the blocks found, and the unaligned segments if they are counted. The walk goes one segment
+     * beyond the limits, to be safe.
+     */
+    int64_t blockDistance = 0, baseDistance = 0;
+    while (blockDistance <= maxBlockDistance && baseDistance <= maxBaseDistance
+            && (segment = fivePrime ? stPinchSegment_get5Prime(segment) : stPinchSegment_get3Prime(segment)) != NULL) {
+        stPinchBlock *block = stPinchSegment_getBlock(segment);
+        if (block != NULL) {
+            addBlockIntervals(threadsToIntervals, block);
+            blockDistance++;
+            baseDistance += stPinchSegment_getLength(segment);
+        } else if (!ignoreUnalignedBases) {
+            addInterval(threadsToIntervals, segment);
+            baseDistance += stPinchSegment_getLength(segment);
+        }
+    }
+}
+
+static int intervalCmp(const stIntTuple *interval1, const stIntTuple *interval2) {
+    return stIntTuple_get(interval1, 0) < stIntTuple_get(interval2, 0) ? -1
+            : (stIntTuple_get(interval1, 0) > stIntTuple_get(interval2, 0) ? 1 : 0);
+}
+
+static stList *mergeIntervals(stList *intervals) {
+    /*
+     * Gets the sorted, disjoint windows covering the intervals.
+     */
+    stList_sort(intervals, (int (*)(const void *, const void *)) intervalCmp);
+    stList *windows = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    int64_t start = INT64_MAX, end = INT64_MIN;
+    for (int64_t i = 0; i < stList_length(intervals); i++) {
+        stIntTuple *interval = stList_get(intervals, i);
+        if (stIntTuple_get(interval, 0) > end) {
+            if (end > start) {
+                stList_append(windows, stIntTuple_construct2(start, end));
+            }
+            start = stIntTuple_get(interval, 0);
+        }
+        end = stIntTuple_get(interval, 1) > end ? stIntTuple_get(interval, 1) : end;
+    }
+    if (end > start) {
+        stList_append(windows, stIntTuple_construct2(start, end));
+    }
+    return windows;
+}
+
+static stHash *pinChunks(stCaf_ThreadStringProvider *provider, stHash *threadsToWindows) {
+    /*
+     * Gets the chunks covering the windows, pinned so that they are not evicted while the strings are copied
+     * from them. The missing chunks are fetched with the lock released, so other threads can use the cache
+     * meanwhile, and then cached unless another thread has cached them first.
+     */
+    stHash *chunks = chunkSet_construct();
+    stList *missingChunks = stList_construct();
+    pthread_mutex_lock(&provider->lock);
+    stHashIterator *it = stHash_getIterator(threadsToWindows);
+    stPinchThread *thread;
+    while ((thread = stHash_getNext(it)) != NULL) {
+        stList *windows = stHash_search(threadsToWindows, thread);
+        for (int64_t i = 0; i < stList_length(windows); i++) {
+            stIntTuple *window = stList_get(windows, i);
+            for (int64_t index = stIntTuple_get(window, 0) / THREAD_STRING_CHUNK_SIZE;
+                    index * THREAD_STRING_CHUNK_SIZE < stIntTuple_get(window, 1); index++) {
+                StringChunk key;
+                key.name = stPinchThread_getName(thread);
+                key.index = index;
+                if (stHash_search(chunks, &key) != NULL) { //Shared with the previous window.
+                    continue;
+                }
+                StringChunk *chunk = stHash_search(provider->chunks, &key);
+                if (chunk != NULL) {
+                    pinChunk(provider, chunk);
+                } else {
+                    chunk = stringChunk_construct(thread, index);
+                    stList_append(missingChunks, chunk);
+                }
+                stHash_insert(chunks, chunk, chunk);
+            }
+        }
+    }
+    stHash_destructIterator(it);
+    pthread_mutex_unlock(&provider->lock);
+
+    for (int64_t i = 0; i < stList_length(missingChunks); i++) {
+        fetchChunk(provider, stList_get(missingChunks, i));
+    }
+
+    pthread_mutex_lock(&provider->lock);
+    for (int64_t i = 0; i < stList_length(missingChunks); i++) {
+        StringChunk *chunk = stList_get(missingChunks, i);
+        StringChunk *cachedChunk = stHash_search(provider->chunks, chunk);
+        if (cachedChunk != NULL) { //Fetched by another thread meanwhile.
+            stHash_remove(chunks, chunk);
+            stringChunk_destruct(chunk);
+            pinChunk(provider, cachedChunk);
+            stHash_insert(chunks, cachedChunk, cachedChunk);
+        } else {
+            stHash_insert(provider->chunks, chunk, chunk);
+            linkChunkFirst(provider, chunk);
+            chunk->pinCount = 1;
+            provider->cacheSize += chunk->length;
+        }
+    }
+    evictChunks(provider);
+    pthread_mutex_unlock(&provider->lock);
+    stList_destruct(missingChunks);
+    return chunks;
+}
+
+static void unpinChunks(stCaf_ThreadStringProvider *provider, stHash *chunks) {
+    pthread_mutex_lock(&provider->lock);
+    stHashIterator *it = stHash_getIterator(chunks);
+    StringChunk *chunk;
+    while ((chunk = stHash_getNext(it)) != NULL) {
+        assert(chunk->pinCount > 0);
+        chunk->pinCount--;
+    }
+    stHash_destructIterator(it);
+    evictChunks(provider);
+    pthread_mutex_unlock(&provider->lock);
+    stHash_destruct(chunks);
+}
+
+static void copyWindow(stHash *chunks, stPinchThread *thread, char *string, int64_t start, int64_t end) {
+    for (int64_t index = start / THREAD_STRING_CHUNK_SIZE; index * THREAD_STRING_CHUNK_SIZE < end; index++) {
+        StringChunk key;
+        key.name = stPinchThread_getName(thread);
+        key.index = index;
+        StringChunk *chunk = stHash_search(chunks, &key);
+        assert(chunk != NULL);
+        int64_t copyStart = start > chunk->start ? start : chunk->start;
+        int64_t copyEnd = end < chunk->start + chunk->length ? end : chunk->start + chunk->length;
+        if (copyEnd > copyStart) {
+            memcpy(string + copyStart - stPinchThread_getStart(thread), chunk->string + copyStart - chunk->start,
+                    copyEnd - copyStart);
+        }
+    }
+}
+
+static int64_t getMappedLength(stPinchThread *thread) {
+    return stPinchThread_getLength(thread) + 1;
+}
+
+static stHash *getStrings(stCaf_ThreadStringProvider *provider, stList *blocks, int64_t maxBaseDistance,
+        int64_t maxBlockDistance, bool ignoreUnalignedBases, bool fillBases) {
+    //Find the windows needed, which only reads the pinch graph.
+    stHash *threadsToIntervals = stHash_construct2(NULL, (void (*)(void *)) stList_destruct);
+    for (int64_t i = 0; i < stList_length(blocks); i++) {
+        stPinchBlock *block = stList_get(blocks, i);
+        addBlockIntervals(threadsToIntervals, block);
+        stPinchBlockIt blockIt = stPinchBlock_getSegmentIterator(block);
+        stPinchSegment *segment;
+        while ((segment = stPinchBlockIt_getNext(&blockIt)) != NULL) {
+            addContextIntervals(threadsToIntervals, segment, 1, maxBaseDistance, maxBlockDistance,
+                    ignoreUnalignedBases);
+            addContextIntervals(threadsToIntervals, segment, 0, maxBaseDistance, maxBlockDistance,
+                    ignoreUnalignedBases);
+        }
+    }
+    stHash *threadsToWindows = stHash_construct2(NULL, (void (*)(void *)) stList_destruct);
+    stHashIterator *it = stHash_getIterator(threadsToIntervals);
+    stPinchThread *thread;
+    while ((thread = stHash_getNext(it)) != NULL) {
+        stHash_insert(threadsToWindows, thread, mergeIntervals(stHash_search(threadsToIntervals, thread)));
+    }
+    stHash_destructIterator(it);
+    stHash_destruct(threadsToIntervals);
+    stHash *chunks = fillBases ? pinChunks(provider, threadsToWindows) : NULL;
+
+    /*
+     * Each string spans the whole thread, so it can be indexed by thread coordinates, but is an anonymous
+     * mapping of which only the pages in the windows are ever written, and so take up memory.
+     */
+    stHash *strings = stHash_construct();
+    it = stHash_getIterator(threadsToWindows);
+    while ((thread = stHash_getNext(it)) != NULL) {
+        char *string = mmap(NULL, getMappedLength(thread), PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (string == MAP_FAILED) {
+            st_errAbort("Could not map a string of length %" PRIi64 " for thread %" PRIi64 "",
+                    getMappedLength(thread), stPinchThread_getName(thread));
+        }
+        //The positions representing the caps, as in stCaf_getThreadStrings.
+        string[0] = 'N';
+        string[stPinchThread_getLength(thread) - 1] = 'N';
+        if (fillBases) {
+            stList *windows = stHash_search(threadsToWindows, thread);
+            for (int64_t i = 0; i < stList_length(windows); i++) {
+                stIntTuple *window = stList_get(windows, i);
+                copyWindow(chunks, thread, string, stIntTuple_get(window, 0), stIntTuple_get(window, 1));
+            }
+        }
+        stHash_insert(strings, thread, string);
+    }
+    stHash_destructIterator(it);
+    if (fillBases) {
+        unpinChunks(provider, chunks);
+    }
+    stHash_destruct(threadsToWindows);
+    return strings;
+}
+
+stHash *stCaf_ThreadStringProvider_getStrings(stCaf_ThreadStringProvider *provider, stList *blocks,
+        int64_t maxBaseDistance, int64_t maxBlockDistance, bool ignoreUnalignedBases) {
+    return getStrings(provider, blocks, maxBaseDistance, maxBlockDistance, ignoreUnalignedBases, 1);
+}
+
+stHash *stCaf_ThreadStringProvider_getUnfilledStrings(stCaf_ThreadStringProvider *provider, stList *blocks,
+        int64_t maxBaseDistance, int64_t maxBlockDistance, bool ignoreUnalignedBases) {
+    return getStrings(provider, blocks, maxBaseDistance, maxBlockDistance, ignoreUnalignedBases, 0);
+}
+
+void stCaf_ThreadStringProvider_releaseStrings(stHash *strings) {
+    stHashIterator *it = stHash_getIterator(strings);
+    stPinchThread *thread;
+    while ((thread = stHash_getNext(it)) != NULL) {
+        munmap(stHash_search(strings, thread), getMappedLength(thread));
+    }
+    stHash_destructIterator(it);
+    stHash_destruct(strings);
+}
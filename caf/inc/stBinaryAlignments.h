@@ -0,0 +1,85 @@
+/*
+ * stBinaryAlignments.h
+ *
+ * A compact binary format for the pairwise alignments given to caf, holding just what annealing
+ * needs: the gapless matches of each alignment, as pinches, and its score.
+ */
+
+#ifndef ST_BINARY_ALIGNMENTS_H_
+#define ST_BINARY_ALIGNMENTS_H_
+
+#include "sonLib.h"
+#include "stPinchGraphs.h"
+
+struct PairwiseAlignment;
+
+/*
+ * The default amount of memory used to sort a file, in bytes.
+ */
+#define ST_BINARY_ALIGNMENTS_SORT_MEMORY 268435456
+
+/*
+ * Writes alignments to a binary alignments file.
+ */
+typedef struct _stBinaryAlignmentWriter stBinaryAlignmentWriter;
+
+/*
+ * Creates the file and writes its header. Aborts if the file can not be created.
+ */
+stBinaryAlignmentWriter *stBinaryAlignmentWriter_construct(const char *binaryFile);
+
+/*
+ * Appends an alignment to the file. The contig names of the alignment must be cactus names.
+ */
+void stBinaryAlignmentWriter_writeAlignment(stBinaryAlignmentWriter *writer,
+        struct PairwiseAlignment *pairwiseAlignment);
+
+/*
+ * Closes the file.
+ */
+void stBinaryAlignmentWriter_destruct(stBinaryAlignmentWriter *writer);
+
+/*
+ * Reads the pinches from a binary alignments file, which is memory mapped.
+ */
+typedef struct _stBinaryAlignmentReader stBinaryAlignmentReader;
+
+/*
+ * Opens the file. Aborts if it is not a binary alignments file.
+ */
+stBinaryAlignmentReader *stBinaryAlignmentReader_construct(const char *binaryFile);
+
+/*
+ * Returns the next pinch, or NULL at the end of the file. The pinch is overwritten by the next call.
+ */
+stPinch *stBinaryAlignmentReader_getNextPinch(stBinaryAlignmentReader *reader);
+
+/*
+ * Returns to the start of the file, returning the reader.
+ */
+stBinaryAlignmentReader *stBinaryAlignmentReader_reset(stBinaryAlignmentReader *reader);
+
+/*
+ * Closes the file.
+ */
+void stBinaryAlignmentReader_destruct(stBinaryAlignmentReader *reader);
+
+/*
+ * Returns non-zero if the file is a binary alignments file.
+ */
+bool stCaf_isBinaryAlignmentsFile(const char *file);
+
+/*
+ * Converts a file of cigars to a binary alignments file, returning the number of alignments.
+ */
+int64_t stCaf_convertCigarsFileToBinaryAlignments(const char *cigarsFile, const char *binaryFile);
+
+/*
+ * Sorts a binary alignments file by alignment score, highest first, writing the result to sortedFile.
+ * Alignments with equal scores keep their order. Uses at most about memoryLimit bytes of memory, sorting
+ * runs of the file in memory and merging them through temporary files named after sortedFile.
+ */
+void stCaf_sortBinaryAlignmentsFileByScoreInDescendingOrder(const char *binaryFile, const char *sortedFile,
+        int64_t memoryLimit);
+
+#endif /* ST_BINARY_ALIGNMENTS_H_ */
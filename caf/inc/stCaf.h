@@ -43,6 +43,18 @@ void stCaf_anneal(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, b
  */
 void stCaf_annealBetweenAdjacencyComponents(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, bool (*filterFn)(stPinchSegment *, stPinchSegment *));
 
+/*
+ * As stCaf_anneal, but using the given number of threads. The pinches are partitioned by the components
+ * of threads they join, and the components are pinched in parallel. The result is identical to stCaf_anneal.
+ * The filter function, if given, must be safe to call concurrently on segments of different components.
+ */
+void stCaf_annealInParallel(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads);
+
+/*
+ * As stCaf_annealBetweenAdjacencyComponents, but using the given number of threads, as stCaf_annealInParallel.
+ */
+void stCaf_annealBetweenAdjacencyComponentsInParallel(stPinchThreadSet *threadSet, stPinchIterator *pinchIterator, bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads);
+
 /*
  * Joins all trivial boundaries, but not joining stub boundaries.
  */
@@ -58,6 +70,13 @@ void stCaf_joinTrivialBoundaries(stPinchThreadSet *threadSet);
 void stCaf_melt(Flower *flower, stPinchThreadSet *threadSet, bool blockFilterfn(stPinchBlock *), int64_t blockEndTrim,
         int64_t minimumChainLength, bool breakChainsAtReverseTandems, int64_t maximumMedianSpacingBetweenLinkedEnds);
 
+/*
+ * Equivalent to calling stCaf_melt with each of the minimum chain lengths in turn, without a block filter, trim or
+ * chain breaking. Rather than building a cactus graph for each round, a single graph is kept up to date as chains
+ * are removed, so each round only does work proportional to the blocks it removes.
+ */
+void stCaf_meltInRounds(Flower *flower, stPinchThreadSet *threadSet, int64_t *minimumChainLengths, int64_t roundNumber);
+
 /*
  * Removes any recoverable chains (those expected to be picked up by
  * bar phase) from the graph. Only chains that are recoverable *and*
@@ -124,6 +143,14 @@ void stCaf_finish(Flower *flower, stPinchThreadSet *threadSet, int64_t chainLeng
  */
 void stCaf_setFlowerForAlignmentFiltering(Flower *input);
 
+/*
+ * The alignment filters cache a summary of the events in each block. The
+ * annealing functions call this before they start, and it must be called
+ * whenever the pinch graph has been changed other than by pinching before
+ * the filters are used again.
+ */
+void stCaf_resetAlignmentFilteringCache(void);
+
 /*
  * Filters incoming alignments by presence of outgroup, to ensure at
  * most one outgroup segment is in any block.
@@ -142,7 +169,7 @@ bool stCaf_relaxedFilterByOutgroup(stPinchSegment *segment1,
 
 /*
  * Filters incoming alignments by presence of repeat species in
- * block. This code is inefficient and does not scale.
+ * block.
  */
 bool stCaf_filterByRepeatSpecies(stPinchSegment *segment1,
                                  stPinchSegment *segment2);
@@ -29,6 +29,9 @@ typedef struct {
     void *unit;
 } HomologyUnit;
 
+// Fetches the bases of threads around homology units on demand.
+typedef struct _stCaf_ThreadStringProvider stCaf_ThreadStringProvider;
+
 // A "split branch": a branch in a block tree that, if removed, would
 // produce a partition of the leaf set that would remove an ancient
 // homology. In practice, this means that split branches have a
@@ -189,7 +192,7 @@ void stCaf_removeSplitBranches(HomologyUnit *unit, stTree *tree,
  */
 void stCaf_buildTreesToRemoveAncientHomologies(stPinchThreadSet *threadSet,
                                                HomologyUnitType type,
-                                               stHash *threadStrings,
+                                               stCaf_ThreadStringProvider *threadStrings,
                                                stSet *outgroupThreads,
                                                Flower *flower,
                                                stCaf_PhylogenyParameters *params,
@@ -201,6 +204,43 @@ void stCaf_buildTreesToRemoveAncientHomologies(stPinchThreadSet *threadSet,
  */
 stHash *stCaf_getThreadStrings(Flower *flower, stPinchThreadSet *threadSet);
 
+/*
+ * The default number of bases a thread string provider caches.
+ */
+#define ST_CAF_THREAD_STRING_CACHE_SIZE 268435456
+
+/*
+ * Constructs a provider of the strings of the threads of the flower, which fetches the bases
+ * around homology units from the cactus disk on demand, caching at most (roughly) maxCacheSize
+ * bases of them. Can be used by several threads at once.
+ */
+stCaf_ThreadStringProvider *stCaf_ThreadStringProvider_construct(Flower *flower, int64_t maxCacheSize);
+
+void stCaf_ThreadStringProvider_destruct(stCaf_ThreadStringProvider *provider);
+
+/*
+ * Gets the number of bases currently cached.
+ */
+int64_t stCaf_ThreadStringProvider_getCacheSize(stCaf_ThreadStringProvider *provider);
+
+/*
+ * Gets a map from threads to strings, as stCaf_getThreadStrings, but with the bases filled in
+ * only for the segments of the blocks and those within the given distances of them, which is all
+ * the feature blocks and columns of the blocks can use. The strings must be released with
+ * stCaf_ThreadStringProvider_releaseStrings.
+ */
+stHash *stCaf_ThreadStringProvider_getStrings(stCaf_ThreadStringProvider *provider, stList *blocks,
+        int64_t maxBaseDistance, int64_t maxBlockDistance, bool ignoreUnalignedBases);
+
+/*
+ * As stCaf_ThreadStringProvider_getStrings, but with no bases filled in, for callers that need the
+ * strings of the threads but never read their bases, which are then not fetched.
+ */
+stHash *stCaf_ThreadStringProvider_getUnfilledStrings(stCaf_ThreadStringProvider *provider, stList *blocks,
+        int64_t maxBaseDistance, int64_t maxBlockDistance, bool ignoreUnalignedBases);
+
+void stCaf_ThreadStringProvider_releaseStrings(stHash *strings);
+
 /*
  * Gets the sub-set of threads that are part of outgroup events.
  */
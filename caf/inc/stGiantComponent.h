@@ -11,14 +11,34 @@
 #include "sonLib.h"
 #include "stPinchGraphs.h"
 
+/*
+ * An edge between two nodes, numbered from 0, for stCaf_breakupComponentGreedily2.
+ */
+typedef struct _stCaf_WeightedEdge {
+    int64_t weight;
+    int64_t node1;
+    int64_t node2;
+    bool rejected;
+} stCaf_WeightedEdge;
+
 /*
  * Nodes is a list of integers representing the nodes.
  * Each edge is represented as an int tuple (weight, vertex1, vertex2).
- * Returns a sublist of the edges in edges that must deleted, so that the size of the largest component in the graph
- * is smaller than maxComponentSize.
+ * Returns a list of copies of the edges in edges that must deleted, so that the size of the largest component in the graph
+ * is smaller than maxComponentSize. The list owns the copies.
  */
 stList *stCaf_breakupComponentGreedily(stList *nodes, stList *edges, int64_t maxComponentSize);
 
+/*
+ * As stCaf_breakupComponentGreedily, but for nodes numbered 0 to nodeNumber - 1 and an array of edges.
+ * Adds the edges in descending order of weight, then nodes, keeping each that does not join two components
+ * into one larger than maxComponentSize. Heap sorts the edges in place, so they end up in ascending order,
+ * sets the rejected flag of each and returns the number rejected. Beyond the edges, uses memory linear in the
+ * number of nodes.
+ */
+int64_t stCaf_breakupComponentGreedily2(int64_t nodeNumber, stCaf_WeightedEdge *edges, int64_t edgeNumber,
+        int64_t maxComponentSize);
+
 /*
  * Break up component extra large compoonents greedily.
  */
@@ -10,11 +10,29 @@
 
 #include "cactus.h"
 #include "sonLib.h"
+#include "stPinchIterator.h"
 
 stList *stCaf_selfAlignFlower(Flower *flower, int64_t minimumSequenceLength, const char *lastzArgs,
         bool realign, const char *realignArgs,
         char *tempFile1);
 
+/*
+ * Runs the command, which must write cigars to its standard output, returning an iterator over the pinches of
+ * the alignments. The alignments are read on a separate thread as the command produces them, so the iterator can
+ * be used while the command is still running. If convertCoordinates is non-zero the coordinates of the alignments
+ * are converted from those of the sequences written by writeFlowerSequencesInFile. If sortByScore is non-zero the
+ * iterator waits for the command to finish and returns the alignments in descending order of score. If command is
+ * NULL the iterator is empty. Aborts if the command fails.
+ */
+stPinchIterator *stCaf_streamAlignmentsFromCommand(const char *command, bool convertCoordinates, bool sortByScore);
+
+/*
+ * As stCaf_selfAlignFlower, but returns the alignments as a stream from stCaf_streamAlignmentsFromCommand.
+ * tempFile1 must not be changed until the iterator is destructed.
+ */
+stPinchIterator *stCaf_selfAlignFlowerAsStream(Flower *flower, int64_t minimumSequenceLength, const char *lastzArgs,
+        bool realign, const char *realignArgs, bool sortByScore, char *tempFile1);
+
 void stCaf_sortCigarsByScoreInDescendingOrder(stList *cigars);
 
 void stCaf_sortCigarsFileByScoreInDescendingOrder(char *cigarsFile, char *sortedFile);
@@ -13,6 +13,8 @@
 
 typedef struct _stPinchIterator stPinchIterator;
 
+struct PairwiseAlignment;
+
 /*
  * Get next alignment from iterator.
  */
@@ -31,12 +33,38 @@ void stPinchIterator_reset(
 void stPinchIterator_destruct(
         stPinchIterator *stPinchIterator);
 
+/*
+ * Constructs an iterator from functions on alignmentArg. getNextAlignment returns the next pinch, which
+ * the iterator may modify, or NULL at the end. startAlignmentStack returns to the beginning, returning
+ * the new alignmentArg, and destructAlignmentArg is called when the iterator is destructed.
+ */
+stPinchIterator *stPinchIterator_construct(void *alignmentArg, stPinch *(*getNextAlignment)(void *),
+        void *(*startAlignmentStack)(void *), void (*destructAlignmentArg)(void *));
+
+/*
+ * Sets a function on alignmentArg that returns non-zero if getNextAlignment would return without waiting for more
+ * alignments to arrive. Without one the iterator never waits.
+ */
+void stPinchIterator_setIsNextReady(stPinchIterator *pinchIterator, bool (*isNextReady)(void *));
+
+/*
+ * Returns non-zero if stPinchIterator_getNext would return without waiting for more alignments to arrive, as when
+ * the iterator streams the alignments of a command that is still running.
+ */
+bool stPinchIterator_isNextReady(stPinchIterator *pinchIterator);
+
 /*
  * Get a pairwise alignment iterator from a file.
  */
 stPinchIterator *stPinchIterator_constructFromFile(
         const char *alignmentFile);
 
+/*
+ * Get a pairwise alignment iterator from a binary alignments file (see stBinaryAlignments.h).
+ */
+stPinchIterator *stPinchIterator_constructFromBinaryFile(
+        const char *binaryFile);
+
 /*
  * Get a pairwise alignment iterator from a list of alignments.
  * Does not cleanup the list or modify the list.
@@ -50,6 +78,11 @@ stPinchIterator *stPinchIterator_constructFromList(
 stPinchIterator *stPinchIterator_constructFromAlignedPairs(
         stSortedSet *alignedPairs, stPinch *(*getNextAlignedPairAlignment)(stSortedSetIterator *));
 
+/*
+ * Returns the gapless matches of a pairwise alignment as a list of pinches, which the list frees.
+ */
+stList *stPinchIterator_getPinchesOfPairwiseAlignment(struct PairwiseAlignment *pairwiseAlignment);
+
 /*
  * Sets the amount to trim from the ends of each pinch in bases.
  */
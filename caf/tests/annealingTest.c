@@ -14,6 +14,10 @@ void stCaf_anneal2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *
 void stCaf_annealBetweenAdjacencyComponents2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *),
         void *extraArg, bool (*filterFn)(stPinchSegment *, stPinchSegment *));
 
+void stCaf_annealInParallel2(stPinchThreadSet *threadSet, stPinch *(*pinchIterator)(void *),
+        bool (*isNextPinchReady)(void *), void *extraArg, stSortedSet *adjacencyComponentIntervals,
+        bool (*filterFn)(stPinchSegment *, stPinchSegment *), int64_t numThreads, int64_t batchSize);
+
 static stPinch *randomPinch(void *extraArg) {
     if(st_random() < 0.01) {
         return NULL;
@@ -41,9 +45,130 @@ static void testAnnealingBetweenAdjacencyComponents(CuTest *testCase) {
     }
 }
 
+/*
+ * Pinches for comparing serial and parallel annealing. The pinches are fixed in advance so the same
+ * ones can be given to both.
+ */
+
+typedef struct _pinchList {
+    stPinch *pinches;
+    int64_t length;
+    int64_t index;
+} PinchList;
+
+static stPinch *pinchList_getNext(PinchList *pinchList) {
+    return pinchList->index < pinchList->length ? &pinchList->pinches[pinchList->index++] : NULL;
+}
+
+static bool pinchList_isNextReady(PinchList *pinchList) {
+    //As a stream that stalls now and then, so partial batches are annealed.
+    return st_random() > 0.2;
+}
+
+static PinchList *getRandomPinches(stPinchThreadSet *threadSet, int64_t groups) {
+    /*
+     * Gets random pinches, mostly between threads whose names are equal modulo the number of groups, so that
+     * the threads form several components.
+     */
+    PinchList *pinchList = st_malloc(sizeof(PinchList));
+    pinchList->length = st_randomInt(0, 1000);
+    pinchList->pinches = st_malloc(sizeof(stPinch) * pinchList->length);
+    pinchList->index = 0;
+    for (int64_t i = 0; i < pinchList->length;) {
+        stPinch pinch = stPinchThreadSet_getRandomPinch(threadSet);
+        if (pinch.name1 % groups == pinch.name2 % groups || st_random() < 0.01) {
+            pinchList->pinches[i++] = pinch;
+        }
+    }
+    return pinchList;
+}
+
+static void checkThreadSetsIdentical(CuTest *testCase, stPinchThreadSet *threadSet1, stPinchThreadSet *threadSet2) {
+    CuAssertIntEquals(testCase, stPinchThreadSet_getSize(threadSet1), stPinchThreadSet_getSize(threadSet2));
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet1);
+    stPinchThread *thread1;
+    while ((thread1 = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet2, stPinchThread_getName(thread1));
+        CuAssertTrue(testCase, thread2 != NULL);
+        stPinchSegment *segment1 = stPinchThread_getFirst(thread1);
+        stPinchSegment *segment2 = stPinchThread_getFirst(thread2);
+        while (segment1 != NULL) {
+            CuAssertTrue(testCase, segment2 != NULL);
+            CuAssertIntEquals(testCase, stPinchSegment_getStart(segment1), stPinchSegment_getStart(segment2));
+            CuAssertIntEquals(testCase, stPinchSegment_getLength(segment1), stPinchSegment_getLength(segment2));
+            stPinchBlock *block1 = stPinchSegment_getBlock(segment1);
+            stPinchBlock *block2 = stPinchSegment_getBlock(segment2);
+            CuAssertTrue(testCase, (block1 == NULL) == (block2 == NULL));
+            if (block1 != NULL) {
+                //The blocks should be the same, with the same first segment and orientations.
+                CuAssertIntEquals(testCase, stPinchBlock_getDegree(block1), stPinchBlock_getDegree(block2));
+                stPinchSegment *first1 = stPinchBlock_getFirst(block1);
+                stPinchSegment *first2 = stPinchBlock_getFirst(block2);
+                CuAssertIntEquals(testCase, stPinchSegment_getName(first1), stPinchSegment_getName(first2));
+                CuAssertIntEquals(testCase, stPinchSegment_getStart(first1), stPinchSegment_getStart(first2));
+                CuAssertIntEquals(testCase, stPinchSegment_getBlockOrientation(segment1),
+                        stPinchSegment_getBlockOrientation(segment2));
+            }
+            segment1 = stPinchSegment_get3Prime(segment1);
+            segment2 = stPinchSegment_get3Prime(segment2);
+        }
+        CuAssertTrue(testCase, segment2 == NULL);
+    }
+}
+
+static void testAnnealingInParallel(CuTest *testCase, bool betweenAdjacencyComponents) {
+    for (int64_t test = 0; test < 100; test++) {
+        st_logInfo("Starting parallel annealing random test %" PRIi64 "\n", test);
+        //Make two copies of the same random graph.
+        int64_t seed = st_randomInt(0, INT64_MAX);
+        st_randomSeed(seed);
+        stPinchThreadSet *threadSet1 = betweenAdjacencyComponents ? stPinchThreadSet_getRandomGraph() : stPinchThreadSet_getRandomEmptyGraph();
+        st_randomSeed(seed);
+        stPinchThreadSet *threadSet2 = betweenAdjacencyComponents ? stPinchThreadSet_getRandomGraph() : stPinchThreadSet_getRandomEmptyGraph();
+        PinchList *pinchList = getRandomPinches(threadSet1, st_randomInt(1, 5));
+        int64_t batchSize = st_randomInt(1, 100);
+        if (betweenAdjacencyComponents) {
+            stCaf_annealBetweenAdjacencyComponents2(threadSet1, (stPinch *(*)(void *)) pinchList_getNext, pinchList, NULL);
+        } else {
+            stCaf_anneal2(threadSet1, (stPinch *(*)(void *)) pinchList_getNext, pinchList);
+        }
+        pinchList->index = 0;
+        stSortedSet *adjacencyComponentIntervals = NULL;
+        stList *adjacencyComponents = NULL;
+        if (betweenAdjacencyComponents) {
+            stHash *pinchEndsToAdjacencyComponents;
+            adjacencyComponents = stPinchThreadSet_getAdjacencyComponents2(threadSet2, &pinchEndsToAdjacencyComponents);
+            adjacencyComponentIntervals = stPinchThreadSet_getLabelIntervals(threadSet2, pinchEndsToAdjacencyComponents);
+            stHash_destruct(pinchEndsToAdjacencyComponents);
+        }
+        bool (*isNextReady)(void *) = st_random() > 0.5 ? (bool (*)(void *)) pinchList_isNextReady : NULL;
+        stCaf_annealInParallel2(threadSet2, (stPinch *(*)(void *)) pinchList_getNext, isNextReady, pinchList,
+                adjacencyComponentIntervals, NULL, 4, batchSize);
+        checkThreadSetsIdentical(testCase, threadSet1, threadSet2);
+        if (betweenAdjacencyComponents) {
+            stSortedSet_destruct(adjacencyComponentIntervals);
+            stList_destruct(adjacencyComponents);
+        }
+        free(pinchList->pinches);
+        free(pinchList);
+        stPinchThreadSet_destruct(threadSet1);
+        stPinchThreadSet_destruct(threadSet2);
+    }
+}
+
+static void testAnnealingInParallel_all(CuTest *testCase) {
+    testAnnealingInParallel(testCase, 0);
+}
+
+static void testAnnealingInParallel_betweenAdjacencyComponents(CuTest *testCase) {
+    testAnnealingInParallel(testCase, 1);
+}
+
 CuSuite* annealingTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testAnnealing);
     SUITE_ADD_TEST(suite, testAnnealingBetweenAdjacencyComponents);
+    SUITE_ADD_TEST(suite, testAnnealingInParallel_all);
+    SUITE_ADD_TEST(suite, testAnnealingInParallel_betweenAdjacencyComponents);
     return suite;
 }
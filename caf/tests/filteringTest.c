@@ -349,11 +349,108 @@ static void testHGVMFiltering(CuTest *testCase) {
     }
 }
 
+static stSet *getEventsDirectly(stPinchSegment *segment) {
+    stSet *events = stSet_construct();
+    stPinchBlock *block = stPinchSegment_getBlock(segment);
+    if (block != NULL) {
+        stPinchBlockIt it = stPinchBlock_getSegmentIterator(block);
+        stPinchSegment *segment2;
+        while ((segment2 = stPinchBlockIt_getNext(&it)) != NULL) {
+            stSet_insert(events, stCaf_getEvent(segment2, flower));
+        }
+    } else {
+        stSet_insert(events, stCaf_getEvent(segment, flower));
+    }
+    return events;
+}
+
+static bool eventsIntersectDirectly(stSet *events1, stSet *events2, bool ingroupsOnly) {
+    bool intersect = false;
+    stSetIterator *it = stSet_getIterator(events1);
+    Event *event;
+    while ((event = stSet_getNext(it)) != NULL) {
+        if (stSet_search(events2, event) && (!ingroupsOnly || !event_isOutgroup(event))) {
+            intersect = true;
+        }
+    }
+    stSet_destructIterator(it);
+    return intersect;
+}
+
+static bool containsOutgroupDirectly(stSet *events) {
+    bool outgroup = false;
+    stSetIterator *it = stSet_getIterator(events);
+    Event *event;
+    while ((event = stSet_getNext(it)) != NULL) {
+        outgroup = outgroup || event_isOutgroup(event);
+    }
+    stSet_destructIterator(it);
+    return outgroup;
+}
+
+static stPinchSegment *getRandomSegment(stPinchThreadSet *threadSet, stList *threadNames) {
+    stPinchThread *thread = stPinchThreadSet_getThread(threadSet, *(Name *) st_randomChoice(threadNames));
+    return stPinchThread_getSegment(thread, st_randomInt(stPinchThread_getStart(thread),
+            stPinchThread_getStart(thread) + stPinchThread_getLength(thread)));
+}
+
+static void testFiltersAgreeWithBlockEvents(CuTest *testCase) {
+    /*
+     * The filters use cached summaries of the events in each block, which must stay in step with the blocks
+     * as they are pinched together.
+     */
+    for (int64_t testNum = 0; testNum < 20; testNum++) {
+        setup(true);
+        Event *events[] = { ingroup1, ingroup2, outgroup1, outgroup2 };
+        stList *threadNames = stList_construct3(0, free);
+        for (int64_t i = 0; i < 12; i++) {
+            Name *threadName = st_malloc(sizeof(Name));
+            *threadName = addThreadToFlower(flower, events[st_randomInt(0, 4)], 100);
+            stList_append(threadNames, threadName);
+        }
+        stCaf_setFlowerForAlignmentFiltering(flower);
+        stPinchThreadSet *threadSet = stCaf_setup(flower);
+        stCaf_resetAlignmentFilteringCache();
+
+        for (int64_t i = 0; i < 500; i++) {
+            for (int64_t j = 0; j < 10; j++) {
+                stPinchSegment *segment1 = getRandomSegment(threadSet, threadNames);
+                stPinchSegment *segment2 = getRandomSegment(threadSet, threadNames);
+                stSet *events1 = getEventsDirectly(segment1);
+                stSet *events2 = getEventsDirectly(segment2);
+                bool blocks = stPinchSegment_getBlock(segment1) != NULL && stPinchSegment_getBlock(segment2) != NULL;
+                CuAssertIntEquals(testCase, eventsIntersectDirectly(events1, events2, 0),
+                        stCaf_filterByRepeatSpecies(segment1, segment2));
+                CuAssertIntEquals(testCase, blocks && eventsIntersectDirectly(events1, events2, 0),
+                        stCaf_relaxedFilterByRepeatSpecies(segment1, segment2));
+                CuAssertIntEquals(testCase, eventsIntersectDirectly(events1, events2, 1),
+                        stCaf_singleCopyIngroup(segment1, segment2));
+                if (stPinchSegment_getBlock(segment1) == NULL || stPinchSegment_getBlock(segment1) != stPinchSegment_getBlock(segment2)) {
+                    CuAssertIntEquals(testCase, containsOutgroupDirectly(events1) && containsOutgroupDirectly(events2),
+                            stCaf_filterByOutgroup(segment1, segment2));
+                }
+                stSet_destruct(events1);
+                stSet_destruct(events2);
+            }
+            stPinch pinch = stPinchThreadSet_getRandomPinch(threadSet);
+            stPinchThread_filterPinch(stPinchThreadSet_getThread(threadSet, pinch.name1),
+                                      stPinchThreadSet_getThread(threadSet, pinch.name2),
+                                      pinch.start1, pinch.start2, pinch.length, pinch.strand,
+                                      st_random() > 0.5 ? stCaf_relaxedFilterByRepeatSpecies : stCaf_relaxedFilterByOutgroup);
+        }
+
+        stList_destruct(threadNames);
+        stPinchThreadSet_destruct(threadSet);
+        teardown();
+    }
+}
+
 CuSuite* filteringTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testChainHasUnequalNumberOfIngroupCopies);
     SUITE_ADD_TEST(suite, testChainHasUnequalNumberOfIngroupCopiesOrNoOutgroup);
     SUITE_ADD_TEST(suite, testChainHasUnequalNumberOfIngroupCopiesOrNoOutgroup_noOutgroups);
     SUITE_ADD_TEST(suite, testHGVMFiltering);
+    SUITE_ADD_TEST(suite, testFiltersAgreeWithBlockEvents);
     return suite;
 }
@@ -137,6 +137,45 @@ static void testBreakUpComponentGreedily(CuTest *testCase) {
     }
 }
 
+static void testBreakUpComponentGreedily2(CuTest *testCase) {
+    /*
+     * The nodes made by setup are numbered from 0, so the edges can be given to the engine directly. The edges
+     * it keeps should satisfy the same checks, and it should leave the edges sorted.
+     */
+    for (int64_t test = 0; test < 100; test++) {
+        setup();
+        stCaf_WeightedEdge *weightedEdges = st_malloc(sizeof(stCaf_WeightedEdge) * (stList_length(edges) + 1));
+        for (int64_t i = 0; i < stList_length(edges); i++) {
+            stIntTuple *edge = stList_get(edges, i);
+            weightedEdges[i].weight = stIntTuple_get(edge, 0);
+            weightedEdges[i].node1 = stIntTuple_get(edge, 1);
+            weightedEdges[i].node2 = stIntTuple_get(edge, 2);
+        }
+        int64_t rejectedEdges = stCaf_breakupComponentGreedily2(stList_length(nodes), weightedEdges, stList_length(edges),
+                maxComponentSize);
+        stList *filteredEdges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+        for (int64_t i = 0; i < stList_length(edges); i++) {
+            stCaf_WeightedEdge *edge = &weightedEdges[i];
+            if (i > 0) {
+                stCaf_WeightedEdge *previousEdge = &weightedEdges[i - 1];
+                CuAssertTrue(testCase, previousEdge->weight < edge->weight || (previousEdge->weight == edge->weight
+                        && (previousEdge->node1 < edge->node1 || (previousEdge->node1 == edge->node1
+                        && previousEdge->node2 <= edge->node2))));
+            }
+            if (edge->rejected) {
+                rejectedEdges--;
+            } else {
+                stList_append(filteredEdges, stIntTuple_construct3(edge->weight, edge->node1, edge->node2));
+            }
+        }
+        CuAssertIntEquals(testCase, 0, rejectedEdges);
+        checkComponents(testCase, filteredEdges);
+        stList_destruct(filteredEdges);
+        free(weightedEdges);
+        teardown();
+    }
+}
+
 static int64_t getSizeOfLargestAdjacencyComponent(stList *adjacencyComponents) {
     int64_t largestAdjacencyComponentSizeInGraph = 0;
     for (int64_t i = 0; i < stList_length(adjacencyComponents); i++) {
@@ -184,6 +223,7 @@ static void testBreakUpPinchGraphAdjacencyComponentsGreedily(CuTest *testCase) {
 CuSuite* giantComponentTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testBreakUpComponentGreedily);
+    SUITE_ADD_TEST(suite, testBreakUpComponentGreedily2);
     SUITE_ADD_TEST(suite, testBreakUpPinchGraphAdjacencyComponentsGreedily);
     return suite;
 }
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "CuTest.h"
+#include "sonLib.h"
+#include "stCaf.h"
+#include "stPinchGraphs.h"
+
+static void pinchRandomly(stPinchThreadSet *threadSet, stList *threadNames, int64_t threadLength, int64_t groups,
+        int64_t pinchNumber) {
+    /*
+     * Pinches random intervals of the sequences of the threads, mostly between threads in the same group, so the
+     * threads form several components that melting can split.
+     */
+    for (int64_t i = 0; i < pinchNumber;) {
+        int64_t j = st_randomInt(0, stList_length(threadNames));
+        int64_t k = st_randomInt(0, stList_length(threadNames));
+        if (j % groups != k % groups && st_random() > 0.05) {
+            continue;
+        }
+        int64_t length = st_randomInt(1, 20);
+        //The sequence of each thread runs from 2 to threadLength + 1, between its caps.
+        int64_t start1 = st_randomInt(2, threadLength + 2 - length);
+        int64_t start2 = st_randomInt(2, threadLength + 2 - length);
+        stPinchThread *thread1 = stPinchThreadSet_getThread(threadSet, *(Name *) stList_get(threadNames, j));
+        stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet, *(Name *) stList_get(threadNames, k));
+        stPinchThread_pinch(thread1, thread2, start1, start2, length, st_random() > 0.5);
+        i++;
+    }
+}
+
+static void getBlockKey(stPinchBlock *block, int64_t *name, int64_t *start) {
+    /*
+     * The least segment of the block, which identifies it independently of the order it was built in.
+     */
+    *name = INT64_MAX;
+    *start = INT64_MAX;
+    stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(block);
+    stPinchSegment *segment;
+    while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+        if (stPinchSegment_getName(segment) < *name
+                || (stPinchSegment_getName(segment) == *name && stPinchSegment_getStart(segment) < *start)) {
+            *name = stPinchSegment_getName(segment);
+            *start = stPinchSegment_getStart(segment);
+        }
+    }
+}
+
+static void checkThreadSetsEquivalent(CuTest *testCase, stPinchThreadSet *threadSet1, stPinchThreadSet *threadSet2) {
+    CuAssertIntEquals(testCase, stPinchThreadSet_getTotalBlockNumber(threadSet1), stPinchThreadSet_getTotalBlockNumber(threadSet2));
+    stPinchThreadSetIt threadIt = stPinchThreadSet_getIt(threadSet1);
+    stPinchThread *thread1;
+    while ((thread1 = stPinchThreadSetIt_getNext(&threadIt)) != NULL) {
+        stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet2, stPinchThread_getName(thread1));
+        CuAssertTrue(testCase, thread2 != NULL);
+        stPinchSegment *segment1 = stPinchThread_getFirst(thread1);
+        stPinchSegment *segment2 = stPinchThread_getFirst(thread2);
+        while (segment1 != NULL) {
+            CuAssertTrue(testCase, segment2 != NULL);
+            CuAssertIntEquals(testCase, stPinchSegment_getStart(segment1), stPinchSegment_getStart(segment2));
+            CuAssertIntEquals(testCase, stPinchSegment_getLength(segment1), stPinchSegment_getLength(segment2));
+            stPinchBlock *block1 = stPinchSegment_getBlock(segment1);
+            stPinchBlock *block2 = stPinchSegment_getBlock(segment2);
+            CuAssertTrue(testCase, (block1 == NULL) == (block2 == NULL));
+            if (block1 != NULL) {
+                CuAssertIntEquals(testCase, stPinchBlock_getDegree(block1), stPinchBlock_getDegree(block2));
+                int64_t name1, start1, name2, start2;
+                getBlockKey(block1, &name1, &start1);
+                getBlockKey(block2, &name2, &start2);
+                CuAssertIntEquals(testCase, name1, name2);
+                CuAssertIntEquals(testCase, start1, start2);
+            }
+            segment1 = stPinchSegment_get3Prime(segment1);
+            segment2 = stPinchSegment_get3Prime(segment2);
+        }
+        CuAssertTrue(testCase, segment2 == NULL);
+    }
+}
+
+static void testMeltInRounds(CuTest *testCase) {
+    /*
+     * Melting in rounds should give the same graph as melting round by round, rebuilding the cactus graph each time.
+     * The flower is the top level flower, so thread components split by melting must be attached.
+     */
+    for (int64_t test = 0; test < 50; test++) {
+        CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+        eventTree_construct2(cactusDisk);
+        Flower *flower = flower_construct2(0, cactusDisk);
+        group_construct2(flower);
+        int64_t threadNumber = st_randomInt(2, 20), threadLength = 200, groups = st_randomInt(1, 4);
+        stList *threadNames = stList_construct3(0, free);
+        for (int64_t i = 0; i < threadNumber; i++) {
+            Name *threadName = st_malloc(sizeof(Name));
+            char *header = stString_print("thread%" PRIi64 "", i);
+            *threadName = testCommon_addThreadToFlower(flower, header, threadLength);
+            free(header);
+            stList_append(threadNames, threadName);
+        }
+        stPinchThreadSet *threadSet1 = stCaf_setup(flower);
+        stPinchThreadSet *threadSet2 = stCaf_constructEmptyPinchGraph(flower);
+        int64_t seed = st_randomInt(0, INT64_MAX);
+        int64_t pinchNumber = st_randomInt(0, 200);
+        st_randomSeed(seed);
+        pinchRandomly(threadSet1, threadNames, threadLength, groups, pinchNumber);
+        st_randomSeed(seed);
+        pinchRandomly(threadSet2, threadNames, threadLength, groups, pinchNumber);
+        checkThreadSetsEquivalent(testCase, threadSet1, threadSet2);
+
+        int64_t minimumChainLengths[] = { 2, 4, 8, 16, 32, 64 };
+        int64_t roundNumber = st_randomInt(0, 7);
+        st_logInfo("Doing a random melting test %" PRIi64 " with %" PRIi64 " threads, %" PRIi64 " pinches and %" PRIi64 " rounds\n",
+                test, threadNumber, pinchNumber, roundNumber);
+        for (int64_t i = 0; i < roundNumber; i++) {
+            stCaf_melt(flower, threadSet1, NULL, 0, minimumChainLengths[i], 0, INT64_MAX);
+        }
+        stCaf_meltInRounds(flower, threadSet2, minimumChainLengths, roundNumber);
+        if (roundNumber == 0) {
+            stCaf_joinTrivialBoundaries(threadSet1);
+            stCaf_joinTrivialBoundaries(threadSet2);
+        }
+        checkThreadSetsEquivalent(testCase, threadSet1, threadSet2);
+
+        stPinchThreadSet_destruct(threadSet1);
+        stPinchThreadSet_destruct(threadSet2);
+        stList_destruct(threadNames);
+        testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    }
+}
+
+CuSuite* meltingTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testMeltInRounds);
+    return suite;
+}
@@ -487,6 +487,186 @@ static void test_stCaf_correctChainOrientation(CuTest *testCase) {
     stPinchThreadSet_destruct(threadSet);
 }
 
+static void checkSegmentString(CuTest *testCase, stPinchSegment *segment, stHash *strings, stHash *expectedStrings) {
+    stPinchThread *thread = stPinchSegment_getThread(segment);
+    char *string = stHash_search(strings, thread);
+    char *expectedString = stHash_search(expectedStrings, thread);
+    CuAssertTrue(testCase, string != NULL);
+    int64_t offset = stPinchSegment_getStart(segment) - stPinchThread_getStart(thread);
+    CuAssertTrue(testCase, memcmp(string + offset, expectedString + offset, stPinchSegment_getLength(segment)) == 0);
+    CuAssertTrue(testCase, string[0] == 'N');
+    CuAssertTrue(testCase, string[stPinchThread_getLength(thread) - 1] == 'N');
+}
+
+static void test_stCaf_ThreadStringProvider(CuTest *testCase) {
+    /*
+     * The strings the provider gives for each block should agree with the full thread strings over the
+     * segments of the block and the segments next to them, however small the cache.
+     */
+    for (int64_t test = 0; test < 20; test++) {
+        CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+        eventTree_construct2(cactusDisk);
+        Flower *flower = flower_construct2(0, cactusDisk);
+        group_construct2(flower);
+        int64_t threadNumber = st_randomInt(1, 10), threadLength = st_randomInt(1, 1000);
+        stList *threadNames = stList_construct3(0, free);
+        for (int64_t i = 0; i < threadNumber; i++) {
+            Name *threadName = st_malloc(sizeof(Name));
+            char *header = stString_print("thread%" PRIi64 "", i);
+            *threadName = testCommon_addThreadToFlower(flower, header, threadLength);
+            free(header);
+            stList_append(threadNames, threadName);
+        }
+        stPinchThreadSet *threadSet = stCaf_setup(flower);
+        int64_t pinchNumber = st_randomInt(0, 100);
+        for (int64_t i = 0; i < pinchNumber; i++) {
+            int64_t length = st_randomInt(1, threadLength + 1);
+            stPinchThread *thread1 = stPinchThreadSet_getThread(threadSet,
+                    *(Name *) stList_get(threadNames, st_randomInt(0, threadNumber)));
+            stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet,
+                    *(Name *) stList_get(threadNames, st_randomInt(0, threadNumber)));
+            stPinchThread_pinch(thread1, thread2, st_randomInt(2, threadLength + 3 - length),
+                    st_randomInt(2, threadLength + 3 - length), length, st_random() > 0.5);
+        }
+
+        stHash *expectedStrings = stCaf_getThreadStrings(flower, threadSet);
+        int64_t maxCacheSize = st_randomInt(0, 2000);
+        stCaf_ThreadStringProvider *provider = stCaf_ThreadStringProvider_construct(flower, maxCacheSize);
+        stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+        stPinchBlock *block;
+        while ((block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL) {
+            stList *blocks = stList_construct();
+            stList_append(blocks, block);
+            int64_t maxBaseDistance = st_randomInt(0, 100), maxBlockDistance = st_randomInt(0, 10);
+            bool ignoreUnalignedBases = st_random() > 0.5;
+            stHash *strings = stCaf_ThreadStringProvider_getStrings(provider, blocks, maxBaseDistance,
+                    maxBlockDistance, ignoreUnalignedBases);
+            //Nothing is left pinned, so the cache is back within its size.
+            CuAssertTrue(testCase, stCaf_ThreadStringProvider_getCacheSize(provider) <= maxCacheSize);
+            //The unfilled strings are for the same threads, and fetch nothing.
+            int64_t cacheSize = stCaf_ThreadStringProvider_getCacheSize(provider);
+            stHash *unfilledStrings = stCaf_ThreadStringProvider_getUnfilledStrings(provider, blocks, maxBaseDistance,
+                    maxBlockDistance, ignoreUnalignedBases);
+            CuAssertIntEquals(testCase, stHash_size(strings), stHash_size(unfilledStrings));
+            CuAssertIntEquals(testCase, cacheSize, stCaf_ThreadStringProvider_getCacheSize(provider));
+            stCaf_ThreadStringProvider_releaseStrings(unfilledStrings);
+            stPinchBlockIt segmentIt = stPinchBlock_getSegmentIterator(block);
+            stPinchSegment *segment;
+            while ((segment = stPinchBlockIt_getNext(&segmentIt)) != NULL) {
+                checkSegmentString(testCase, segment, strings, expectedStrings);
+                stPinchSegment *adjacentSegment = stPinchSegment_get5Prime(segment);
+                if (adjacentSegment != NULL && stPinchSegment_getBlock(adjacentSegment) != NULL) {
+                    checkSegmentString(testCase, adjacentSegment, strings, expectedStrings);
+                }
+                adjacentSegment = stPinchSegment_get3Prime(segment);
+                if (adjacentSegment != NULL && stPinchSegment_getBlock(adjacentSegment) != NULL) {
+                    checkSegmentString(testCase, adjacentSegment, strings, expectedStrings);
+                }
+            }
+            stCaf_ThreadStringProvider_releaseStrings(strings);
+            stList_destruct(blocks);
+        }
+
+        stCaf_ThreadStringProvider_destruct(provider);
+        stHash_destruct(expectedStrings);
+        stPinchThreadSet_destruct(threadSet);
+        stList_destruct(threadNames);
+        testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    }
+}
+
+static void checkMatricesEqual(CuTest *testCase, stMatrixDiffs *diffs, stMatrixDiffs *expectedDiffs) {
+    unsigned int seed = 0;
+    stMatrix *matrix = stPinchPhylogeny_constructMatrixFromDiffs(diffs, false, &seed);
+    stMatrix *expectedMatrix = stPinchPhylogeny_constructMatrixFromDiffs(expectedDiffs, false, &seed);
+    CuAssertTrue(testCase, stMatrix_equal(matrix, expectedMatrix, 0.0));
+    stMatrix_destruct(matrix);
+    stMatrix_destruct(expectedMatrix);
+}
+
+static void test_stCaf_ThreadStringProviderFeatureBlocks(CuTest *testCase) {
+    /*
+     * The feature blocks built from the provider's strings should give the same columns, and so the same
+     * substitution and breakpoint matrices the trees are built from, as those built from the full thread
+     * strings. The contextual walk reaches up to maxBlockDistance blocks and maxBaseDistance bases away,
+     * through unaligned segments too, and a base the provider missed would read as a zero, not fail.
+     */
+    for (int64_t test = 0; test < 20; test++) {
+        CactusDisk *cactusDisk = testCommon_getTemporaryCactusDisk();
+        eventTree_construct2(cactusDisk);
+        Flower *flower = flower_construct2(0, cactusDisk);
+        group_construct2(flower);
+        int64_t threadNumber = st_randomInt(2, 10), threadLength = st_randomInt(100, 2000);
+        stList *threadNames = stList_construct3(0, free);
+        for (int64_t i = 0; i < threadNumber; i++) {
+            Name *threadName = st_malloc(sizeof(Name));
+            char *header = stString_print("thread%" PRIi64 "", i);
+            *threadName = testCommon_addThreadToFlower(flower, header, threadLength);
+            free(header);
+            stList_append(threadNames, threadName);
+        }
+        stPinchThreadSet *threadSet = stCaf_setup(flower);
+        //Short pinches, so the blocks are separated by aligned and unaligned segments for the walk to cross.
+        int64_t pinchNumber = st_randomInt(0, 200);
+        for (int64_t i = 0; i < pinchNumber; i++) {
+            int64_t length = st_randomInt(1, 50);
+            stPinchThread *thread1 = stPinchThreadSet_getThread(threadSet,
+                    *(Name *) stList_get(threadNames, st_randomInt(0, threadNumber)));
+            stPinchThread *thread2 = stPinchThreadSet_getThread(threadSet,
+                    *(Name *) stList_get(threadNames, st_randomInt(0, threadNumber)));
+            stPinchThread_pinch(thread1, thread2, st_randomInt(2, threadLength + 3 - length),
+                    st_randomInt(2, threadLength + 3 - length), length, st_random() > 0.5);
+        }
+
+        stHash *expectedStrings = stCaf_getThreadStrings(flower, threadSet);
+        stCaf_ThreadStringProvider *provider = stCaf_ThreadStringProvider_construct(flower, st_randomInt(0, 2000));
+        stPinchThreadSetBlockIt blockIt = stPinchThreadSet_getBlockIt(threadSet);
+        stPinchBlock *block;
+        while ((block = stPinchThreadSetBlockIt_getNext(&blockIt)) != NULL) {
+            stList *blocks = stList_construct();
+            stList_append(blocks, block);
+            int64_t maxBaseDistance = st_randomInt(0, 500), maxBlockDistance = st_randomInt(0, 20);
+            bool ignoreUnalignedBases = st_random() > 0.5, onlyIncludeCompleteFeatureBlocks = st_random() > 0.5;
+            stHash *strings = stCaf_ThreadStringProvider_getStrings(provider, blocks, maxBaseDistance,
+                    maxBlockDistance, ignoreUnalignedBases);
+            stList *featureBlocks = stFeatureBlock_getContextualFeatureBlocks(block, maxBaseDistance,
+                    maxBlockDistance, ignoreUnalignedBases, onlyIncludeCompleteFeatureBlocks, strings);
+            stList *expectedFeatureBlocks = stFeatureBlock_getContextualFeatureBlocks(block, maxBaseDistance,
+                    maxBlockDistance, ignoreUnalignedBases, onlyIncludeCompleteFeatureBlocks, expectedStrings);
+            CuAssertIntEquals(testCase, stList_length(expectedFeatureBlocks), stList_length(featureBlocks));
+            stList *featureColumns = stFeatureColumn_getFeatureColumns(featureBlocks);
+            stList *expectedFeatureColumns = stFeatureColumn_getFeatureColumns(expectedFeatureBlocks);
+            CuAssertIntEquals(testCase, stList_length(expectedFeatureColumns), stList_length(featureColumns));
+
+            int64_t degree = stPinchBlock_getDegree(block);
+            stMatrixDiffs *diffs = stPinchPhylogeny_getMatrixDiffsFromSubstitutions(featureColumns, degree, NULL);
+            stMatrixDiffs *expectedDiffs = stPinchPhylogeny_getMatrixDiffsFromSubstitutions(expectedFeatureColumns,
+                    degree, NULL);
+            checkMatricesEqual(testCase, diffs, expectedDiffs);
+            stMatrixDiffs_destruct(diffs);
+            stMatrixDiffs_destruct(expectedDiffs);
+            diffs = stPinchPhylogeny_getMatrixDiffsFromBreakpoints(featureColumns, degree, NULL);
+            expectedDiffs = stPinchPhylogeny_getMatrixDiffsFromBreakpoints(expectedFeatureColumns, degree, NULL);
+            checkMatricesEqual(testCase, diffs, expectedDiffs);
+            stMatrixDiffs_destruct(diffs);
+            stMatrixDiffs_destruct(expectedDiffs);
+
+            stList_destruct(featureColumns);
+            stList_destruct(expectedFeatureColumns);
+            stList_destruct(featureBlocks);
+            stList_destruct(expectedFeatureBlocks);
+            stCaf_ThreadStringProvider_releaseStrings(strings);
+            stList_destruct(blocks);
+        }
+
+        stCaf_ThreadStringProvider_destruct(provider);
+        stHash_destruct(expectedStrings);
+        stPinchThreadSet_destruct(threadSet);
+        stList_destruct(threadNames);
+        testCommon_deleteTemporaryCactusDisk(cactusDisk);
+    }
+}
+
 CuSuite *phylogenyTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stCaf_splitBlock);
@@ -494,6 +674,8 @@ CuSuite *phylogenyTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stCaf_findAndRemoveSplitBranches);
     SUITE_ADD_TEST(suite, test_stCaf_getHomologyUnits);
     SUITE_ADD_TEST(suite, test_stCaf_correctChainOrientation);
+    SUITE_ADD_TEST(suite, test_stCaf_ThreadStringProvider);
+    SUITE_ADD_TEST(suite, test_stCaf_ThreadStringProviderFeatureBlocks);
 
     return suite;
 }
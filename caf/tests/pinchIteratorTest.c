@@ -7,6 +7,8 @@
 #include "CuTest.h"
 #include "sonLib.h"
 #include "stPinchIterator.h"
+#include "stBinaryAlignments.h"
+#include "stLastzAlignments.h"
 #include "pairwiseAlignment.h"
 #include <math.h>
 
@@ -106,6 +108,128 @@ static void testPinchIteratorFromFile(CuTest *testCase) {
     }
 }
 
+static void writeBinaryAlignmentsFile(const char *binaryFile, stList *pairwiseAlignments) {
+    stBinaryAlignmentWriter *writer = stBinaryAlignmentWriter_construct(binaryFile);
+    for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+        stBinaryAlignmentWriter_writeAlignment(writer, stList_get(pairwiseAlignments, i));
+    }
+    stBinaryAlignmentWriter_destruct(writer);
+}
+
+static void testPinchIteratorFromBinaryFile(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        stList *pairwiseAlignments = getRandomPairwiseAlignments();
+        st_logInfo("Doing a random pinch iterator from binary file test %" PRIi64 " with %" PRIi64 " alignments\n", test, stList_length(pairwiseAlignments));
+        //Put alignments in a cigar file and convert it
+        char *tempFile = "tempFileForPinchIteratorTest.cig";
+        char *binaryFile = "tempFileForPinchIteratorTest.bin";
+        FILE *fileHandle = fopen(tempFile, "w");
+        for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+            cigarWrite(fileHandle, stList_get(pairwiseAlignments, i), 0);
+        }
+        fclose(fileHandle);
+        CuAssertTrue(testCase, !stCaf_isBinaryAlignmentsFile(tempFile));
+        CuAssertIntEquals(testCase, stList_length(pairwiseAlignments), stCaf_convertCigarsFileToBinaryAlignments(tempFile, binaryFile));
+        CuAssertTrue(testCase, stCaf_isBinaryAlignmentsFile(binaryFile));
+        //Get an iterator and test it
+        stPinchIterator *pinchIterator = stPinchIterator_constructFromBinaryFile(binaryFile);
+        testIterator(testCase, pinchIterator, pairwiseAlignments);
+        //Cleanup
+        stPinchIterator_destruct(pinchIterator);
+        stFile_rmrf(tempFile);
+        stFile_rmrf(binaryFile);
+        stList_destruct(pairwiseAlignments);
+    }
+}
+
+static stList *getRandomScoredPairwiseAlignments() {
+    stList *pairwiseAlignments = stList_construct3(0, (void(*)(void *)) destructPairwiseAlignment);
+    for (int64_t i = 0; i < 5; i++) {
+        stList *moreAlignments = getRandomPairwiseAlignments();
+        stList_appendAll(pairwiseAlignments, moreAlignments);
+        stList_setDestructor(moreAlignments, NULL);
+        stList_destruct(moreAlignments);
+    }
+    //Few distinct scores, so sorting must keep the order of ties.
+    for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+        ((struct PairwiseAlignment *) stList_get(pairwiseAlignments, i))->score = st_randomInt(0, 4);
+    }
+    return pairwiseAlignments;
+}
+
+static stList *getAlignmentsSortedByScore(stList *pairwiseAlignments) {
+    //Stable insertion sort of the alignments, highest score first.
+    stList *sortedAlignments = stList_construct();
+    for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+        struct PairwiseAlignment *pairwiseAlignment = stList_get(pairwiseAlignments, i);
+        int64_t j = stList_length(sortedAlignments);
+        stList_append(sortedAlignments, pairwiseAlignment);
+        while (j > 0 && ((struct PairwiseAlignment *) stList_get(sortedAlignments, j - 1))->score < pairwiseAlignment->score) {
+            stList_set(sortedAlignments, j, stList_get(sortedAlignments, j - 1));
+            j--;
+        }
+        stList_set(sortedAlignments, j, pairwiseAlignment);
+    }
+    return sortedAlignments;
+}
+
+static void testSortBinaryAlignmentsFile(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        stList *pairwiseAlignments = getRandomScoredPairwiseAlignments();
+        //A tiny memory limit forces the file to be sorted in many runs.
+        int64_t memoryLimit = st_random() > 0.5 ? 256 : ST_BINARY_ALIGNMENTS_SORT_MEMORY;
+        st_logInfo("Doing a random binary alignments sort test %" PRIi64 " with %" PRIi64 " alignments and a memory limit of %" PRIi64 "\n",
+                test, stList_length(pairwiseAlignments), memoryLimit);
+        char *binaryFile = "tempFileForPinchIteratorTest.bin";
+        char *sortedFile = "tempFileForPinchIteratorTest.sorted.bin";
+        writeBinaryAlignmentsFile(binaryFile, pairwiseAlignments);
+        stCaf_sortBinaryAlignmentsFileByScoreInDescendingOrder(binaryFile, sortedFile, memoryLimit);
+        stList *sortedAlignments = getAlignmentsSortedByScore(pairwiseAlignments);
+        stPinchIterator *pinchIterator = stPinchIterator_constructFromBinaryFile(sortedFile);
+        testIterator(testCase, pinchIterator, sortedAlignments);
+        //The temporary files of the runs should be gone
+        CuAssertTrue(testCase, !stFile_exists("tempFileForPinchIteratorTest.sorted.bin.run0"));
+        //Cleanup
+        stPinchIterator_destruct(pinchIterator);
+        stFile_rmrf(binaryFile);
+        stFile_rmrf(sortedFile);
+        stList_destruct(sortedAlignments);
+        stList_destruct(pairwiseAlignments);
+    }
+}
+
+static void testPinchIteratorFromCommand(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        stList *pairwiseAlignments = getRandomScoredPairwiseAlignments();
+        bool sortByScore = st_random() > 0.5;
+        st_logInfo("Doing a random pinch iterator from command test %" PRIi64 " with %" PRIi64 " alignments\n", test, stList_length(pairwiseAlignments));
+        char *tempFile = "tempFileForPinchIteratorTest.cig";
+        FILE *fileHandle = fopen(tempFile, "w");
+        for (int64_t i = 0; i < stList_length(pairwiseAlignments); i++) {
+            cigarWrite(fileHandle, stList_get(pairwiseAlignments, i), 0);
+        }
+        fclose(fileHandle);
+        //Stream the alignments through a command
+        char *command = stString_print("cat %s", tempFile);
+        stPinchIterator *pinchIterator = stCaf_streamAlignmentsFromCommand(command, 0, sortByScore);
+        stList *expectedAlignments = sortByScore ? getAlignmentsSortedByScore(pairwiseAlignments) : stList_copy(pairwiseAlignments, NULL);
+        testIterator(testCase, pinchIterator, expectedAlignments);
+        //The command has finished, so the iterator no longer waits.
+        CuAssertTrue(testCase, stPinchIterator_isNextReady(pinchIterator));
+        //Cleanup
+        stPinchIterator_destruct(pinchIterator);
+        stList_destruct(expectedAlignments);
+        free(command);
+        stFile_rmrf(tempFile);
+        stList_destruct(pairwiseAlignments);
+    }
+    //An empty stream
+    stPinchIterator *pinchIterator = stCaf_streamAlignmentsFromCommand(NULL, 0, 0);
+    CuAssertTrue(testCase, stPinchIterator_isNextReady(pinchIterator));
+    CuAssertPtrEquals(testCase, NULL, stPinchIterator_getNext(pinchIterator));
+    stPinchIterator_destruct(pinchIterator);
+}
+
 static void testPinchIteratorFromList(CuTest *testCase) {
     for (int64_t test = 0; test < 100; test++) {
         stList *pairwiseAlignments = getRandomPairwiseAlignments();
@@ -124,5 +248,8 @@ CuSuite* pinchIteratorTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testPinchIteratorFromFile);
     SUITE_ADD_TEST(suite, testPinchIteratorFromList);
+    SUITE_ADD_TEST(suite, testPinchIteratorFromBinaryFile);
+    SUITE_ADD_TEST(suite, testSortBinaryAlignmentsFile);
+    SUITE_ADD_TEST(suite, testPinchIteratorFromCommand);
     return suite;
 }
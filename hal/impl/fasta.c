@@ -34,17 +34,33 @@ static stList *getSequences(Flower *flower, Name referenceEventName) {
     return sequences;
 }
 
+#define FASTA_WRITE_BUFFER_SIZE 65536
+
+static void writeFastaSequence(Sequence *sequence, FILE *fileHandle) {
+    /*
+     * Writes the sequence as fastaWrite would, reading it through a view of the string cache in
+     * chunks rather than making a copy of the whole sequence.
+     */
+    StringView stringView;
+    sequence_getStringView(sequence, sequence_getStart(sequence), sequence_getLength(sequence), 1, &stringView);
+    fprintf(fileHandle, ">%s\n", sequence_getHeader(sequence));
+    char buffer[FASTA_WRITE_BUFFER_SIZE];
+    for (int64_t i = 0; i < stringView_getLength(&stringView); i += FASTA_WRITE_BUFFER_SIZE) {
+        int64_t length = stringView_getLength(&stringView) - i;
+        length = length > FASTA_WRITE_BUFFER_SIZE ? FASTA_WRITE_BUFFER_SIZE : length;
+        stringView_copy(&stringView, i, length, buffer);
+        fwrite(buffer, sizeof(char), length, fileHandle);
+    }
+    fprintf(fileHandle, "\n");
+    stringView_release(&stringView);
+}
+
 void printFastaSequences(Flower *flower, FILE *fileHandle, Name referenceEventName) {
     stList *sequences = getSequences(flower, referenceEventName);
     for(int64_t i=0; i<stList_length(sequences); i++) {
         Sequence *sequence = stList_get(sequences, i);
         if(!metaSequence_isTrivialSequence(sequence_getMetaSequence(sequence))) {
-            char *string = sequence_getString(sequence, sequence_getStart(sequence),
-                    sequence_getLength(sequence), 1);
-            const char *header = sequence_getHeader(sequence);
-            fastaWrite(string, (char *)header, fileHandle);
-            //fprintf(fileHandle, ">%s\n%s\n", (char *)header, string);
-            free(string);
+            writeFastaSequence(sequence, fileHandle);
         }
     }
     stList_destruct(sequences);
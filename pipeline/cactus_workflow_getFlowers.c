@@ -8,7 +8,7 @@
 
 int main(int argc, char *argv[]) {
     parseArgs(argc, argv);
-    FlowerStream *flowerStream = flowerWriter_getFlowerStream(cactusDisk, stdin);
+    FlowerStream *flowerStream = flowerWriter_getPrefetchingFlowerStream(cactusDisk, stdin, 0, 0);
     Flower *flower;
     while ((flower = flowerStream_getNext(flowerStream)) != NULL) {
         if(!flower_isLeaf(flower)) {
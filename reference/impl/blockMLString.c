@@ -169,14 +169,14 @@ double *getEmptyBaseProbsString(int64_t length) {
     return baseProbs;
 }
 
-double *getBaseProbsString(char *string, int64_t length) {
+double *getBaseProbsString(StringView *stringView, int64_t length) {
     /*
      * Gets an array of base probs, as described in getMaxLikelihoodString, representing
      * the input string.
      */
     double *baseProbs = st_calloc(length * 4, sizeof(double)); //Gets the initial array initialised to 0.0 values
     for (int64_t i = 0; i < length; i++) {
-        switch (toupper(string[i])) {
+        switch (toupper((unsigned char) stringView_getBase(stringView, i))) {
         case 'A':
             assert(baseProbs[i * 4] == 0.0);
             baseProbs[i * 4] = 1.0;
@@ -260,13 +260,15 @@ void maskAncestralRepeatBases(Block *block, char *mlString) {
     while ((segment = block_getNext(segmentIt)) != NULL) {
         if (segment_getSequence(segment) != NULL) {
             numSegmentsWithSequence++;
-            char *string = segment_getString(segment);
+            StringView stringView;
+            segment_getStringView(segment, &stringView);
             for (int64_t i = 0; i < block_getLength(block); i++) {
-                char uC = toupper(string[i]);
-                upperCounts[i] += uC == string[i] ? 1 : 0;
+                char c = stringView_getBase(&stringView, i);
+                char uC = toupper(c);
+                upperCounts[i] += uC == c ? 1 : 0;
                 nCounts[i] += (uC != 'A' && uC != 'C' && uC != 'G' && uC != 'T' ? 1 : 0);
             }
-            free(string);
+            stringView_release(&stringView);
         }
     }
     block_destructInstanceIterator(segmentIt);
@@ -286,22 +288,26 @@ void maskAncestralRepeatBases(Block *block, char *mlString) {
     free(nCounts);
 }
 
-static stHash *hashEventsToSegmentStrings(Block *block) {
+static stHash *hashEventsToSegmentStrings(Block *block, StringView *stringViews, int64_t *stringViewNumber) {
     /*
-     * Returns a hash of events to the strings of segments with a given event.
-     * The strings are stored in a list.
+     * Returns a hash of events to views of the strings of segments with a given event.
+     * The views are filled in to the given array, which must have space for one per segment, and
+     * stored in a list.
      */
     stHash *eventsToStrings = stHash_construct2(NULL, (void (*)(void *)) stList_destruct);
     Block_InstanceIterator *segmentIt = block_getInstanceIterator(block);
     Segment *segment;
+    *stringViewNumber = 0;
     while ((segment = block_getNext(segmentIt)) != NULL) {
         if (segment_getSequence(segment) != NULL) {
             stList *strings = stHash_search(eventsToStrings, segment_getEvent(segment));
             if (strings == NULL) {
-                strings = stList_construct3(0, free);
+                strings = stList_construct();
                 stHash_insert(eventsToStrings, segment_getEvent(segment), strings);
             }
-            stList_append(strings, segment_getString(segment));
+            StringView *stringView = &stringViews[(*stringViewNumber)++];
+            segment_getStringView(segment, stringView);
+            stList_append(strings, stringView);
         }
     }
     block_destructInstanceIterator(segmentIt);
@@ -323,12 +329,18 @@ char *getMaximumLikelihoodString(stTree *tree, Block *block) {
         memset(mlString, 'N', block_getLength(block));
         mlString[block_getLength(block)] = '\0';
     } else {
-        stHash *eventsToStrings = hashEventsToSegmentStrings(block);
+        StringView *stringViews = st_malloc(sizeof(StringView) * block_getInstanceNumber(block));
+        int64_t stringViewNumber;
+        stHash *eventsToStrings = hashEventsToSegmentStrings(block, stringViews, &stringViewNumber);
         double *baseProbs = computeBaseProbs(tree, eventsToStrings, block_getLength(block));
         mlString = getMaxLikelihoodString(baseProbs, block_getLength(block));
         //Cleanup
         free(baseProbs);
         stHash_destruct(eventsToStrings);
+        for (int64_t i = 0; i < stringViewNumber; i++) {
+            stringView_release(&stringViews[i]);
+        }
+        free(stringViews);
     }
     maskAncestralRepeatBases(block, mlString);
     return mlString;
@@ -800,7 +800,10 @@ def runBarForJob(self, fileStore=None, features=None, calculateWhichEndsToComput
                  ingroupCoverageFile=self.cactusWorkflowArguments.ingroupCoverageID if self.getOptionalPhaseAttrib("rescue", bool) else None,
                  minimumSizeToRescue=self.getOptionalPhaseAttrib("minimumSizeToRescue"),
                  minimumCoverageToRescue=self.getOptionalPhaseAttrib("minimumCoverageToRescue"),
-                 minimumNumberOfSpecies=self.getOptionalPhaseAttrib("minimumNumberOfSpecies", int))
+                 minimumNumberOfSpecies=self.getOptionalPhaseAttrib("minimumNumberOfSpecies", int),
+                 numThreads=self.getOptionalPhaseAttrib("numThreads", int),
+                 adaptiveEndAlignments=self.getOptionalPhaseAttrib("adaptiveEndAlignments", bool),
+                 adaptiveFullCostDivergence=self.getOptionalPhaseAttrib("adaptiveFullCostDivergence", float))
 
 class CactusBarWrapper(CactusRecursionJob):
     """Runs the BAR algorithm implementation.
@@ -444,6 +444,9 @@ def runCactusBar(cactusDiskDatabaseString, flowerNames, logLevel=None,
                  minimumSizeToRescue=None,
                  minimumCoverageToRescue=None,
                  minimumNumberOfSpecies=None,
+                 numThreads=None,
+                 adaptiveEndAlignments=False,
+                 adaptiveFullCostDivergence=None,
                  jobName=None,
                  fileStore=None,
                  features=None):
@@ -499,6 +502,12 @@ def runCactusBar(cactusDiskDatabaseString, flowerNames, logLevel=None,
         args += ["--minimumCoverageToRescue", str(minimumCoverageToRescue)]
     if minimumNumberOfSpecies is not None:
         args += ["--minimumNumberOfSpecies", str(minimumNumberOfSpecies)]
+    if numThreads is not None:
+        args += ["--numThreads", str(numThreads)]
+    if adaptiveEndAlignments:
+        args += ["--adaptiveEndAlignments"]
+    if adaptiveFullCostDivergence is not None:
+        args += ["--adaptiveFullCostDivergence", str(adaptiveFullCostDivergence)]
 
     masterMessages = cactus_call(stdin_string=flowerNames, check_output=True,
                                  parameters=["cactus_bar"] + args,